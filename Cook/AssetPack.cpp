@@ -0,0 +1,317 @@
+#include "AssetPack.hpp"
+#include "CpuProfiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// Compression libraries are optional. Define ASSET_PACK_WITH_LZ4 / ASSET_PACK_WITH_ZSTD, and link liblz4 / libzstd,
+// to read and write compressed entries; without them looking up a compressed entry fails
+#if defined(ASSET_PACK_WITH_LZ4) && __has_include(<lz4.h>)
+#include <lz4.h>
+#define ASSET_PACK_LZ4 1
+#endif
+#if defined(ASSET_PACK_WITH_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define ASSET_PACK_ZSTD 1
+#endif
+
+static const char     PACK_MAGIC[8]        = { 'C', 'O', 'O', 'K', 'P', 'A', 'C', 'K' };
+static const uint32_t PACK_VERSION         = 1;
+static const uint64_t ASSET_PACK_ALIGNMENT = 64;     // Entry data starts on a cache line, SPIR-V needs 4 at least
+
+struct PackHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t tocOffset;          // entryCount PackTocEntry, then the names
+    uint64_t namesSize;
+};
+
+struct PackTocEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    uint64_t uncompressedSize;
+    uint32_t compression;
+    uint32_t nameOffset;         // Into the names following the table of contents
+    uint32_t nameLength;
+    uint32_t padding;
+};
+
+static bool compress(AssetCompression compression, const std::vector<char>& data, std::vector<char>* compressed)
+{
+    switch (compression)
+    {
+#ifdef ASSET_PACK_LZ4
+        case ASSET_COMPRESSION_LZ4:
+        {
+            compressed->resize(LZ4_compressBound(static_cast<int>(data.size())));
+            int size = LZ4_compress_default(data.data(), compressed->data(), static_cast<int>(data.size()), static_cast<int>(compressed->size()));
+            compressed->resize(size);
+            return size > 0;
+        }
+#endif
+#ifdef ASSET_PACK_ZSTD
+        case ASSET_COMPRESSION_ZSTD:
+        {
+            compressed->resize(ZSTD_compressBound(data.size()));
+            size_t size = ZSTD_compress(compressed->data(), compressed->size(), data.data(), data.size(), 19);
+            if (ZSTD_isError(size))
+            {
+                return false;
+            }
+            compressed->resize(size);
+            return true;
+        }
+#endif
+        default:
+            (void)data;
+            (void)compressed;
+            return false;
+    }
+}
+
+static bool decompress(AssetCompression compression, const char* data, uint64_t size, std::vector<char>* decompressed)
+{
+    switch (compression)
+    {
+#ifdef ASSET_PACK_LZ4
+        case ASSET_COMPRESSION_LZ4:
+            return LZ4_decompress_safe(data, decompressed->data(), static_cast<int>(size), static_cast<int>(decompressed->size()))
+                   == static_cast<int>(decompressed->size());
+#endif
+#ifdef ASSET_PACK_ZSTD
+        case ASSET_COMPRESSION_ZSTD:
+            return ZSTD_decompress(decompressed->data(), decompressed->size(), data, size) == decompressed->size();
+#endif
+        default:
+            (void)data;
+            (void)size;
+            (void)decompressed;
+            return false;
+    }
+}
+
+AssetPack::AssetPack()
+{
+    _mapping     = nullptr;
+    _mappingSize = 0;
+}
+
+bool AssetPack::open(const std::string& filePath)
+{
+    CPU_PROFILE_SCOPE("AssetPack::open");
+
+    close();
+
+    // Whole file mapped read only, pages come in as entries are touched
+    if (!_file.open(filePath))
+    {
+        return false;
+    }
+    _mapping     = _file.getData().data();
+    _mappingSize = _file.getData().size();
+    if (_mappingSize < sizeof(PackHeader))
+    {
+        printf("Asset pack %s is too small to be a pack\n", filePath.c_str());
+        close();
+        return false;
+    }
+
+    // Everything the table of contents points at has to be inside the file, a truncated pack is rejected here
+    const PackHeader* header = reinterpret_cast<const PackHeader*>(_mapping);
+    uint64_t          tocSize = static_cast<uint64_t>(header->entryCount) * sizeof(PackTocEntry);
+    if (memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header->version != PACK_VERSION
+        || header->tocOffset > _mappingSize || tocSize > _mappingSize - header->tocOffset
+        || header->namesSize > _mappingSize - header->tocOffset - tocSize)
+    {
+        printf("Asset pack %s is corrupt or from another version\n", filePath.c_str());
+        close();
+        return false;
+    }
+
+    // Copied out, packs written before the table of contents was aligned have it at any offset
+    const char* tocEntries = _mapping + header->tocOffset;
+    const char* names      = _mapping + header->tocOffset + tocSize;
+    _entries.reserve(header->entryCount);
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        PackTocEntry tocEntry;
+        memcpy(&tocEntry, tocEntries + i * sizeof(PackTocEntry), sizeof(PackTocEntry));
+        if (tocEntry.offset > _mappingSize || tocEntry.size > _mappingSize - tocEntry.offset
+            || static_cast<uint64_t>(tocEntry.nameOffset) + tocEntry.nameLength > header->namesSize)
+        {
+            printf("Asset pack %s is corrupt\n", filePath.c_str());
+            close();
+            return false;
+        }
+
+        Entry entry            = {};
+        entry.offset           = tocEntry.offset;
+        entry.size             = tocEntry.size;
+        entry.uncompressedSize = tocEntry.uncompressedSize;
+        entry.compression      = static_cast<AssetCompression>(tocEntry.compression);
+        _entries[std::string_view(names + tocEntry.nameOffset, tocEntry.nameLength)] = entry;
+    }
+
+    return true;
+}
+
+bool AssetPack::isOpen()
+{
+    return _mapping != nullptr;
+}
+
+std::span<const char> AssetPack::find(std::string_view name)
+{
+    auto found = _entries.find(name);
+    if (found == _entries.end())
+    {
+        return {};
+    }
+
+    const Entry& entry = found->second;
+    if (entry.compression == ASSET_COMPRESSION_NONE)
+    {
+        return std::span<const char>(_mapping + entry.offset, entry.size);
+    }
+
+    // Decompressed once, and kept so the span stays valid like the mapped ones
+    std::lock_guard<std::mutex> lock(_decompressedMutex);
+    auto decompressed = _decompressed.find(found->first);
+    if (decompressed == _decompressed.end())
+    {
+        std::vector<char> data(entry.uncompressedSize);
+        if (!decompress(entry.compression, _mapping + entry.offset, entry.size, &data))
+        {
+            printf("Failed to decompress %.*s from the asset pack%s\n", static_cast<int>(name.size()), name.data(),
+                   isCompressionSupported(entry.compression) ? "" : ", built without its compression library");
+            return {};
+        }
+        decompressed = _decompressed.emplace(found->first, std::move(data)).first;
+    }
+    return std::span<const char>(decompressed->second.data(), decompressed->second.size());
+}
+
+size_t AssetPack::getEntryCount()
+{
+    return _entries.size();
+}
+
+void AssetPack::close()
+{
+    _decompressed.clear();
+    _entries.clear();
+    _file.close();
+    _mapping     = nullptr;
+    _mappingSize = 0;
+}
+
+bool AssetPack::write(const std::string& filePath, const std::vector<AssetPackSource>& sources)
+{
+    std::ofstream pack(filePath, std::ios::binary);
+    if (!pack.is_open())
+    {
+        printf("Failed to create asset pack %s\n", filePath.c_str());
+        return false;
+    }
+
+    // Header is written again at the end, once the table of contents offset is known
+    PackHeader header = {};
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version    = PACK_VERSION;
+    header.entryCount = static_cast<uint32_t>(sources.size());
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<PackTocEntry> tocEntries;
+    std::string               names;
+    uint64_t                  offset = sizeof(header);
+    for (const AssetPackSource& source : sources)
+    {
+        std::ifstream file(source.filePath, std::ios::binary);
+        if (!file.is_open())
+        {
+            printf("Failed to open %s for the asset pack\n", source.filePath.c_str());
+            return false;
+        }
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        // Entries that don't get smaller are stored as they are, already compressed images usually don't
+        PackTocEntry tocEntry     = {};
+        tocEntry.uncompressedSize = data.size();
+        tocEntry.compression      = ASSET_COMPRESSION_NONE;
+        std::vector<char> compressed;
+        if (source.compression != ASSET_COMPRESSION_NONE)
+        {
+            if (!compress(source.compression, data, &compressed))
+            {
+                printf("Can't compress %s, %s\n", source.name.c_str(), isCompressionSupported(source.compression)
+                       ? "compression failed" : "built without its compression library");
+            }
+            else if (compressed.size() < data.size())
+            {
+                tocEntry.compression = source.compression;
+            }
+        }
+        const std::vector<char>& stored = tocEntry.compression == ASSET_COMPRESSION_NONE ? data : compressed;
+
+        uint64_t alignedOffset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+        std::vector<char> padding(alignedOffset - offset, 0);
+        pack.write(padding.data(), padding.size());
+        pack.write(stored.data(), stored.size());
+
+        tocEntry.offset     = alignedOffset;
+        tocEntry.size       = stored.size();
+        tocEntry.nameOffset = static_cast<uint32_t>(names.size());
+        tocEntry.nameLength = static_cast<uint32_t>(source.name.size());
+        tocEntries.push_back(tocEntry);
+        names += source.name;
+        offset = alignedOffset + stored.size();
+    }
+
+    // Table of contents aligned too, so it can be read in place
+    uint64_t tocOffset = (offset + alignof(PackTocEntry) - 1) / alignof(PackTocEntry) * alignof(PackTocEntry);
+    std::vector<char> tocPadding(tocOffset - offset, 0);
+    pack.write(tocPadding.data(), tocPadding.size());
+
+    header.tocOffset = tocOffset;
+    header.namesSize = names.size();
+    pack.write(reinterpret_cast<const char*>(tocEntries.data()), tocEntries.size() * sizeof(PackTocEntry));
+    pack.write(names.data(), names.size());
+    pack.seekp(0);
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (!pack.good())
+    {
+        printf("Failed to write asset pack %s\n", filePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::isCompressionSupported(AssetCompression compression)
+{
+    switch (compression)
+    {
+        case ASSET_COMPRESSION_NONE:
+            return true;
+#ifdef ASSET_PACK_LZ4
+        case ASSET_COMPRESSION_LZ4:
+            return true;
+#endif
+#ifdef ASSET_PACK_ZSTD
+        case ASSET_COMPRESSION_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+AssetPack::~AssetPack()
+{
+    close();
+}
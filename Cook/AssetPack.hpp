@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+// How an entry's bytes are stored in the pack
+enum AssetCompression : uint32_t
+{
+    ASSET_COMPRESSION_NONE = 0,
+    ASSET_COMPRESSION_LZ4,
+    ASSET_COMPRESSION_ZSTD
+};
+
+// File to put in a pack, under name, when writing one
+struct AssetPackSource
+{
+    std::string      name;            // What find looks it up by, e.g. "Textures/panda.jpg"
+    std::string      filePath;
+    AssetCompression compression;
+};
+
+// Read only archive of every asset, memory mapped once on open. Layout:
+//   header | entry data, each entry ASSET_PACK_ALIGNMENT aligned | table of contents | entry names
+// Uncompressed entries are returned as spans straight into the mapping, so reading them is a lookup and no copy.
+// Compressed entries (LZ4 or Zstd, when built with them) are decompressed on their first lookup and kept until close.
+class AssetPack
+{
+    public:
+        AssetPack();
+
+        bool                  open(const std::string& filePath);
+        bool                  isOpen();
+        std::span<const char> find(std::string_view name);      // Empty if the pack doesn't have it
+        size_t                getEntryCount();
+        void                  close();
+
+        static bool write(const std::string& filePath, const std::vector<AssetPackSource>& sources);
+        static bool isCompressionSupported(AssetCompression compression);
+
+        ~AssetPack();
+
+    private:
+        struct Entry
+        {
+            uint64_t         offset;
+            uint64_t         size;                // Bytes in the pack
+            uint64_t         uncompressedSize;
+            AssetCompression compression;
+        };
+
+        MappedFile                                                 _file;
+        const char*                                                _mapping;          // _file's data
+        size_t                                                     _mappingSize;
+        std::unordered_map<std::string_view, Entry>                _entries;          // Names point into the mapping
+        std::mutex                                                 _decompressedMutex;
+        std::unordered_map<std::string_view, std::vector<char>>    _decompressed;
+};
@@ -0,0 +1,506 @@
+#include "AsyncFileLoader.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// io_uring is used through its syscalls directly, so there is no liburing to link
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define ASYNC_FILE_IO_URING 1
+#endif
+
+static const size_t   ASYNC_FILE_ALIGNMENT = 4096;            // Buffers, offsets and lengths of direct reads
+static const uint32_t ASYNC_FILE_MAX_READ  = 1u << 30;        // Bigger files take more than one read
+
+enum RequestStage
+{
+    REQUEST_STAGE_OPEN = 0,
+    REQUEST_STAGE_STATX,
+    REQUEST_STAGE_READ
+};
+
+static size_t alignUp(size_t size)
+{
+    return (size + ASYNC_FILE_ALIGNMENT - 1) / ASYNC_FILE_ALIGNMENT * ASYNC_FILE_ALIGNMENT;
+}
+
+static bool allocateBuffer(AsyncFileData* file, size_t size)
+{
+    file->size   = size;
+    file->buffer = static_cast<char*>(aligned_alloc(ASYNC_FILE_ALIGNMENT, std::max(alignUp(size), ASYNC_FILE_ALIGNMENT)));
+    return file->buffer != nullptr;
+}
+
+AsyncFileData::~AsyncFileData()
+{
+    free(buffer);
+}
+
+AsyncFileLoader::AsyncFileLoader()
+{
+    _directIO              = false;
+    _queueDepth            = 0;
+    _pending               = 0;
+    _ringFd                = -1;
+    _submissionRing        = nullptr;
+    _submissionRingSize    = 0;
+    _completionRing        = nullptr;
+    _completionRingSize    = 0;
+    _submissionEntries     = nullptr;
+    _submissionEntriesSize = 0;
+    _submissionHead        = nullptr;
+    _submissionTail        = nullptr;
+    _submissionMask        = 0;
+    _submissionArray       = nullptr;
+    _completionHead        = nullptr;
+    _completionTail        = nullptr;
+    _completionMask        = 0;
+    _completions           = nullptr;
+    _inFlight              = 0;
+    _unsubmitted           = 0;
+    _stopping              = false;
+}
+
+void AsyncFileLoader::init(uint32_t queueDepth, uint32_t fallbackThreadCount, bool directIO)
+{
+    _directIO   = directIO;
+    _queueDepth = queueDepth;
+    _stopping   = false;
+
+    if (initIoUring(queueDepth))
+    {
+        return;
+    }
+
+    printf("io_uring unavailable, reading files with %u threads\n", fallbackThreadCount);
+    for (uint32_t i = 0; i < std::max(fallbackThreadCount, 1u); i++)
+    {
+        _threads.emplace_back(&AsyncFileLoader::threadLoop, this);
+    }
+}
+
+void AsyncFileLoader::read(const std::string& filePath, AsyncFileCallback callback)
+{
+    std::unique_ptr<Request> request = std::make_unique<Request>();
+    request->file           = std::make_shared<AsyncFileData>();
+    request->file->filePath = filePath;
+    request->callback       = std::move(callback);
+    request->fileDescriptor = -1;
+    request->bytesRead      = 0;
+    request->directIO       = _directIO;
+    request->stage          = REQUEST_STAGE_OPEN;
+    _pending++;
+
+    // Only queued here, poll hands it over so a batch of reads goes in together
+    std::lock_guard<std::mutex> lock(_mutex);
+    _queued.push_back(std::move(request));
+    if (!_threads.empty())
+    {
+        _workAvailable.notify_one();
+    }
+}
+
+uint32_t AsyncFileLoader::poll()
+{
+    if (isUsingIoUring())
+    {
+        // Start as many queued files as there is room for, then collect whatever has finished
+        while (!_queued.empty() && _inFlight < _queueDepth)
+        {
+            pushIoUring(_queued.front().release());
+            _queued.pop_front();
+            _inFlight++;
+        }
+        submitIoUring(0);
+        return reapIoUring();
+    }
+
+    std::deque<std::unique_ptr<Request>> completed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        completed.swap(_completed);
+    }
+    for (std::unique_ptr<Request>& request : completed)
+    {
+        finishRequest(request.release());
+    }
+    return static_cast<uint32_t>(completed.size());
+}
+
+void AsyncFileLoader::waitAll()
+{
+    CPU_PROFILE_SCOPE("AsyncFileLoader::waitAll");
+
+    while (_pending > 0)
+    {
+        if (poll() > 0)
+        {
+            continue;
+        }
+
+        // Nothing finished yet, sleep until something does
+        if (isUsingIoUring())
+        {
+            submitIoUring(1);
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _workDone.wait(lock, [this]() { return !_completed.empty(); });
+        }
+    }
+}
+
+uint32_t AsyncFileLoader::getPendingCount()
+{
+    return _pending;
+}
+
+bool AsyncFileLoader::isUsingIoUring()
+{
+    return _ringFd >= 0;
+}
+
+void AsyncFileLoader::shutdown()
+{
+    // Nothing may still be writing into a buffer when it goes away
+    waitAll();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (std::thread& thread : _threads)
+    {
+        thread.join();
+    }
+    _threads.clear();
+
+    destroyIoUring();
+}
+
+void AsyncFileLoader::finishRequest(Request* request)
+{
+    std::unique_ptr<Request> finished(request);
+    if (finished->fileDescriptor >= 0)
+    {
+        close(finished->fileDescriptor);
+    }
+    if (!finished->file->succeeded)
+    {
+        printf("Failed to read %s\n", finished->file->filePath.c_str());
+    }
+
+    _pending--;
+    finished->callback(finished->file);
+}
+
+bool AsyncFileLoader::initIoUring(uint32_t queueDepth)
+{
+#ifdef ASYNC_FILE_IO_URING
+    io_uring_params params = {};
+    int ringFd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+    if (ringFd < 0)
+    {
+        return false;
+    }
+
+    // Opening and statx through the ring came in with 5.6, fast poll the release after, so it stands in for a version check
+    if (!(params.features & IORING_FEAT_FAST_POLL))
+    {
+        close(ringFd);
+        return false;
+    }
+
+    _ringFd             = ringFd;
+    _queueDepth         = params.sq_entries;
+    _submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    _completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    _submissionRing     = mmap(nullptr, _submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    _completionRing     = mmap(nullptr, _completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+    _submissionEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _submissionEntries  = mmap(nullptr, _submissionEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+    if (_submissionRing == MAP_FAILED || _completionRing == MAP_FAILED || _submissionEntries == MAP_FAILED)
+    {
+        destroyIoUring();
+        return false;
+    }
+
+    char* submissionRing = static_cast<char*>(_submissionRing);
+    char* completionRing = static_cast<char*>(_completionRing);
+    _submissionHead  = reinterpret_cast<uint32_t*>(submissionRing + params.sq_off.head);
+    _submissionTail  = reinterpret_cast<uint32_t*>(submissionRing + params.sq_off.tail);
+    _submissionMask  = *reinterpret_cast<uint32_t*>(submissionRing + params.sq_off.ring_mask);
+    _submissionArray = reinterpret_cast<uint32_t*>(submissionRing + params.sq_off.array);
+    _completionHead  = reinterpret_cast<uint32_t*>(completionRing + params.cq_off.head);
+    _completionTail  = reinterpret_cast<uint32_t*>(completionRing + params.cq_off.tail);
+    _completionMask  = *reinterpret_cast<uint32_t*>(completionRing + params.cq_off.ring_mask);
+    _completions     = completionRing + params.cq_off.cqes;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AsyncFileLoader::destroyIoUring()
+{
+#ifdef ASYNC_FILE_IO_URING
+    if (_submissionEntries && _submissionEntries != MAP_FAILED)
+    {
+        munmap(_submissionEntries, _submissionEntriesSize);
+    }
+    if (_completionRing && _completionRing != MAP_FAILED)
+    {
+        munmap(_completionRing, _completionRingSize);
+    }
+    if (_submissionRing && _submissionRing != MAP_FAILED)
+    {
+        munmap(_submissionRing, _submissionRingSize);
+    }
+    if (_ringFd >= 0)
+    {
+        close(_ringFd);
+    }
+#endif
+    _submissionEntries = nullptr;
+    _completionRing    = nullptr;
+    _submissionRing    = nullptr;
+    _ringFd            = -1;
+}
+
+// Queues the operation for the request's current stage. Each request has at most one in flight, and no more than
+// the submission queue's size are in flight, so there is always a free entry
+void AsyncFileLoader::pushIoUring(Request* request)
+{
+#ifdef ASYNC_FILE_IO_URING
+    uint32_t      tail  = *_submissionTail;
+    uint32_t      index = tail & _submissionMask;
+    io_uring_sqe* entry = static_cast<io_uring_sqe*>(_submissionEntries) + index;
+    memset(entry, 0, sizeof(io_uring_sqe));
+    entry->user_data = reinterpret_cast<uint64_t>(request);
+
+    switch (request->stage)
+    {
+        case REQUEST_STAGE_OPEN:
+            entry->opcode     = IORING_OP_OPENAT;
+            entry->fd         = AT_FDCWD;
+            entry->addr       = reinterpret_cast<uint64_t>(request->file->filePath.c_str());
+            entry->open_flags = O_RDONLY | O_CLOEXEC | (request->directIO ? O_DIRECT : 0);
+            break;
+        case REQUEST_STAGE_STATX:
+            static_assert(sizeof(struct statx) <= sizeof(Request::statxBuffer), "statx buffer too small");
+            entry->opcode      = IORING_OP_STATX;
+            entry->fd          = request->fileDescriptor;
+            entry->addr        = reinterpret_cast<uint64_t>("");
+            entry->len         = STATX_SIZE;
+            entry->addr2       = reinterpret_cast<uint64_t>(request->statxBuffer);
+            entry->statx_flags = AT_EMPTY_PATH;
+            break;
+        case REQUEST_STAGE_READ:
+            entry->opcode = IORING_OP_READ;
+            entry->fd     = request->fileDescriptor;
+            entry->addr   = reinterpret_cast<uint64_t>(request->file->buffer + request->bytesRead);
+            entry->len    = static_cast<uint32_t>(std::min<size_t>(alignUp(request->file->size) - request->bytesRead, ASYNC_FILE_MAX_READ));
+            entry->off    = request->bytesRead;
+            break;
+    }
+
+    _submissionArray[index] = index;
+    __atomic_store_n(_submissionTail, tail + 1, __ATOMIC_RELEASE);
+    _unsubmitted++;
+#endif
+}
+
+// Hands the queued operations to the kernel, and with minComplete waits for that many to finish
+void AsyncFileLoader::submitIoUring(uint32_t minComplete)
+{
+#ifdef ASYNC_FILE_IO_URING
+    if (_unsubmitted == 0 && minComplete == 0)
+    {
+        return;
+    }
+
+    int result;
+    do
+    {
+        result = static_cast<int>(syscall(__NR_io_uring_enter, _ringFd, _unsubmitted, minComplete,
+                                          minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0 && errno != EAGAIN && errno != EBUSY)
+    {
+        throw std::runtime_error("Failed to submit file reads to io_uring!");
+    }
+    if (result > 0)
+    {
+        _unsubmitted -= static_cast<uint32_t>(result);
+    }
+#endif
+}
+
+// Moves every finished operation's request on to its next stage, or to its callback once it has been read
+uint32_t AsyncFileLoader::reapIoUring()
+{
+    uint32_t finished = 0;
+#ifdef ASYNC_FILE_IO_URING
+    uint32_t head = *_completionHead;
+    uint32_t tail = __atomic_load_n(_completionTail, __ATOMIC_ACQUIRE);
+    std::vector<Request*> done;
+    while (head != tail)
+    {
+        io_uring_cqe* completion = reinterpret_cast<io_uring_cqe*>(_completions) + (head & _completionMask);
+        Request*      request    = reinterpret_cast<Request*>(completion->user_data);
+        int           result     = completion->res;
+        head++;
+
+        bool failed = result < 0;
+        switch (request->stage)
+        {
+            case REQUEST_STAGE_OPEN:
+                // Filesystems without direct I/O refuse the open, those files are read through the page cache
+                if (result == -EINVAL && request->directIO)
+                {
+                    request->directIO = false;
+                    pushIoUring(request);
+                    continue;
+                }
+                if (!failed)
+                {
+                    request->fileDescriptor = result;
+                    request->stage          = REQUEST_STAGE_STATX;
+                    pushIoUring(request);
+                    continue;
+                }
+                break;
+            case REQUEST_STAGE_STATX:
+                if (!failed)
+                {
+                    const struct statx* fileStat = reinterpret_cast<const struct statx*>(request->statxBuffer);
+                    failed = !allocateBuffer(request->file.get(), static_cast<size_t>(fileStat->stx_size));
+                    if (!failed && request->file->size > 0)
+                    {
+                        request->stage = REQUEST_STAGE_READ;
+                        pushIoUring(request);
+                        continue;
+                    }
+                }
+                break;
+            case REQUEST_STAGE_READ:
+                // Short reads carry on from where they stopped, until the file has all been read
+                if (result > 0)
+                {
+                    request->bytesRead += static_cast<size_t>(result);
+                    if (request->bytesRead < request->file->size)
+                    {
+                        pushIoUring(request);
+                        continue;
+                    }
+                }
+                failed = request->bytesRead < request->file->size;
+                break;
+        }
+
+        request->file->succeeded = !failed;
+        done.push_back(request);
+    }
+    __atomic_store_n(_completionHead, head, __ATOMIC_RELEASE);
+
+    // Next stages go in now, before callbacks that may take a while
+    submitIoUring(0);
+    for (Request* request : done)
+    {
+        _inFlight--;
+        finishRequest(request);
+    }
+    finished = static_cast<uint32_t>(done.size());
+#endif
+    return finished;
+}
+
+void AsyncFileLoader::threadLoop()
+{
+    while (true)
+    {
+        std::unique_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _workAvailable.wait(lock, [this]() { return _stopping || !_queued.empty(); });
+            if (_queued.empty())
+            {
+                return;
+            }
+            request = std::move(_queued.front());
+            _queued.pop_front();
+        }
+
+        readBlocking(request.get());
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _completed.push_back(std::move(request));
+        _workDone.notify_all();
+    }
+}
+
+void AsyncFileLoader::readBlocking(Request* request)
+{
+    CPU_PROFILE_SCOPE("AsyncFileLoader::readBlocking");
+
+    int flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_DIRECT
+    if (request->directIO)
+    {
+        request->fileDescriptor = open(request->file->filePath.c_str(), flags | O_DIRECT);
+    }
+#endif
+    if (request->fileDescriptor < 0)
+    {
+        request->fileDescriptor = open(request->file->filePath.c_str(), flags);
+#ifdef F_NOCACHE
+        if (request->fileDescriptor >= 0 && request->directIO)
+        {
+            fcntl(request->fileDescriptor, F_NOCACHE, 1);
+        }
+#endif
+    }
+
+    struct stat fileStat;
+    if (request->fileDescriptor < 0 || fstat(request->fileDescriptor, &fileStat) != 0
+        || !allocateBuffer(request->file.get(), static_cast<size_t>(fileStat.st_size)))
+    {
+        return;
+    }
+
+    while (request->bytesRead < request->file->size)
+    {
+        size_t  length = std::min<size_t>(alignUp(request->file->size) - request->bytesRead, ASYNC_FILE_MAX_READ);
+        ssize_t result = pread(request->fileDescriptor, request->file->buffer + request->bytesRead, length,
+                               static_cast<off_t>(request->bytesRead));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            return;
+        }
+        request->bytesRead += static_cast<size_t>(result);
+    }
+    request->file->succeeded = true;
+}
+
+AsyncFileLoader::~AsyncFileLoader()
+{
+}
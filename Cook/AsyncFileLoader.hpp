@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Contents of one file read by AsyncFileLoader. The buffer is page aligned and its length rounded up to a page,
+// as direct I/O needs, only the first size bytes are the file.
+struct AsyncFileData
+{
+    std::string filePath;
+    char*       buffer    = nullptr;
+    size_t      size      = 0;
+    bool        succeeded = false;
+
+    std::span<const char> data()
+    {
+        return std::span<const char>(buffer, size);
+    }
+
+    ~AsyncFileData();
+};
+
+// Called on the thread that calls poll or waitAll, once the file has been read (or failed to be).
+// Keep the shared pointer to hand the data on, to a decode job for instance, without copying it.
+using AsyncFileCallback = std::function<void(std::shared_ptr<AsyncFileData> file)>;
+
+// Reads whole files in the background, many at once, instead of one blocking read after another.
+//   - On Linux the reads go through io_uring: each file is an open, a statx for its size and its reads, all submitted
+//     to the kernel's queue, so up to queueDepth files are in flight with one syscall per batch rather than per file.
+//   - Elsewhere, or when io_uring can't be set up (old kernel, blocked by a sandbox), a few threads do the same with
+//     ordinary blocking calls.
+// With directIO the page cache is bypassed (O_DIRECT, F_NOCACHE on macOS), for assets that are read once and then
+// only live on the GPU. Files whose filesystem doesn't support it are read normally.
+// read, poll and waitAll are called from one thread, and completions are handed to the callbacks on it, never on a
+// loader thread, so callbacks can use the renderer freely and feed the job system the decode work.
+class AsyncFileLoader
+{
+    public:
+        AsyncFileLoader();
+
+        void     init(uint32_t queueDepth, uint32_t fallbackThreadCount, bool directIO);
+        void     read(const std::string& filePath, AsyncFileCallback callback);
+        uint32_t poll();                // Starts what is queued and runs the callbacks of finished reads, doesn't block
+        void     waitAll();             // Blocks until every read so far has finished and had its callback run
+        uint32_t getPendingCount();
+        bool     isUsingIoUring();
+        void     shutdown();
+
+        ~AsyncFileLoader();
+
+    private:
+        struct Request
+        {
+            std::shared_ptr<AsyncFileData> file;
+            AsyncFileCallback              callback;
+            int                            fileDescriptor;
+            size_t                         bytesRead;
+            bool                           directIO;
+            int                            stage;               // Which io_uring operation is in flight for it
+            alignas(8) char                statxBuffer[256];    // struct statx, kept opaque so this header stays portable
+        };
+
+        bool                                  _directIO;
+        uint32_t                              _queueDepth;
+        uint32_t                              _pending;           // Asked for but callback not run yet
+        std::mutex                            _mutex;             // Guards _queued and _completed, for the threads
+        std::deque<std::unique_ptr<Request>>  _queued;            // Not yet handed to io_uring or a thread
+        std::deque<std::unique_ptr<Request>>  _completed;         // Read by a thread, callback not run yet
+
+        // io_uring, when in use
+        int                                   _ringFd;
+        void*                                 _submissionRing;
+        size_t                                _submissionRingSize;
+        void*                                 _completionRing;
+        size_t                                _completionRingSize;
+        void*                                 _submissionEntries;
+        size_t                                _submissionEntriesSize;
+        uint32_t*                             _submissionHead;
+        uint32_t*                             _submissionTail;
+        uint32_t                              _submissionMask;
+        uint32_t*                             _submissionArray;
+        uint32_t*                             _completionHead;
+        uint32_t*                             _completionTail;
+        uint32_t                              _completionMask;
+        void*                                 _completions;
+        uint32_t                              _inFlight;          // Requests with an operation in the ring
+        uint32_t                              _unsubmitted;       // Operations queued since the last io_uring_enter
+
+        // Thread pool fallback
+        std::vector<std::thread>              _threads;
+        std::condition_variable               _workAvailable;
+        std::condition_variable               _workDone;
+        bool                                  _stopping;
+
+        bool     initIoUring(uint32_t queueDepth);
+        void     destroyIoUring();
+        void     pushIoUring(Request* request);
+        void     submitIoUring(uint32_t minComplete);
+        uint32_t reapIoUring();
+        void     threadLoop();
+        void     readBlocking(Request* request);
+        void     finishRequest(Request* request);
+};
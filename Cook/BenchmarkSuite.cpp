@@ -0,0 +1,301 @@
+#include "BenchmarkSuite.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+// Side length of the square the instances are spread over, centred in front of the camera
+static const float    GRID_SIZE              = 3.0f;
+static const uint32_t BENCHMARK_TEXTURE_SIZE = 64;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t getResidentBytes()
+{
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t taskInfo;
+    mach_msg_type_number_t      infoCount = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&taskInfo, &infoCount) == KERN_SUCCESS)
+    {
+        return taskInfo.resident_size;
+    }
+    return 0;
+#elif defined(__linux__)
+    // Second field is resident pages
+    unsigned long long totalPages    = 0;
+    unsigned long long residentPages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+    {
+        return 0;
+    }
+    if (fscanf(statm, "%llu %llu", &totalPages, &residentPages) != 2)
+    {
+        residentPages = 0;
+    }
+    fclose(statm);
+    return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+static BenchmarkTimings summarise(const std::vector<double>& samples)
+{
+    BenchmarkTimings timings;
+    if (samples.empty())
+    {
+        return timings;
+    }
+
+    double total = 0.0;
+    timings.min  = samples[0];
+    timings.max  = samples[0];
+    for (double sample : samples)
+    {
+        total      += sample;
+        timings.min = std::min(timings.min, sample);
+        timings.max = std::max(timings.max, sample);
+    }
+    timings.mean = total / samples.size();
+    return timings;
+}
+
+// Cheap integer hash, so generated colours are varied but the same every run
+static uint32_t hashIndex(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7feb352d;
+    value ^= value >> 15;
+    value *= 0x846ca68b;
+    value ^= value >> 16;
+    return value;
+}
+
+BenchmarkSuite::BenchmarkSuite(VulkanRenderer* renderer)
+{
+    _renderer = renderer;
+}
+
+std::vector<BenchmarkSceneDesc> BenchmarkSuite::getDefaultScenes()
+{
+    std::vector<BenchmarkSceneDesc> scenes;
+
+    // Draw call scaling, small meshes so the CPU side dominates
+    for (uint32_t instanceCount : { 1u, 100u, 10000u, 100000u, 1000000u })
+    {
+        scenes.push_back({ "instances_" + std::to_string(instanceCount), instanceCount, 16, 16, 128 });
+    }
+
+    // Texture (descriptor set) switching
+    for (uint32_t textureCount : { 1u, 16u, 256u })
+    {
+        scenes.push_back({ "textures_" + std::to_string(textureCount), 10000, 16, textureCount, 128 });
+    }
+
+    // Vertex and triangle throughput
+    for (uint32_t triangleCount : { 2u, 512u, 8192u, 65536u })
+    {
+        scenes.push_back({ "triangles_" + std::to_string(triangleCount), 1000, 4, 16, triangleCount });
+    }
+
+    return scenes;
+}
+
+BenchmarkResult BenchmarkSuite::runScene(const BenchmarkSceneDesc& scene, uint32_t warmUpFrames, uint32_t measuredFrames)
+{
+    BenchmarkResult result = {};
+    result.scene = scene;
+
+    auto setupStart = std::chrono::steady_clock::now();
+    result.trianglesPerMesh  = buildScene(scene, &result.sceneGpuBytes);
+    result.trianglesPerFrame = static_cast<uint64_t>(result.trianglesPerMesh) * scene.instanceCount;
+    result.setupMilliseconds = millisecondsSince(setupStart);
+
+    // Lets pipeline variants, caches and the GPU clocks settle
+    for (uint32_t i = 0; i < warmUpFrames; i++)
+    {
+        _renderer->draw();
+    }
+
+    std::vector<double> cpuSamples;
+    std::vector<double> gpuSamples;
+    uint64_t            lastGpuFrame = UINT64_MAX;
+    for (uint32_t i = 0; i < measuredFrames; i++)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        _renderer->draw();
+        cpuSamples.push_back(millisecondsSince(frameStart));
+
+        // GPU results arrive a couple of frames late, take each frame once
+        for (const GpuScopeTiming& timing : _renderer->getGpuTimings())
+        {
+            if (timing.name == "Frame" && timing.frameNumber != lastGpuFrame)
+            {
+                gpuSamples.push_back(timing.durationMilliseconds);
+                lastGpuFrame = timing.frameNumber;
+            }
+        }
+    }
+
+    result.cpuFrameMilliseconds = summarise(cpuSamples);
+    result.gpuFrameMilliseconds = summarise(gpuSamples);
+    result.drawCalls            = _renderer->getDrawCount();
+    result.deviceMemoryBytes    = MemoryTracker::getTotalBytes();
+    result.residentBytes        = getResidentBytes();
+
+    printf("  %-18s %8.3f ms cpu  %8.3f ms gpu  %8u draws  %12llu tris  setup %8.1f ms\n",
+           scene.name.c_str(), result.cpuFrameMilliseconds.mean, result.gpuFrameMilliseconds.mean, result.drawCalls,
+           static_cast<unsigned long long>(result.trianglesPerFrame), result.setupMilliseconds);
+
+    return result;
+}
+
+bool BenchmarkSuite::writeReport(const std::string& filePath, const std::vector<BenchmarkResult>& results, uint32_t measuredFrames)
+{
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    VkExtent2D extent = _renderer->getExtent();
+    fprintf(file, "{\n");
+    fprintf(file, "  \"device\": \"%s\",\n", _renderer->getDeviceName().c_str());
+    fprintf(file, "  \"width\": %u,\n  \"height\": %u,\n", extent.width, extent.height);
+    fprintf(file, "  \"measured_frames\": %u,\n", measuredFrames);
+    fprintf(file, "  \"scenes\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& result = results[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", result.scene.name.c_str());
+        fprintf(file, "      \"instances\": %u,\n", result.scene.instanceCount);
+        fprintf(file, "      \"unique_meshes\": %u,\n", result.scene.uniqueMeshCount);
+        fprintf(file, "      \"unique_textures\": %u,\n", result.scene.uniqueTextureCount);
+        fprintf(file, "      \"triangles_per_mesh\": %u,\n", result.trianglesPerMesh);
+        fprintf(file, "      \"triangles_per_frame\": %llu,\n", static_cast<unsigned long long>(result.trianglesPerFrame));
+        fprintf(file, "      \"draw_calls\": %u,\n", result.drawCalls);
+        fprintf(file, "      \"setup_ms\": %.3f,\n", result.setupMilliseconds);
+        fprintf(file, "      \"cpu_frame_ms\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f },\n",
+                result.cpuFrameMilliseconds.mean, result.cpuFrameMilliseconds.min, result.cpuFrameMilliseconds.max);
+        fprintf(file, "      \"gpu_frame_ms\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f },\n",
+                result.gpuFrameMilliseconds.mean, result.gpuFrameMilliseconds.min, result.gpuFrameMilliseconds.max);
+        fprintf(file, "      \"scene_gpu_bytes\": %llu,\n", static_cast<unsigned long long>(result.sceneGpuBytes));
+        fprintf(file, "      \"device_memory_bytes\": %llu,\n", static_cast<unsigned long long>(result.deviceMemoryBytes));
+        fprintf(file, "      \"resident_bytes\": %llu\n", static_cast<unsigned long long>(result.residentBytes));
+        fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+    return written;
+}
+
+BenchmarkSuite::~BenchmarkSuite()
+{
+}
+
+uint32_t BenchmarkSuite::buildScene(const BenchmarkSceneDesc& scene, uint64_t* sceneGpuBytes)
+{
+    _renderer->clearScene();
+    *sceneGpuBytes = 0;
+
+    uint32_t textureCount = std::max(scene.uniqueTextureCount, 1u);
+    uint32_t shapeCount   = std::max(scene.uniqueMeshCount, 1u);
+
+    // Checkerboard textures, two colours each
+    std::vector<int> textureIds;
+    for (uint32_t t = 0; t < textureCount; t++)
+    {
+        uint32_t colours[2] = { hashIndex(t * 2) | 0xff000000, hashIndex(t * 2 + 1) | 0xff000000 };
+
+        std::vector<uint8_t> pixels(BENCHMARK_TEXTURE_SIZE * BENCHMARK_TEXTURE_SIZE * 4);
+        for (uint32_t y = 0; y < BENCHMARK_TEXTURE_SIZE; y++)
+        {
+            for (uint32_t x = 0; x < BENCHMARK_TEXTURE_SIZE; x++)
+            {
+                uint32_t colour = colours[((x / 8) + (y / 8)) % 2];
+                uint8_t* pixel  = &pixels[(y * BENCHMARK_TEXTURE_SIZE + x) * 4];
+                pixel[0] = colour & 0xff;
+                pixel[1] = (colour >> 8) & 0xff;
+                pixel[2] = (colour >> 16) & 0xff;
+                pixel[3] = 0xff;
+            }
+        }
+
+        textureIds.push_back(_renderer->createTextureFromPixels(BENCHMARK_TEXTURE_SIZE, BENCHMARK_TEXTURE_SIZE, pixels));
+        *sceneGpuBytes += pixels.size();
+    }
+
+    // Each shape is a flat grid of cellsPerSide x cellsPerSide cells (two triangles each), bent by a per shape
+    // amount so the shapes really are different geometry
+    uint32_t cellsPerSide = std::max(1u, static_cast<uint32_t>(std::lround(std::sqrt(scene.trianglesPerMesh / 2.0))));
+    std::vector<std::vector<Vertex>>   shapeVertices(shapeCount);
+    std::vector<std::vector<uint32_t>> shapeIndices(shapeCount);
+    for (uint32_t shape = 0; shape < shapeCount; shape++)
+    {
+        float     bend   = 0.2f * shape / shapeCount;
+        uint32_t  hashed = hashIndex(shape);
+        glm::vec3 colour = glm::vec3((hashed & 0xff) / 255.0f, ((hashed >> 8) & 0xff) / 255.0f, ((hashed >> 16) & 0xff) / 255.0f);
+
+        for (uint32_t y = 0; y <= cellsPerSide; y++)
+        {
+            for (uint32_t x = 0; x <= cellsPerSide; x++)
+            {
+                float u = static_cast<float>(x) / cellsPerSide;
+                float v = static_cast<float>(y) / cellsPerSide;
+                float z = bend * std::sin(u * 3.14159f) * std::sin(v * 3.14159f);
+                shapeVertices[shape].push_back({ { u - 0.5f, v - 0.5f, z }, colour, { u, v } });
+            }
+        }
+
+        uint32_t rowLength = cellsPerSide + 1;
+        for (uint32_t y = 0; y < cellsPerSide; y++)
+        {
+            for (uint32_t x = 0; x < cellsPerSide; x++)
+            {
+                uint32_t corner = y * rowLength + x;
+                shapeIndices[shape].insert(shapeIndices[shape].end(), { corner, corner + 1, corner + rowLength + 1,
+                                                                        corner + rowLength + 1, corner + rowLength, corner });
+            }
+        }
+    }
+
+    // A mesh owns its texture, so there is one mesh per shape/texture pairing that gets used
+    uint32_t         meshCount = std::max(shapeCount, textureCount);
+    std::vector<int> meshIds;
+    for (uint32_t m = 0; m < meshCount; m++)
+    {
+        uint32_t shape = m % shapeCount;
+        meshIds.push_back(_renderer->addMesh(&shapeVertices[shape], &shapeIndices[shape], textureIds[m % textureCount]));
+        size_t indexSize = shapeVertices[shape].size() <= UINT16_INDEX_MAX_VERTICES ? sizeof(uint16_t) : sizeof(uint32_t);
+        *sceneGpuBytes  += shapeVertices[shape].size() * sizeof(Vertex) + shapeIndices[shape].size() * indexSize;
+    }
+
+    // Instances on a square grid, scaled down to fit as their number grows
+    uint32_t side    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(scene.instanceCount))));
+    float    spacing = GRID_SIZE / std::max(side, 1u);
+    for (uint32_t i = 0; i < scene.instanceCount; i++)
+    {
+        float x = ((i % side) + 0.5f) * spacing - GRID_SIZE / 2.0f;
+        float y = ((i / side) + 0.5f) * spacing - GRID_SIZE / 2.0f;
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, -2.0f));
+        transform           = glm::scale(transform, glm::vec3(spacing * 0.9f));
+        _renderer->addSceneNode(_renderer->getSceneRoot(), transform, meshIds[i % meshCount]);
+    }
+
+    return cellsPerSide * cellsPerSide * 2;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VulkanRenderer.hpp"
+
+// Procedurally generated scene: instanceCount scene nodes spread over a grid in front of the camera,
+// drawing meshes with uniqueMeshCount different shapes and uniqueTextureCount different textures
+struct BenchmarkSceneDesc
+{
+    std::string name;
+    uint32_t    instanceCount;
+    uint32_t    uniqueMeshCount;
+    uint32_t    uniqueTextureCount;
+    uint32_t    trianglesPerMesh;
+};
+
+struct BenchmarkTimings
+{
+    double mean = 0.0;
+    double min  = 0.0;
+    double max  = 0.0;
+};
+
+struct BenchmarkResult
+{
+    BenchmarkSceneDesc scene;
+    uint32_t           trianglesPerMesh;        // Actual count, generated grids round to whole cells
+    uint64_t           trianglesPerFrame;
+    uint32_t           drawCalls;               // Draws in the last measured frame (after culling)
+    double             setupMilliseconds;       // Generating and uploading the scene
+    BenchmarkTimings   cpuFrameMilliseconds;    // Time spent in VulkanRenderer::draw
+    BenchmarkTimings   gpuFrameMilliseconds;    // "Frame" scope of the GPU profiler, 0 if timestamps unsupported
+    uint64_t           sceneGpuBytes;           // Vertex, index and texture data uploaded for the scene
+    uint64_t           deviceMemoryBytes;       // All live device memory allocations, from MemoryTracker
+    uint64_t           residentBytes;           // Process resident memory after the run
+};
+
+// Runs a list of generated scenes for a fixed number of frames each, and writes the results as JSON
+// so runs can be compared against a baseline.
+class BenchmarkSuite
+{
+    public:
+        BenchmarkSuite(VulkanRenderer* renderer);
+
+        static std::vector<BenchmarkSceneDesc> getDefaultScenes();
+
+        BenchmarkResult runScene(const BenchmarkSceneDesc& scene, uint32_t warmUpFrames, uint32_t measuredFrames);
+        bool            writeReport(const std::string& filePath, const std::vector<BenchmarkResult>& results, uint32_t measuredFrames);
+
+        ~BenchmarkSuite();
+
+    private:
+        VulkanRenderer* _renderer;
+
+        uint32_t buildScene(const BenchmarkSceneDesc& scene, uint64_t* sceneGpuBytes);
+};
@@ -0,0 +1,98 @@
+#include "BufferUploadBatch.hpp"
+#include "Utilities.hpp"
+#include "CpuProfiler.hpp"
+
+#include <cstring>
+
+// Copies start on an offset every buffer usage is happy with
+static const VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+BufferUploadBatch::BufferUploadBatch()
+{
+    _physicalDevice      = VK_NULL_HANDLE;
+    _device              = VK_NULL_HANDLE;
+    _transferQueue       = VK_NULL_HANDLE;
+    _transferCommandPool = VK_NULL_HANDLE;
+    _pendingBytes        = 0;
+}
+
+void BufferUploadBatch::init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool)
+{
+    _physicalDevice      = physicalDevice;
+    _device              = device;
+    _transferQueue       = transferQueue;
+    _transferCommandPool = transferCommandPool;
+}
+
+void BufferUploadBatch::addUpload(VkBuffer dstBuffer, std::span<const char> data)
+{
+    if (data.empty())
+    {
+        return;
+    }
+    _uploads.push_back({ dstBuffer, data });
+    _pendingBytes = (_pendingBytes + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT + data.size();
+}
+
+void BufferUploadBatch::addUpload(VkBuffer dstBuffer, std::vector<char>&& data)
+{
+    // Moving the vector keeps its storage where it is, so the span stays valid however many more are added
+    _ownedData.push_back(std::move(data));
+    addUpload(dstBuffer, std::span<const char>(_ownedData.back().data(), _ownedData.back().size()));
+}
+
+void BufferUploadBatch::submit()
+{
+    CPU_PROFILE_SCOPE("BufferUploadBatch::submit");
+
+    if (_uploads.empty())
+    {
+        return;
+    }
+
+    // Everything is packed into one staging buffer, the copies are recorded as it is filled
+    VkBuffer       stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(_physicalDevice, _device, _pendingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
+
+    void* data;
+    vkMapMemory(_device, stagingBufferMemory, 0, _pendingBytes, 0, &data);
+
+    VkCommandBuffer transferCommandBuffer = beginCommandBuffer(_device, _transferCommandPool);
+    VkDeviceSize    offset                = 0;
+    for (const Upload& upload : _uploads)
+    {
+        offset = (offset + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+        memcpy(static_cast<char*>(data) + offset, upload.data.data(), upload.data.size());
+
+        VkBufferCopy bufferCopyRegion = {};
+        bufferCopyRegion.srcOffset    = offset;
+        bufferCopyRegion.dstOffset    = 0;
+        bufferCopyRegion.size         = upload.data.size();
+        vkCmdCopyBuffer(transferCommandBuffer, stagingBuffer, upload.dstBuffer, 1, &bufferCopyRegion);
+
+        offset += upload.data.size();
+    }
+    vkUnmapMemory(_device, stagingBufferMemory);
+
+    // Waits for the queue, so the staging buffer can go straight away
+    endAndSubmitCommandBuffer(_device, _transferCommandPool, _transferQueue, transferCommandBuffer);
+
+    vkDestroyBuffer(_device, stagingBuffer, nullptr);
+    MemoryTracker::freeMemory(_device, stagingBufferMemory);
+
+    _uploads.clear();
+    _ownedData.clear();
+    _pendingBytes = 0;
+}
+
+VkDeviceSize BufferUploadBatch::getPendingBytes()
+{
+    return _pendingBytes;
+}
+
+BufferUploadBatch::~BufferUploadBatch()
+{
+}
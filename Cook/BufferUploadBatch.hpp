@@ -0,0 +1,39 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <span>
+#include <vector>
+
+// Collects uploads into device local buffers and does them all together: one staging buffer, one command buffer
+// of copies and one wait, instead of a staging buffer, a submit and a queue wait for every buffer.
+// Data added is only read in submit, so it has to stay valid (and unchanged) until then.
+class BufferUploadBatch
+{
+    public:
+        BufferUploadBatch();
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool);
+        void addUpload(VkBuffer dstBuffer, std::span<const char> data);
+        void addUpload(VkBuffer dstBuffer, std::vector<char>&& data);     // Data made just for the upload, kept until submit
+        void submit();
+        VkDeviceSize getPendingBytes();
+
+        ~BufferUploadBatch();
+
+    private:
+        struct Upload
+        {
+            VkBuffer              dstBuffer;
+            std::span<const char> data;
+        };
+
+        VkPhysicalDevice               _physicalDevice;
+        VkDevice                       _device;
+        VkQueue                        _transferQueue;
+        VkCommandPool                  _transferCommandPool;
+        std::vector<Upload>            _uploads;
+        std::vector<std::vector<char>> _ownedData;
+        VkDeviceSize                   _pendingBytes;
+};
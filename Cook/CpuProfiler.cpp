@@ -0,0 +1,162 @@
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+// Every thread that has recorded an event. Buffers are kept after their thread exits so they can still be exported
+struct CpuProfileRegistry
+{
+    std::atomic<bool>                                    enabled{false};
+    std::mutex                                           mutex;
+    std::vector<std::unique_ptr<CpuProfileThreadEvents>> threads;
+};
+
+static CpuProfileRegistry& getRegistry()
+{
+    static CpuProfileRegistry registry;
+    return registry;
+}
+
+static thread_local CpuProfileThreadEvents* tlsThreadEvents = nullptr;
+
+// Names are usually literals, but quotes or backslashes would break the JSON
+static std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void CpuProfiler::setEnabled(bool enabled)
+{
+    getRegistry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::isEnabled()
+{
+    return getRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+void CpuProfiler::setThreadName(const std::string& threadName)
+{
+    CpuProfileThreadEvents* threadEvents = getThreadEvents();
+
+    std::lock_guard<std::mutex> lock(getRegistry().mutex);
+    threadEvents->threadName = threadName;
+}
+
+void CpuProfiler::record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds)
+{
+    CpuProfileThreadEvents* threadEvents = getThreadEvents();
+
+    // Ring is only allocated once the thread actually records something
+    if (threadEvents->events.empty())
+    {
+        threadEvents->events.resize(CpuProfileThreadEvents::CAPACITY);
+    }
+
+    // Single writer, so the slot can be filled in before the count is published
+    uint64_t written = threadEvents->written.load(std::memory_order_relaxed);
+    threadEvents->events[written & (CpuProfileThreadEvents::CAPACITY - 1)] = { name, startNanoseconds, endNanoseconds };
+    threadEvents->written.store(written + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::exportChromeTrace(const std::string& filePath)
+{
+    std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    CpuProfileRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Timestamps relative to the earliest event, in microseconds
+    uint64_t origin = UINT64_MAX;
+    for (auto& threadEvents : registry.threads)
+    {
+        uint64_t written = threadEvents->written.load(std::memory_order_acquire);
+        uint64_t first   = written > CpuProfileThreadEvents::CAPACITY ? written - CpuProfileThreadEvents::CAPACITY : 0;
+        if (first < written)
+        {
+            origin = std::min(origin, threadEvents->events[first & (CpuProfileThreadEvents::CAPACITY - 1)].startNanoseconds);
+        }
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool firstEntry = true;
+    char entry[512];
+    for (auto& threadEvents : registry.threads)
+    {
+        // Metadata event so the track is labelled with the thread's name
+        snprintf(entry, sizeof(entry), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                 firstEntry ? "" : ",\n", threadEvents->threadId, escapeJson(threadEvents->threadName).c_str());
+        file << entry;
+        firstEntry = false;
+
+        // Events still in the ring, oldest first. Threads that are still recording may overwrite the oldest ones
+        uint64_t written = threadEvents->written.load(std::memory_order_acquire);
+        uint64_t first   = written > CpuProfileThreadEvents::CAPACITY ? written - CpuProfileThreadEvents::CAPACITY : 0;
+        for (uint64_t i = first; i < written; i++)
+        {
+            const CpuProfileEvent& event = threadEvents->events[i & (CpuProfileThreadEvents::CAPACITY - 1)];
+            snprintf(entry, sizeof(entry), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                     escapeJson(event.name).c_str(), threadEvents->threadId,
+                     (event.startNanoseconds - origin) * 1e-3, (event.endNanoseconds - event.startNanoseconds) * 1e-3);
+            file << entry;
+        }
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+uint64_t CpuProfiler::nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CpuProfileThreadEvents* CpuProfiler::getThreadEvents()
+{
+    if (tlsThreadEvents)
+    {
+        return tlsThreadEvents;
+    }
+
+    // First use on this thread, register it
+    CpuProfileRegistry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto threadEvents = std::make_unique<CpuProfileThreadEvents>();
+    threadEvents->threadId   = static_cast<uint32_t>(registry.threads.size());
+    threadEvents->threadName = "thread " + std::to_string(threadEvents->threadId);
+
+    tlsThreadEvents = threadEvents.get();
+    registry.threads.push_back(std::move(threadEvents));
+    return tlsThreadEvents;
+}
+
+CpuProfileScope::CpuProfileScope(const char* name)
+{
+    _name             = name;
+    _startNanoseconds = CpuProfiler::isEnabled() ? CpuProfiler::nowNanoseconds() : 0;
+}
+
+CpuProfileScope::~CpuProfileScope()
+{
+    if (_startNanoseconds != 0)
+    {
+        CpuProfiler::record(_name, _startNanoseconds, CpuProfiler::nowNanoseconds());
+    }
+}
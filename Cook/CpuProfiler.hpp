@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One timed scope. Name must outlive the profiler (string literals)
+struct CpuProfileEvent
+{
+    const char* name;
+    uint64_t    startNanoseconds;   // steady_clock
+    uint64_t    endNanoseconds;
+};
+
+// Events recorded by one thread. Only the owning thread writes, so recording needs no locks,
+// when full the oldest events are overwritten
+struct CpuProfileThreadEvents
+{
+    static const uint64_t        CAPACITY = 65536;   // Must be a power of 2
+    uint32_t                     threadId;
+    std::string                  threadName;
+    std::vector<CpuProfileEvent> events;
+    std::atomic<uint64_t>        written{0};         // Events recorded since start, index of next slot is written % CAPACITY
+};
+
+// Collects timed scopes from every thread, and writes them out as a Chrome trace
+// (JSON, opens in chrome://tracing or ui.perfetto.dev).
+class CpuProfiler
+{
+    public:
+        static void     setEnabled(bool enabled);
+        static bool     isEnabled();
+        static void     setThreadName(const std::string& threadName);
+        static void     record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+        static bool     exportChromeTrace(const std::string& filePath);
+        static uint64_t nowNanoseconds();
+
+    private:
+        static CpuProfileThreadEvents* getThreadEvents();
+};
+
+// Times the enclosing block, records nothing if the profiler is disabled
+class CpuProfileScope
+{
+    public:
+        CpuProfileScope(const char* name);
+        ~CpuProfileScope();
+
+    private:
+        const char* _name;
+        uint64_t    _startNanoseconds;     // 0 when not recording
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b)       CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_SCOPE(name)        CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
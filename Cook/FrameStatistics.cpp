@@ -0,0 +1,191 @@
+#include "FrameStatistics.hpp"
+#include "Utilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Weight of the newest frame in the moving average hitches are measured against
+static const double AVERAGE_FRAME_WEIGHT = 0.05;
+
+static const char* const CHANNEL_NAMES[FRAME_TIME_CHANNEL_COUNT] = { "CPU frame", "Fence wait", "Acquire", "Present" };
+
+FrameHistogram::FrameHistogram()
+{
+    _counts.resize(SUB_BUCKET_COUNT + BUCKET_COUNT * SUB_BUCKET_HALF_COUNT);
+    _totalCount = 0;
+    _max        = 0;
+}
+
+void FrameHistogram::record(uint64_t microseconds)
+{
+    _counts[getIndex(microseconds)]++;
+    _totalCount++;
+    _max = std::max(_max, microseconds);
+}
+
+uint64_t FrameHistogram::getPercentile(double percentile)
+{
+    if (_totalCount == 0)
+    {
+        return 0;
+    }
+
+    // Smallest bucket that has at least percentile% of the values at or below it
+    uint64_t target     = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * _totalCount)));
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < _counts.size(); i++)
+    {
+        cumulative += _counts[i];
+        if (cumulative >= target)
+        {
+            return std::min(getUpperBound(i), _max);
+        }
+    }
+    return _max;
+}
+
+uint64_t FrameHistogram::getMax()
+{
+    return _max;
+}
+
+uint64_t FrameHistogram::getCount()
+{
+    return _totalCount;
+}
+
+void FrameHistogram::reset()
+{
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _totalCount = 0;
+    _max        = 0;
+}
+
+FrameHistogram::~FrameHistogram()
+{
+}
+
+uint32_t FrameHistogram::getIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<uint32_t>(value);
+    }
+
+    // Values past the last bucket are counted in it, _max still holds the real value
+    uint64_t largestValue = (static_cast<uint64_t>(SUB_BUCKET_COUNT) << BUCKET_COUNT) - 1;
+    value = std::min(value, largestValue);
+
+    // Shift so the value fits in the upper half of the sub-buckets, the shift picks the bucket
+    uint32_t highestBit = 63 - __builtin_clzll(value);
+    uint32_t bucket     = highestBit - SUB_BUCKET_BITS + 1;
+    uint32_t subBucket  = static_cast<uint32_t>(value >> bucket);
+    return SUB_BUCKET_COUNT + (bucket - 1) * SUB_BUCKET_HALF_COUNT + (subBucket - SUB_BUCKET_HALF_COUNT);
+}
+
+uint64_t FrameHistogram::getUpperBound(uint32_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    uint32_t bucket    = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF_COUNT + 1;
+    uint64_t subBucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF_COUNT + SUB_BUCKET_HALF_COUNT;
+    return ((subBucket + 1) << bucket) - 1;
+}
+
+FrameStatistics::FrameStatistics()
+{
+    _frameStarted             = false;
+    _averageFrameMicroseconds = 0.0;
+    _hitchCount               = 0;
+}
+
+void FrameStatistics::beginFrame()
+{
+    // CPU frame time is measured start to start, so it covers everything the loop does between draws too
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (_frameStarted)
+    {
+        record(FRAME_TIME_CPU_FRAME, now - _frameStart);
+    }
+    _frameStarted = true;
+    _frameStart   = now;
+}
+
+void FrameStatistics::record(FrameTimeChannel channel, std::chrono::steady_clock::duration duration)
+{
+    uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    _histograms[channel].record(microseconds);
+
+    if (channel != FRAME_TIME_CPU_FRAME)
+    {
+        return;
+    }
+
+    // Compared against the average before this frame is added, so one long frame can't hide itself
+    if (_averageFrameMicroseconds > 0.0 && microseconds > _averageFrameMicroseconds * FRAME_STATISTICS_HITCH_FACTOR)
+    {
+        _hitchCount++;
+    }
+    _averageFrameMicroseconds = _averageFrameMicroseconds > 0.0
+        ? _averageFrameMicroseconds + (microseconds - _averageFrameMicroseconds) * AVERAGE_FRAME_WEIGHT
+        : static_cast<double>(microseconds);
+}
+
+uint64_t FrameStatistics::getPercentileMicroseconds(FrameTimeChannel channel, double percentile)
+{
+    return _histograms[channel].getPercentile(percentile);
+}
+
+uint64_t FrameStatistics::getMaxMicroseconds(FrameTimeChannel channel)
+{
+    return _histograms[channel].getMax();
+}
+
+uint64_t FrameStatistics::getHitchCount()
+{
+    return _hitchCount;
+}
+
+void FrameStatistics::printReport()
+{
+    uint64_t frameCount = _histograms[FRAME_TIME_CPU_FRAME].getCount();
+    if (frameCount == 0)
+    {
+        return;
+    }
+
+    printf("Frame statistics, %llu frames (ms):\n", static_cast<unsigned long long>(frameCount));
+    printf("  %-12s %9s %9s %9s %9s\n", "", "p50", "p95", "p99", "max");
+    for (uint32_t channel = 0; channel < FRAME_TIME_CHANNEL_COUNT; channel++)
+    {
+        FrameHistogram& histogram = _histograms[channel];
+        if (histogram.getCount() == 0)
+        {
+            continue;
+        }
+        printf("  %-12s %9.3f %9.3f %9.3f %9.3f\n", CHANNEL_NAMES[channel],
+               histogram.getPercentile(50.0) * 1e-3, histogram.getPercentile(95.0) * 1e-3,
+               histogram.getPercentile(99.0) * 1e-3, histogram.getMax() * 1e-3);
+    }
+    printf("  Hitches (over %.1fx recent average): %llu (%.2f%% of frames)\n", FRAME_STATISTICS_HITCH_FACTOR,
+           static_cast<unsigned long long>(_hitchCount), 100.0 * _hitchCount / frameCount);
+}
+
+void FrameStatistics::reset()
+{
+    for (FrameHistogram& histogram : _histograms)
+    {
+        histogram.reset();
+    }
+    _frameStarted             = false;
+    _averageFrameMicroseconds = 0.0;
+    _hitchCount               = 0;
+}
+
+FrameStatistics::~FrameStatistics()
+{
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Frame phases timed every frame
+enum FrameTimeChannel
+{
+    FRAME_TIME_CPU_FRAME = 0,   // Start of one draw to the start of the next, what the user sees as frame time
+    FRAME_TIME_FENCE_WAIT,      // Waiting for the frame slot's previous submission to finish on the GPU
+    FRAME_TIME_ACQUIRE,         // vkAcquireNextImageKHR
+    FRAME_TIME_PRESENT,         // vkQueuePresentKHR
+    FRAME_TIME_CHANNEL_COUNT
+};
+
+// Histogram of durations in microseconds with log-linear buckets (as in HdrHistogram): every power of two range
+// is split into the same number of linear sub-buckets, so any recorded value is kept to within 1/SUB_BUCKET_HALF_COUNT
+// of its true value, from 1us up to hours, in a fixed few KB.
+class FrameHistogram
+{
+    public:
+        static const uint32_t SUB_BUCKET_BITS       = 7;
+        static const uint32_t SUB_BUCKET_COUNT      = 1 << SUB_BUCKET_BITS;     // Values below this are counted exactly
+        static const uint32_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT / 2;
+        static const uint32_t BUCKET_COUNT          = 32;                       // Power of two ranges above SUB_BUCKET_COUNT
+
+        FrameHistogram();
+
+        void     record(uint64_t microseconds);
+        uint64_t getPercentile(double percentile);     // 0 - 100, upper bound of the bucket holding that value
+        uint64_t getMax();
+        uint64_t getCount();
+        void     reset();
+
+        ~FrameHistogram();
+
+    private:
+        std::vector<uint64_t> _counts;
+        uint64_t              _totalCount;
+        uint64_t              _max;
+
+        static uint32_t getIndex(uint64_t value);
+        static uint64_t getUpperBound(uint32_t index);
+};
+
+// Tail latency of the frame loop: a histogram per FrameTimeChannel, and hitches, frames that took more than
+// FRAME_STATISTICS_HITCH_FACTOR times the recent average. Recorded and read from the thread that calls draw.
+class FrameStatistics
+{
+    public:
+        FrameStatistics();
+
+        void beginFrame();
+        void record(FrameTimeChannel channel, std::chrono::steady_clock::duration duration);
+
+        uint64_t getPercentileMicroseconds(FrameTimeChannel channel, double percentile);
+        uint64_t getMaxMicroseconds(FrameTimeChannel channel);
+        uint64_t getHitchCount();
+        void     printReport();
+        void     reset();
+
+        ~FrameStatistics();
+
+    private:
+        FrameHistogram                        _histograms[FRAME_TIME_CHANNEL_COUNT];
+        bool                                  _frameStarted;
+        std::chrono::steady_clock::time_point _frameStart;
+        double                                _averageFrameMicroseconds;   // Exponential moving average, 0 until the first frame
+        uint64_t                              _hitchCount;
+};
@@ -0,0 +1,656 @@
+#include "GltfImporter.hpp"
+#include "Json.hpp"
+#include "MeshSimplifier.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t GLB_MAGIC      = 0x46546C67;     // "glTF"
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;     // "JSON"
+static const uint32_t GLB_CHUNK_BIN  = 0x004E4942;     // "BIN\0"
+
+static const int GLTF_BYTE           = 5120;
+static const int GLTF_UNSIGNED_BYTE  = 5121;
+static const int GLTF_SHORT          = 5122;
+static const int GLTF_UNSIGNED_SHORT = 5123;
+static const int GLTF_UNSIGNED_INT   = 5125;
+static const int GLTF_FLOAT          = 5126;
+
+static const int GLTF_MODE_TRIANGLES      = 4;
+static const int GLTF_MODE_TRIANGLE_STRIP = 5;
+static const int GLTF_MODE_TRIANGLE_FAN   = 6;
+
+// Where an accessor's elements are, resolved through its buffer view
+struct AccessorView
+{
+    const char* data           = nullptr;
+    size_t      count          = 0;
+    size_t      stride         = 0;
+    int         componentType  = 0;
+    int         componentCount = 0;
+    bool        normalized     = false;
+};
+
+static size_t getComponentSize(int componentType)
+{
+    switch (componentType)
+    {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:  return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:          return 4;
+        default:                  return 0;
+    }
+}
+
+static int getComponentCount(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2")   return 2;
+    if (type == "VEC3")   return 3;
+    if (type == "VEC4")   return 4;
+    return 0;
+}
+
+static bool getAccessor(const JsonValue& gltf, const std::vector<std::span<const char>>& buffers, int64_t accessorIndex,
+                        AccessorView* view)
+{
+    const JsonValue& accessor = gltf["accessors"][static_cast<size_t>(accessorIndex)];
+    if (accessor.type != JSON_OBJECT || accessor.has("sparse"))
+    {
+        return false;
+    }
+
+    int64_t count        = accessor["count"].getInt(-1);
+    view->count          = static_cast<size_t>(count);
+    view->componentType  = static_cast<int>(accessor["componentType"].getInt());
+    view->componentCount = getComponentCount(accessor["type"].getString());
+    view->normalized     = accessor["normalized"].getBool();
+    size_t elementSize   = getComponentSize(view->componentType) * view->componentCount;
+    if (count < 0 || elementSize == 0 || !accessor.has("bufferView"))
+    {
+        return false;
+    }
+
+    const JsonValue& bufferView = gltf["bufferViews"][static_cast<size_t>(accessor["bufferView"].getInt())];
+    int64_t          buffer     = bufferView["buffer"].getInt(-1);
+    if (buffer < 0 || buffer >= static_cast<int64_t>(buffers.size()))
+    {
+        return false;
+    }
+
+    // Whole range the elements cover has to be inside both the view and the buffer. Negative values are refused
+    // before they become huge sizes, and the count is checked by dividing so nothing can overflow
+    int64_t viewOffset = bufferView["byteOffset"].getInt();
+    int64_t viewLength = bufferView["byteLength"].getInt();
+    int64_t offset     = accessor["byteOffset"].getInt();
+    int64_t stride     = bufferView.has("byteStride") ? bufferView["byteStride"].getInt() : static_cast<int64_t>(elementSize);
+    if (viewOffset < 0 || viewLength < 0 || offset < 0 || stride < static_cast<int64_t>(elementSize)
+        || static_cast<uint64_t>(viewOffset) > buffers[buffer].size()
+        || static_cast<uint64_t>(viewLength) > buffers[buffer].size() - viewOffset || offset > viewLength)
+    {
+        return false;
+    }
+    size_t available = static_cast<size_t>(viewLength - offset);
+    view->stride     = static_cast<size_t>(stride);
+    if (view->count > 0 && (elementSize > available || view->count > (available - elementSize) / view->stride + 1))
+    {
+        return false;
+    }
+
+    view->data = buffers[buffer].data() + viewOffset + offset;
+    return true;
+}
+
+// Component of any type as a float, normalised integers scaled to [0, 1] or [-1, 1] as the spec says
+static float readComponent(const char* data, int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+        case GLTF_FLOAT:
+        {
+            float value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        case GLTF_UNSIGNED_BYTE:
+        {
+            uint8_t value = static_cast<uint8_t>(*data);
+            return normalized ? value / 255.0f : value;
+        }
+        case GLTF_BYTE:
+        {
+            int8_t value = static_cast<int8_t>(*data);
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return normalized ? value / 65535.0f : value;
+        }
+        case GLTF_SHORT:
+        {
+            int16_t value;
+            memcpy(&value, data, sizeof(value));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case GLTF_UNSIGNED_INT:
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return static_cast<float>(value);
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+static uint32_t readIndex(const char* data, int componentType)
+{
+    switch (componentType)
+    {
+        case GLTF_UNSIGNED_BYTE:
+            return static_cast<uint8_t>(*data);
+        case GLTF_UNSIGNED_SHORT:
+        {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        default:
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+}
+
+static std::string decodeUri(const std::string& uri)
+{
+    // Only the percent escapes matter for file names, "%20" for spaces mostly
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); i++)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) && isxdigit(static_cast<unsigned char>(uri[i + 2])))
+        {
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        }
+        else
+        {
+            decoded.push_back(uri[i]);
+        }
+    }
+    return decoded;
+}
+
+static bool decodeBase64(std::string_view text, std::vector<char>* decoded)
+{
+    static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    decoded->reserve(text.size() / 4 * 3);
+    uint32_t bits     = 0;
+    int      bitCount = 0;
+    for (char c : text)
+    {
+        if (c == '=')
+        {
+            break;
+        }
+        size_t value = alphabet.find(c);
+        if (value == std::string::npos)
+        {
+            return false;
+        }
+        bits      = (bits << 6) | static_cast<uint32_t>(value);
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            decoded->push_back(static_cast<char>((bits >> bitCount) & 0xFF));
+        }
+    }
+    return true;
+}
+
+// Buffers' contents: the .glb's binary chunk, a mapped .bin file or a decoded data URI
+static bool loadBuffers(const JsonValue& gltf, const std::string& directory, std::span<const char> glbBinary,
+                        GltfScene* scene, std::vector<std::span<const char>>* buffers)
+{
+    CPU_PROFILE_SCOPE("loadGltfBuffers");
+
+    const JsonValue& gltfBuffers = gltf["buffers"];
+    for (size_t i = 0; i < gltfBuffers.size(); i++)
+    {
+        const JsonValue&   gltfBuffer = gltfBuffers[i];
+        const std::string& uri        = gltfBuffer["uri"].getString();
+        size_t             byteLength = static_cast<size_t>(gltfBuffer["byteLength"].getInt());
+
+        std::span<const char> data;
+        if (uri.empty())
+        {
+            data = glbBinary;
+        }
+        else if (uri.compare(0, 5, "data:") == 0)
+        {
+            size_t comma = uri.find(";base64,");
+            scene->decodedBuffers.emplace_back();
+            if (comma == std::string::npos || !decodeBase64(std::string_view(uri).substr(comma + 8), &scene->decodedBuffers.back()))
+            {
+                printf("glTF buffer %zu has a data URI that isn't base64\n", i);
+                return false;
+            }
+            data = std::span<const char>(scene->decodedBuffers.back().data(), scene->decodedBuffers.back().size());
+        }
+        else
+        {
+            scene->mappedFiles.push_back(std::make_unique<MappedFile>());
+            if (!scene->mappedFiles.back()->open(directory + decodeUri(uri)))
+            {
+                printf("Failed to open glTF buffer %s\n", (directory + uri).c_str());
+                return false;
+            }
+            data = scene->mappedFiles.back()->getData();
+        }
+
+        if (data.size() < byteLength)
+        {
+            printf("glTF buffer %zu is shorter than its byteLength\n", i);
+            return false;
+        }
+        buffers->push_back(data.first(byteLength));
+        scene->bufferBytes += byteLength;
+    }
+    return true;
+}
+
+static glm::mat4 getNodeTransform(const JsonValue& node)
+{
+    const JsonValue& matrix = node["matrix"];
+    if (matrix.size() == 16)
+    {
+        // Column major, like glm
+        glm::mat4 transform(1.0f);
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                transform[column][row] = static_cast<float>(matrix[column * 4 + row].getNumber());
+            }
+        }
+        return transform;
+    }
+
+    // Otherwise translation * rotation * scale, each optional
+    const JsonValue& translation = node["translation"];
+    const JsonValue& rotation    = node["rotation"];
+    const JsonValue& scale       = node["scale"];
+    glm::vec3 t(static_cast<float>(translation[0].getNumber()), static_cast<float>(translation[1].getNumber()),
+                static_cast<float>(translation[2].getNumber()));
+    glm::vec3 s(static_cast<float>(scale[0].getNumber(1.0)), static_cast<float>(scale[1].getNumber(1.0)),
+                static_cast<float>(scale[2].getNumber(1.0)));
+    float x = static_cast<float>(rotation[0].getNumber());
+    float y = static_cast<float>(rotation[1].getNumber());
+    float z = static_cast<float>(rotation[2].getNumber());
+    float w = static_cast<float>(rotation[3].getNumber(1.0));
+
+    // Rotation matrix of the unit quaternion (x, y, z, w), its columns scaled
+    glm::vec3 xAxis(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w));
+    glm::vec3 yAxis(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w));
+    glm::vec3 zAxis(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y));
+    return glm::mat4(glm::vec4(xAxis * s.x, 0.0f), glm::vec4(yAxis * s.y, 0.0f), glm::vec4(zAxis * s.z, 0.0f), glm::vec4(t, 1.0f));
+}
+
+// Converts one primitive's accessors into its vertices and indices. Runs on a job, touches only its own primitive
+static bool convertPrimitive(const JsonValue& gltf, const JsonValue& gltfPrimitive, const std::vector<std::span<const char>>& buffers,
+                             const std::vector<GltfMaterial>& materials, GltfPrimitive* primitive)
+{
+    CPU_PROFILE_SCOPE("convertGltfPrimitive");
+
+    int mode = static_cast<int>(gltfPrimitive["mode"].getInt(GLTF_MODE_TRIANGLES));
+    if (mode != GLTF_MODE_TRIANGLES && mode != GLTF_MODE_TRIANGLE_STRIP && mode != GLTF_MODE_TRIANGLE_FAN)
+    {
+        return false;
+    }
+
+    const JsonValue& attributes = gltfPrimitive["attributes"];
+    AccessorView     positions;
+    if (!getAccessor(gltf, buffers, attributes["POSITION"].getInt(-1), &positions) || positions.componentCount != 3)
+    {
+        return false;
+    }
+
+    AccessorView texCoords;
+    AccessorView colours;
+    bool hasTexCoords = attributes.has("TEXCOORD_0") && getAccessor(gltf, buffers, attributes["TEXCOORD_0"].getInt(), &texCoords)
+                        && texCoords.componentCount == 2 && texCoords.count == positions.count;
+    bool hasColours   = attributes.has("COLOR_0") && getAccessor(gltf, buffers, attributes["COLOR_0"].getInt(), &colours)
+                        && colours.componentCount >= 3 && colours.count == positions.count;
+
+    primitive->material = static_cast<int>(gltfPrimitive["material"].getInt(-1));
+    if (primitive->material >= static_cast<int>(materials.size()))
+    {
+        primitive->material = -1;
+    }
+    glm::vec4 factor = primitive->material >= 0 ? materials[primitive->material].baseColourFactor : glm::vec4(1.0f);
+    primitive->hasVertexColours = hasColours || factor.x != 1.0f || factor.y != 1.0f || factor.z != 1.0f;
+
+    // Written straight into the final array, one pass over each accessor
+    primitive->vertices.resize(positions.count);
+    size_t colourSize = getComponentSize(colours.componentType);
+    size_t texSize    = getComponentSize(texCoords.componentType);
+    glm::vec3 minPos(0.0f);
+    glm::vec3 maxPos(0.0f);
+    for (size_t i = 0; i < positions.count; i++)
+    {
+        Vertex&     vertex   = primitive->vertices[i];
+        const char* position = positions.data + i * positions.stride;
+        if (positions.componentType == GLTF_FLOAT)
+        {
+            memcpy(&vertex.pos, position, sizeof(vertex.pos));
+        }
+        else
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                vertex.pos[c] = readComponent(position + c * getComponentSize(positions.componentType), positions.componentType, positions.normalized);
+            }
+        }
+
+        vertex.col = glm::vec3(factor.x, factor.y, factor.z);
+        if (hasColours)
+        {
+            const char* colour = colours.data + i * colours.stride;
+            for (int c = 0; c < 3; c++)
+            {
+                vertex.col[c] *= readComponent(colour + c * colourSize, colours.componentType, colours.normalized);
+            }
+        }
+
+        vertex.tex = glm::vec2(0.0f, 0.0f);
+        if (hasTexCoords)
+        {
+            const char* texCoord = texCoords.data + i * texCoords.stride;
+            vertex.tex.x = readComponent(texCoord, texCoords.componentType, texCoords.normalized);
+            vertex.tex.y = readComponent(texCoord + texSize, texCoords.componentType, texCoords.normalized);
+        }
+
+        minPos = i == 0 ? vertex.pos : glm::min(minPos, vertex.pos);
+        maxPos = i == 0 ? vertex.pos : glm::max(maxPos, vertex.pos);
+    }
+
+    // Same sphere Mesh works out, done here while the vertices are still in cache
+    primitive->boundingCentre = (minPos + maxPos) * 0.5f;
+    primitive->boundingRadius = 0.0f;
+    for (const Vertex& vertex : primitive->vertices)
+    {
+        primitive->boundingRadius = std::max(primitive->boundingRadius, glm::length(vertex.pos - primitive->boundingCentre));
+    }
+
+    // Unindexed primitives draw their vertices in order
+    std::vector<uint32_t> order;
+    if (gltfPrimitive.has("indices"))
+    {
+        AccessorView indices;
+        if (!getAccessor(gltf, buffers, gltfPrimitive["indices"].getInt(), &indices) || indices.componentCount != 1
+            || (indices.componentType != GLTF_UNSIGNED_BYTE && indices.componentType != GLTF_UNSIGNED_SHORT
+                && indices.componentType != GLTF_UNSIGNED_INT))
+        {
+            return false;
+        }
+        std::vector<uint32_t>& target = mode == GLTF_MODE_TRIANGLES ? primitive->indices : order;
+        target.resize(indices.count);
+        for (size_t i = 0; i < indices.count; i++)
+        {
+            target[i] = readIndex(indices.data + i * indices.stride, indices.componentType);
+            if (target[i] >= positions.count)
+            {
+                return false;
+            }
+        }
+    }
+    else
+    {
+        std::vector<uint32_t>& target = mode == GLTF_MODE_TRIANGLES ? primitive->indices : order;
+        target.resize(positions.count);
+        for (size_t i = 0; i < positions.count; i++)
+        {
+            target[i] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Strips and fans become lists, strips alternating winding so every triangle faces the same way
+    for (size_t i = 2; i < order.size(); i++)
+    {
+        if (mode == GLTF_MODE_TRIANGLE_FAN)
+        {
+            primitive->indices.insert(primitive->indices.end(), { order[0], order[i - 1], order[i] });
+        }
+        else if (i % 2 == 0)
+        {
+            primitive->indices.insert(primitive->indices.end(), { order[i - 2], order[i - 1], order[i] });
+        }
+        else
+        {
+            primitive->indices.insert(primitive->indices.end(), { order[i - 1], order[i - 2], order[i] });
+        }
+    }
+    primitive->indices.resize(primitive->indices.size() / 3 * 3);
+
+    // Bounds don't depend on the order, so they stay as they are
+    optimizeMesh(&primitive->vertices, &primitive->indices, &primitive->cacheBefore, &primitive->cacheAfter);
+    generateLods(primitive->vertices, &primitive->indices, &primitive->lods);
+    return true;
+}
+
+bool importGltf(const std::string& filePath, JobSystem* jobSystem, GltfScene* scene)
+{
+    CPU_PROFILE_SCOPE("importGltf");
+
+    *scene = GltfScene();
+    std::string directory = filePath.substr(0, filePath.find_last_of('/') + 1);
+
+    // .glb is a header then a JSON chunk and an optional binary chunk, .gltf is just the JSON
+    scene->mappedFiles.push_back(std::make_unique<MappedFile>());
+    MappedFile& file = *scene->mappedFiles.back();
+    if (!file.open(filePath))
+    {
+        printf("Failed to open glTF file %s\n", filePath.c_str());
+        return false;
+    }
+    std::span<const char> json      = file.getData();
+    std::span<const char> glbBinary;
+    uint32_t              magic     = 0;
+    memcpy(&magic, json.data(), std::min(json.size(), sizeof(magic)));
+    if (magic == GLB_MAGIC)
+    {
+        std::span<const char> glb = file.getData();
+        json = {};
+        for (size_t offset = 12; offset + 8 <= glb.size();)
+        {
+            uint32_t chunkLength;
+            uint32_t chunkType;
+            memcpy(&chunkLength, glb.data() + offset, sizeof(chunkLength));
+            memcpy(&chunkType, glb.data() + offset + 4, sizeof(chunkType));
+            if (chunkLength > glb.size() - offset - 8)
+            {
+                break;
+            }
+            std::span<const char> chunk = glb.subspan(offset + 8, chunkLength);
+            if (chunkType == GLB_CHUNK_JSON && json.empty())
+            {
+                json = chunk;
+            }
+            else if (chunkType == GLB_CHUNK_BIN && glbBinary.empty())
+            {
+                glbBinary = chunk;
+            }
+            offset += 8 + (chunkLength + 3) / 4 * 4;
+        }
+    }
+
+    JsonValue gltf;
+    {
+        CPU_PROFILE_SCOPE("parseGltfJson");
+        if (json.empty() || !parseJson(std::string_view(json.data(), json.size()), &gltf) || gltf.type != JSON_OBJECT)
+        {
+            printf("glTF file %s isn't valid\n", filePath.c_str());
+            return false;
+        }
+    }
+    if (gltf["asset"]["version"].getString().compare(0, 2, "2.") != 0)
+    {
+        printf("glTF file %s isn't glTF 2.0\n", filePath.c_str());
+        return false;
+    }
+
+    std::vector<std::span<const char>> buffers;
+    if (!loadBuffers(gltf, directory, glbBinary, scene, &buffers))
+    {
+        return false;
+    }
+
+    // Images are only located here, they are read and decoded with the rest of the renderer's textures
+    const JsonValue& images = gltf["images"];
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        GltfImage image;
+        if (images[i].has("uri"))
+        {
+            image.filePath = directory + decodeUri(images[i]["uri"].getString());
+        }
+        else
+        {
+            const JsonValue& bufferView = gltf["bufferViews"][static_cast<size_t>(images[i]["bufferView"].getInt())];
+            int64_t          buffer     = bufferView["buffer"].getInt(-1);
+            size_t           offset     = static_cast<size_t>(bufferView["byteOffset"].getInt());
+            size_t           length     = static_cast<size_t>(bufferView["byteLength"].getInt());
+            if (buffer >= 0 && buffer < static_cast<int64_t>(buffers.size()) && offset <= buffers[buffer].size()
+                && length <= buffers[buffer].size() - offset)
+            {
+                image.data = buffers[buffer].subspan(offset, length);
+            }
+        }
+        scene->images.push_back(image);
+    }
+
+    const JsonValue& materials = gltf["materials"];
+    for (size_t i = 0; i < materials.size(); i++)
+    {
+        const JsonValue& pbr    = materials[i]["pbrMetallicRoughness"];
+        const JsonValue& factor = pbr["baseColorFactor"];
+        GltfMaterial     material;
+        material.baseColourFactor = glm::vec4(static_cast<float>(factor[0].getNumber(1.0)), static_cast<float>(factor[1].getNumber(1.0)),
+                                              static_cast<float>(factor[2].getNumber(1.0)), static_cast<float>(factor[3].getNumber(1.0)));
+        material.alphaMask        = materials[i]["alphaMode"].getString() == "MASK";
+        if (pbr.has("baseColorTexture"))
+        {
+            const JsonValue& texture = gltf["textures"][static_cast<size_t>(pbr["baseColorTexture"]["index"].getInt())];
+            int64_t          image   = texture["source"].getInt(-1);
+            material.baseColourImage = image >= 0 && image < static_cast<int64_t>(scene->images.size()) ? static_cast<int>(image) : -1;
+        }
+        scene->materials.push_back(material);
+    }
+
+    // Every primitive of every mesh is its own job, big meshes spread over the workers with everything else
+    struct PrimitiveSource
+    {
+        const JsonValue* gltfPrimitive;
+        size_t           mesh;
+    };
+    std::vector<PrimitiveSource> primitiveSources;
+    const JsonValue& meshes = gltf["meshes"];
+    scene->meshes.resize(meshes.size());
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        const JsonValue& primitives = meshes[m]["primitives"];
+        for (size_t p = 0; p < primitives.size(); p++)
+        {
+            scene->meshes[m].push_back(static_cast<int>(primitiveSources.size()));
+            primitiveSources.push_back({ &primitives[p], m });
+        }
+    }
+    scene->primitives.resize(primitiveSources.size());
+
+    std::atomic<uint32_t> failedPrimitives{0};
+    JobCounter            primitivesDone;
+    jobSystem->parallelFor(static_cast<uint32_t>(primitiveSources.size()), 1,
+        [&gltf, &buffers, &primitiveSources, &failedPrimitives, scene](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            if (!convertPrimitive(gltf, *primitiveSources[i].gltfPrimitive, buffers, scene->materials, &scene->primitives[i]))
+            {
+                // Left empty, and skipped when the scene is added
+                scene->primitives[i] = GltfPrimitive();
+                failedPrimitives.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }, &primitivesDone, "Convert glTF primitives");
+    jobSystem->wait(&primitivesDone);
+    if (failedPrimitives.load() > 0)
+    {
+        printf("Skipped %u glTF primitives in %s, they aren't triangles or use unsupported accessors\n", failedPrimitives.load(), filePath.c_str());
+    }
+
+    for (const GltfPrimitive& primitive : scene->primitives)
+    {
+        scene->cacheBefore.add(primitive.cacheBefore);
+        scene->cacheAfter.add(primitive.cacheAfter);
+    }
+
+    const JsonValue& nodes = gltf["nodes"];
+    std::vector<bool> isChild(nodes.size(), false);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        GltfNode node;
+        node.localTransform = getNodeTransform(nodes[i]);
+        node.mesh           = static_cast<int>(nodes[i]["mesh"].getInt(-1));
+        if (node.mesh >= static_cast<int>(scene->meshes.size()))
+        {
+            node.mesh = -1;
+        }
+        const JsonValue& children = nodes[i]["children"];
+        for (size_t c = 0; c < children.size(); c++)
+        {
+            int64_t child = children[c].getInt(-1);
+            if (child >= 0 && child < static_cast<int64_t>(nodes.size()) && !isChild[child])
+            {
+                node.children.push_back(static_cast<int>(child));
+                isChild[child] = true;
+            }
+        }
+        scene->nodes.push_back(node);
+    }
+
+    // Roots of the default scene, or every node nothing else is a parent of when there are no scenes
+    const JsonValue& sceneNodes = gltf["scenes"][static_cast<size_t>(gltf["scene"].getInt(0))]["nodes"];
+    for (size_t i = 0; i < sceneNodes.size(); i++)
+    {
+        int64_t node = sceneNodes[i].getInt(-1);
+        if (node >= 0 && node < static_cast<int64_t>(nodes.size()))
+        {
+            scene->rootNodes.push_back(static_cast<int>(node));
+        }
+    }
+    if (!gltf.has("scenes"))
+    {
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            if (!isChild[i])
+            {
+                scene->rootNodes.push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    return true;
+}
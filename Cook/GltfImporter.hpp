@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Utilities.hpp"
+#include "MappedFile.hpp"
+#include "JobSystem.hpp"
+#include "MeshOptimizer.hpp"
+
+// One glTF mesh primitive, converted to what Mesh takes
+struct GltfPrimitive
+{
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;                     // Every level of detail, one after another
+    std::vector<MeshLod>  lods;
+    int                   material         = -1;       // -1 for the default material (white, untextured)
+    bool                  hasVertexColours = false;    // COLOR_0, or a base colour factor that isn't white, is in Vertex::col
+    glm::vec3             boundingCentre;
+    float                 boundingRadius   = 0.0f;
+    VertexCacheStatistics cacheBefore;                 // Of the indices as the file had them
+    VertexCacheStatistics cacheAfter;                  // After optimizeMesh
+};
+
+struct GltfMaterial
+{
+    int       baseColourImage = -1;        // Index into GltfScene::images
+    glm::vec4 baseColourFactor;
+    bool      alphaMask       = false;     // alphaMode MASK, drawn with the alpha test
+};
+
+// Image file next to the glTF, or encoded image data inside one of its buffers (data then points into the scene)
+struct GltfImage
+{
+    std::string           filePath;
+    std::span<const char> data;
+};
+
+struct GltfNode
+{
+    glm::mat4        localTransform;
+    int              mesh = -1;
+    std::vector<int> children;
+};
+
+// Everything a glTF file describes, ready to be turned into textures, meshes and scene nodes
+struct GltfScene
+{
+    std::vector<GltfNode>                    nodes;
+    std::vector<int>                         rootNodes;
+    std::vector<std::vector<int>>            meshes;           // Each glTF mesh's primitives, indices into primitives
+    std::vector<GltfPrimitive>               primitives;
+    std::vector<GltfMaterial>                materials;
+    std::vector<GltfImage>                   images;
+    uint64_t                                 bufferBytes = 0;  // Size of all the binary buffers read
+    VertexCacheStatistics                    cacheBefore;      // Every primitive's, added up
+    VertexCacheStatistics                    cacheAfter;
+
+    // What the buffers, and so embedded images, point into. Freed with the scene
+    std::vector<std::unique_ptr<MappedFile>> mappedFiles;
+    std::vector<std::vector<char>>           decodedBuffers;
+};
+
+// Imports a glTF 2.0 file, .gltf (JSON with external or base64 buffers) or .glb (binary container). Buffers are
+// memory mapped, not read, and every primitive's accessors are converted on its own job, reading straight from the
+// mapping into the primitive's final vertex and index arrays, which are then optimised (optimizeMesh) on the same
+// job, which also generates the levels of detail (generateLods). Triangle strips and fans become lists, points and
+// lines are skipped, as are sparse accessors.
+bool importGltf(const std::string& filePath, JobSystem* jobSystem, GltfScene* scene);
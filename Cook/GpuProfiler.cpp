@@ -0,0 +1,399 @@
+#include "GpuProfiler.hpp"
+#include "Utilities.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+static uint64_t cpuNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GpuProfiler::GpuProfiler()
+{
+    _enabled                   = false;
+    _vkGetCalibratedTimestamps = nullptr;
+    _currentFrame              = 0;
+}
+
+void GpuProfiler::init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device,
+                       VkQueue queue, uint32_t queueFamilyIndex, VkCommandPool commandPool,
+                       bool calibratedTimestampsEnabled)
+{
+    _device      = device;
+    _queue       = queue;
+    _commandPool = commandPool;
+
+    // Queue family must be able to write timestamps at all
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    _timestampValidBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    if (_timestampValidBits == 0)
+    {
+        printf("GPU profiler disabled, queue family doesn't support timestamps\n");
+        return;
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    _nanosecondsPerTick = deviceProperties.limits.timestampPeriod;
+
+    // Calibrated timestamps read both clocks in one call. steady_clock is CLOCK_MONOTONIC on Linux,
+    // elsewhere it isn't one of the calibrateable domains, so the one off calibration is used instead
+#ifdef __linux__
+    if (calibratedTimestampsEnabled)
+    {
+        auto getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+
+        uint32_t timeDomainCount = 0;
+        std::vector<VkTimeDomainEXT> timeDomains;
+        if (getTimeDomains && getTimeDomains(physicalDevice, &timeDomainCount, nullptr) == VK_SUCCESS)
+        {
+            timeDomains.resize(timeDomainCount);
+            getTimeDomains(physicalDevice, &timeDomainCount, timeDomains.data());
+        }
+
+        bool hasDevice    = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != timeDomains.end();
+        bool hasMonotonic = std::find(timeDomains.begin(), timeDomains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) != timeDomains.end();
+        if (hasDevice && hasMonotonic)
+        {
+            _vkGetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT");
+        }
+    }
+#endif
+
+    // Query pool per frame in flight, two queries (begin and end) per scope
+    VkQueryPoolCreateInfo queryPoolCI = {};
+    queryPoolCI.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount            = GPU_PROFILER_MAX_SCOPES * 2;
+
+    _frames.resize(MAX_FRAME_DRAWS);
+    for (FrameQueries& frame : _frames)
+    {
+        VkResult result = vkCreateQueryPool(_device, &queryPoolCI, nullptr, &frame.queryPool);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a timestamp Query Pool!");
+        }
+        frame.queriesUsed = 0;
+        frame.frameNumber = 0;
+    }
+
+    _enabled = true;
+    calibrate();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    if (!_openScopes.empty())
+    {
+        throw std::runtime_error("GPU profiler scope was not ended before the next frame!");
+    }
+
+    // This slot's fence has been waited on, so its last frame has finished and results are ready
+    FrameQueries& frame = _frames[frameIndex];
+    collectResults(frame);
+
+    frame.scopes.clear();
+    frame.queriesUsed = 0;
+    frame.frameNumber = frameNumber;
+    _currentFrame     = frameIndex;
+
+    // Queries must be reset before they are written again (outside of a render pass)
+    vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    FrameQueries& frame = _frames[_currentFrame];
+
+    // Out of queries, scope is still pushed so endScope stays balanced, but isn't measured
+    if (frame.queriesUsed + 2 > GPU_PROFILER_MAX_SCOPES * 2)
+    {
+        _openScopes.push_back(UINT32_MAX);
+        return;
+    }
+
+    PendingScope scope;
+    scope.name       = name;
+    scope.depth      = static_cast<uint32_t>(_openScopes.size());
+    scope.beginQuery = frame.queriesUsed;
+    scope.endQuery   = frame.queriesUsed + 1;
+    frame.queriesUsed += 2;
+
+    _openScopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+    frame.scopes.push_back(scope);
+
+    // Written once all previous commands have started
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, scope.beginQuery);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    if (_openScopes.empty())
+    {
+        throw std::runtime_error("GPU profiler scope ended without being begun!");
+    }
+
+    uint32_t scopeIndex = _openScopes.back();
+    _openScopes.pop_back();
+    if (scopeIndex == UINT32_MAX)
+    {
+        return;
+    }
+
+    // Written once all previous commands have finished
+    FrameQueries& frame = _frames[_currentFrame];
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.scopes[scopeIndex].endQuery);
+}
+
+void GpuProfiler::calibrate()
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    // Both clocks sampled together by the driver
+    if (_vkGetCalibratedTimestamps)
+    {
+        VkCalibratedTimestampInfoEXT timestampInfos[2] = {};
+        timestampInfos[0].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+        timestampInfos[1].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+        timestampInfos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+        uint64_t timestamps[2];
+        uint64_t maxDeviation;
+        if (_vkGetCalibratedTimestamps(_device, 2, timestampInfos, timestamps, &maxDeviation) == VK_SUCCESS)
+        {
+            _calibrationGpuTicks       = timestamps[0];
+            _calibrationCpuNanoseconds = timestamps[1];
+            return;
+        }
+    }
+
+    // Otherwise write a timestamp from an otherwise empty submission, and assume it was taken half way
+    // between submitting and the queue going idle. Blocks, so only done at start up
+    VkQueryPoolCreateInfo queryPoolCI = {};
+    queryPoolCI.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCI.queryCount            = 1;
+
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(_device, &queryPoolCI, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a timestamp Query Pool!");
+    }
+
+    VkCommandBuffer commandBuffer = beginCommandBuffer(_device, _commandPool);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+
+    uint64_t submitted = cpuNanoseconds();
+    endAndSubmitCommandBuffer(_device, _commandPool, _queue, commandBuffer);
+    uint64_t finished  = cpuNanoseconds();
+
+    uint64_t gpuTicks = 0;
+    vkGetQueryPoolResults(_device, queryPool, 0, 1, sizeof(gpuTicks), &gpuTicks, sizeof(gpuTicks), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    vkDestroyQueryPool(_device, queryPool, nullptr);
+
+    _calibrationGpuTicks       = gpuTicks;
+    _calibrationCpuNanoseconds = submitted + (finished - submitted) / 2;
+}
+
+bool GpuProfiler::isEnabled()
+{
+    return _enabled;
+}
+
+const std::vector<GpuScopeTiming>& GpuProfiler::getLatestTimings()
+{
+    return _latestTimings;
+}
+
+double GpuProfiler::getAverageMilliseconds(const std::string& name)
+{
+    auto found = _history.find(name);
+    if (found == _history.end() || found->second.samples.empty())
+    {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (double sample : found->second.samples)
+    {
+        total += sample;
+    }
+    return total / found->second.samples.size();
+}
+
+std::string GpuProfiler::getSummary()
+{
+    // One line, short enough for a window title
+    std::string summary = "GPU";
+    char        entry[96];
+    for (const std::string& name : _scopeOrder)
+    {
+        snprintf(entry, sizeof(entry), " | %s %.3f ms", name.c_str(), getAverageMilliseconds(name));
+        summary += entry;
+    }
+    return summary;
+}
+
+void GpuProfiler::printReport()
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    printf("GPU timings over last %d frames:\n", GPU_PROFILER_HISTORY_FRAMES);
+    for (const std::string& name : _scopeOrder)
+    {
+        const RollingTiming& timing = _history[name];
+        if (timing.samples.empty())
+        {
+            continue;
+        }
+
+        auto minMax = std::minmax_element(timing.samples.begin(), timing.samples.end());
+        printf("  %*s%-*s avg %8.3f ms  min %8.3f ms  max %8.3f ms\n",
+               timing.depth * 2, "", 32 - timing.depth * 2, name.c_str(),
+               getAverageMilliseconds(name), *minMax.first, *minMax.second);
+    }
+}
+
+bool GpuProfiler::openCsvReport(const std::string& filePath)
+{
+    _csvFile.open(filePath, std::ios::out | std::ios::trunc);
+    if (!_csvFile.is_open())
+    {
+        return false;
+    }
+
+    _csvFile << "frame,scope,depth,cpu_start_ms,duration_ms\n";
+    return true;
+}
+
+void GpuProfiler::destroy()
+{
+    for (FrameQueries& frame : _frames)
+    {
+        vkDestroyQueryPool(_device, frame.queryPool, nullptr);
+    }
+    _frames.clear();
+
+    if (_csvFile.is_open())
+    {
+        _csvFile.close();
+    }
+    _enabled = false;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
+
+void GpuProfiler::collectResults(FrameQueries& frame)
+{
+    if (frame.queriesUsed == 0)
+    {
+        return;
+    }
+
+    // Each query returns its value followed by an availability word, never waits
+    std::vector<uint64_t> results(frame.queriesUsed * 2);
+    VkResult result = vkGetQueryPoolResults(_device, frame.queryPool, 0, frame.queriesUsed,
+                                            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY)
+    {
+        return;
+    }
+
+    // Keep the CPU mapping fresh, the two clocks drift apart over time
+    if (_vkGetCalibratedTimestamps)
+    {
+        calibrate();
+    }
+
+    _latestTimings.clear();
+    for (const PendingScope& scope : frame.scopes)
+    {
+        uint64_t beginTicks = results[scope.beginQuery * 2];
+        uint64_t endTicks   = results[scope.endQuery * 2];
+        bool     available  = results[scope.beginQuery * 2 + 1] != 0 && results[scope.endQuery * 2 + 1] != 0;
+        if (!available)
+        {
+            continue;
+        }
+
+        GpuScopeTiming timing;
+        timing.name                 = scope.name;
+        timing.depth                = scope.depth;
+        timing.frameNumber          = frame.frameNumber;
+        timing.cpuStartMilliseconds = ticksToCpuMilliseconds(beginTicks);
+        timing.durationMilliseconds = tickDelta(beginTicks, endTicks) * _nanosecondsPerTick * 1e-6;
+        _latestTimings.push_back(timing);
+
+        // Rolling window for the report
+        auto inserted = _history.emplace(scope.name, RollingTiming());
+        if (inserted.second)
+        {
+            _scopeOrder.push_back(scope.name);
+        }
+        RollingTiming& rolling = inserted.first->second;
+        rolling.depth = scope.depth;
+        if (rolling.samples.size() < GPU_PROFILER_HISTORY_FRAMES)
+        {
+            rolling.samples.push_back(timing.durationMilliseconds);
+        }
+        else
+        {
+            rolling.samples[rolling.next] = timing.durationMilliseconds;
+        }
+        rolling.next = (rolling.next + 1) % GPU_PROFILER_HISTORY_FRAMES;
+
+        if (_csvFile.is_open())
+        {
+            _csvFile << timing.frameNumber << ',' << timing.name << ',' << timing.depth << ','
+                     << timing.cpuStartMilliseconds << ',' << timing.durationMilliseconds << '\n';
+        }
+    }
+}
+
+int64_t GpuProfiler::tickDelta(uint64_t from, uint64_t to)
+{
+    // Only the low timestampValidBits bits are meaningful, shift them to the top so the
+    // subtraction wraps correctly, then shift back down keeping the sign
+    uint32_t unusedBits = 64 - _timestampValidBits;
+    return static_cast<int64_t>((to - from) << unusedBits) >> unusedBits;
+}
+
+double GpuProfiler::ticksToCpuMilliseconds(uint64_t ticks)
+{
+    double nanoseconds = _calibrationCpuNanoseconds + tickDelta(_calibrationGpuTicks, ticks) * _nanosecondsPerTick;
+    return nanoseconds * 1e-6;
+}
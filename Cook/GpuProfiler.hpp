@@ -0,0 +1,95 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Timing of one named scope, from a frame that has finished on the GPU
+struct GpuScopeTiming
+{
+    std::string name;
+    uint32_t    depth;                  // 0 for outermost scopes, +1 per enclosing scope
+    uint64_t    frameNumber;            // Frame the scope was recorded in
+    double      cpuStartMilliseconds;   // When the GPU started the scope, on the CPU steady_clock
+    double      durationMilliseconds;
+};
+
+// Measures GPU time spent between points in a command buffer using timestamp queries.
+// There is one query pool per frame in flight, a frame's results are read back the next time
+// its slot comes round (after its fence has been waited on), so reading never stalls the CPU.
+// Scopes must be recorded from one thread, and outside of render passes that use secondary command buffers.
+class GpuProfiler
+{
+    public:
+        GpuProfiler();
+
+        void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device,
+                  VkQueue queue, uint32_t queueFamilyIndex, VkCommandPool commandPool,
+                  bool calibratedTimestampsEnabled);
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+        void beginScope(VkCommandBuffer commandBuffer, const char* name);
+        void endScope(VkCommandBuffer commandBuffer);
+        void calibrate();
+
+        bool                               isEnabled();
+        const std::vector<GpuScopeTiming>& getLatestTimings();
+        double                             getAverageMilliseconds(const std::string& name);
+        std::string                        getSummary();
+        void                               printReport();
+        bool                               openCsvReport(const std::string& filePath);
+        void                               destroy();
+
+        ~GpuProfiler();
+
+    private:
+        // Scope recorded into a frame, waiting for its queries to complete
+        struct PendingScope
+        {
+            std::string name;
+            uint32_t    depth;
+            uint32_t    beginQuery;
+            uint32_t    endQuery;
+        };
+
+        struct FrameQueries
+        {
+            VkQueryPool               queryPool;
+            std::vector<PendingScope> scopes;
+            uint32_t                  queriesUsed;
+            uint64_t                  frameNumber;
+        };
+
+        // Last GPU_PROFILER_HISTORY_FRAMES durations of one scope
+        struct RollingTiming
+        {
+            std::vector<double> samples;
+            size_t              next  = 0;
+            uint32_t            depth = 0;
+        };
+
+        VkDevice                                       _device;
+        VkQueue                                        _queue;
+        VkCommandPool                                  _commandPool;
+        bool                                           _enabled;
+        double                                         _nanosecondsPerTick;    // VkPhysicalDeviceLimits::timestampPeriod
+        uint32_t                                       _timestampValidBits;    // Queue family only writes this many low bits
+        PFN_vkGetCalibratedTimestampsEXT               _vkGetCalibratedTimestamps;
+        uint64_t                                       _calibrationGpuTicks;   // GPU and CPU clocks read at (about) the same moment
+        uint64_t                                       _calibrationCpuNanoseconds;
+        std::vector<FrameQueries>                      _frames;                // One per frame in flight
+        uint32_t                                       _currentFrame;
+        std::vector<uint32_t>                          _openScopes;            // Indices into current frame's scopes
+        std::vector<GpuScopeTiming>                    _latestTimings;
+        std::vector<std::string>                       _scopeOrder;            // Scope names in the order first seen, for reports
+        std::unordered_map<std::string, RollingTiming> _history;
+        std::ofstream                                  _csvFile;
+
+        void     collectResults(FrameQueries& frame);
+        int64_t  tickDelta(uint64_t from, uint64_t to);
+        double   ticksToCpuMilliseconds(uint64_t ticks);
+};
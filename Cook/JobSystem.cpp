@@ -0,0 +1,409 @@
+#include "JobSystem.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+// Index of the JobSystem thread running this code (0 = main thread), EXTERNAL_THREAD for any other thread
+static const uint32_t EXTERNAL_THREAD = UINT32_MAX;
+static thread_local uint32_t tlsThreadIndex = EXTERNAL_THREAD;
+
+static uint64_t nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+WorkStealingQueue::WorkStealingQueue() : _top(0), _bottom(0), _jobs(CAPACITY)
+{
+}
+
+bool WorkStealingQueue::push(Job* job)
+{
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top    = _top.load(std::memory_order_acquire);
+
+    // Queue is full, caller must run the job itself
+    if (bottom - top >= CAPACITY)
+    {
+        return false;
+    }
+
+    _jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_release);      // Job must be visible before bottom moves
+    return true;
+}
+
+Job* WorkStealingQueue::pop()
+{
+    // Reserve the bottom slot before looking at top, so a racing steal can be detected
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Queue was empty, restore bottom
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = _jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last job in queue, race stealers for it
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* WorkStealingQueue::steal()
+{
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job* job = _jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+
+    // Another thread (owner or stealer) took it first
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+
+    return job;
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+}
+
+JobSystem::JobSystem() : _running(false), _queuedJobs(0)
+{
+}
+
+void JobSystem::init(uint32_t workerCount)
+{
+    // One queue for the main thread, plus one per worker
+    for (uint32_t i = 0; i < workerCount + 1; i++)
+    {
+        _queues.push_back(std::make_unique<WorkStealingQueue>());
+        _stats.push_back(std::make_unique<JobThreadStats>());
+    }
+
+    tlsThreadIndex = 0;
+    CpuProfiler::setThreadName("main");
+    _running       = true;
+    _statsStart    = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 1; i <= workerCount; i++)
+    {
+        _workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::run(std::function<void()> function, JobCounter* counter, const char* name)
+{
+    if (counter)
+    {
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    submit(new Job{ std::move(function), counter, name });
+}
+
+void JobSystem::runAfter(JobCounter* dependency, std::function<void()> function, JobCounter* counter, const char* name)
+{
+    if (counter)
+    {
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job* job = new Job{ std::move(function), counter, name };
+
+    // Park job on the dependency, unless it has already finished
+    {
+        std::lock_guard<std::mutex> lock(dependency->dependentsMutex);
+        if (!dependency->isDone())
+        {
+            dependency->dependents.push_back(job);
+            return;
+        }
+    }
+
+    submit(job);
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter, const char* name)
+{
+    grainSize = std::max(grainSize, 1u);
+
+    // Split range into jobs of at most grainSize elements
+    for (uint32_t begin = 0; begin < count; begin += grainSize)
+    {
+        uint32_t end = std::min(begin + grainSize, count);
+        run([function, begin, end]() { function(begin, end); }, counter, name);
+    }
+}
+
+void JobSystem::wait(JobCounter* counter)
+{
+    // Help out with queued work instead of blocking. Other threads have no queue or thread index of their own,
+    // so they leave the jobs to the job system's threads
+    while (!counter->isDone())
+    {
+        if (tlsThreadIndex == EXTERNAL_THREAD || !executeNextJob(tlsThreadIndex))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Last finishing job may still hold the lock, counter is only safe to destroy once it lets go
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(counter->dependentsMutex);
+        exception = counter->exception;
+        counter->exception = nullptr;
+    }
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+void JobSystem::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _running = false;
+    }
+    _sleepCondition.notify_all();
+
+    for (std::thread& worker : _workers)
+    {
+        worker.join();
+    }
+
+    _workers.clear();
+    _queues.clear();
+    _stats.clear();
+}
+
+uint32_t JobSystem::getThreadCount()
+{
+    return static_cast<uint32_t>(_queues.size());
+}
+
+uint32_t JobSystem::getThreadIndex()
+{
+    return tlsThreadIndex;
+}
+
+void JobSystem::resetStats()
+{
+    for (auto& stats : _stats)
+    {
+        stats->busyNanoseconds = 0;
+        stats->jobsExecuted    = 0;
+        stats->jobsStolen      = 0;
+    }
+    _statsStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::printUtilisation()
+{
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _statsStart).count();
+    if (elapsed <= 0.0)
+    {
+        return;
+    }
+
+    printf("Job system utilisation over %.2f s:\n", elapsed * 1e-9);
+    for (size_t i = 0; i < _stats.size(); i++)
+    {
+        double busy = 100.0 * _stats[i]->busyNanoseconds.load() / elapsed;
+
+        // Bar of up to 50 characters, one per 2% busy
+        std::string bar(static_cast<size_t>(std::min(busy, 100.0) / 2.0), '#');
+        printf("  %-8s %3u |%-50s| %5.1f%%  jobs %8llu  stolen %8llu\n",
+               i == 0 ? "main" : "worker", static_cast<uint32_t>(i), bar.c_str(), busy,
+               static_cast<unsigned long long>(_stats[i]->jobsExecuted.load()),
+               static_cast<unsigned long long>(_stats[i]->jobsStolen.load()));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    if (_running)
+    {
+        shutdown();
+    }
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex)
+{
+    tlsThreadIndex = threadIndex;
+    CpuProfiler::setThreadName("worker " + std::to_string(threadIndex));
+
+    while (_running)
+    {
+        if (executeNextJob(threadIndex))
+        {
+            continue;
+        }
+
+        // Nothing to do, sleep until a job is queued
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _sleepCondition.wait(lock, [this]() { return !_running || _queuedJobs.load() > 0; });
+    }
+}
+
+void JobSystem::submit(Job* job)
+{
+    // Only the owning thread may push to a queue, anything else goes through the shared one
+    if (tlsThreadIndex == EXTERNAL_THREAD)
+    {
+        std::lock_guard<std::mutex> lock(_externalMutex);
+        _externalJobs.push_back(job);
+    }
+    else if (!_queues[tlsThreadIndex]->push(job))
+    {
+        // Own queue is full, just run it here
+        executeJob(job);
+        return;
+    }
+
+    _queuedJobs.fetch_add(1);
+
+    // Taking the lock stops a worker missing the wake up between checking and sleeping
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+    }
+    _sleepCondition.notify_one();
+}
+
+bool JobSystem::executeNextJob(uint32_t threadIndex)
+{
+    Job* job = findJob(threadIndex);
+    if (!job)
+    {
+        return false;
+    }
+
+    const char* name  = job->name;      // Job is gone once it has run
+    uint64_t    start = nowNanoseconds();
+    executeJob(job);
+    uint64_t    end   = nowNanoseconds();
+    _stats[threadIndex]->busyNanoseconds += end - start;
+    _stats[threadIndex]->jobsExecuted++;
+
+    // Already timed for the stats, so it costs nothing extra to show in the trace
+    if (CpuProfiler::isEnabled())
+    {
+        CpuProfiler::record(name, start, end);
+    }
+    return true;
+}
+
+void JobSystem::executeJob(Job* job)
+{
+    // An exception must not leave a worker thread, it is handed to whoever waits on the counter instead
+    try
+    {
+        job->function();
+    }
+    catch (...)
+    {
+        if (job->counter)
+        {
+            std::lock_guard<std::mutex> lock(job->counter->dependentsMutex);
+            if (!job->counter->exception)
+            {
+                job->counter->exception = std::current_exception();
+            }
+        }
+        else
+        {
+            // Nobody to hand it to, and carrying on as if the job had done its work would only hide the failure
+            printf("Job %s has no counter but threw an exception, terminating\n", job->name);
+            std::terminate();
+        }
+    }
+
+    finishJob(job);
+}
+
+Job* JobSystem::findJob(uint32_t threadIndex)
+{
+    // Own queue first (most recently pushed, likely still in cache)
+    Job* job = _queues[threadIndex]->pop();
+
+    // Otherwise steal the oldest job from another thread, starting at the next one along
+    uint32_t queueCount = static_cast<uint32_t>(_queues.size());
+    for (uint32_t i = 1; !job && i < queueCount; i++)
+    {
+        job = _queues[(threadIndex + i) % queueCount]->steal();
+        if (job)
+        {
+            _stats[threadIndex]->jobsStolen++;
+        }
+    }
+
+    // Then jobs submitted from outside
+    if (!job)
+    {
+        std::lock_guard<std::mutex> lock(_externalMutex);
+        if (!_externalJobs.empty())
+        {
+            job = _externalJobs.front();
+            _externalJobs.pop_front();
+        }
+    }
+
+    if (job)
+    {
+        _queuedJobs.fetch_sub(1);
+    }
+
+    return job;
+}
+
+void JobSystem::finishJob(Job* job)
+{
+    JobCounter* counter = job->counter;
+    delete job;
+
+    if (!counter)
+    {
+        return;
+    }
+
+    // Decrement under the lock, so runAfter can't park a job on a counter that has just finished
+    std::vector<Job*> dependents;
+    {
+        std::lock_guard<std::mutex> lock(counter->dependentsMutex);
+        if (counter->count.load(std::memory_order_relaxed) == 1)
+        {
+            dependents.swap(counter->dependents);
+        }
+        counter->count.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Last job on this counter, release everything that was waiting for it
+    for (Job* dependent : dependents)
+    {
+        submit(dependent);
+    }
+}
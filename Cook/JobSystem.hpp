@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+// Counts outstanding jobs. Hits zero when every job that was run with it has finished,
+// at which point any jobs that were queued behind it (runAfter) are released.
+// Only destroy or reuse a counter after JobSystem::wait on it has returned.
+// An exception thrown by one of its jobs is kept here and rethrown by wait, the other jobs still run.
+// Jobs run without a counter must not throw, there is nobody to rethrow to and the program is terminated.
+struct JobCounter
+{
+    std::atomic<int>   count{0};
+    std::mutex         dependentsMutex;
+    std::vector<Job*>  dependents;      // Jobs waiting for count to reach zero
+    std::exception_ptr exception;       // First exception a job threw, under dependentsMutex
+
+    bool isDone()
+    {
+        return count.load(std::memory_order_acquire) == 0;
+    }
+};
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter*           counter;      // Decremented when function returns (may be nullptr)
+    const char*           name;         // Shown in CPU profiler traces
+};
+
+// Chase-Lev work-stealing deque of fixed capacity.
+// Only the owning thread may push/pop (LIFO end), any thread may steal (FIFO end).
+class WorkStealingQueue
+{
+    public:
+        WorkStealingQueue();
+
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+
+        ~WorkStealingQueue();
+
+    private:
+        static const int64_t           CAPACITY = 4096;   // Must be a power of 2
+        std::atomic<int64_t>           _top;
+        std::atomic<int64_t>           _bottom;
+        std::vector<std::atomic<Job*>> _jobs;
+};
+
+// Per-thread execution statistics, used to report how well the cores are being used
+struct JobThreadStats
+{
+    std::atomic<uint64_t> busyNanoseconds{0};
+    std::atomic<uint64_t> jobsExecuted{0};
+    std::atomic<uint64_t> jobsStolen{0};
+};
+
+class JobSystem
+{
+    public:
+        JobSystem();
+
+        void init(uint32_t workerCount);
+        void run(std::function<void()> function, JobCounter* counter, const char* name = "Job");
+        void runAfter(JobCounter* dependency, std::function<void()> function, JobCounter* counter, const char* name = "Job");
+        void parallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter, const char* name = "Job");
+        void wait(JobCounter* counter);
+        void shutdown();
+
+        uint32_t getThreadCount();
+        uint32_t getThreadIndex();
+        void     resetStats();
+        void     printUtilisation();
+
+        ~JobSystem();
+
+    private:
+        std::vector<std::thread>                        _workers;
+        std::vector<std::unique_ptr<WorkStealingQueue>> _queues;      // One per thread, index 0 is the main thread
+        std::vector<std::unique_ptr<JobThreadStats>>    _stats;
+        std::mutex                                      _externalMutex;
+        std::deque<Job*>                                _externalJobs; // Submitted from threads that aren't the job system's
+        std::atomic<bool>                               _running;
+        std::atomic<int>                                _queuedJobs;  // Jobs pushed but not yet picked up
+        std::mutex                                      _sleepMutex;
+        std::condition_variable                         _sleepCondition;
+        std::chrono::steady_clock::time_point           _statsStart;
+
+        void workerLoop(uint32_t threadIndex);
+        void submit(Job* job);
+        bool executeNextJob(uint32_t threadIndex);
+        void executeJob(Job* job);
+        Job* findJob(uint32_t threadIndex);
+        void finishJob(Job* job);
+};
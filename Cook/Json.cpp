@@ -0,0 +1,351 @@
+#include "Json.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const JsonValue NULL_VALUE;
+static const int       JSON_MAX_DEPTH = 256;      // Deeper than any real asset, stops a hostile file blowing the stack
+
+const JsonValue& JsonValue::operator[](std::string_view key) const
+{
+    if (type == JSON_OBJECT)
+    {
+        for (const std::pair<std::string, JsonValue>& member : object)
+        {
+            if (member.first == key)
+            {
+                return member.second;
+            }
+        }
+    }
+    return NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    return type == JSON_ARRAY && index < array.size() ? array[index] : NULL_VALUE;
+}
+
+size_t JsonValue::size() const
+{
+    return type == JSON_ARRAY ? array.size() : type == JSON_OBJECT ? object.size() : 0;
+}
+
+bool JsonValue::has(std::string_view key) const
+{
+    return (*this)[key].type != JSON_NULL;
+}
+
+double JsonValue::getNumber(double defaultValue) const
+{
+    return type == JSON_NUMBER ? number : defaultValue;
+}
+
+int64_t JsonValue::getInt(int64_t defaultValue) const
+{
+    // Casting a double outside int64_t's range is undefined, so those (and NaN) get the default too
+    if (type != JSON_NUMBER || !(number >= -9223372036854775808.0 && number < 9223372036854775808.0))
+    {
+        return defaultValue;
+    }
+    return static_cast<int64_t>(number);
+}
+
+bool JsonValue::getBool(bool defaultValue) const
+{
+    return type == JSON_BOOL ? boolean : defaultValue;
+}
+
+const std::string& JsonValue::getString() const
+{
+    return type == JSON_STRING ? string : NULL_VALUE.string;
+}
+
+// Recursive descent over the text, cursor is left just past whatever was parsed
+struct JsonParser
+{
+    const char* cursor;
+    const char* end;
+    const char* begin;
+
+    void skipWhitespace()
+    {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+        {
+            cursor++;
+        }
+    }
+
+    bool match(const char* literal)
+    {
+        size_t length = strlen(literal);
+        if (static_cast<size_t>(end - cursor) < length || memcmp(cursor, literal, length) != 0)
+        {
+            return false;
+        }
+        cursor += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string* string, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            string->push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            string->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            string->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            string->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            string->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            string->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            string->push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            string->push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            string->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            string->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    bool parseHex4(uint32_t* value)
+    {
+        if (end - cursor < 4)
+        {
+            return false;
+        }
+        *value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char     c     = *cursor++;
+            uint32_t digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+            if (digit > 15)
+            {
+                return false;
+            }
+            *value = *value * 16 + digit;
+        }
+        return true;
+    }
+
+    bool parseString(std::string* string)
+    {
+        cursor++;     // Opening quote
+        while (cursor < end && *cursor != '"')
+        {
+            // Runs without escapes are appended in one go
+            const char* runStart = cursor;
+            while (cursor < end && *cursor != '"' && *cursor != '\\')
+            {
+                cursor++;
+            }
+            string->append(runStart, cursor);
+            if (cursor >= end || *cursor == '"')
+            {
+                break;
+            }
+
+            cursor++;
+            if (cursor >= end)
+            {
+                return false;
+            }
+            char escape = *cursor++;
+            switch (escape)
+            {
+                case '"':  string->push_back('"');  break;
+                case '\\': string->push_back('\\'); break;
+                case '/':  string->push_back('/');  break;
+                case 'b':  string->push_back('\b'); break;
+                case 'f':  string->push_back('\f'); break;
+                case 'n':  string->push_back('\n'); break;
+                case 'r':  string->push_back('\r'); break;
+                case 't':  string->push_back('\t'); break;
+                case 'u':
+                {
+                    uint32_t codePoint;
+                    if (!parseHex4(&codePoint))
+                    {
+                        return false;
+                    }
+                    // Characters outside the basic plane come as a surrogate pair
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && match("\\u"))
+                    {
+                        uint32_t low;
+                        if (!parseHex4(&low) || low < 0xDC00 || low >= 0xE000)
+                        {
+                            return false;
+                        }
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(string, codePoint);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        if (cursor >= end)
+        {
+            return false;
+        }
+        cursor++;     // Closing quote
+        return true;
+    }
+
+    bool parseNumber(double* number)
+    {
+        // strtod would read past the end of an unterminated buffer, so the number is copied out first
+        const char* numberStart = cursor;
+        while (cursor < end && ((*cursor >= '0' && *cursor <= '9') || (*cursor != '\0' && strchr("+-.eE", *cursor))))
+        {
+            cursor++;
+        }
+        char   buffer[64];
+        size_t length = static_cast<size_t>(cursor - numberStart);
+        if (length == 0 || length >= sizeof(buffer))
+        {
+            return false;
+        }
+        memcpy(buffer, numberStart, length);
+        buffer[length] = '\0';
+
+        char* parsedEnd;
+        *number = strtod(buffer, &parsedEnd);
+        return parsedEnd == buffer + length;
+    }
+
+    bool parseValue(JsonValue* value, int depth)
+    {
+        if (depth > JSON_MAX_DEPTH)
+        {
+            return false;
+        }
+
+        skipWhitespace();
+        if (cursor >= end)
+        {
+            return false;
+        }
+
+        switch (*cursor)
+        {
+            case '{':
+            {
+                value->type = JSON_OBJECT;
+                cursor++;
+                skipWhitespace();
+                if (cursor < end && *cursor == '}')
+                {
+                    cursor++;
+                    return true;
+                }
+                while (true)
+                {
+                    skipWhitespace();
+                    if (cursor >= end || *cursor != '"')
+                    {
+                        return false;
+                    }
+                    value->object.emplace_back();
+                    if (!parseString(&value->object.back().first))
+                    {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if (cursor >= end || *cursor != ':')
+                    {
+                        return false;
+                    }
+                    cursor++;
+                    if (!parseValue(&value->object.back().second, depth + 1))
+                    {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if (cursor < end && *cursor == ',')
+                    {
+                        cursor++;
+                        continue;
+                    }
+                    if (cursor < end && *cursor == '}')
+                    {
+                        cursor++;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+            case '[':
+            {
+                value->type = JSON_ARRAY;
+                cursor++;
+                skipWhitespace();
+                if (cursor < end && *cursor == ']')
+                {
+                    cursor++;
+                    return true;
+                }
+                while (true)
+                {
+                    value->array.emplace_back();
+                    if (!parseValue(&value->array.back(), depth + 1))
+                    {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if (cursor < end && *cursor == ',')
+                    {
+                        cursor++;
+                        continue;
+                    }
+                    if (cursor < end && *cursor == ']')
+                    {
+                        cursor++;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+            case '"':
+                value->type = JSON_STRING;
+                return parseString(&value->string);
+            case 't':
+                value->type    = JSON_BOOL;
+                value->boolean = true;
+                return match("true");
+            case 'f':
+                value->type    = JSON_BOOL;
+                value->boolean = false;
+                return match("false");
+            case 'n':
+                value->type = JSON_NULL;
+                return match("null");
+            default:
+                value->type = JSON_NUMBER;
+                return parseNumber(&value->number);
+        }
+    }
+};
+
+bool parseJson(std::string_view text, JsonValue* root)
+{
+    JsonParser parser = { text.data(), text.data() + text.size(), text.data() };
+
+    *root = JsonValue();
+    bool parsed = parser.parseValue(root, 0);
+    parser.skipWhitespace();
+    if (!parsed || parser.cursor != parser.end)
+    {
+        printf("Failed to parse JSON at byte %zu\n", static_cast<size_t>(parser.cursor - parser.begin));
+        *root = JsonValue();
+        return false;
+    }
+    return true;
+}
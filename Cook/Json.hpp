@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum JsonType
+{
+    JSON_NULL = 0,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+// Parsed JSON document, just enough of one for asset formats like glTF. Looking up a missing member or index gives
+// a null value, so optional fields can be read with a default without checking for them first.
+struct JsonValue
+{
+    JsonType                                       type    = JSON_NULL;
+    bool                                           boolean = false;
+    double                                         number  = 0.0;
+    std::string                                    string;
+    std::vector<JsonValue>                         array;
+    std::vector<std::pair<std::string, JsonValue>> object;       // In document order
+
+    const JsonValue& operator[](std::string_view key) const;
+    const JsonValue& operator[](size_t index) const;
+    size_t           size() const;                               // Elements or members, 0 for anything else
+    bool             has(std::string_view key) const;
+
+    double             getNumber(double defaultValue = 0.0) const;
+    int64_t            getInt(int64_t defaultValue = 0) const;    // Default as well if it doesn't fit in an int64_t
+    bool               getBool(bool defaultValue = false) const;
+    const std::string& getString() const;                         // Empty unless this is a string
+};
+
+// Parses a whole document, on failure prints where it went wrong and returns false
+bool parseJson(std::string_view text, JsonValue* root);
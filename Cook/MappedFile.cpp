@@ -0,0 +1,68 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+{
+    _mapping = nullptr;
+    _size    = 0;
+}
+
+bool MappedFile::open(const std::string& filePath)
+{
+    close();
+
+    int file = ::open(filePath.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    // Empty files can't be mapped, and have nothing to read anyway
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    // Mapping holds its own reference to the file, the descriptor isn't needed after this
+    void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    _mapping = static_cast<const char*>(mapping);
+    _size    = static_cast<size_t>(fileStat.st_size);
+    return true;
+}
+
+bool MappedFile::isOpen()
+{
+    return _mapping != nullptr;
+}
+
+std::span<const char> MappedFile::getData()
+{
+    return std::span<const char>(_mapping, _size);
+}
+
+void MappedFile::close()
+{
+    if (_mapping)
+    {
+        munmap(const_cast<char*>(_mapping), _size);
+    }
+    _mapping = nullptr;
+    _size    = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
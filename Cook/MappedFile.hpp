@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+// Whole file mapped read only. Pages are read in as they are touched, and stay valid until close
+class MappedFile
+{
+    public:
+        MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool                  open(const std::string& filePath);
+        bool                  isOpen();
+        std::span<const char> getData();
+        void                  close();
+
+        ~MappedFile();
+
+    private:
+        const char* _mapping;
+        size_t      _size;
+};
@@ -0,0 +1,263 @@
+#include "MemoryTracker.hpp"
+
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+static const char* const CATEGORY_NAMES[MEMORY_CATEGORY_COUNT] = { "Mesh", "Texture", "Uniform", "Staging", "Attachment", "Other" };
+
+struct TrackedAllocation
+{
+    VkDeviceSize   size;
+    MemoryCategory category;
+    uint32_t       heapIndex;
+};
+
+struct MemoryTrackerState
+{
+    std::mutex                                            mutex;
+    VkPhysicalDevice                                      physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties                      memoryProperties = {};
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR           getMemoryProperties2 = nullptr;   // Set when the budget can be read
+    std::unordered_map<VkDeviceMemory, TrackedAllocation> allocations;
+    VkDeviceSize                                          categoryBytes[MEMORY_CATEGORY_COUNT] = {};
+    VkDeviceSize                                          heapBytes[VK_MAX_MEMORY_HEAPS] = {};
+    uint32_t                                              heapAllocationCount[VK_MAX_MEMORY_HEAPS] = {};
+
+    // Last VK_EXT_memory_budget reading, and what had been allocated at the time, so usage can be kept
+    // up to date between readings
+    VkDeviceSize                                          reportedUsage[VK_MAX_MEMORY_HEAPS] = {};
+    VkDeviceSize                                          reportedBudget[VK_MAX_MEMORY_HEAPS] = {};
+    VkDeviceSize                                          heapBytesAtReport[VK_MAX_MEMORY_HEAPS] = {};
+
+    float                                                 thresholdFraction = 0.0f;
+    MemoryThresholdCallback                               thresholdCallback;
+    bool                                                  overThreshold[VK_MAX_MEMORY_HEAPS] = {};
+};
+
+static MemoryTrackerState& getState()
+{
+    static MemoryTrackerState state;
+    return state;
+}
+
+// Usage and budget of one heap, state's mutex must be held
+static MemoryHeapUsage getHeapUsageLocked(MemoryTrackerState& state, uint32_t heapIndex)
+{
+    MemoryHeapUsage heapUsage;
+    heapUsage.heapIndex       = heapIndex;
+    heapUsage.flags           = state.memoryProperties.memoryHeaps[heapIndex].flags;
+    heapUsage.heapSize        = state.memoryProperties.memoryHeaps[heapIndex].size;
+    heapUsage.allocatedBytes  = state.heapBytes[heapIndex];
+    heapUsage.allocationCount = state.heapAllocationCount[heapIndex];
+    heapUsage.usage           = state.heapBytes[heapIndex];
+    heapUsage.budget          = heapUsage.heapSize;
+
+    if (state.getMemoryProperties2)
+    {
+        // Reported usage includes memory the driver allocated for us, so add our changes since the reading to it
+        VkDeviceSize usage = state.reportedUsage[heapIndex] + state.heapBytes[heapIndex];
+        heapUsage.usage    = usage > state.heapBytesAtReport[heapIndex] ? usage - state.heapBytesAtReport[heapIndex] : 0;
+        heapUsage.budget   = state.reportedBudget[heapIndex];
+    }
+    return heapUsage;
+}
+
+void MemoryTracker::init(VkInstance instance, VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled)
+{
+    MemoryTrackerState& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.physicalDevice = physicalDevice;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &state.memoryProperties);
+
+        // Budget comes back chained to the properties2 query, from VK_KHR_get_physical_device_properties2
+        if (memoryBudgetEnabled)
+        {
+            state.getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        }
+    }
+
+    if (!isBudgetAvailable())
+    {
+        printf("Memory budget unavailable, device doesn't support VK_EXT_memory_budget, using heap sizes\n");
+    }
+    update();
+}
+
+VkResult MemoryTracker::allocateMemory(VkDevice device, const VkMemoryAllocateInfo* allocateInfo, MemoryCategory category,
+                                       VkDeviceMemory* deviceMemory)
+{
+    VkResult result = vkAllocateMemory(device, allocateInfo, nullptr, deviceMemory);
+    if (result != VK_SUCCESS)
+    {
+        return result;
+    }
+
+    MemoryTrackerState& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        uint32_t heapIndex = state.memoryProperties.memoryTypes[allocateInfo->memoryTypeIndex].heapIndex;
+
+        state.allocations[*deviceMemory] = { allocateInfo->allocationSize, category, heapIndex };
+        state.categoryBytes[category]   += allocateInfo->allocationSize;
+        state.heapBytes[heapIndex]      += allocateInfo->allocationSize;
+        state.heapAllocationCount[heapIndex]++;
+    }
+
+    // Crossing is seen straight away, not just at the next update
+    checkThresholds();
+    return result;
+}
+
+void MemoryTracker::freeMemory(VkDevice device, VkDeviceMemory deviceMemory)
+{
+    if (deviceMemory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    MemoryTrackerState& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        auto allocation = state.allocations.find(deviceMemory);
+        if (allocation != state.allocations.end())
+        {
+            state.categoryBytes[allocation->second.category] -= allocation->second.size;
+            state.heapBytes[allocation->second.heapIndex]    -= allocation->second.size;
+            state.heapAllocationCount[allocation->second.heapIndex]--;
+            state.allocations.erase(allocation);
+        }
+    }
+
+    vkFreeMemory(device, deviceMemory, nullptr);
+}
+
+void MemoryTracker::update()
+{
+    MemoryTrackerState& state = getState();
+    if (state.getMemoryProperties2)
+    {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2 = {};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties2.pNext = &budgetProperties;
+
+        state.getMemoryProperties2(state.physicalDevice, &memoryProperties2);
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (uint32_t i = 0; i < state.memoryProperties.memoryHeapCount; i++)
+        {
+            state.reportedUsage[i]     = budgetProperties.heapUsage[i];
+            state.reportedBudget[i]    = budgetProperties.heapBudget[i];
+            state.heapBytesAtReport[i] = state.heapBytes[i];
+        }
+    }
+
+    checkThresholds();
+}
+
+void MemoryTracker::setThresholdCallback(float fractionOfBudget, MemoryThresholdCallback callback)
+{
+    MemoryTrackerState& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.thresholdFraction = fractionOfBudget;
+        state.thresholdCallback = callback;
+        for (bool& overThreshold : state.overThreshold)
+        {
+            overThreshold = false;
+        }
+    }
+    checkThresholds();
+}
+
+bool MemoryTracker::isBudgetAvailable()
+{
+    return getState().getMemoryProperties2 != nullptr;
+}
+
+VkDeviceSize MemoryTracker::getCategoryBytes(MemoryCategory category)
+{
+    MemoryTrackerState&         state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.categoryBytes[category];
+}
+
+VkDeviceSize MemoryTracker::getTotalBytes()
+{
+    MemoryTrackerState&         state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    VkDeviceSize totalBytes = 0;
+    for (VkDeviceSize categoryBytes : state.categoryBytes)
+    {
+        totalBytes += categoryBytes;
+    }
+    return totalBytes;
+}
+
+std::vector<MemoryHeapUsage> MemoryTracker::getHeapUsage()
+{
+    MemoryTrackerState&         state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    std::vector<MemoryHeapUsage> heapUsage;
+    for (uint32_t i = 0; i < state.memoryProperties.memoryHeapCount; i++)
+    {
+        heapUsage.push_back(getHeapUsageLocked(state, i));
+    }
+    return heapUsage;
+}
+
+void MemoryTracker::printReport()
+{
+    const double mebibyte = 1024.0 * 1024.0;
+
+    printf("Device memory (MiB):\n");
+    for (uint32_t category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+    {
+        printf("  %-12s %10.2f\n", CATEGORY_NAMES[category], getCategoryBytes(static_cast<MemoryCategory>(category)) / mebibyte);
+    }
+    for (const MemoryHeapUsage& heapUsage : getHeapUsage())
+    {
+        printf("  Heap %u%-6s %10.2f in %u allocations, usage %.2f of %.2f budget (heap %.2f)\n",
+               heapUsage.heapIndex, (heapUsage.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " local" : "",
+               heapUsage.allocatedBytes / mebibyte, heapUsage.allocationCount,
+               heapUsage.usage / mebibyte, heapUsage.budget / mebibyte, heapUsage.heapSize / mebibyte);
+    }
+}
+
+void MemoryTracker::checkThresholds()
+{
+    MemoryTrackerState&          state = getState();
+    std::vector<MemoryHeapUsage> crossed;
+    MemoryThresholdCallback      callback;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.thresholdCallback)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < state.memoryProperties.memoryHeapCount; i++)
+        {
+            MemoryHeapUsage heapUsage = getHeapUsageLocked(state, i);
+            bool            over      = heapUsage.usage > heapUsage.budget * static_cast<double>(state.thresholdFraction);
+            if (over && !state.overThreshold[i])
+            {
+                crossed.push_back(heapUsage);
+            }
+            state.overThreshold[i] = over;
+        }
+        callback = state.thresholdCallback;
+    }
+
+    // Called without the lock held, so the callback can free memory
+    for (const MemoryHeapUsage& heapUsage : crossed)
+    {
+        callback(heapUsage);
+    }
+}
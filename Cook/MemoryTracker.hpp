@@ -0,0 +1,59 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// What a device memory allocation is used for
+enum MemoryCategory
+{
+    MEMORY_CATEGORY_MESH = 0,       // Vertex and index buffers
+    MEMORY_CATEGORY_TEXTURE,
+    MEMORY_CATEGORY_UNIFORM,
+    MEMORY_CATEGORY_STAGING,        // Host visible upload buffers, freed once the copy has finished
+    MEMORY_CATEGORY_ATTACHMENT,     // Depth buffer and offscreen colour images
+    MEMORY_CATEGORY_OTHER,
+    MEMORY_CATEGORY_COUNT
+};
+
+// Live totals for one memory heap
+struct MemoryHeapUsage
+{
+    uint32_t          heapIndex;
+    VkMemoryHeapFlags flags;
+    VkDeviceSize      heapSize;
+    VkDeviceSize      allocatedBytes;       // Live allocations made through MemoryTracker
+    uint32_t          allocationCount;
+    VkDeviceSize      usage;                // Process usage reported by VK_EXT_memory_budget, else allocatedBytes
+    VkDeviceSize      budget;               // Budget reported by VK_EXT_memory_budget, else heapSize
+};
+
+// Called when a heap's usage goes over the threshold, not again until it has dropped back below it
+using MemoryThresholdCallback = std::function<void(const MemoryHeapUsage& heapUsage)>;
+
+// Every vkAllocateMemory / vkFreeMemory goes through here, so device memory use is known per category and per heap.
+// With VK_EXT_memory_budget the OS reported budget and usage are read on update (once per frame); without it the
+// heap size stands in for the budget. Like CpuProfiler it is static, allocations are made from free functions
+// (createBuffer) and from several classes that only hold a VkDevice.
+class MemoryTracker
+{
+    public:
+        static void     init(VkInstance instance, VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled);
+        static VkResult allocateMemory(VkDevice device, const VkMemoryAllocateInfo* allocateInfo, MemoryCategory category,
+                                       VkDeviceMemory* deviceMemory);
+        static void     freeMemory(VkDevice device, VkDeviceMemory deviceMemory);
+        static void     update();
+        static void     setThresholdCallback(float fractionOfBudget, MemoryThresholdCallback callback);
+
+        static bool                         isBudgetAvailable();
+        static VkDeviceSize                 getCategoryBytes(MemoryCategory category);
+        static VkDeviceSize                 getTotalBytes();
+        static std::vector<MemoryHeapUsage> getHeapUsage();
+        static void                         printReport();
+
+    private:
+        static void checkThresholds();
+};
@@ -1,4 +1,62 @@
 #include "Mesh.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Nearest half float, for texture coordinates outside what UNORM can hold
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign     = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int32_t  exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+    {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);     // Infinity or NaN
+    }
+    if (exponent >= 31)
+    {
+        return sign | 0x7C00;                              // Too big, infinity
+    }
+    if (exponent <= 0)
+    {
+        // Denormal, or zero if it is too small even for that
+        if (exponent < -10)
+        {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half  = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Rounding up can carry into the exponent, which is still the right answer
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+static uint16_t floatToUnorm16(float value)
+{
+    return static_cast<uint16_t>(lroundf(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+static uint8_t floatToUnorm8(float value)
+{
+    return static_cast<uint8_t>(lroundf(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
 
 
 Mesh::Mesh()
@@ -15,12 +73,44 @@ Mesh::Mesh(VkPhysicalDevice newPhysicalDevice,
 {
     _vertexCount = static_cast<int>(vertices->size());
     _indexCount = static_cast<int>(indices->size());
+    _lods = { { 0, static_cast<uint32_t>(indices->size()), 0.0f } };
     _physicalDevice = newPhysicalDevice;
     _device = newDevice;
-    createVertexBuffer(transferQueue, transferCommandPool, vertices);
-    createIndexBuffer(transferQueue, transferCommandPool, indices);
+    calculateBoundingSphere(*vertices);
+
+    // Uploaded on their own, straight away
+    BufferUploadBatch uploadBatch;
+    uploadBatch.init(_physicalDevice, _device, transferQueue, transferCommandPool);
+    createBuffers(&uploadBatch, *vertices, *indices, false);
+    uploadBatch.submit();
     
-    _model.model = glm::mat4(1.0f);
+    _texId = newTexId;
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice,
+           VkDevice newDevice,
+           BufferUploadBatch* uploadBatch,
+           std::span<const Vertex> vertices,
+           std::span<const uint32_t> indices,
+           glm::vec3 boundingCentre,
+           float boundingRadius,
+           int newTexId,
+           std::span<const MeshLod> lods,
+           bool packVertices)
+{
+    _vertexCount = static_cast<int>(vertices.size());
+    _indexCount = static_cast<int>(indices.size());
+    _lods.assign(lods.begin(), lods.end());
+    if (_lods.empty())
+    {
+        _lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+    }
+    _physicalDevice = newPhysicalDevice;
+    _device = newDevice;
+    _boundingCentre = boundingCentre;
+    _boundingRadius = boundingRadius;
+    createBuffers(uploadBatch, vertices, indices, packVertices);
+
     _texId = newTexId;
 }
 
@@ -29,14 +119,16 @@ int Mesh::getTexId()
     return _texId;
 }
 
-void Mesh::setModel(glm::mat4 newModel)
+void Mesh::setPipelineState(const PipelineStateDesc& pipelineState)
 {
-    _model.model = newModel;
+    // Vertex format is the buffer's, whatever else the caller changes
+    _pipelineState              = pipelineState;
+    _pipelineState.vertexFormat = _vertexFormat;
 }
 
-Model Mesh::getModel()
+const PipelineStateDesc& Mesh::getPipelineState()
 {
-    return _model;
+    return _pipelineState;
 }
 
 int Mesh::getVertexCount()
@@ -59,12 +151,42 @@ VkBuffer Mesh::getIndexBuffer()
     return _indexVkBuffer;
 }
 
+VkIndexType Mesh::getIndexType()
+{
+    return _indexType;
+}
+
+const std::vector<MeshLod>& Mesh::getLods()
+{
+    return _lods;
+}
+
+glm::vec3 Mesh::getBoundingCentre()
+{
+    return _boundingCentre;
+}
+
+float Mesh::getBoundingRadius()
+{
+    return _boundingRadius;
+}
+
+VertexFormat Mesh::getVertexFormat()
+{
+    return _vertexFormat;
+}
+
+const glm::mat4& Mesh::getDequantisation()
+{
+    return _dequantisation;
+}
+
 void Mesh::destroyBuffers()
 {
     vkDestroyBuffer(_device, _vertexVkBuffer, nullptr);
-    vkFreeMemory(_device, _vertexVkDeviceMemory, nullptr);
+    MemoryTracker::freeMemory(_device, _vertexVkDeviceMemory);
     vkDestroyBuffer(_device, _indexVkBuffer, nullptr);
-    vkFreeMemory(_device, _indexVkDeviceMemory, nullptr);
+    MemoryTracker::freeMemory(_device, _indexVkDeviceMemory);
 }
 
 
@@ -72,78 +194,129 @@ Mesh::~Mesh()
 {
 }
 
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
+void Mesh::calculateBoundingSphere(std::span<const Vertex> vertices)
 {
-    // Get size of buffer needed for vertices
-    VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();
+    _boundingCentre = glm::vec3(0.0f);
+    _boundingRadius = 0.0f;
+    if (vertices.empty())
+    {
+        return;
+    }
+
+    // Centre of the axis aligned bounding box, then radius out to the furthest vertex
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    for (const Vertex& vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+    }
+    _boundingCentre = (minPos + maxPos) * 0.5f;
 
-    // Temporary buffer to "stage" vertex data before transferring to GPU
-    VkBuffer stagingVkBuffer;
-    VkDeviceMemory stagingVkDeviceMemory;
+    for (const Vertex& vertex : vertices)
+    {
+        _boundingRadius = std::max(_boundingRadius, glm::length(vertex.pos - _boundingCentre));
+    }
+}
 
-    // Create Staging Buffer and Allocate Memory to it
-    createBuffer(_physicalDevice, _device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingVkBuffer, &stagingVkDeviceMemory);
+void Mesh::createBuffers(BufferUploadBatch* uploadBatch, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                         bool packVertices)
+{
+    CPU_PROFILE_SCOPE("Mesh::createBuffers");
 
-    // MAP MEMORY TO VERTEX BUFFER
-    void * data; // 1. Create pointer to a point in normal memory
-    vkMapMemory(_device,
-                stagingVkDeviceMemory,
-                0, bufferSize,
-                0, &data); // 2. "Map" the vertex buffer memory to that point
-    memcpy(data,
-           vertices->data(),
-           (size_t)bufferSize); // 3. Copy memory from vertices vec to the point
-    
-    vkUnmapMemory(_device, stagingVkDeviceMemory); // 4. Unmap the vertex buffer memory
+    _vertexFormat   = VERTEX_FORMAT_FULL;
+    _dequantisation = glm::mat4(1.0f);
+    std::vector<char> packedVertices;
+    if (packVertices && !vertices.empty())
+    {
+        packedVertices = packVertexData(vertices);
+    }
+    _pipelineState.vertexFormat = _vertexFormat;
+    VkDeviceSize vertexBytes    = packedVertices.empty() ? vertices.size_bytes() : packedVertices.size();
 
-    // Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER)
+    // Small meshes, most of them, can index every vertex with 16 bits
+    _indexType = vertices.size() <= UINT16_INDEX_MAX_VERTICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    std::vector<char> shortIndices;
+    if (_indexType == VK_INDEX_TYPE_UINT16)
+    {
+        shortIndices.resize(indices.size() * sizeof(uint16_t));
+        uint16_t* shortIndex = reinterpret_cast<uint16_t*>(shortIndices.data());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            shortIndex[i] = static_cast<uint16_t>(indices[i]);
+        }
+    }
+    VkDeviceSize indexBytes = _indexType == VK_INDEX_TYPE_UINT16 ? shortIndices.size() : indices.size_bytes();
+
+    // Create buffers with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER / INDEX_BUFFER)
     // Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU and only accessible by it and not CPU (host)
     createBuffer(_physicalDevice,
-                 _device, bufferSize,
+                 _device, vertexBytes,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                  &_vertexVkBuffer,
-                 &_vertexVkDeviceMemory);
-
-    // Copy staging buffer to vertex buffer on GPU
-    copyBuffer(_device, transferQueue, transferCommandPool, stagingVkBuffer, _vertexVkBuffer, bufferSize);
+                 &_vertexVkDeviceMemory,
+                 MEMORY_CATEGORY_MESH);
+    createBuffer(_physicalDevice, _device, indexBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_indexVkBuffer, &_indexVkDeviceMemory, MEMORY_CATEGORY_MESH);
 
-    // Clean up staging buffer parts
-    vkDestroyBuffer(_device, stagingVkBuffer, nullptr);
-    vkFreeMemory(_device, stagingVkDeviceMemory, nullptr);
+    // Data goes through the batch's staging buffer when it is submitted
+    if (packedVertices.empty())
+    {
+        uploadBatch->addUpload(_vertexVkBuffer, std::span<const char>(reinterpret_cast<const char*>(vertices.data()), vertices.size_bytes()));
+    }
+    else
+    {
+        uploadBatch->addUpload(_vertexVkBuffer, std::move(packedVertices));
+    }
+    if (_indexType == VK_INDEX_TYPE_UINT16)
+    {
+        uploadBatch->addUpload(_indexVkBuffer, std::move(shortIndices));
+    }
+    else
+    {
+        uploadBatch->addUpload(_indexVkBuffer, std::span<const char>(reinterpret_cast<const char*>(indices.data()), indices.size_bytes()));
+    }
 }
 
-void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
+std::vector<char> Mesh::packVertexData(std::span<const Vertex> vertices)
 {
-    // Get size of buffer needed for indices
-    VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
-    
-    // Temporary buffer to "stage" index data before transferring to GPU
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(_physicalDevice,
-                 _device, bufferSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 &stagingBuffer, &stagingBufferMemory);
-
-    // MAP MEMORY TO INDEX BUFFER
-    void * data;
-    vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices->data(), (size_t)bufferSize);
-    vkUnmapMemory(_device, stagingBufferMemory);
+    CPU_PROFILE_SCOPE("Mesh::packVertexData");
 
-    // Create buffer for INDEX data on GPU access only area
-    createBuffer(_physicalDevice, _device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_indexVkBuffer, &_indexVkDeviceMemory);
+    // Positions are spread over the bounding box, each axis gets all 65536 steps
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    bool      unitTex = true;
+    for (const Vertex& vertex : vertices)
+    {
+        minPos  = glm::min(minPos, vertex.pos);
+        maxPos  = glm::max(maxPos, vertex.pos);
+        unitTex = unitTex && vertex.tex.x >= 0.0f && vertex.tex.x <= 1.0f && vertex.tex.y >= 0.0f && vertex.tex.y <= 1.0f;
+    }
+    glm::vec3 extent = maxPos - minPos;
+    glm::vec3 scale(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
 
-    // Copy from staging buffer to GPU access buffer
-    copyBuffer(_device, transferQueue, transferCommandPool, stagingBuffer, _indexVkBuffer, bufferSize);
+    // Fetch gives back pos / 65535 in [0, 1], this scales and moves that back onto the box
+    _vertexFormat   = unitTex ? VERTEX_FORMAT_PACKED : VERTEX_FORMAT_PACKED_HALF_TEX;
+    _dequantisation = glm::mat4(glm::vec4(extent.x, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, extent.y, 0.0f, 0.0f),
+                                glm::vec4(0.0f, 0.0f, extent.z, 0.0f), glm::vec4(minPos, 1.0f));
 
-    // Destroy + Release Staging Buffer resources
-    vkDestroyBuffer(_device, stagingBuffer, nullptr);
-    vkFreeMemory(_device, stagingBufferMemory, nullptr);
+    std::vector<char> packedData(vertices.size() * sizeof(PackedVertex));
+    PackedVertex*     packedVertices = reinterpret_cast<PackedVertex*>(packedData.data());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& packed = packedVertices[i];
+        packed.pos[0] = floatToUnorm16((vertex.pos.x - minPos.x) * scale.x);
+        packed.pos[1] = floatToUnorm16((vertex.pos.y - minPos.y) * scale.y);
+        packed.pos[2] = floatToUnorm16((vertex.pos.z - minPos.z) * scale.z);
+        packed.pos[3] = 0;
+        packed.col[0] = floatToUnorm8(vertex.col.x);
+        packed.col[1] = floatToUnorm8(vertex.col.y);
+        packed.col[2] = floatToUnorm8(vertex.col.z);
+        packed.col[3] = 255;
+        packed.tex[0] = unitTex ? floatToUnorm16(vertex.tex.x) : floatToHalf(vertex.tex.x);
+        packed.tex[1] = unitTex ? floatToUnorm16(vertex.tex.y) : floatToHalf(vertex.tex.y);
+    }
+    return packedData;
 }
-
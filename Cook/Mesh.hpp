@@ -3,9 +3,12 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <span>
 #include <vector>
 
 #include "Utilities.hpp"
+#include "PipelineLibrary.hpp"
+#include "BufferUploadBatch.hpp"
 
 struct Model {
     glm::mat4 model;
@@ -22,40 +25,68 @@ class Mesh
              std::vector<Vertex>* vertices,
              std::vector<uint32_t> * indices,
              int newTexId);
+        // Straight from memory such as a mapped mesh file, with its bounding sphere already worked out.
+        // Buffers are filled when uploadBatch is submitted, vertices and indices have to stay valid until then.
+        // Packed meshes store PackedVertex instead, about half the memory and fetch bandwidth.
+        // lods are ranges of indices, no lods meaning all of them is the only level
+        Mesh(VkPhysicalDevice newPhysicalDevice,
+             VkDevice newDevice,
+             BufferUploadBatch* uploadBatch,
+             std::span<const Vertex> vertices,
+             std::span<const uint32_t> indices,
+             glm::vec3 boundingCentre,
+             float boundingRadius,
+             int newTexId,
+             std::span<const MeshLod> lods = {},
+             bool packVertices = false);
         
         int getTexId();
-    
-        void setModel(glm::mat4 newModel);
-        Model getModel();
+
+        void                     setPipelineState(const PipelineStateDesc& pipelineState);
+        const PipelineStateDesc& getPipelineState();
 
         int getVertexCount();
         VkBuffer getVertexBuffer();
     
         int getIndexCount();
         VkBuffer getIndexBuffer();
+        VkIndexType getIndexType();
+        const std::vector<MeshLod>& getLods();      // Finest first, at least one
+
+        glm::vec3 getBoundingCentre();
+        float     getBoundingRadius();
+
+        VertexFormat     getVertexFormat();
+        const glm::mat4& getDequantisation();    // Packed positions to model space, goes before the model transform
 
         void destroyBuffers();
 
         ~Mesh();
 
     private:
-        Model            _model;
         int              _texId;
+        PipelineStateDesc _pipelineState;   // Blend/cull/depth variant this mesh is drawn with
         int              _vertexCount;
         int              _indexCount;
         VkBuffer         _vertexVkBuffer;
         VkDeviceMemory   _vertexVkDeviceMemory;
         VkBuffer         _indexVkBuffer;
         VkDeviceMemory   _indexVkDeviceMemory;
+        VkIndexType      _indexType;          // UINT16 when the vertex count allows, half the index memory and fetch
+        std::vector<MeshLod> _lods;
+        glm::vec3        _boundingCentre;     // Bounding sphere in model space, used for culling
+        float            _boundingRadius;
+        VertexFormat     _vertexFormat;
+        glm::mat4        _dequantisation;
     
         VkPhysicalDevice _physicalDevice;
         VkDevice         _device;
 
-        void createVertexBuffer(VkQueue transferQueue,
-                                VkCommandPool transferCommandPool,
-                                std::vector<Vertex>* vertices);
-    
-        void createIndexBuffer(VkQueue transferQueue,
-                               VkCommandPool transferCommandPool,
-                               std::vector<uint32_t>* indices);
+        void calculateBoundingSphere(std::span<const Vertex> vertices);
+        std::vector<char> packVertexData(std::span<const Vertex> vertices);    // Sets the vertex format and dequantisation too
+
+        void createBuffers(BufferUploadBatch* uploadBatch,
+                           std::span<const Vertex> vertices,
+                           std::span<const uint32_t> indices,
+                           bool packVertices);
 };
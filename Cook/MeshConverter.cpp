@@ -0,0 +1,194 @@
+#include "MeshConverter.hpp"
+#include "MeshFile.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+// Resolves an OBJ index (1 based, or negative counting back from the end) to 0 based, -1 if it is out of range
+static int resolveObjIndex(long index, size_t count)
+{
+    long resolved = index > 0 ? index - 1 : static_cast<long>(count) + index;
+    return resolved >= 0 && resolved < static_cast<long>(count) ? static_cast<int>(resolved) : -1;
+}
+
+bool loadObjFile(const std::string& filePath, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+    CPU_PROFILE_SCOPE("loadObjFile");
+
+    std::vector<char> fileData;
+    try
+    {
+        fileData = readFile(filePath);
+    }
+    catch (const std::exception&)
+    {
+        printf("Failed to open OBJ file %s\n", filePath.c_str());
+        return false;
+    }
+    fileData.push_back('\0');
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+
+    // Position and texture coordinate index pair to the vertex made for it
+    std::unordered_map<uint64_t, uint32_t> vertexLookup;
+    std::vector<uint32_t>                  polygon;
+
+    vertices->clear();
+    indices->clear();
+
+    const char* cursor = fileData.data();
+    while (*cursor)
+    {
+        const char* lineEnd = cursor;
+        while (*lineEnd && *lineEnd != '\n')
+        {
+            lineEnd++;
+        }
+
+        if (cursor[0] == 'v' && cursor[1] == ' ')
+        {
+            char*     next = const_cast<char*>(cursor + 2);
+            glm::vec3 position;
+            position.x = strtof(next, &next);
+            position.y = strtof(next, &next);
+            position.z = strtof(next, &next);
+            positions.push_back(position);
+        }
+        else if (cursor[0] == 'v' && cursor[1] == 't' && cursor[2] == ' ')
+        {
+            char*     next = const_cast<char*>(cursor + 3);
+            glm::vec2 texCoord;
+            texCoord.x = strtof(next, &next);
+            texCoord.y = strtof(next, &next);
+            texCoords.push_back(texCoord);
+        }
+        else if (cursor[0] == 'f' && cursor[1] == ' ')
+        {
+            // Each corner is v, v/vt, v//vn or v/vt/vn, normals aren't used
+            polygon.clear();
+            char* next = const_cast<char*>(cursor + 2);
+            while (next < lineEnd)
+            {
+                while (next < lineEnd && isspace(static_cast<unsigned char>(*next)))
+                {
+                    next++;
+                }
+                if (next >= lineEnd)
+                {
+                    break;
+                }
+
+                char* parsed;
+                long  positionIndex = strtol(next, &parsed, 10);
+                long  texCoordIndex = 0;
+                if (parsed == next)
+                {
+                    printf("Failed to read a face in OBJ file %s\n", filePath.c_str());
+                    return false;
+                }
+                next = parsed;
+                if (*next == '/')
+                {
+                    next++;
+                    if (*next != '/')
+                    {
+                        texCoordIndex = strtol(next, &next, 10);
+                    }
+                    if (*next == '/')
+                    {
+                        strtol(next + 1, &next, 10);
+                    }
+                }
+
+                int position = resolveObjIndex(positionIndex, positions.size());
+                int texCoord = texCoordIndex != 0 ? resolveObjIndex(texCoordIndex, texCoords.size()) : -1;
+                if (position < 0)
+                {
+                    printf("OBJ file %s has a face with a missing vertex\n", filePath.c_str());
+                    return false;
+                }
+
+                uint64_t key   = (static_cast<uint64_t>(position) << 32) | static_cast<uint32_t>(texCoord);
+                auto     found = vertexLookup.find(key);
+                if (found == vertexLookup.end())
+                {
+                    Vertex vertex = {};
+                    vertex.pos = positions[position];
+                    vertex.col = glm::vec3(1.0f, 1.0f, 1.0f);
+                    vertex.tex = texCoord >= 0 ? glm::vec2(texCoords[texCoord].x, 1.0f - texCoords[texCoord].y) : glm::vec2(0.0f);
+                    found = vertexLookup.emplace(key, static_cast<uint32_t>(vertices->size())).first;
+                    vertices->push_back(vertex);
+                }
+                polygon.push_back(found->second);
+            }
+
+            for (size_t i = 2; i < polygon.size(); i++)
+            {
+                indices->push_back(polygon[0]);
+                indices->push_back(polygon[i - 1]);
+                indices->push_back(polygon[i]);
+            }
+        }
+
+        cursor = *lineEnd ? lineEnd + 1 : lineEnd;
+    }
+
+    if (indices->empty())
+    {
+        printf("OBJ file %s has no faces\n", filePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool convertToMeshFile(const std::string& sourcePath, const std::string& meshFilePath)
+{
+    CPU_PROFILE_SCOPE("convertToMeshFile");
+
+    std::string extension = sourcePath.substr(std::min(sourcePath.find_last_of('.'), sourcePath.size()));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    std::vector<Vertex>   vertices;
+    std::vector<uint32_t> indices;
+    if (extension == ".obj")
+    {
+        if (!loadObjFile(sourcePath, &vertices, &indices))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        printf("Can't convert %s, only OBJ files are supported\n", sourcePath.c_str());
+        return false;
+    }
+
+    // Optimised once here, so loading the file is still just a copy
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+    optimizeMesh(&vertices, &indices, &before, &after);
+
+    // Coarser levels go after the full mesh in the same indices
+    std::vector<MeshLod> lods;
+    generateLods(vertices, &indices, &lods);
+
+    if (!MeshFile::write(meshFilePath, vertices, indices, lods))
+    {
+        return false;
+    }
+    printf("Converted %s to %s, %zu vertices and %u triangles\n", sourcePath.c_str(), meshFilePath.c_str(),
+           vertices.size(), lods[0].indexCount / 3);
+    for (size_t i = 1; i < lods.size(); i++)
+    {
+        printf("LOD %zu: %u triangles, error %g\n", i, lods[i].indexCount / 3, lods[i].error);
+    }
+    printf("Vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.getAcmr(), after.getAcmr(), before.getAtvr(), after.getAtvr());
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Utilities.hpp"
+
+// Reads a Wavefront OBJ file's triangles into Vertex form. Polygons are split into fans, vertices that share a
+// position and texture coordinate are shared, and texture coordinates are flipped to Vulkan's top left origin.
+// OBJ has no vertex colour, so vertices are white.
+bool loadObjFile(const std::string& filePath, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+// Converts an interchange format mesh into a mesh file (see MeshFile), picked by the source's extension.
+// The mesh is run through optimizeMesh first.
+bool convertToMeshFile(const std::string& sourcePath, const std::string& meshFilePath);
@@ -0,0 +1,230 @@
+#include "MeshFile.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char     MESH_FILE_MAGIC[8]  = { 'C', 'O', 'O', 'K', 'M', 'E', 'S', 'H' };
+static const uint32_t MESH_FILE_VERSION   = 1;
+static const uint64_t MESH_FILE_ALIGNMENT = 64;
+
+// The layout Vertex has, files written for any other are refused
+static const MeshFileAttribute VERTEX_ATTRIBUTES[] =
+{
+    { 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos) },
+    { 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, col) },
+    { 2, VK_FORMAT_R32G32_SFLOAT,    offsetof(Vertex, tex) },
+};
+static const uint32_t VERTEX_ATTRIBUTE_COUNT = sizeof(VERTEX_ATTRIBUTES) / sizeof(VERTEX_ATTRIBUTES[0]);
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+MeshFile::MeshFile()
+{
+    _header = nullptr;
+}
+
+bool MeshFile::open(const std::string& filePath)
+{
+    CPU_PROFILE_SCOPE("MeshFile::open");
+
+    close();
+
+    if (!_file.open(filePath))
+    {
+        printf("Failed to open mesh file %s\n", filePath.c_str());
+        return false;
+    }
+
+    if (!parse(_file.getData()))
+    {
+        printf("Mesh file %s is corrupt, from another version or for another vertex layout\n", filePath.c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshFile::parse(std::span<const char> data)
+{
+    _header = nullptr;
+    _data   = {};
+    if (data.size() < sizeof(MeshFileHeader) || reinterpret_cast<uintptr_t>(data.data()) % alignof(MeshFileHeader) != 0)
+    {
+        return false;
+    }
+
+    // Only the header is checked, the data itself is trusted to be what the converter wrote
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(data.data());
+    if (memcmp(header->magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC)) != 0 || header->version != MESH_FILE_VERSION
+        || header->vertexStride != sizeof(Vertex) || header->attributeCount != VERTEX_ATTRIBUTE_COUNT
+        || header->lodCount == 0 || header->lodCount > MESH_FILE_MAX_LODS)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+    {
+        if (memcmp(&header->attributes[i], &VERTEX_ATTRIBUTES[i], sizeof(MeshFileAttribute)) != 0)
+        {
+            return false;
+        }
+    }
+
+    // Blobs have to be inside the data, and every level of detail inside the indices
+    uint64_t vertexBytes = header->vertexCount * sizeof(Vertex);
+    uint64_t indexBytes  = header->indexCount * sizeof(uint32_t);
+    if (header->vertexCount > data.size() / sizeof(Vertex) || header->indexCount > data.size() / sizeof(uint32_t)
+        || header->vertexOffset % MESH_FILE_ALIGNMENT != 0 || header->indexOffset % MESH_FILE_ALIGNMENT != 0
+        || header->vertexOffset > data.size() || vertexBytes > data.size() - header->vertexOffset
+        || header->indexOffset > data.size() || indexBytes > data.size() - header->indexOffset)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->lodCount; i++)
+    {
+        if (static_cast<uint64_t>(header->lods[i].firstIndex) + header->lods[i].indexCount > header->indexCount)
+        {
+            return false;
+        }
+    }
+
+    _header = header;
+    _data   = data;
+    return true;
+}
+
+void MeshFile::close()
+{
+    _file.close();
+    _header = nullptr;
+    _data   = {};
+}
+
+std::span<const Vertex> MeshFile::getVertices()
+{
+    if (!_header)
+    {
+        return {};
+    }
+    return std::span<const Vertex>(reinterpret_cast<const Vertex*>(_data.data() + _header->vertexOffset), _header->vertexCount);
+}
+
+std::span<const uint32_t> MeshFile::getIndices()
+{
+    if (!_header)
+    {
+        return {};
+    }
+    return std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(_data.data() + _header->indexOffset), _header->indexCount);
+}
+
+std::span<const MeshFileLod> MeshFile::getLods()
+{
+    if (!_header)
+    {
+        return {};
+    }
+    return std::span<const MeshFileLod>(_header->lods, _header->lodCount);
+}
+
+glm::vec3 MeshFile::getBoundingCentre()
+{
+    return _header ? glm::vec3(_header->boundingCentre[0], _header->boundingCentre[1], _header->boundingCentre[2]) : glm::vec3(0.0f);
+}
+
+float MeshFile::getBoundingRadius()
+{
+    return _header ? _header->boundingRadius : 0.0f;
+}
+
+bool MeshFile::write(const std::string& filePath, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                     std::span<const MeshFileLod> lods)
+{
+    if (lods.size() > MESH_FILE_MAX_LODS)
+    {
+        printf("Mesh file %s can have at most %u levels of detail\n", filePath.c_str(), MESH_FILE_MAX_LODS);
+        return false;
+    }
+
+    MeshFileHeader header = {};
+    memcpy(header.magic, MESH_FILE_MAGIC, sizeof(MESH_FILE_MAGIC));
+    header.version        = MESH_FILE_VERSION;
+    header.vertexStride   = sizeof(Vertex);
+    header.attributeCount = VERTEX_ATTRIBUTE_COUNT;
+    std::copy(std::begin(VERTEX_ATTRIBUTES), std::end(VERTEX_ATTRIBUTES), header.attributes);
+    header.vertexOffset   = alignUp(sizeof(MeshFileHeader));
+    header.vertexCount    = vertices.size();
+    header.indexOffset    = alignUp(header.vertexOffset + vertices.size_bytes());
+    header.indexCount     = indices.size();
+
+    // Without a table the whole index buffer is the one level of detail
+    if (lods.empty())
+    {
+        header.lodCount = 1;
+        header.lods[0]  = { 0, static_cast<uint32_t>(indices.size()), 0.0f };
+    }
+    else
+    {
+        header.lodCount = static_cast<uint32_t>(lods.size());
+        std::copy(lods.begin(), lods.end(), header.lods);
+    }
+
+    // Same bounding sphere Mesh would work out, so loading doesn't have to go over the vertices
+    glm::vec3 minPos(0.0f);
+    glm::vec3 maxPos(0.0f);
+    if (!vertices.empty())
+    {
+        minPos = vertices[0].pos;
+        maxPos = vertices[0].pos;
+    }
+    for (const Vertex& vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+    }
+    glm::vec3 centre = (minPos + maxPos) * 0.5f;
+    float     radius = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        radius = std::max(radius, glm::length(vertex.pos - centre));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        header.boundsMin[i]      = minPos[i];
+        header.boundsMax[i]      = maxPos[i];
+        header.boundingCentre[i] = centre[i];
+    }
+    header.boundingRadius = radius;
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open())
+    {
+        printf("Failed to create mesh file %s\n", filePath.c_str());
+        return false;
+    }
+
+    std::vector<char> padding(MESH_FILE_ALIGNMENT, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding.data(), header.vertexOffset - sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size_bytes());
+    file.write(padding.data(), header.indexOffset - header.vertexOffset - vertices.size_bytes());
+    file.write(reinterpret_cast<const char*>(indices.data()), indices.size_bytes());
+
+    if (!file.good())
+    {
+        printf("Failed to write mesh file %s\n", filePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+MeshFile::~MeshFile()
+{
+    close();
+}
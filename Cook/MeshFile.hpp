@@ -0,0 +1,78 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Utilities.hpp"
+#include "MappedFile.hpp"
+
+const uint32_t MESH_FILE_MAX_ATTRIBUTES = 8;
+const uint32_t MESH_FILE_MAX_LODS = 8;
+
+// One vertex attribute, as a pipeline's vertex input would describe it
+struct MeshFileAttribute
+{
+    uint32_t location;
+    uint32_t format;             // VkFormat
+    uint32_t offset;
+};
+
+// Levels of detail are stored as the renderer uses them
+using MeshFileLod = MeshLod;
+
+// Start of a mesh file, the vertex and index data follow, each MESH_FILE_ALIGNMENT aligned:
+//   header | vertices | indices
+// Everything is stored as the GPU takes it, so a loaded file is used where it lies in memory
+struct MeshFileHeader
+{
+    char              magic[8];
+    uint32_t          version;
+    uint32_t          vertexStride;
+    uint32_t          attributeCount;
+    uint32_t          lodCount;
+    uint64_t          vertexOffset;
+    uint64_t          vertexCount;
+    uint64_t          indexOffset;
+    uint64_t          indexCount;
+    float             boundsMin[3];
+    float             boundsMax[3];
+    float             boundingCentre[3];     // Sphere around the vertices, what culling uses
+    float             boundingRadius;
+    MeshFileAttribute attributes[MESH_FILE_MAX_ATTRIBUTES];
+    MeshFileLod       lods[MESH_FILE_MAX_LODS];
+};
+
+// Binary mesh file, memory mapped and read in place: the vertices and indices are spans into the mapping that go
+// straight into the staging buffers, no parsing and no vectors in between. Produced by the converters in MeshConverter.
+// Files are only accepted if their vertex layout is the one Vertex has, which is what the pipelines are built for.
+class MeshFile
+{
+    public:
+        MeshFile();
+
+        bool open(const std::string& filePath);
+        void close();
+
+        std::span<const Vertex>   getVertices();
+        std::span<const uint32_t> getIndices();
+        std::span<const MeshFileLod> getLods();
+        glm::vec3 getBoundingCentre();
+        float     getBoundingRadius();
+
+        static bool write(const std::string& filePath, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                          std::span<const MeshFileLod> lods = {});
+
+        ~MeshFile();
+
+    private:
+        MappedFile            _file;
+        const MeshFileHeader* _header;
+        std::span<const char> _data;              // _file's data, once the header has been checked
+
+        bool parse(std::span<const char> data);
+};
@@ -0,0 +1,357 @@
+#include "MeshOptimizer.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Cache modelled by optimizeVertexCache, an LRU a little bigger than real hardware so the order suits most GPUs
+static const int   FORSYTH_CACHE_SIZE     = 32;
+static const float FORSYTH_DECAY_POWER    = 1.5f;
+static const float FORSYTH_LAST_TRIANGLE  = 0.75f;    // Score of the last triangle's vertices, low so strips don't just turn back on themselves
+static const float FORSYTH_VALENCE_SCALE  = 2.0f;
+static const float FORSYTH_VALENCE_POWER  = 0.5f;
+static const int   FORSYTH_MAX_VALENCE    = 64;       // Valence scores are looked up below this, all the same above
+
+// FIFO entries in the cache the statistics and cluster boundaries come from, what most current GPUs roughly behave like
+static const uint32_t SIMULATED_CACHE_SIZE = 16;
+
+VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount)
+{
+    VertexCacheStatistics statistics;
+    statistics.triangles = indices.size() / 3;
+
+    // A vertex is in the FIFO if fewer than SIMULATED_CACHE_SIZE misses have happened since its own
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool>     used(vertexCount, false);
+    uint32_t              timestamp = SIMULATED_CACHE_SIZE + 1;
+    for (uint32_t index : indices)
+    {
+        if (timestamp - cacheTime[index] > SIMULATED_CACHE_SIZE)
+        {
+            cacheTime[index] = timestamp++;
+            statistics.vertexTransforms++;
+        }
+        if (!used[index])
+        {
+            used[index] = true;
+            statistics.vertices++;
+        }
+    }
+    return statistics;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+{
+    CPU_PROFILE_SCOPE("optimizeVertexCache");
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Scores for a vertex's cache position and for how many triangles still need it, vertices few triangles still
+    // need score higher so they are finished off rather than left behind
+    float cacheScores[FORSYTH_CACHE_SIZE];
+    float valenceScores[FORSYTH_MAX_VALENCE];
+    for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+    {
+        cacheScores[i] = i < 3 ? FORSYTH_LAST_TRIANGLE
+                               : powf(1.0f - static_cast<float>(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_DECAY_POWER);
+    }
+    for (int i = 0; i < FORSYTH_MAX_VALENCE; i++)
+    {
+        valenceScores[i] = i == 0 ? 0.0f : FORSYTH_VALENCE_SCALE * powf(static_cast<float>(i), -FORSYTH_VALENCE_POWER);
+    }
+    auto getVertexScore = [&cacheScores, &valenceScores](int cachePosition, uint32_t liveTriangles)
+    {
+        if (liveTriangles == 0)
+        {
+            return -1.0f;
+        }
+        float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+        return score + valenceScores[std::min(liveTriangles, static_cast<uint32_t>(FORSYTH_MAX_VALENCE - 1))];
+    };
+
+    // Triangles using each vertex, the first liveTriangles of them not yet emitted
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+    {
+        adjacency[adjacencyFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScores[v] = getVertexScore(-1, liveTriangles[v]);
+    }
+    std::vector<float>   triangleScores(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    int64_t              bestTriangle = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+        {
+            bestTriangle = static_cast<int64_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t nextUnemitted = 0;
+    while (output.size() < triangleCount * 3)
+    {
+        // Nothing in the cache has triangles left, start again from the first triangle not drawn yet
+        if (bestTriangle < 0)
+        {
+            while (emitted[nextUnemitted])
+            {
+                nextUnemitted++;
+            }
+            bestTriangle = static_cast<int64_t>(nextUnemitted);
+        }
+
+        emitted[bestTriangle] = 1;
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Triangle's vertices go to the front of the cache, and no longer count it as live
+        newCache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t vertex = triangle[k];
+            if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+            {
+                newCache.push_back(vertex);
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t  vertex    = triangle[k];
+            uint32_t* liveBegin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* liveEnd   = liveBegin + liveTriangles[vertex];
+            uint32_t* found     = std::find(liveBegin, liveEnd, static_cast<uint32_t>(bestTriangle));
+            if (found != liveEnd)
+            {
+                std::swap(*found, *(liveEnd - 1));
+                liveTriangles[vertex]--;
+            }
+        }
+        for (uint32_t vertex : cache)
+        {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+            {
+                newCache.push_back(vertex);
+            }
+        }
+        std::swap(cache, newCache);
+
+        // Scores change only for vertices that moved in the cache or fell out, and for those vertices' triangles
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[cache[i]] = getVertexScore(position, liveTriangles[cache[i]]);
+        }
+        bestTriangle    = -1;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : cache)
+        {
+            for (uint32_t a = 0; a < liveTriangles[vertex]; a++)
+            {
+                uint32_t t = adjacency[adjacencyOffsets[vertex] + a];
+                triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore    = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (cache.size() > FORSYTH_CACHE_SIZE)
+        {
+            cache.resize(FORSYTH_CACHE_SIZE);
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold)
+{
+    CPU_PROFILE_SCOPE("optimizeOverdraw");
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Same FIFO as analyzeVertexCache, clearing it is just moving the timestamp on
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t              timestamp = SIMULATED_CACHE_SIZE + 1;
+    auto countMisses = [&indices, &cacheTime, &timestamp](size_t triangle)
+    {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t vertex = indices[triangle * 3 + k];
+            if (timestamp - cacheTime[vertex] > SIMULATED_CACHE_SIZE)
+            {
+                cacheTime[vertex] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+
+    // Hard boundaries are where the cache order already jumps, a triangle that reuses nothing before it
+    std::vector<size_t>   hardClusters;
+    std::vector<uint32_t> triangleMisses(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleMisses[t] = countMisses(t);
+        if (t == 0 || triangleMisses[t] == 3)
+        {
+            hardClusters.push_back(t);
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Each is split again wherever the part so far has an ACMR within threshold of the whole, starting cold as the
+    // next cluster might be drawn anywhere
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hardClusters.size(); h++)
+    {
+        size_t   start        = hardClusters[h];
+        size_t   end          = hardClusters[h + 1];
+        uint32_t hardMisses   = std::accumulate(triangleMisses.begin() + start, triangleMisses.begin() + end, 0u);
+        float    limit        = threshold * hardMisses / (end - start);
+        uint32_t misses       = 0;
+        size_t   clusterStart = start;
+
+        clusters.push_back(start);
+        timestamp += SIMULATED_CACHE_SIZE + 1;
+        for (size_t t = start; t < end; t++)
+        {
+            misses += countMisses(t);
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - clusterStart) <= limit)
+            {
+                clusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses       = 0;
+                timestamp   += SIMULATED_CACHE_SIZE + 1;
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Clusters whose surface faces away from the middle of the mesh are on the outside, and drawn first
+    struct ClusterSortKey
+    {
+        size_t start;
+        size_t end;
+        float  key;
+    };
+    std::vector<ClusterSortKey> sortKeys(clusters.size() - 1);
+    std::vector<glm::vec3>      clusterCentroids(sortKeys.size());
+    std::vector<glm::vec3>      clusterNormals(sortKeys.size());
+    glm::vec3 meshCentroid(0.0f);
+    float     meshArea = 0.0f;
+    for (size_t c = 0; c < sortKeys.size(); c++)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float     area = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            // Cross product's length is twice the area, so summing them weights each triangle's normal by its size
+            glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+            float     faceArea   = glm::length(faceNormal);
+            normal   = normal + faceNormal;
+            centroid = centroid + (p0 + p1 + p2) * (faceArea / 3.0f);
+            area    += faceArea;
+        }
+        meshCentroid = meshCentroid + centroid;
+        meshArea    += area;
+
+        sortKeys[c].start   = clusters[c];
+        sortKeys[c].end     = clusters[c + 1];
+        clusterCentroids[c] = area > 0.0f ? centroid / area : vertices[indices[clusters[c] * 3]].pos;
+        clusterNormals[c]   = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+    for (size_t c = 0; c < sortKeys.size(); c++)
+    {
+        sortKeys[c].key = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+    }
+    std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const ClusterSortKey& a, const ClusterSortKey& b)
+    {
+        return a.key > b.key;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (const ClusterSortKey& cluster : sortKeys)
+    {
+        output.insert(output.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void optimizeVertexFetch(std::vector<Vertex>* vertices, std::span<uint32_t> indices)
+{
+    CPU_PROFILE_SCOPE("optimizeVertexFetch");
+
+    std::vector<uint32_t> remap(vertices->size(), UINT32_MAX);
+    std::vector<Vertex>   reordered;
+    reordered.reserve(vertices->size());
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back((*vertices)[index]);
+        }
+        index = remap[index];
+    }
+    *vertices = std::move(reordered);
+}
+
+void optimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexCacheStatistics* before,
+                  VertexCacheStatistics* after)
+{
+    CPU_PROFILE_SCOPE("optimizeMesh");
+
+    if (before)
+    {
+        *before = analyzeVertexCache(*indices, vertices->size());
+    }
+
+    // Overdraw works on the cache order's clusters, and the vertex order follows the final triangle order
+    optimizeVertexCache(*indices, vertices->size());
+    optimizeOverdraw(*indices, *vertices);
+    optimizeVertexFetch(vertices, *indices);
+
+    if (after)
+    {
+        *after = analyzeVertexCache(*indices, vertices->size());
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Utilities.hpp"
+
+// How an index buffer uses the GPU's post-transform vertex cache, from a FIFO cache simulation.
+// Counts rather than ratios, so statistics for many meshes can be added together.
+struct VertexCacheStatistics
+{
+    uint64_t vertexTransforms = 0;     // Cache misses, each one a vertex shader invocation
+    uint64_t triangles        = 0;
+    uint64_t vertices         = 0;     // Vertices the indices use
+
+    // Average cache miss ratio, transforms per triangle: 0.5 is the best a regular grid can do, 3 is no reuse at all
+    float getAcmr() const { return triangles > 0 ? static_cast<float>(vertexTransforms) / triangles : 0.0f; }
+
+    // Average transform to vertex ratio: 1 means every vertex is transformed once
+    float getAtvr() const { return vertices > 0 ? static_cast<float>(vertexTransforms) / vertices : 0.0f; }
+
+    void add(const VertexCacheStatistics& other)
+    {
+        vertexTransforms += other.vertexTransforms;
+        triangles        += other.triangles;
+        vertices         += other.vertices;
+    }
+};
+
+VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount);
+
+// Reorders triangles so vertices are reused while still in the cache (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+// Reorders clusters of the cache optimised triangles so those facing outwards, which tend to hide the rest, are
+// drawn first. Clusters are split smaller while their ACMR stays within threshold times what it was, so the
+// vertex cache gains are mostly kept.
+void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold = 1.05f);
+
+// Reorders vertices into the order the indices first use them, so vertex fetches walk through memory, and drops
+// vertices no index uses. Indices are remapped to match.
+void optimizeVertexFetch(std::vector<Vertex>* vertices, std::span<uint32_t> indices);
+
+// All three, in the order they have to run in. Statistics before and after are filled in when given.
+void optimizeMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexCacheStatistics* before = nullptr,
+                  VertexCacheStatistics* after = nullptr);
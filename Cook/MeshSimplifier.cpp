@@ -0,0 +1,392 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Cost of a whole unit of texture coordinate or colour change, as a fraction of the mesh's size squared
+static const double SIMPLIFY_ATTRIBUTE_WEIGHT = 0.01;
+
+// Level has to drop at least this fraction of the last one's triangles to be worth keeping
+static const float LOD_MIN_REDUCTION = 0.2f;
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of ax + by + cz + d
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    void addPlane(double a, double b, double c, double d)
+    {
+        a00 += a * a; a01 += a * b; a02 += a * c; a03 += a * d;
+        a11 += b * b; a12 += b * c; a13 += b * d;
+        a22 += c * c; a23 += c * d;
+        a33 += d * d;
+    }
+
+    void add(const Quadric& other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+    }
+
+    double error(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                      + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                      + a22 * z * z + 2 * a23 * z
+                      + a33;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse
+{
+    uint32_t vertex;     // Moves onto target, and is gone
+    uint32_t target;
+    double   cost;       // What collapses are ordered by, quadric error plus the attribute change
+    double   error;      // Quadric error alone, the squared distance off the input surface
+};
+
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount,
+                                   float maxError, float* resultError)
+{
+    CPU_PROFILE_SCOPE("simplifyMesh");
+
+    std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    *resultError = 0.0f;
+    if (result.empty() || vertices.empty())
+    {
+        return result;
+    }
+
+    // Vertices with the same position are one point of the surface, the others are copies across a seam
+    std::vector<uint32_t> positionIds(vertices.size());
+    {
+        std::vector<uint32_t> sorted(vertices.size());
+        for (uint32_t v = 0; v < vertices.size(); v++)
+        {
+            sorted[v] = v;
+        }
+        auto positionLess = [&vertices](uint32_t a, uint32_t b)
+        {
+            return memcmp(&vertices[a].pos, &vertices[b].pos, sizeof(glm::vec3)) < 0;
+        };
+        std::sort(sorted.begin(), sorted.end(), positionLess);
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            bool samePosition = i > 0 && !positionLess(sorted[i - 1], sorted[i]);
+            positionIds[sorted[i]] = samePosition ? positionIds[sorted[i - 1]] : sorted[i];
+        }
+    }
+
+    // Attribute costs are scaled to the mesh, so the weight means the same for a tiny mesh as for a huge one
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    for (const Vertex& vertex : vertices)
+    {
+        minPos = glm::min(minPos, vertex.pos);
+        maxPos = glm::max(maxPos, vertex.pos);
+    }
+    double meshSize        = glm::length(maxPos - minPos);
+    double attributeWeight = SIMPLIFY_ATTRIBUTE_WEIGHT * meshSize * meshSize;
+
+    // Planes of the triangles around each point, collected into a collapse's target as it happens
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t t = 0; t < result.size(); t += 3)
+    {
+        const glm::vec3& p0 = vertices[result[t]].pos;
+        glm::vec3 normal = glm::cross(vertices[result[t + 1]].pos - p0, vertices[result[t + 2]].pos - p0);
+        float     length = glm::length(normal);
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal = normal / length;
+        double d = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; k++)
+        {
+            quadrics[positionIds[result[t + k]]].addPlane(normal.x, normal.y, normal.z, d);
+        }
+    }
+
+    double                                 maxSquaredError     = static_cast<double>(maxError) * maxError;
+    double                                 appliedSquaredError = 0.0;
+    std::vector<uint8_t>                   locked(vertices.size());
+    std::vector<uint8_t>                   touched(vertices.size());
+    std::vector<uint32_t>                  remap(vertices.size());
+    std::vector<uint32_t>                  triangleOffsets(vertices.size() + 1);
+    std::vector<uint32_t>                  pointTriangles;
+    std::vector<Collapse>                  bestCollapses;
+    std::vector<uint32_t>                  neighbours;
+    std::vector<uint32_t>                  targetNeighbours;
+    std::unordered_map<uint64_t, uint32_t> edgeCounts;
+
+    // Points around a point, itself included, sorted
+    auto collectNeighbours = [&](uint32_t centre, std::vector<uint32_t>* out)
+    {
+        out->clear();
+        for (uint32_t i = triangleOffsets[centre]; i < triangleOffsets[centre + 1]; i++)
+        {
+            const uint32_t* triangle = &result[pointTriangles[i] * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                out->push_back(positionIds[triangle[k]]);
+            }
+        }
+        std::sort(out->begin(), out->end());
+        out->erase(std::unique(out->begin(), out->end()), out->end());
+    };
+
+    // Passes of independent collapses, until there are few enough triangles or nothing more can go
+    while (result.size() > targetIndexCount)
+    {
+        // Edges between points, counted each way round. One without its reverse is a border, one seen twice
+        // the same way round is non-manifold, and both keep their points fixed
+        edgeCounts.clear();
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint64_t from = positionIds[result[t + k]];
+                uint64_t to   = positionIds[result[t + (k + 1) % 3]];
+                edgeCounts[(from << 32) | to]++;
+            }
+        }
+        std::fill(locked.begin(), locked.end(), 0);
+        for (const std::pair<const uint64_t, uint32_t>& edge : edgeCounts)
+        {
+            uint64_t reverse = (edge.first << 32) | (edge.first >> 32);
+            if (edge.second > 1 || edgeCounts.find(reverse) == edgeCounts.end())
+            {
+                locked[edge.first >> 32]        = 1;
+                locked[edge.first & 0xFFFFFFFF] = 1;
+            }
+        }
+
+        // Seams: a point some triangles use one copy of and some another
+        std::fill(remap.begin(), remap.end(), UINT32_MAX);
+        for (uint32_t index : result)
+        {
+            uint32_t point = positionIds[index];
+            if (remap[point] == UINT32_MAX)
+            {
+                remap[point] = index;
+            }
+            else if (remap[point] != index)
+            {
+                locked[point] = 1;
+            }
+        }
+
+        // Triangles around each point
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t index : result)
+        {
+            triangleOffsets[positionIds[index] + 1]++;
+        }
+        for (size_t i = 1; i < triangleOffsets.size(); i++)
+        {
+            triangleOffsets[i] += triangleOffsets[i - 1];
+        }
+        pointTriangles.resize(result.size());
+        {
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                pointTriangles[fill[positionIds[result[i]]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // Cheapest way for each free vertex to go: onto one of its neighbours, paying the neighbour's distance from
+        // its planes, and the attribute change for the triangles it leaves
+        bestCollapses.clear();
+        std::vector<int64_t> bestForVertex(vertices.size(), -1);
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                for (int other = 1; other < 3; other++)
+                {
+                    uint32_t vertex = result[t + k];
+                    uint32_t target = result[t + (k + other) % 3];
+                    uint32_t point  = positionIds[vertex];
+                    if (locked[point] || point == positionIds[target])
+                    {
+                        continue;
+                    }
+
+                    const Vertex& from    = vertices[vertex];
+                    const Vertex& to      = vertices[target];
+                    glm::vec2     texDiff = from.tex - to.tex;
+                    glm::vec3     colDiff = from.col - to.col;
+                    double        error   = quadrics[point].error(to.pos);
+                    double        cost    = error + attributeWeight * (glm::dot(texDiff, texDiff) + glm::dot(colDiff, colDiff));
+                    if (bestForVertex[vertex] < 0)
+                    {
+                        bestForVertex[vertex] = static_cast<int64_t>(bestCollapses.size());
+                        bestCollapses.push_back({ vertex, target, cost, error });
+                    }
+                    else if (cost < bestCollapses[bestForVertex[vertex]].cost)
+                    {
+                        bestCollapses[bestForVertex[vertex]] = { vertex, target, cost, error };
+                    }
+                }
+            }
+        }
+        std::sort(bestCollapses.begin(), bestCollapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        // Cheapest first. A collapse changes the triangles around its vertex, so none of their points can be part of
+        // another this pass, which keeps the flip and link checks valid
+        std::fill(touched.begin(), touched.end(), 0);
+        for (uint32_t v = 0; v < vertices.size(); v++)
+        {
+            remap[v] = v;
+        }
+        size_t remainingIndices = result.size();
+        size_t collapses        = 0;
+        for (const Collapse& collapse : bestCollapses)
+        {
+            // Skipped rather than stopping, as a cheaper one in the order can have more geometric error than the next
+            if (remainingIndices <= targetIndexCount)
+            {
+                break;
+            }
+            if (collapse.error > maxSquaredError)
+            {
+                continue;
+            }
+            uint32_t point       = positionIds[collapse.vertex];
+            uint32_t targetPoint = positionIds[collapse.target];
+            if (touched[point] || touched[targetPoint])
+            {
+                continue;
+            }
+
+            uint32_t removedTriangles = 0;
+            bool     flips            = false;
+            for (uint32_t i = triangleOffsets[point]; i < triangleOffsets[point + 1] && !flips; i++)
+            {
+                const uint32_t* triangle = &result[pointTriangles[i] * 3];
+                bool            hasTarget = positionIds[triangle[0]] == targetPoint || positionIds[triangle[1]] == targetPoint
+                                            || positionIds[triangle[2]] == targetPoint;
+                if (hasTarget)
+                {
+                    removedTriangles++;
+                    continue;
+                }
+
+                // Triangles that stay must still face the same way once the vertex has moved
+                glm::vec3 corners[3];
+                glm::vec3 moved[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    corners[k] = vertices[triangle[k]].pos;
+                    moved[k]   = positionIds[triangle[k]] == point ? vertices[collapse.target].pos : corners[k];
+                }
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                glm::vec3 after  = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            // Link condition: besides the two across their shared edge, the points may have no neighbour in
+            // common, or the surface would fold onto itself
+            collectNeighbours(point, &neighbours);
+            collectNeighbours(targetPoint, &targetNeighbours);
+            size_t sharedNeighbours = 0;
+            for (uint32_t neighbour : targetNeighbours)
+            {
+                if (neighbour != point && neighbour != targetPoint
+                    && std::binary_search(neighbours.begin(), neighbours.end(), neighbour))
+                {
+                    sharedNeighbours++;
+                }
+            }
+            if (sharedNeighbours > 2)
+            {
+                continue;
+            }
+
+            for (uint32_t i = triangleOffsets[point]; i < triangleOffsets[point + 1]; i++)
+            {
+                const uint32_t* triangle = &result[pointTriangles[i] * 3];
+                for (int k = 0; k < 3; k++)
+                {
+                    touched[positionIds[triangle[k]]] = 1;
+                }
+            }
+            touched[targetPoint] = 1;
+
+            remap[collapse.vertex] = collapse.target;
+            quadrics[targetPoint].add(quadrics[point]);
+            appliedSquaredError = std::max(appliedSquaredError, collapse.error);
+            remainingIndices   -= removedTriangles * 3;
+            collapses++;
+        }
+        if (collapses == 0)
+        {
+            break;
+        }
+
+        // Triangles that lost a corner are dropped. Compared by position, as the collapse counted them: a triangle on
+        // another seam copy of the target's position is left with two corners in the same place
+        size_t written = 0;
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            uint32_t a = remap[result[t]];
+            uint32_t b = remap[result[t + 1]];
+            uint32_t c = remap[result[t + 2]];
+            if (positionIds[a] != positionIds[b] && positionIds[b] != positionIds[c] && positionIds[a] != positionIds[c])
+            {
+                result[written++] = a;
+                result[written++] = b;
+                result[written++] = c;
+            }
+        }
+        result.resize(written);
+    }
+
+    // Only the geometric part, the attribute term ranks collapses but isn't a distance
+    *resultError = static_cast<float>(std::sqrt(appliedSquaredError));
+    return result;
+}
+
+void generateLods(std::span<const Vertex> vertices, std::vector<uint32_t>* indices, std::vector<MeshLod>* lods)
+{
+    CPU_PROFILE_SCOPE("generateLods");
+
+    lods->clear();
+    lods->push_back({ 0, static_cast<uint32_t>(indices->size()), 0.0f });
+
+    // Each level is made from the last, faster than from the full mesh every time, their errors adding up
+    std::vector<uint32_t> current(indices->begin(), indices->end());
+    float                 error = 0.0f;
+    while (lods->size() < MESH_LOD_MAX_LEVELS && current.size() / 3 > MESH_LOD_MIN_TRIANGLES)
+    {
+        float                 levelError;
+        std::vector<uint32_t> simplified = simplifyMesh(vertices, current, current.size() / 6 * 3, FLT_MAX, &levelError);
+        if (simplified.empty() || simplified.size() > current.size() * (1.0f - LOD_MIN_REDUCTION))
+        {
+            break;
+        }
+
+        optimizeVertexCache(simplified, vertices.size());
+        error += levelError;
+        lods->push_back({ static_cast<uint32_t>(indices->size()), static_cast<uint32_t>(simplified.size()), error });
+        indices->insert(indices->end(), simplified.begin(), simplified.end());
+        current = std::move(simplified);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Utilities.hpp"
+
+// Removes triangles by collapsing edges in order of quadric error (Garland-Heckbert), a vertex moving onto one of
+// its neighbours so the result indexes the same vertices. A collapse also costs the change in texture coordinate and
+// colour it causes, so detail survives longer where the surface is flat but the texture isn't. Borders, attribute
+// seams and non-manifold vertices are kept where they are, and collapses that would flip a triangle aren't done.
+// Stops at targetIndexCount or when every collapse left would be further than maxError off the input.
+// resultError is set to how far off the result can be, in model space units (geometry only, not the attributes).
+std::vector<uint32_t> simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount,
+                                   float maxError, float* resultError);
+
+// Appends a chain of ever coarser levels of detail, each about half the triangles of the last, to indices, all in the
+// one index buffer. lods gets every level's range, level 0 being the indices as they were, and the model space error
+// each level adds up to. Levels are vertex cache optimised.
+void generateLods(std::span<const Vertex> vertices, std::vector<uint32_t>* indices, std::vector<MeshLod>* lods);
@@ -0,0 +1,438 @@
+#include "Microbenchmarks.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+// A run shorter than this is mostly timer and loop overhead, so the iteration count is raised until a run takes this long
+static const double   MICROBENCHMARK_MIN_SECONDS = 0.5;
+static const uint64_t MICROBENCHMARK_MAX_ITERATIONS = 1000000000;
+
+// Results are added in here so the compiler can't drop the work that produced them
+static volatile uint64_t benchmarkSink = 0;
+
+static void doNotOptimize(uint64_t value)
+{
+    benchmarkSink = benchmarkSink + value;
+}
+
+MicrobenchmarkState::MicrobenchmarkState(uint64_t iterations)
+{
+    _iterations         = iterations;
+    _remaining          = iterations;
+    _timing             = false;
+    _elapsedNanoseconds = 0.0;
+    _bytesPerIteration  = 0;
+    _itemsPerIteration  = 0;
+}
+
+bool MicrobenchmarkState::keepRunning()
+{
+    // Timer starts on the first call, so set up before the loop isn't counted
+    if (_remaining == _iterations && !_timing)
+    {
+        resumeTiming();
+    }
+    if (_remaining == 0)
+    {
+        pauseTiming();
+        return false;
+    }
+    _remaining--;
+    return true;
+}
+
+void MicrobenchmarkState::pauseTiming()
+{
+    if (_timing)
+    {
+        _elapsedNanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _start).count();
+        _timing = false;
+    }
+}
+
+void MicrobenchmarkState::resumeTiming()
+{
+    if (!_timing)
+    {
+        _start  = std::chrono::steady_clock::now();
+        _timing = true;
+    }
+}
+
+void MicrobenchmarkState::setBytesProcessed(uint64_t bytesPerIteration)
+{
+    _bytesPerIteration = bytesPerIteration;
+}
+
+void MicrobenchmarkState::setItemsProcessed(uint64_t itemsPerIteration)
+{
+    _itemsPerIteration = itemsPerIteration;
+}
+
+uint64_t MicrobenchmarkState::getIterations()
+{
+    return _iterations;
+}
+
+double MicrobenchmarkState::getElapsedNanoseconds()
+{
+    return _elapsedNanoseconds;
+}
+
+uint64_t MicrobenchmarkState::getBytesProcessed()
+{
+    return _bytesPerIteration * _iterations;
+}
+
+uint64_t MicrobenchmarkState::getItemsProcessed()
+{
+    return _itemsPerIteration * _iterations;
+}
+
+MicrobenchmarkState::~MicrobenchmarkState()
+{
+}
+
+Microbenchmarks::Microbenchmarks(VulkanRenderer* renderer)
+{
+    _renderer = renderer;
+}
+
+void Microbenchmarks::add(const std::string& name, std::function<void(MicrobenchmarkState&)> benchmark)
+{
+    _benchmarks.push_back({ name, benchmark });
+}
+
+void Microbenchmarks::addDefaultBenchmarks()
+{
+    RendererDeviceContext context = _renderer->getDeviceContext();
+
+    // readFile: a small SPIR-V file, as read at start up and on every shader reload, and a texture sized file
+    std::vector<std::string> readFiles = { getShaderDirectory() + VERTEX_SHADER_FILE + ".spv",
+                                           getTextureDirectory() + "giraffe.jpg" };
+    for (const std::string& filePath : readFiles)
+    {
+        add("readFile/" + filePath.substr(filePath.find_last_of('/') + 1), [filePath](MicrobenchmarkState& state)
+        {
+            while (state.keepRunning())
+            {
+                std::vector<char> fileData = readFile(filePath);
+                state.setBytesProcessed(fileData.size());
+                doNotOptimize(fileData.size());
+            }
+        });
+    }
+
+    // The same two files out of the asset pack: open, map and look up, which is all start up does for them now
+    std::vector<std::string> packNames = { std::string("shaders/") + VERTEX_SHADER_FILE + ".spv", "Textures/giraffe.jpg" };
+    AssetPack                probePack;
+    for (const std::string& packName : packNames)
+    {
+        if (!probePack.open(ASSET_PACK_FILE) || probePack.find(packName).empty())
+        {
+            continue;
+        }
+
+        add("assetPack/" + packName.substr(packName.find_last_of('/') + 1), [packName](MicrobenchmarkState& state)
+        {
+            while (state.keepRunning())
+            {
+                AssetPack assetPack;
+                assetPack.open(ASSET_PACK_FILE);
+                std::span<const char> fileData = assetPack.find(packName);
+                state.setBytesProcessed(fileData.size());
+                doNotOptimize(fileData.size());
+            }
+        });
+    }
+
+    add("findMemoryTypeIndex/host_visible_coherent", [context](MicrobenchmarkState& state)
+    {
+        while (state.keepRunning())
+        {
+            doNotOptimize(findMemoryTypeIndex(context.physicalDevice, 0xffffffff,
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+        }
+    });
+
+    // Buffer creation plus its own allocation, destroying it again isn't counted
+    add("createBuffer/64KiB_device_local", [context](MicrobenchmarkState& state)
+    {
+        while (state.keepRunning())
+        {
+            VkBuffer       buffer;
+            VkDeviceMemory bufferMemory;
+            createBuffer(context.physicalDevice, context.logicalDevice, 64 * 1024,
+                         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &buffer, &bufferMemory, MEMORY_CATEGORY_OTHER);
+
+            state.pauseTiming();
+            vkDestroyBuffer(context.logicalDevice, buffer, nullptr);
+            MemoryTracker::freeMemory(context.logicalDevice, bufferMemory);
+            state.resumeTiming();
+        }
+    });
+
+    for (uint32_t vertexCount : { 1024u, 65536u })
+    {
+        add("Mesh upload/" + std::to_string(vertexCount) + "_vertices", [this, vertexCount](MicrobenchmarkState& state)
+        {
+            benchmarkMeshUpload(state, vertexCount);
+        });
+    }
+
+    // Decoding the sample textures, bytes are the decoded RGBA pixels
+    for (const char* fileName : { "giraffe.jpg", "panda.jpg" })
+    {
+        std::string filePath = getTextureDirectory() + fileName;
+        add(std::string("stbi_load/") + fileName, [filePath](MicrobenchmarkState& state)
+        {
+            while (state.keepRunning())
+            {
+                int width, height, channels;
+                stbi_uc* image = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+                if (!image)
+                {
+                    throw std::runtime_error("Failed to load a Texture file! (" + filePath + ")");
+                }
+                state.setBytesProcessed(static_cast<uint64_t>(width) * height * 4);
+
+                state.pauseTiming();
+                stbi_image_free(image);
+                state.resumeTiming();
+            }
+        });
+    }
+
+    for (uint32_t drawCount : { 64u, 4096u })
+    {
+        add("recordDrawCommands/" + std::to_string(drawCount) + "_draws", [this, drawCount](MicrobenchmarkState& state)
+        {
+            benchmarkRecordDraws(state, drawCount);
+        });
+    }
+}
+
+// Whole glTF import: map the buffers, parse the JSON and convert every primitive on the job system. Bytes are the
+// binary buffers, so a large scene (hundreds of MB of geometry) shows the conversion throughput
+void Microbenchmarks::addGltfImportBenchmark(const std::string& filePath)
+{
+    add("importGltf/" + filePath.substr(filePath.find_last_of('/') + 1), [this, filePath](MicrobenchmarkState& state)
+    {
+        while (state.keepRunning())
+        {
+            GltfScene scene;
+            if (!importGltf(filePath, &_renderer->getJobSystem(), &scene))
+            {
+                throw std::runtime_error("Failed to load a glTF file! (" + filePath + ")");
+            }
+            state.setBytesProcessed(scene.bufferBytes);
+            doNotOptimize(scene.primitives.size());
+
+            // Unmapping and freeing the converted arrays isn't counted
+            state.pauseTiming();
+            scene = GltfScene();
+            state.resumeTiming();
+        }
+    });
+}
+
+std::vector<MicrobenchmarkResult> Microbenchmarks::run(const char* filter)
+{
+    std::vector<MicrobenchmarkResult> results;
+
+    printf("%-44s %12s %14s %14s\n", "Microbenchmark", "Iterations", "ns/iteration", "Throughput");
+    for (const Microbenchmark& microbenchmark : _benchmarks)
+    {
+        if (filter && microbenchmark.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        MicrobenchmarkResult result = runBenchmark(microbenchmark);
+
+        char throughput[32] = "";
+        if (result.bytesPerSecond > 0.0)
+        {
+            snprintf(throughput, sizeof(throughput), "%.1f MiB/s", result.bytesPerSecond / (1024.0 * 1024.0));
+        }
+        else if (result.itemsPerSecond > 0.0)
+        {
+            snprintf(throughput, sizeof(throughput), "%.3f M/s", result.itemsPerSecond * 1e-6);
+        }
+        printf("%-44s %12llu %14.1f %14s\n", result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+               result.nanosecondsPerIteration, throughput);
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+bool Microbenchmarks::writeReport(const std::string& filePath, const std::vector<MicrobenchmarkResult>& results)
+{
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"device\": \"%s\",\n", _renderer->getDeviceName().c_str());
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const MicrobenchmarkResult& result = results[i];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", result.name.c_str());
+        fprintf(file, "      \"iterations\": %llu,\n", static_cast<unsigned long long>(result.iterations));
+        fprintf(file, "      \"ns_per_iteration\": %.3f,\n", result.nanosecondsPerIteration);
+        fprintf(file, "      \"bytes_per_second\": %.1f,\n", result.bytesPerSecond);
+        fprintf(file, "      \"items_per_second\": %.1f\n", result.itemsPerSecond);
+        fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+    return written;
+}
+
+Microbenchmarks::~Microbenchmarks()
+{
+}
+
+MicrobenchmarkResult Microbenchmarks::runBenchmark(const Microbenchmark& microbenchmark)
+{
+    CPU_PROFILE_SCOPE("Microbenchmarks::runBenchmark");
+
+    uint64_t iterations = 1;
+    while (true)
+    {
+        MicrobenchmarkState state(iterations);
+        microbenchmark.benchmark(state);
+
+        double elapsedSeconds = state.getElapsedNanoseconds() * 1e-9;
+        if (elapsedSeconds >= MICROBENCHMARK_MIN_SECONDS || iterations >= MICROBENCHMARK_MAX_ITERATIONS)
+        {
+            MicrobenchmarkResult result;
+            result.name                    = microbenchmark.name;
+            result.iterations              = iterations;
+            result.nanosecondsPerIteration = state.getElapsedNanoseconds() / iterations;
+            result.bytesPerSecond          = elapsedSeconds > 0.0 ? state.getBytesProcessed() / elapsedSeconds : 0.0;
+            result.itemsPerSecond          = elapsedSeconds > 0.0 ? state.getItemsProcessed() / elapsedSeconds : 0.0;
+            return result;
+        }
+
+        // Aim a little past the minimum time, growing at most tenfold when the last run was too short to go by
+        double multiplier = elapsedSeconds > 0.0 ? MICROBENCHMARK_MIN_SECONDS * 1.4 / elapsedSeconds : 10.0;
+        multiplier        = std::min(multiplier, 10.0);
+        iterations        = std::min(std::max(static_cast<uint64_t>(iterations * multiplier), iterations + 1),
+                                     MICROBENCHMARK_MAX_ITERATIONS);
+    }
+}
+
+void Microbenchmarks::benchmarkMeshUpload(MicrobenchmarkState& state, uint32_t vertexCount)
+{
+    RendererDeviceContext context = _renderer->getDeviceContext();
+
+    // Vertex data dominates, the single triangle of indices keeps the index buffer upload small
+    std::vector<Vertex> vertices(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        vertices[i] = { { static_cast<float>(i % 256), static_cast<float>(i / 256), 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } };
+    }
+    std::vector<uint32_t> indices = { 0, 1, 2 };
+
+    state.setBytesProcessed(sizeof(Vertex) * vertices.size());
+    while (state.keepRunning())
+    {
+        // Staging buffer, copy and wait for the transfer queue, as done for every mesh loaded
+        Mesh mesh(context.physicalDevice, context.logicalDevice, context.graphicsQueue, context.graphicsCommandPool,
+                  &vertices, &indices, 0);
+
+        state.pauseTiming();
+        mesh.destroyBuffers();
+        state.resumeTiming();
+    }
+}
+
+void Microbenchmarks::benchmarkRecordDraws(MicrobenchmarkState& state, uint32_t drawCount)
+{
+    RendererDeviceContext context = _renderer->getDeviceContext();
+
+    // Scene of drawCount visible nodes sharing one quad, drawn once so the draw list and pipelines are in place
+    _renderer->clearScene();
+
+    std::vector<uint8_t> whitePixel = { 255, 255, 255, 255 };
+    int textureId = _renderer->createTextureFromPixels(1, 1, whitePixel);
+
+    std::vector<Vertex> quadVertices = {
+        { { -0.5f, -0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+        { {  0.5f, -0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+        { {  0.5f,  0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+        { { -0.5f,  0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } }
+    };
+    std::vector<uint32_t> quadIndices = { 0, 1, 2, 2, 3, 0 };
+    int meshId = _renderer->addMesh(&quadVertices, &quadIndices, textureId);
+
+    for (uint32_t i = 0; i < drawCount; i++)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f));
+        _renderer->addSceneNode(_renderer->getSceneRoot(), glm::scale(transform, glm::vec3(0.01f)), meshId);
+    }
+    _renderer->draw();
+
+    // Own pool and secondary buffer, recorded but never submitted
+    VkCommandPoolCreateInfo poolCI = {};
+    poolCI.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCI.queueFamilyIndex        = context.graphicsQueueFamilyIndex;
+
+    VkCommandPool commandPool;
+    VkResult result = vkCreateCommandPool(context.logicalDevice, &poolCI, nullptr, &commandPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a microbenchmark Command Pool!");
+    }
+
+    VkCommandBufferAllocateInfo cbAllocInfo = {};
+    cbAllocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cbAllocInfo.commandPool                 = commandPool;
+    cbAllocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    cbAllocInfo.commandBufferCount          = 1;
+
+    VkCommandBuffer commandBuffer;
+    result = vkAllocateCommandBuffers(context.logicalDevice, &cbAllocInfo, &commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate a microbenchmark Command Buffer!");
+    }
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType                          = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass                     = context.renderPass;
+    inheritanceInfo.subpass                        = 0;
+    inheritanceInfo.framebuffer                    = context.framebuffer;
+
+    VkCommandBufferBeginInfo vkCommandBufferBI = {};
+    vkCommandBufferBI.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkCommandBufferBI.flags                    = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkCommandBufferBI.pInheritanceInfo         = &inheritanceInfo;
+
+    // Items are draws, so the result reads as the cost of one iteration of the per-mesh recording loop
+    uint32_t recordedDraws = _renderer->getDrawCount();
+    state.setItemsProcessed(recordedDraws);
+    while (state.keepRunning())
+    {
+        vkBeginCommandBuffer(commandBuffer, &vkCommandBufferBI);
+        _renderer->recordDrawCommands(commandBuffer, 0, 0, recordedDraws);
+        vkEndCommandBuffer(commandBuffer);
+
+        state.pauseTiming();
+        vkResetCommandPool(context.logicalDevice, commandPool, 0);
+        state.resumeTiming();
+    }
+
+    vkDestroyCommandPool(context.logicalDevice, commandPool, nullptr);
+    _renderer->clearScene();
+}
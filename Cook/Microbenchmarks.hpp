@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "VulkanRenderer.hpp"
+
+// Passed to each microbenchmark, which times its loop with:
+//     while (state.keepRunning()) { ... }
+// Work that shouldn't be counted (freeing what an iteration created) goes between pauseTiming and resumeTiming.
+class MicrobenchmarkState
+{
+    public:
+        MicrobenchmarkState(uint64_t iterations);
+
+        bool keepRunning();
+        void pauseTiming();
+        void resumeTiming();
+
+        // Work done by one iteration, reported as throughput
+        void setBytesProcessed(uint64_t bytesPerIteration);
+        void setItemsProcessed(uint64_t itemsPerIteration);
+
+        uint64_t getIterations();
+        double   getElapsedNanoseconds();
+        uint64_t getBytesProcessed();
+        uint64_t getItemsProcessed();
+
+        ~MicrobenchmarkState();
+
+    private:
+        uint64_t                              _iterations;
+        uint64_t                              _remaining;
+        bool                                  _timing;
+        std::chrono::steady_clock::time_point _start;
+        double                                _elapsedNanoseconds;
+        uint64_t                              _bytesPerIteration;
+        uint64_t                              _itemsPerIteration;
+};
+
+struct MicrobenchmarkResult
+{
+    std::string name;
+    uint64_t    iterations;
+    double      nanosecondsPerIteration;
+    double      bytesPerSecond;     // 0 if the benchmark doesn't report bytes
+    double      itemsPerSecond;     // 0 if the benchmark doesn't report items
+};
+
+// Times the low level helpers (Utilities.hpp, Mesh uploads, draw recording) in isolation. Each benchmark is run
+// with a growing iteration count until one run takes at least MICROBENCHMARK_MIN_SECONDS, and that run is reported.
+class Microbenchmarks
+{
+    public:
+        Microbenchmarks(VulkanRenderer* renderer);
+
+        void add(const std::string& name, std::function<void(MicrobenchmarkState&)> benchmark);
+        void addDefaultBenchmarks();
+        void addGltfImportBenchmark(const std::string& filePath);
+
+        std::vector<MicrobenchmarkResult> run(const char* filter);
+        bool                              writeReport(const std::string& filePath, const std::vector<MicrobenchmarkResult>& results);
+
+        ~Microbenchmarks();
+
+    private:
+        struct Microbenchmark
+        {
+            std::string                               name;
+            std::function<void(MicrobenchmarkState&)> benchmark;
+        };
+
+        VulkanRenderer*             _renderer;
+        std::vector<Microbenchmark> _benchmarks;
+
+        MicrobenchmarkResult runBenchmark(const Microbenchmark& microbenchmark);
+        void                 benchmarkMeshUpload(MicrobenchmarkState& state, uint32_t vertexCount);
+        void                 benchmarkRecordDraws(MicrobenchmarkState& state, uint32_t drawCount);
+};
@@ -0,0 +1,131 @@
+#include "PipelineCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+PipelineCache::PipelineCache()
+{
+    _vkPipelineCache = VK_NULL_HANDLE;
+    _warm            = false;
+}
+
+void PipelineCache::create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& filePath)
+{
+    _physicalDevice = physicalDevice;
+    _device         = device;
+    _filePath       = filePath;
+
+    // Only hand the driver data it wrote itself, anything else starts an empty cache
+    std::vector<char> cacheData = loadCacheData();
+    _warm = isCompatible(cacheData);
+    if (!_warm)
+    {
+        cacheData.clear();
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCI = {};
+    pipelineCacheCI.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCI.initialDataSize           = cacheData.size();
+    pipelineCacheCI.pInitialData              = cacheData.empty() ? nullptr : cacheData.data();
+
+    VkResult result = vkCreatePipelineCache(_device, &pipelineCacheCI, nullptr, &_vkPipelineCache);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Pipeline Cache!");
+    }
+}
+
+VkPipelineCache PipelineCache::getPipelineCache()
+{
+    return _vkPipelineCache;
+}
+
+bool PipelineCache::isWarm()
+{
+    return _warm;
+}
+
+void PipelineCache::save()
+{
+    if (_vkPipelineCache == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    // First call gets size, second call gets data
+    size_t dataSize = 0;
+    vkGetPipelineCacheData(_device, _vkPipelineCache, &dataSize, nullptr);
+    std::vector<char> cacheData(dataSize);
+    if (dataSize == 0 || vkGetPipelineCacheData(_device, _vkPipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+    {
+        printf("Failed to read Pipeline Cache data, not saving it\n");
+        return;
+    }
+
+    // Write to a temporary file then rename over the old one, so a crash mid-write can't leave a half written cache
+    std::string tempFilePath = _filePath + ".tmp";
+    std::ofstream file(tempFilePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        printf("Failed to open %s, not saving Pipeline Cache\n", tempFilePath.c_str());
+        return;
+    }
+    file.write(cacheData.data(), static_cast<std::streamsize>(dataSize));
+    file.close();
+
+    if (!file || std::rename(tempFilePath.c_str(), _filePath.c_str()) != 0)
+    {
+        printf("Failed to write %s, not saving Pipeline Cache\n", _filePath.c_str());
+        std::remove(tempFilePath.c_str());
+    }
+}
+
+void PipelineCache::destroy()
+{
+    vkDestroyPipelineCache(_device, _vkPipelineCache, nullptr);
+    _vkPipelineCache = VK_NULL_HANDLE;
+}
+
+PipelineCache::~PipelineCache()
+{
+}
+
+std::vector<char> PipelineCache::loadCacheData()
+{
+    // No file yet (first run) is fine, just means a cold cache
+    std::ifstream file(_filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return {};
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> cacheData(fileSize);
+    file.seekg(0);
+    file.read(cacheData.data(), fileSize);
+
+    return file ? cacheData : std::vector<char>();
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& cacheData)
+{
+    if (cacheData.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header;
+    memcpy(&header, cacheData.data(), sizeof(header));
+
+    // Cache is only valid for the exact device (and driver build, via the UUID) that created it
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProperties);
+
+    return header.headerSize    >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID      == deviceProperties.vendorID &&
+           header.deviceID      == deviceProperties.deviceID &&
+           memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+
+// VkPipelineCache that is loaded from and saved back to a file, so pipelines compiled
+// on one run don't have to be compiled again from SPIR-V on the next.
+class PipelineCache
+{
+    public:
+        PipelineCache();
+
+        void            create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& filePath);
+        VkPipelineCache getPipelineCache();
+        bool            isWarm();
+        void            save();
+        void            destroy();
+
+        ~PipelineCache();
+
+    private:
+        VkPipelineCache  _vkPipelineCache;
+        VkPhysicalDevice _physicalDevice;
+        VkDevice         _device;
+        std::string      _filePath;
+        bool             _warm;       // Started from valid data on disk
+
+        std::vector<char> loadCacheData();
+        bool              isCompatible(const std::vector<char>& cacheData);
+};
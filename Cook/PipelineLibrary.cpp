@@ -0,0 +1,564 @@
+#include "PipelineLibrary.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+
+uint64_t PipelineStateDesc::hash() const
+{
+    // FNV-1a over each field
+    uint64_t fields[] = { blendEnable, cullMode, depthTestEnable, depthWriteEnable, static_cast<uint64_t>(depthCompareOp), vertexFormat };
+    uint64_t result   = 14695981039346656037ull;
+    for (uint64_t field : fields)
+    {
+        result = (result ^ field) * 1099511628211ull;
+    }
+    for (uint32_t shaderFeature : shaderFeatures)
+    {
+        result = (result ^ shaderFeature) * 1099511628211ull;
+    }
+    return result;
+}
+
+bool PipelineStateDesc::operator==(const PipelineStateDesc& other) const
+{
+    return blendEnable      == other.blendEnable &&
+           cullMode         == other.cullMode &&
+           depthTestEnable  == other.depthTestEnable &&
+           depthWriteEnable == other.depthWriteEnable &&
+           depthCompareOp   == other.depthCompareOp &&
+           vertexFormat     == other.vertexFormat &&
+           shaderFeatures   == other.shaderFeatures;
+}
+
+PipelineLibrary::PipelineLibrary()
+{
+    _fallbackPipeline = VK_NULL_HANDLE;
+    _running          = false;
+    _generation       = 0;
+    _reloadPending    = false;
+}
+
+void PipelineLibrary::init(VkDevice device,
+                           VkPipelineCache pipelineCache,
+                           VkRenderPass renderPass,
+                           VkPipelineLayout pipelineLayout,
+                           VkExtent2D extent,
+                           VkShaderModule vertexShaderModule,
+                           VkShaderModule fragmentShaderModule,
+                           const std::vector<VkVertexInputAttributeDescription>& vertexAttributes,
+                           uint32_t vertexStride,
+                           const PipelineStateDesc& fallbackDesc,
+                           uint32_t compileThreadCount)
+{
+    _device               = device;
+    _pipelineCache        = pipelineCache;
+    _renderPass           = renderPass;
+    _pipelineLayout       = pipelineLayout;
+    _extent               = extent;
+    _vertexShaderModule   = vertexShaderModule;
+    _fragmentShaderModule = fragmentShaderModule;
+    _vertexAttributes     = vertexAttributes;
+    _vertexStride         = vertexStride;
+
+    // Fallback is the only pipeline compiled synchronously, everything else can wait for it
+    _fallbackDesc     = fallbackDesc;
+    _fallbackPipeline = compilePipeline(fallbackDesc, _vertexShaderModule, _fragmentShaderModule);
+    if (_fallbackPipeline == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+    }
+    _pipelines[fallbackDesc] = { PipelineStatus::Ready, _fallbackPipeline };
+
+    _running = true;
+    for (uint32_t i = 0; i < compileThreadCount; i++)
+    {
+        _compileThreads.emplace_back(&PipelineLibrary::compileLoop, this);
+    }
+}
+
+void PipelineLibrary::request(const PipelineStateDesc& desc)
+{
+    bool queued;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        queued = requestLocked(desc);
+    }
+
+    if (queued)
+    {
+        _compileCondition.notify_one();
+    }
+}
+
+VkPipeline PipelineLibrary::getPipeline(const PipelineStateDesc& desc)
+{
+    bool queued;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _pipelines.find(desc);
+        if (found != _pipelines.end())
+        {
+            return found->second.status == PipelineStatus::Ready ? found->second.pipeline : _fallbackPipeline;
+        }
+        queued = requestLocked(desc);
+    }
+
+    if (queued)
+    {
+        _compileCondition.notify_one();
+    }
+
+    // Not compiled yet, draw with the fallback this frame rather than stall
+    return _fallbackPipeline;
+}
+
+bool PipelineLibrary::isReady(const PipelineStateDesc& desc)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _pipelines.find(desc);
+    return found != _pipelines.end() && found->second.status == PipelineStatus::Ready;
+}
+
+VkPipeline PipelineLibrary::getFallbackPipeline()
+{
+    return _fallbackPipeline;
+}
+
+bool PipelineLibrary::reloadShaders(VkShaderModule vertexShaderModule, VkShaderModule fragmentShaderModule)
+{
+    // Rebuild every permutation that is currently in use, so nothing drops back to the fallback after the swap
+    std::vector<PipelineStateDesc> descs;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& pipeline : _pipelines)
+        {
+            if (pipeline.second.status == PipelineStatus::Ready && !(pipeline.first == _fallbackDesc))
+            {
+                descs.push_back(pipeline.first);
+            }
+        }
+    }
+
+    // New fallback first, without it the new shaders can't be used at all
+    VkPipeline fallbackPipeline = compilePipeline(_fallbackDesc, vertexShaderModule, fragmentShaderModule);
+    if (fallbackPipeline == VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
+        vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
+        return false;
+    }
+
+    std::unordered_map<PipelineStateDesc, VkPipeline, PipelineStateDescHash> pipelines;
+    pipelines[_fallbackDesc] = fallbackPipeline;
+    for (const PipelineStateDesc& desc : descs)
+    {
+        // A permutation that fails is left out, and gets compiled again (with the new shaders) when next requested
+        VkPipeline pipeline = compilePipeline(desc, vertexShaderModule, fragmentShaderModule);
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            pipelines[desc] = pipeline;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    destroyPendingReloadLocked();
+    _reloadPending               = true;
+    _pendingVertexShaderModule   = vertexShaderModule;
+    _pendingFragmentShaderModule = fragmentShaderModule;
+    _pendingPipelines            = std::move(pipelines);
+    return true;
+}
+
+void PipelineLibrary::applyReload(uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_reloadPending)
+    {
+        return;
+    }
+
+    // Everything built from the old shaders stays alive until frames already recorded with it have finished
+    RetiredShaders retired       = {};
+    retired.frameNumber          = frameNumber;
+    retired.generation           = _generation;
+    retired.vertexShaderModule   = _vertexShaderModule;
+    retired.fragmentShaderModule = _fragmentShaderModule;
+
+    std::vector<PipelineStateDesc> queuedDescs;
+    for (auto& pipeline : _pipelines)
+    {
+        if (pipeline.second.pipeline != VK_NULL_HANDLE)
+        {
+            retired.pipelines.push_back(pipeline.second.pipeline);
+        }
+        if (pipeline.second.status == PipelineStatus::Queued)
+        {
+            queuedDescs.push_back(pipeline.first);
+        }
+    }
+    _retiredShaders.push_back(retired);
+
+    // Permutations still in the compile queue stay queued, they will pick up the new shaders
+    _pipelines.clear();
+    for (auto& pipeline : _pendingPipelines)
+    {
+        _pipelines[pipeline.first] = { PipelineStatus::Ready, pipeline.second };
+    }
+    for (const PipelineStateDesc& desc : queuedDescs)
+    {
+        if (_pipelines.count(desc) == 0)
+        {
+            _pipelines[desc] = { PipelineStatus::Queued, VK_NULL_HANDLE };
+        }
+    }
+
+    _vertexShaderModule   = _pendingVertexShaderModule;
+    _fragmentShaderModule = _pendingFragmentShaderModule;
+    _fallbackPipeline     = _pendingPipelines[_fallbackDesc];
+    _pendingPipelines.clear();
+    _reloadPending        = false;
+    _generation++;
+}
+
+void PipelineLibrary::destroyRetired(uint64_t completedFrameNumber)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < _retiredShaders.size();)
+    {
+        RetiredShaders& retired = _retiredShaders[i];
+
+        // Frames recorded before the swap must be finished, and no compile thread can still be using the modules
+        bool framesDone    = completedFrameNumber >= retired.frameNumber;
+        bool compilingDone = _compilingGenerations.empty() || *_compilingGenerations.begin() > retired.generation;
+        if (!framesDone || !compilingDone)
+        {
+            i++;
+            continue;
+        }
+
+        for (VkPipeline pipeline : retired.pipelines)
+        {
+            vkDestroyPipeline(_device, pipeline, nullptr);
+        }
+        vkDestroyShaderModule(_device, retired.fragmentShaderModule, nullptr);
+        vkDestroyShaderModule(_device, retired.vertexShaderModule, nullptr);
+        _retiredShaders.erase(_retiredShaders.begin() + i);
+    }
+}
+
+void PipelineLibrary::destroy()
+{
+    // Compile threads finish whatever pipeline they are on, queued requests are dropped
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+        _compileQueue.clear();
+    }
+    _compileCondition.notify_all();
+
+    for (std::thread& compileThread : _compileThreads)
+    {
+        compileThread.join();
+    }
+    _compileThreads.clear();
+
+    // Fallback is in the map too, so this destroys it as well
+    for (auto& pipeline : _pipelines)
+    {
+        if (pipeline.second.pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(_device, pipeline.second.pipeline, nullptr);
+        }
+    }
+    _pipelines.clear();
+    _fallbackPipeline = VK_NULL_HANDLE;
+
+    vkDestroyShaderModule(_device, _fragmentShaderModule, nullptr);
+    vkDestroyShaderModule(_device, _vertexShaderModule, nullptr);
+
+    // Device is idle by now, so retired shaders can go regardless of frame number
+    std::lock_guard<std::mutex> lock(_mutex);
+    destroyPendingReloadLocked();
+    for (RetiredShaders& retired : _retiredShaders)
+    {
+        for (VkPipeline pipeline : retired.pipelines)
+        {
+            vkDestroyPipeline(_device, pipeline, nullptr);
+        }
+        vkDestroyShaderModule(_device, retired.fragmentShaderModule, nullptr);
+        vkDestroyShaderModule(_device, retired.vertexShaderModule, nullptr);
+    }
+    _retiredShaders.clear();
+}
+
+PipelineLibrary::~PipelineLibrary()
+{
+}
+
+void PipelineLibrary::destroyPendingReloadLocked()
+{
+    if (!_reloadPending)
+    {
+        return;
+    }
+
+    // Never swapped in, so nothing can be using these
+    for (auto& pipeline : _pendingPipelines)
+    {
+        vkDestroyPipeline(_device, pipeline.second, nullptr);
+    }
+    vkDestroyShaderModule(_device, _pendingFragmentShaderModule, nullptr);
+    vkDestroyShaderModule(_device, _pendingVertexShaderModule, nullptr);
+    _pendingPipelines.clear();
+    _reloadPending = false;
+}
+
+bool PipelineLibrary::requestLocked(const PipelineStateDesc& desc)
+{
+    // Identical requests share one entry, so each permutation is only ever compiled once
+    if (!_running || _pipelines.count(desc) > 0)
+    {
+        return false;
+    }
+
+    _pipelines[desc] = { PipelineStatus::Queued, VK_NULL_HANDLE };
+    _compileQueue.push_back(desc);
+    return true;
+}
+
+void PipelineLibrary::compileLoop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _compileCondition.wait(lock, [this]() { return !_running || !_compileQueue.empty(); });
+        if (!_running)
+        {
+            return;
+        }
+
+        PipelineStateDesc desc = _compileQueue.front();
+        _compileQueue.pop_front();
+
+        // Compile without holding the lock, so the render thread never waits on the driver
+        VkShaderModule vertexShaderModule   = _vertexShaderModule;
+        VkShaderModule fragmentShaderModule = _fragmentShaderModule;
+        uint64_t       generation           = _generation;
+        auto           compiling            = _compilingGenerations.insert(generation);
+        lock.unlock();
+        VkPipeline pipeline = compilePipeline(desc, vertexShaderModule, fragmentShaderModule);
+        lock.lock();
+        _compilingGenerations.erase(compiling);
+
+        // Shaders were reloaded while compiling, so this pipeline is out of date. Build it again with the new ones
+        if (generation != _generation)
+        {
+            if (pipeline != VK_NULL_HANDLE)
+            {
+                vkDestroyPipeline(_device, pipeline, nullptr);
+            }
+            if (_running)
+            {
+                _compileQueue.push_back(desc);
+            }
+            continue;
+        }
+
+        PipelineEntry& entry = _pipelines[desc];
+        entry.pipeline       = pipeline;
+        entry.status         = pipeline != VK_NULL_HANDLE ? PipelineStatus::Ready : PipelineStatus::Failed;
+        if (entry.status == PipelineStatus::Failed)
+        {
+            printf("Failed to compile Graphics Pipeline variant %016llx, using fallback\n", static_cast<unsigned long long>(desc.hash()));
+        }
+    }
+}
+
+VkPipeline PipelineLibrary::compilePipeline(const PipelineStateDesc& desc, VkShaderModule vertexShaderModule, VkShaderModule fragmentShaderModule)
+{
+    // -- SPECIALIZATION CONSTANTS --
+    // One 32 bit constant per shader feature, ids match constant_id in the shader
+    std::array<VkSpecializationMapEntry, SHADER_FEATURE_COUNT> specializationEntries;
+    for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++)
+    {
+        specializationEntries[i].constantID = i;
+        specializationEntries[i].offset     = i * sizeof(uint32_t);
+        specializationEntries[i].size       = sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount        = static_cast<uint32_t>(specializationEntries.size());
+    specializationInfo.pMapEntries          = specializationEntries.data();
+    specializationInfo.dataSize             = sizeof(desc.shaderFeatures);
+    specializationInfo.pData                = desc.shaderFeatures.data();
+
+    // -- SHADER STAGE CREATION INFORMATION --
+    // Vertex Stage creation information
+    VkPipelineShaderStageCreateInfo vertexShaderCI   = {};
+    vertexShaderCI.sType                             = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertexShaderCI.stage                             = VK_SHADER_STAGE_VERTEX_BIT;
+    vertexShaderCI.module                            = vertexShaderModule;
+    vertexShaderCI.pName                             = "main";
+
+    // Fragment Stage creation information
+    VkPipelineShaderStageCreateInfo fragmentShaderCI = {};
+    fragmentShaderCI.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragmentShaderCI.stage                           = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragmentShaderCI.module                          = fragmentShaderModule;
+    fragmentShaderCI.pName                           = "main";
+    fragmentShaderCI.pSpecializationInfo             = &specializationInfo;
+
+    // Put shader stage creation info in to array
+    // Graphics Pipeline creation info requires array of shader stage creates
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCI, fragmentShaderCI };
+
+    // Packed vertices keep the shader's locations but are read in smaller formats, which the fetch unpacks to floats
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes = _vertexAttributes;
+    uint32_t                                       vertexStride     = _vertexStride;
+    if (desc.vertexFormat != VERTEX_FORMAT_FULL)
+    {
+        vertexStride = sizeof(PackedVertex);
+        for (VkVertexInputAttributeDescription& attribute : vertexAttributes)
+        {
+            switch (attribute.location)
+            {
+                case 0:
+                    attribute.format = VK_FORMAT_R16G16B16A16_UNORM;
+                    attribute.offset = offsetof(PackedVertex, pos);
+                    break;
+                case 1:
+                    attribute.format = VK_FORMAT_R8G8B8A8_UNORM;
+                    attribute.offset = offsetof(PackedVertex, col);
+                    break;
+                default:
+                    attribute.format = desc.vertexFormat == VERTEX_FORMAT_PACKED ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT;
+                    attribute.offset = offsetof(PackedVertex, tex);
+                    break;
+            }
+        }
+    }
+
+    // How the data for a single vertex (including info such as position, color, texture coords, normals, ...etc) is as a whole.
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding                         = 0;
+    bindingDescription.stride                          = vertexStride;
+    // Choose between VK_VERTEX_INPUT_RATE_INDEX and VK_VERTEX_INPUT_RATE_INSTANCE
+    bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    // -- VERTEX INPUT --
+    VkPipelineVertexInputStateCreateInfo vertexInputCI = {};
+    vertexInputCI.sType                                = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputCI.vertexBindingDescriptionCount        = 1;
+    vertexInputCI.pVertexBindingDescriptions           = &bindingDescription; // List of Vertex Binding Descriptions (data spacing/stride information)
+    vertexInputCI.vertexAttributeDescriptionCount      = static_cast<uint32_t>(vertexAttributes.size());
+    vertexInputCI.pVertexAttributeDescriptions         = vertexAttributes.data(); // List of Vertex Attribute Descriptions (data format and where to bind to/from)
+
+    // -- INPUT ASSEMBLY --
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCI = {};
+    inputAssemblyCI.sType                               = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyCI.topology                            = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyCI.primitiveRestartEnable              = VK_FALSE;
+
+    // -- VIEWPORT & SCISSOR --
+    // Create a viewport info struct
+    VkViewport viewport = {};
+    viewport.x        = 0.0f;                            // x start coordinate
+    viewport.y        = 0.0f;                            // y start coordinate
+    viewport.width    = (float)_extent.width;            // width of viewport
+    viewport.height   = (float)_extent.height;           // height of viewport
+    viewport.minDepth = 0.0f;                            // min framebuffer depth
+    viewport.maxDepth = 1.0f;                            // max framebuffer depth
+
+    // Create a scissor info struct
+    VkRect2D scissor = {};
+    scissor.offset   = { 0,0 };                          // Offset to use region from
+    scissor.extent   = _extent;                          // Extent to describe region to use, starting at offset
+
+    VkPipelineViewportStateCreateInfo viewportStateCI = {};
+    viewportStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCI.viewportCount                     = 1;
+    viewportStateCI.pViewports                        = &viewport;
+    viewportStateCI.scissorCount                      = 1;
+    viewportStateCI.pScissors                         = &scissor;
+
+    // -- RASTERIZER --
+    VkPipelineRasterizationStateCreateInfo rasterizerCI = {};
+    rasterizerCI.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizerCI.depthClampEnable        = VK_FALSE;
+    rasterizerCI.rasterizerDiscardEnable = VK_FALSE;
+    rasterizerCI.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizerCI.lineWidth               = 1.0f;
+    rasterizerCI.cullMode                = desc.cullMode;
+    rasterizerCI.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizerCI.depthBiasEnable         = VK_FALSE;
+
+    // -- MULTISAMPLING --
+    VkPipelineMultisampleStateCreateInfo multisamplingCI = {};
+    multisamplingCI.sType                                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisamplingCI.sampleShadingEnable                  = VK_FALSE;
+    multisamplingCI.rasterizationSamples                 = VK_SAMPLE_COUNT_1_BIT;
+
+    // -- BLENDING --
+    // Blend Attachment State (how blending is handled)
+    VkPipelineColorBlendAttachmentState colourState = {};
+    colourState.colorWriteMask                      = VK_COLOR_COMPONENT_R_BIT |
+                                                      VK_COLOR_COMPONENT_G_BIT |    // Colours to apply blending to
+                                                      VK_COLOR_COMPONENT_B_BIT |
+                                                      VK_COLOR_COMPONENT_A_BIT;
+    colourState.blendEnable                         = desc.blendEnable;
+    colourState.srcColorBlendFactor                 = VK_BLEND_FACTOR_SRC_ALPHA;
+    colourState.dstColorBlendFactor                 = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colourState.colorBlendOp                        = VK_BLEND_OP_ADD;
+
+    // Summarised: (VK_BLEND_FACTOR_SRC_ALPHA * new colour) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old colour)
+    //               (new colour alpha * new colour) + ((1 - new colour alpha) * old colour)
+
+    colourState.srcAlphaBlendFactor                 = VK_BLEND_FACTOR_ONE;
+    colourState.dstAlphaBlendFactor                 = VK_BLEND_FACTOR_ZERO;
+    colourState.alphaBlendOp                        = VK_BLEND_OP_ADD;
+    // Summarised: (1 * new alpha) + (0 * old alpha) = new alpha
+
+    VkPipelineColorBlendStateCreateInfo colourBlendingCI = {};
+    colourBlendingCI.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colourBlendingCI.logicOpEnable   = VK_FALSE;
+    colourBlendingCI.attachmentCount = 1;
+    colourBlendingCI.pAttachments    = &colourState;
+
+    // -- DEPTH STENCIL TESTING --
+    VkPipelineDepthStencilStateCreateInfo depthStencilCI = {};
+    depthStencilCI.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilCI.depthTestEnable       = desc.depthTestEnable;  // Enable checking depth to determine fragment write
+    depthStencilCI.depthWriteEnable      = desc.depthWriteEnable; // Enable writing to depth buffer (to replace old values)
+    depthStencilCI.depthCompareOp        = desc.depthCompareOp;   // Comparison operation that allows an overwrite (is in front)
+    depthStencilCI.depthBoundsTestEnable = VK_FALSE;              // Depth Bounds Test: Does the depth value exist between two bounds
+    depthStencilCI.stencilTestEnable     = VK_FALSE;              // Enable Stencil Test
+
+    // -- GRAPHICS PIPELINE CREATION --
+    VkGraphicsPipelineCreateInfo pipelineCI = {};
+    pipelineCI.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineCI.layout              = _pipelineLayout;      // Pipeline Layout pipeline should use
+    pipelineCI.pStages             = shaderStages;          // List of shader stages
+    pipelineCI.stageCount          = 2;                     // Number of shader stages
+    pipelineCI.pVertexInputState   = &vertexInputCI;        // All the fixed function pipeline states
+    pipelineCI.pViewportState      = &viewportStateCI;
+    pipelineCI.pDynamicState       = nullptr;
+    pipelineCI.pRasterizationState = &rasterizerCI;
+    pipelineCI.pMultisampleState   = &multisamplingCI;
+    pipelineCI.pColorBlendState    = &colourBlendingCI;
+    pipelineCI.pDepthStencilState  = &depthStencilCI;
+    pipelineCI.renderPass          = _renderPass;          // Render pass description the pipeline is compatible with
+    pipelineCI.subpass             = 0;                    // Subpass of render pass to use with pipeline
+    pipelineCI.pInputAssemblyState = &inputAssemblyCI;
+    pipelineCI.basePipelineHandle  = VK_NULL_HANDLE;       // Existing pipeline to derive from...
+    pipelineCI.basePipelineIndex   = -1;                     // or index of pipeline being created to derive from (in case creating multiple at once)
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(_device, _pipelineCache, 1, &pipelineCI, nullptr, &pipeline) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    return pipeline;
+}
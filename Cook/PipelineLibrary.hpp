@@ -0,0 +1,141 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Utilities.hpp"
+
+// Specialization constant ids, must match the constant_id values in simple_shader.frag
+enum ShaderFeature : uint32_t
+{
+    SHADER_FEATURE_VERTEX_COLOUR    = 0,    // Multiply by vertex colour
+    SHADER_FEATURE_ALPHA_TEST       = 1,    // Discard mostly transparent fragments
+    SHADER_FEATURE_TEXTURE_COUNT    = 2,    // 0 = vertex colour only, 1 = sample the texture
+    SHADER_FEATURE_DYNAMIC_FEATURES = 3,    // Ignore the above, branch on UboViewProjection::shaderFeatures instead
+    SHADER_FEATURE_VIRTUAL_TEXTURE  = 4,    // Sample the virtual texture (set 2) instead of the mesh's texture
+    SHADER_FEATURE_COUNT
+};
+
+// Fixed function state and shader specialization that vary between pipeline permutations
+struct PipelineStateDesc
+{
+    VkBool32        blendEnable      = VK_TRUE;
+    VkCullModeFlags cullMode         = VK_CULL_MODE_BACK_BIT;
+    VkBool32        depthTestEnable  = VK_TRUE;
+    VkBool32        depthWriteEnable = VK_TRUE;
+    VkCompareOp     depthCompareOp   = VK_COMPARE_OP_LESS;
+    VertexFormat    vertexFormat     = VERTEX_FORMAT_FULL;
+
+    // Baked into the shaders when the pipeline is compiled, so the driver can strip unused paths
+    std::array<uint32_t, SHADER_FEATURE_COUNT> shaderFeatures = { VK_FALSE, VK_FALSE, 1, VK_FALSE, VK_FALSE };
+
+    uint64_t hash() const;
+    bool     operator==(const PipelineStateDesc& other) const;
+};
+
+struct PipelineStateDescHash
+{
+    size_t operator()(const PipelineStateDesc& desc) const
+    {
+        return static_cast<size_t>(desc.hash());
+    }
+};
+
+// Compiles graphics pipeline permutations on background threads. Until a permutation
+// is ready, getPipeline returns the fallback pipeline (compiled up front in init).
+// Shaders can be replaced while running: reloadShaders rebuilds every compiled permutation,
+// applyReload swaps them in between frames, and the old ones are destroyed once no frame uses them.
+class PipelineLibrary
+{
+    public:
+        PipelineLibrary();
+
+        void       init(VkDevice device,
+                        VkPipelineCache pipelineCache,
+                        VkRenderPass renderPass,
+                        VkPipelineLayout pipelineLayout,
+                        VkExtent2D extent,
+                        VkShaderModule vertexShaderModule,
+                        VkShaderModule fragmentShaderModule,
+                        const std::vector<VkVertexInputAttributeDescription>& vertexAttributes,
+                        uint32_t vertexStride,
+                        const PipelineStateDesc& fallbackDesc,
+                        uint32_t compileThreadCount);
+        void       request(const PipelineStateDesc& desc);
+        VkPipeline getPipeline(const PipelineStateDesc& desc);
+        bool       isReady(const PipelineStateDesc& desc);
+        VkPipeline getFallbackPipeline();
+        bool       reloadShaders(VkShaderModule vertexShaderModule, VkShaderModule fragmentShaderModule);
+        void       applyReload(uint64_t frameNumber);
+        void       destroyRetired(uint64_t completedFrameNumber);
+        void       destroy();
+
+        ~PipelineLibrary();
+
+    private:
+        enum class PipelineStatus
+        {
+            Queued,
+            Ready,
+            Failed
+        };
+
+        struct PipelineEntry
+        {
+            PipelineStatus status;
+            VkPipeline     pipeline;
+        };
+
+        // Shader modules and pipelines replaced by a reload, still possibly in use by frames in flight
+        struct RetiredShaders
+        {
+            uint64_t                frameNumber;     // First frame that didn't use them
+            uint64_t                generation;
+            VkShaderModule          vertexShaderModule;
+            VkShaderModule          fragmentShaderModule;
+            std::vector<VkPipeline> pipelines;
+        };
+
+        VkDevice                 _device;
+        VkPipelineCache          _pipelineCache;      // Shared by all compile threads, Vulkan synchronises access internally
+        VkRenderPass             _renderPass;
+        VkPipelineLayout         _pipelineLayout;
+        VkExtent2D               _extent;
+        VkShaderModule           _vertexShaderModule;  // Kept for the library's lifetime, every permutation is built from them
+        VkShaderModule           _fragmentShaderModule;
+        VkPipeline               _fallbackPipeline;
+        PipelineStateDesc        _fallbackDesc;
+        uint32_t                 _vertexStride;
+        std::vector<VkVertexInputAttributeDescription> _vertexAttributes;      // For VERTEX_FORMAT_FULL, packed formats are derived from them
+
+        std::unordered_map<PipelineStateDesc, PipelineEntry, PipelineStateDescHash> _pipelines;
+        std::deque<PipelineStateDesc>  _compileQueue;
+        std::vector<std::thread>       _compileThreads;
+        std::mutex                     _mutex;        // Guards _pipelines, _compileQueue and _running
+        std::condition_variable        _compileCondition;
+        bool                           _running;
+
+        // Reload state, also guarded by _mutex
+        uint64_t                       _generation;   // Incremented every time reloaded shaders are swapped in
+        std::multiset<uint64_t>        _compilingGenerations;
+        bool                           _reloadPending;
+        VkShaderModule                 _pendingVertexShaderModule;
+        VkShaderModule                 _pendingFragmentShaderModule;
+        std::unordered_map<PipelineStateDesc, VkPipeline, PipelineStateDescHash> _pendingPipelines;
+        std::vector<RetiredShaders>    _retiredShaders;
+
+        void       compileLoop();
+        VkPipeline compilePipeline(const PipelineStateDesc& desc, VkShaderModule vertexShaderModule, VkShaderModule fragmentShaderModule);
+        void       destroyPendingReloadLocked();
+        bool       requestLocked(const PipelineStateDesc& desc);
+};
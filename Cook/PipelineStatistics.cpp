@@ -0,0 +1,194 @@
+#include "PipelineStatistics.hpp"
+#include "Utilities.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+// Number of 64 bit values returned per query, one per statistic flag
+static const uint32_t STATISTIC_COUNT = 6;
+
+PipelineStatistics::PipelineStatistics()
+{
+    _enabled      = false;
+    _currentFrame = 0;
+    _historyNext  = 0;
+}
+
+void PipelineStatistics::init(VkDevice device, bool pipelineStatisticsEnabled)
+{
+    _device = device;
+
+    // Needs the pipelineStatisticsQuery feature, and inheritedQueries since the draws are in secondary command buffers
+    if (!pipelineStatisticsEnabled)
+    {
+        printf("Pipeline statistics disabled, device doesn't support pipeline statistics or inherited queries\n");
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolCI = {};
+    queryPoolCI.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCI.queryType             = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolCI.queryCount            = 1;
+    queryPoolCI.pipelineStatistics    = STATISTIC_FLAGS;
+
+    _frames.resize(MAX_FRAME_DRAWS);
+    for (FrameQuery& frame : _frames)
+    {
+        VkResult result = vkCreateQueryPool(_device, &queryPoolCI, nullptr, &frame.queryPool);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a pipeline statistics Query Pool!");
+        }
+        frame.recorded    = false;
+        frame.frameNumber = 0;
+    }
+
+    _enabled = true;
+}
+
+void PipelineStatistics::begin(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    // This slot's fence has been waited on, so the query from its last frame is complete
+    FrameQuery& frame = _frames[frameIndex];
+    collectResults(frame);
+
+    frame.recorded    = true;
+    frame.frameNumber = frameNumber;
+    _currentFrame     = frameIndex;
+
+    // Reset and begin outside of the render pass, so the whole pass is counted
+    vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, 1);
+    vkCmdBeginQuery(commandBuffer, frame.queryPool, 0, 0);
+}
+
+void PipelineStatistics::end(VkCommandBuffer commandBuffer)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    vkCmdEndQuery(commandBuffer, _frames[_currentFrame].queryPool, 0);
+}
+
+bool PipelineStatistics::isEnabled()
+{
+    return _enabled;
+}
+
+VkQueryPipelineStatisticFlags PipelineStatistics::getInheritedStatistics()
+{
+    // Secondary command buffers executed while the query is active must declare the statistics they inherit
+    return _enabled ? STATISTIC_FLAGS : 0;
+}
+
+const PipelineStatisticsCounters& PipelineStatistics::getLatest()
+{
+    return _latest;
+}
+
+PipelineStatisticsCounters PipelineStatistics::getAverage()
+{
+    PipelineStatisticsCounters average;
+    if (_history.empty())
+    {
+        return average;
+    }
+
+    for (const PipelineStatisticsCounters& counters : _history)
+    {
+        average.inputAssemblyVertices     += counters.inputAssemblyVertices;
+        average.inputAssemblyPrimitives   += counters.inputAssemblyPrimitives;
+        average.vertexShaderInvocations   += counters.vertexShaderInvocations;
+        average.clippingInvocations       += counters.clippingInvocations;
+        average.clippingPrimitives        += counters.clippingPrimitives;
+        average.fragmentShaderInvocations += counters.fragmentShaderInvocations;
+    }
+
+    uint64_t frameCount = _history.size();
+    average.frameNumber                = _latest.frameNumber;
+    average.inputAssemblyVertices     /= frameCount;
+    average.inputAssemblyPrimitives   /= frameCount;
+    average.vertexShaderInvocations   /= frameCount;
+    average.clippingInvocations       /= frameCount;
+    average.clippingPrimitives        /= frameCount;
+    average.fragmentShaderInvocations /= frameCount;
+    return average;
+}
+
+void PipelineStatistics::printReport(VkExtent2D extent)
+{
+    if (!_enabled || _history.empty())
+    {
+        return;
+    }
+
+    // Fragments per pixel is a measure of overdraw (1.0 = every pixel shaded exactly once)
+    PipelineStatisticsCounters average = getAverage();
+    double pixelCount = static_cast<double>(extent.width) * extent.height;
+
+    printf("Pipeline statistics, average over last %u frames:\n", static_cast<uint32_t>(_history.size()));
+    printf("  Input assembly vertices     %12llu\n", static_cast<unsigned long long>(average.inputAssemblyVertices));
+    printf("  Input assembly primitives   %12llu\n", static_cast<unsigned long long>(average.inputAssemblyPrimitives));
+    printf("  Vertex shader invocations   %12llu\n", static_cast<unsigned long long>(average.vertexShaderInvocations));
+    printf("  Clipping invocations        %12llu\n", static_cast<unsigned long long>(average.clippingInvocations));
+    printf("  Clipping primitives         %12llu\n", static_cast<unsigned long long>(average.clippingPrimitives));
+    printf("  Fragment shader invocations %12llu  (%.2f per pixel)\n",
+           static_cast<unsigned long long>(average.fragmentShaderInvocations),
+           pixelCount > 0.0 ? average.fragmentShaderInvocations / pixelCount : 0.0);
+}
+
+void PipelineStatistics::destroy()
+{
+    for (FrameQuery& frame : _frames)
+    {
+        vkDestroyQueryPool(_device, frame.queryPool, nullptr);
+    }
+    _frames.clear();
+    _enabled = false;
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+}
+
+void PipelineStatistics::collectResults(FrameQuery& frame)
+{
+    if (!frame.recorded)
+    {
+        return;
+    }
+
+    // Statistics followed by an availability word, never waits
+    uint64_t results[STATISTIC_COUNT + 1] = {};
+    VkResult result = vkGetQueryPoolResults(_device, frame.queryPool, 0, 1, sizeof(results), results, sizeof(results),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS || results[STATISTIC_COUNT] == 0)
+    {
+        return;
+    }
+
+    _latest.frameNumber               = frame.frameNumber;
+    _latest.inputAssemblyVertices     = results[0];
+    _latest.inputAssemblyPrimitives   = results[1];
+    _latest.vertexShaderInvocations   = results[2];
+    _latest.clippingInvocations       = results[3];
+    _latest.clippingPrimitives        = results[4];
+    _latest.fragmentShaderInvocations = results[5];
+
+    // Rolling window for the report
+    if (_history.size() < GPU_PROFILER_HISTORY_FRAMES)
+    {
+        _history.push_back(_latest);
+    }
+    else
+    {
+        _history[_historyNext] = _latest;
+    }
+    _historyNext = (_historyNext + 1) % GPU_PROFILER_HISTORY_FRAMES;
+}
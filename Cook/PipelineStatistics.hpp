@@ -0,0 +1,68 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// Work the GPU did inside one pipeline statistics query
+struct PipelineStatisticsCounters
+{
+    uint64_t frameNumber               = 0;
+    uint64_t inputAssemblyVertices     = 0;
+    uint64_t inputAssemblyPrimitives   = 0;
+    uint64_t vertexShaderInvocations   = 0;
+    uint64_t clippingInvocations       = 0;     // Primitives that reached the clipping stage
+    uint64_t clippingPrimitives        = 0;     // Primitives that came out of it (culled ones removed, split ones added)
+    uint64_t fragmentShaderInvocations = 0;
+};
+
+// Counts vertices, primitives and fragments processed between begin and end with a
+// VK_QUERY_TYPE_PIPELINE_STATISTICS query. Like GpuProfiler there is one query pool per frame in flight,
+// read back without waiting once that frame slot comes round again.
+class PipelineStatistics
+{
+    public:
+        // Counters that are queried. Results come back in bit order, matching PipelineStatisticsCounters
+        static const VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        PipelineStatistics();
+
+        void init(VkDevice device, bool pipelineStatisticsEnabled);
+        void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+        void end(VkCommandBuffer commandBuffer);
+
+        bool                              isEnabled();
+        VkQueryPipelineStatisticFlags     getInheritedStatistics();
+        const PipelineStatisticsCounters& getLatest();
+        PipelineStatisticsCounters        getAverage();
+        void                              printReport(VkExtent2D extent);
+        void                              destroy();
+
+        ~PipelineStatistics();
+
+    private:
+        struct FrameQuery
+        {
+            VkQueryPool queryPool;
+            bool        recorded;       // Query was begun and ended in this slot's last frame
+            uint64_t    frameNumber;
+        };
+
+        VkDevice                                _device;
+        bool                                    _enabled;
+        std::vector<FrameQuery>                 _frames;         // One per frame in flight
+        uint32_t                                _currentFrame;
+        PipelineStatisticsCounters              _latest;
+        std::vector<PipelineStatisticsCounters> _history;        // Last GPU_PROFILER_HISTORY_FRAMES frames
+        size_t                                  _historyNext;
+
+        void collectResults(FrameQuery& frame);
+};
@@ -0,0 +1,115 @@
+#include "SceneGraph.hpp"
+
+#include <stdexcept>
+
+SceneGraph::SceneGraph()
+{
+    _firstDirtyNode = -1;
+}
+
+int SceneGraph::addNode(int parentId, glm::mat4 localTransform, int meshId)
+{
+    int nodeId = static_cast<int>(_parents.size());
+
+    // Parent must already exist, this keeps the array topologically sorted
+    if (parentId >= nodeId)
+    {
+        throw std::runtime_error("Scene node parent must be added before its children!");
+    }
+
+    _parents.push_back(parentId);
+    _meshIds.push_back(meshId);
+    _localTransforms.push_back(localTransform);
+    _worldTransforms.push_back(localTransform);
+    _dirty.push_back(1);
+    _worldChanged.push_back(0);
+
+    if (_firstDirtyNode < 0)
+    {
+        _firstDirtyNode = nodeId;
+    }
+
+    return nodeId;
+}
+
+void SceneGraph::setLocalTransform(int nodeId, glm::mat4 localTransform)
+{
+    _localTransforms[nodeId] = localTransform;
+    _dirty[nodeId]           = 1;
+
+    if (_firstDirtyNode < 0 || nodeId < _firstDirtyNode)
+    {
+        _firstDirtyNode = nodeId;
+    }
+}
+
+const glm::mat4& SceneGraph::getLocalTransform(int nodeId)
+{
+    return _localTransforms[nodeId];
+}
+
+const glm::mat4& SceneGraph::getWorldTransform(int nodeId)
+{
+    return _worldTransforms[nodeId];
+}
+
+int SceneGraph::getParent(int nodeId)
+{
+    return _parents[nodeId];
+}
+
+int SceneGraph::getMeshId(int nodeId)
+{
+    return _meshIds[nodeId];
+}
+
+int SceneGraph::getNodeCount()
+{
+    return static_cast<int>(_parents.size());
+}
+
+void SceneGraph::updateWorldTransforms()
+{
+    // Nothing moved since last update, so every world transform is still valid
+    if (_firstDirtyNode < 0)
+    {
+        return;
+    }
+
+    // Nodes before the first dirty node can't have changed (parents always come before children)
+    int nodeCount = static_cast<int>(_parents.size());
+    for (int i = _firstDirtyNode; i < nodeCount; i++)
+    {
+        int parent = _parents[i];
+
+        // Recalculate if own transform changed, or if parent's world transform was recalculated this pass
+        bool parentChanged = parent >= _firstDirtyNode && _worldChanged[parent];
+        if (_dirty[i] || parentChanged)
+        {
+            _worldTransforms[i] = parent >= 0 ? _worldTransforms[parent] * _localTransforms[i] : _localTransforms[i];
+            _worldChanged[i]    = 1;
+            _dirty[i]           = 0;
+        }
+        else
+        {
+            _worldChanged[i]    = 0;
+        }
+    }
+
+    _firstDirtyNode = -1;
+}
+
+void SceneGraph::clear()
+{
+    _parents.clear();
+    _meshIds.clear();
+    _localTransforms.clear();
+    _worldTransforms.clear();
+    _dirty.clear();
+    _worldChanged.clear();
+    _firstDirtyNode = -1;
+}
+
+SceneGraph::~SceneGraph()
+{
+}
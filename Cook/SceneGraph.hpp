@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// Scene hierarchy stored as a flat array. A node's parent is always stored before the node itself
+// (topologically sorted), so world transforms can be propagated in one linear pass over the array.
+class SceneGraph
+{
+    public:
+        SceneGraph();
+
+        int              addNode(int parentId, glm::mat4 localTransform, int meshId = -1);
+        void             setLocalTransform(int nodeId, glm::mat4 localTransform);
+        const glm::mat4& getLocalTransform(int nodeId);
+        const glm::mat4& getWorldTransform(int nodeId);
+        int              getParent(int nodeId);
+        int              getMeshId(int nodeId);
+        int              getNodeCount();
+
+        void updateWorldTransforms();
+        void clear();
+
+        ~SceneGraph();
+
+    private:
+        std::vector<int>       _parents;          // Index of parent node, -1 for root nodes
+        std::vector<int>       _meshIds;          // Index of mesh drawn at this node, -1 for none
+        std::vector<glm::mat4> _localTransforms;  // Transform relative to parent
+        std::vector<glm::mat4> _worldTransforms;  // Transform relative to scene origin
+        std::vector<uint8_t>   _dirty;            // Local transform changed since last update
+        std::vector<uint8_t>   _worldChanged;     // World transform recalculated in current update
+        int                    _firstDirtyNode;   // Lowest dirty index, -1 if nothing is dirty
+};
@@ -0,0 +1,225 @@
+#include "ShaderHotReload.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#if __has_include(<shaderc/shaderc.hpp>)
+#include <shaderc/shaderc.hpp>
+#define COOK_HAS_SHADERC 1
+#endif
+
+// Editors often write a file in several steps, wait this long after the last change before reporting
+static const std::chrono::milliseconds SETTLE_TIME(50);
+static const std::chrono::milliseconds POLL_INTERVAL(100);
+
+static bool isGlslSource(const std::string& fileName)
+{
+    std::string extension = std::filesystem::path(fileName).extension().string();
+    return extension == ".vert" || extension == ".frag";
+}
+
+ShaderHotReload::ShaderHotReload() : _running(false)
+{
+}
+
+void ShaderHotReload::start(const std::string& shaderDirectory, std::function<void(const std::vector<std::string>& changedFiles)> onChange)
+{
+    _shaderDirectory = shaderDirectory;
+    _onChange        = std::move(onChange);
+    _running         = true;
+    _watchThread     = std::thread(&ShaderHotReload::watchLoop, this);
+}
+
+void ShaderHotReload::stop()
+{
+    _running = false;
+    if (_watchThread.joinable())
+    {
+        _watchThread.join();
+    }
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    stop();
+}
+
+#ifdef __linux__
+
+void ShaderHotReload::watchLoop()
+{
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0 || inotify_add_watch(inotifyFd, _shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        printf("Failed to watch %s, shader hot reload disabled\n", _shaderDirectory.c_str());
+        if (inotifyFd >= 0)
+        {
+            close(inotifyFd);
+        }
+        return;
+    }
+
+    std::set<std::string> changedFiles;
+    auto lastChange = std::chrono::steady_clock::now();
+
+    while (_running)
+    {
+        // Wake up regularly to check _running, and to report changes once they have settled
+        pollfd pollFd = { inotifyFd, POLLIN, 0 };
+        if (poll(&pollFd, 1, static_cast<int>(POLL_INTERVAL.count())) > 0)
+        {
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+                {
+                    inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+                    if (event->len > 0 && isGlslSource(event->name))
+                    {
+                        changedFiles.insert((std::filesystem::path(_shaderDirectory) / event->name).string());
+                        lastChange = std::chrono::steady_clock::now();
+                    }
+                }
+            }
+        }
+
+        if (!changedFiles.empty() && std::chrono::steady_clock::now() - lastChange >= SETTLE_TIME)
+        {
+            _onChange(std::vector<std::string>(changedFiles.begin(), changedFiles.end()));
+            changedFiles.clear();
+        }
+    }
+
+    close(inotifyFd);
+}
+
+#else
+
+void ShaderHotReload::watchLoop()
+{
+    // No inotify, so compare modification times of every source in the directory
+    std::map<std::string, std::filesystem::file_time_type> writeTimes;
+    auto scan = [this](std::map<std::string, std::filesystem::file_time_type>* times)
+    {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(_shaderDirectory, error))
+        {
+            if (isGlslSource(entry.path().string()))
+            {
+                (*times)[entry.path().string()] = entry.last_write_time(error);
+            }
+        }
+    };
+    scan(&writeTimes);
+
+    while (_running)
+    {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+
+        std::map<std::string, std::filesystem::file_time_type> newWriteTimes;
+        scan(&newWriteTimes);
+
+        std::vector<std::string> changedFiles;
+        for (const auto& file : newWriteTimes)
+        {
+            auto previous = writeTimes.find(file.first);
+            if (previous == writeTimes.end() || previous->second != file.second)
+            {
+                changedFiles.push_back(file.first);
+            }
+        }
+        writeTimes = std::move(newWriteTimes);
+
+        if (!changedFiles.empty())
+        {
+            std::this_thread::sleep_for(SETTLE_TIME);
+            _onChange(changedFiles);
+        }
+    }
+}
+
+#endif
+
+bool compileGlslToSpirv(const std::string& sourcePath, const std::vector<std::string>& definitions,
+                        std::vector<char>* spirvCode, std::string* errors)
+{
+#ifdef COOK_HAS_SHADERC
+    bool isVertex = std::filesystem::path(sourcePath).extension() == ".vert";
+
+    std::ifstream file(sourcePath, std::ios::binary);
+    if (!file.is_open())
+    {
+        *errors = "Failed to open " + sourcePath;
+        return false;
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    shaderc::Compiler       compiler;
+    shaderc::CompileOptions options;
+    for (const std::string& definition : definitions)
+    {
+        size_t equals = definition.find('=');
+        options.AddMacroDefinition(definition.substr(0, equals), equals == std::string::npos ? "" : definition.substr(equals + 1));
+    }
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source,
+                                                                     isVertex ? shaderc_glsl_vertex_shader : shaderc_glsl_fragment_shader,
+                                                                     sourcePath.c_str(),
+                                                                     options);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+    {
+        *errors = result.GetErrorMessage();
+        return false;
+    }
+
+    const char* begin = reinterpret_cast<const char*>(result.cbegin());
+    const char* end   = reinterpret_cast<const char*>(result.cend());
+    spirvCode->assign(begin, end);
+    return true;
+#else
+    // Same compiler compile.sh uses, from the Vulkan SDK if VULKAN_SDK is set, otherwise from PATH
+    const char* vulkanSdk = std::getenv("VULKAN_SDK");
+    std::string glslc     = vulkanSdk ? std::string(vulkanSdk) + "/bin/glslc" : "glslc";
+    std::string output    = sourcePath + ".reload.spv";
+    std::string log       = sourcePath + ".reload.log";
+    std::string command   = "\"" + glslc + "\"";
+    for (const std::string& definition : definitions)
+    {
+        command += " \"-D" + definition + "\"";
+    }
+    command += " \"" + sourcePath + "\" -o \"" + output + "\" > \"" + log + "\" 2>&1";
+
+    int exitCode = std::system(command.c_str());
+
+    std::ifstream logFile(log);
+    std::stringstream logText;
+    logText << logFile.rdbuf();
+    logFile.close();
+    std::remove(log.c_str());
+
+    std::ifstream spirvFile(output, std::ios::binary);
+    if (exitCode != 0 || !spirvFile.is_open())
+    {
+        *errors = logText.str().empty() ? "Failed to run " + glslc : logText.str();
+        std::remove(output.c_str());
+        return false;
+    }
+    spirvCode->assign(std::istreambuf_iterator<char>(spirvFile), std::istreambuf_iterator<char>());
+    spirvFile.close();
+    std::remove(output.c_str());
+    return !spirvCode->empty();
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches a shader directory on a background thread and reports GLSL sources that were saved.
+// Uses inotify on Linux, and polls file modification times everywhere else.
+class ShaderHotReload
+{
+    public:
+        ShaderHotReload();
+
+        void start(const std::string& shaderDirectory, std::function<void(const std::vector<std::string>& changedFiles)> onChange);
+        void stop();
+
+        ~ShaderHotReload();
+
+    private:
+        std::string                                                 _shaderDirectory;
+        std::function<void(const std::vector<std::string>&)>        _onChange;
+        std::thread                                                 _watchThread;
+        std::atomic<bool>                                           _running;
+
+        void watchLoop();
+};
+
+// Compiles a .vert/.frag GLSL file to SPIR-V, with definitions given as "NAME=VALUE" (glslc's -D). Uses shaderc
+// in-process when it is available, otherwise runs glslc. Returns false and fills errors if compilation failed.
+bool compileGlslToSpirv(const std::string& sourcePath, const std::vector<std::string>& definitions,
+                        std::vector<char>* spirvCode, std::string* errors);
@@ -0,0 +1,764 @@
+#include "ShaderReflection.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+// SPIR-V opcodes, decorations and storage classes the reflection needs (from the SPIR-V specification)
+namespace spv
+{
+    const uint32_t MAGIC_NUMBER = 0x07230203;
+
+    enum Op : uint32_t
+    {
+        OpEntryPoint          = 15,
+        OpTypeInt             = 21,
+        OpTypeFloat           = 22,
+        OpTypeVector          = 23,
+        OpTypeMatrix          = 24,
+        OpTypeImage           = 25,
+        OpTypeSampler         = 26,
+        OpTypeSampledImage    = 27,
+        OpTypeArray           = 28,
+        OpTypeRuntimeArray    = 29,
+        OpTypeStruct          = 30,
+        OpTypePointer         = 32,
+        OpConstant            = 43,
+        OpFunction            = 54,
+        OpFunctionCall        = 57,
+        OpVariable            = 59,
+        OpImageTexelPointer   = 60,
+        OpLoad                = 61,
+        OpStore               = 62,
+        OpCopyMemory          = 63,
+        OpAccessChain         = 65,
+        OpInBoundsAccessChain = 66,
+        OpPtrAccessChain      = 67,
+        OpArrayLength         = 68,
+        OpDecorate            = 71,
+        OpMemberDecorate      = 72,
+        OpAtomicLoad          = 227,
+        OpAtomicStore         = 228,
+        OpAtomicXor           = 242
+    };
+
+    enum Decoration : uint32_t
+    {
+        SpecId        = 1,
+        Block         = 2,
+        BufferBlock   = 3,
+        ArrayStride   = 6,
+        MatrixStride  = 7,
+        BuiltIn       = 11,
+        Location      = 30,
+        Binding       = 33,
+        DescriptorSet = 34,
+        Offset        = 35
+    };
+
+    enum StorageClass : uint32_t
+    {
+        UniformConstant = 0,
+        Input           = 1,
+        Uniform         = 2,
+        PushConstant    = 9,
+        StorageBuffer   = 12
+    };
+
+    const uint32_t DIM_BUFFER = 5;
+}
+
+namespace
+{
+    // Everything the reflection needs to know about one SPIR-V id
+    struct SpirvId
+    {
+        uint32_t              opcode = 0;
+        std::vector<uint32_t> operands;             // Instruction words after the result id
+        uint32_t              set = 0;
+        uint32_t              binding = 0;
+        uint32_t              location = 0;
+        uint32_t              arrayStride = 0;
+        bool                  hasLocation = false;
+        bool                  isBuiltIn = false;
+        bool                  isBlock = false;
+        bool                  isBufferBlock = false;
+        std::vector<uint32_t> memberOffsets;
+        std::vector<uint32_t> memberMatrixStrides;
+    };
+
+    struct SpirvModule
+    {
+        std::vector<SpirvId>  ids;
+        std::vector<uint32_t> variables;
+        std::set<uint32_t>    usedIds;              // Ids referenced through a pointer inside a function
+        std::set<uint32_t>    specializationConstantIds;
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+
+        const SpirvId& get(uint32_t id) const
+        {
+            if (id >= ids.size())
+            {
+                throw std::runtime_error("Invalid id in SPIR-V module!");
+            }
+            return ids[id];
+        }
+    };
+
+    VkShaderStageFlagBits executionModelToStage(uint32_t executionModel)
+    {
+        switch (executionModel)
+        {
+            case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        throw std::runtime_error("Unsupported SPIR-V execution model!");
+    }
+
+    SpirvModule parseModule(std::span<const char> spirvCode)
+    {
+        if (spirvCode.size() < 5 * sizeof(uint32_t) || spirvCode.size() % sizeof(uint32_t) != 0)
+        {
+            throw std::runtime_error("Invalid SPIR-V module size!");
+        }
+
+        std::vector<uint32_t> words(spirvCode.size() / sizeof(uint32_t));
+        memcpy(words.data(), spirvCode.data(), spirvCode.size());
+        if (words[0] != spv::MAGIC_NUMBER)
+        {
+            throw std::runtime_error("Invalid SPIR-V magic number!");
+        }
+
+        SpirvModule module;
+        module.ids.resize(words[3]);               // Header word 3 is the id bound
+        bool entryPointFound = false;
+
+        // Header is 5 words, then instructions: (word count << 16 | opcode), followed by operands
+        size_t offset = 5;
+        while (offset < words.size())
+        {
+            uint32_t opcode    = words[offset] & 0xFFFF;
+            uint32_t wordCount = words[offset] >> 16;
+            if (wordCount == 0 || offset + wordCount > words.size())
+            {
+                throw std::runtime_error("Invalid SPIR-V instruction!");
+            }
+            const uint32_t* inst = &words[offset];
+
+            // Only ids used through a pointer matter, i.e. loads, stores, access chains and calls
+            auto markUsed = [&module](uint32_t id) { module.usedIds.insert(id); };
+
+            switch (opcode)
+            {
+                case spv::OpEntryPoint:
+                    // Only the first entry point is reflected, which is all glslc produces
+                    if (!entryPointFound)
+                    {
+                        module.stage    = executionModelToStage(inst[1]);
+                        entryPointFound = true;
+                    }
+                    break;
+
+                case spv::OpDecorate:
+                {
+                    SpirvId& target = module.ids.at(inst[1]);
+                    switch (inst[2])
+                    {
+                        case spv::Block:         target.isBlock = true;                              break;
+                        case spv::BufferBlock:   target.isBufferBlock = true;                        break;
+                        case spv::ArrayStride:   target.arrayStride = inst[3];                       break;
+                        case spv::BuiltIn:       target.isBuiltIn = true;                            break;
+                        case spv::Location:      target.location = inst[3]; target.hasLocation = true; break;
+                        case spv::Binding:       target.binding = inst[3];                           break;
+                        case spv::DescriptorSet: target.set = inst[3];                               break;
+                        case spv::SpecId:        module.specializationConstantIds.insert(inst[3]);   break;
+                    }
+                    break;
+                }
+
+                case spv::OpMemberDecorate:
+                {
+                    SpirvId& target = module.ids.at(inst[1]);
+                    uint32_t member = inst[2];
+                    if (inst[3] == spv::Offset || inst[3] == spv::MatrixStride)
+                    {
+                        std::vector<uint32_t>& values = inst[3] == spv::Offset ? target.memberOffsets : target.memberMatrixStrides;
+                        values.resize(std::max<size_t>(values.size(), member + 1), 0);
+                        values[member] = inst[4];
+                    }
+                    break;
+                }
+
+                case spv::OpTypeInt:
+                case spv::OpTypeFloat:
+                case spv::OpTypeVector:
+                case spv::OpTypeMatrix:
+                case spv::OpTypeImage:
+                case spv::OpTypeSampler:
+                case spv::OpTypeSampledImage:
+                case spv::OpTypeArray:
+                case spv::OpTypeRuntimeArray:
+                case spv::OpTypeStruct:
+                case spv::OpTypePointer:
+                {
+                    SpirvId& result = module.ids.at(inst[1]);
+                    result.opcode   = opcode;
+                    result.operands.assign(inst + 2, inst + wordCount);
+                    break;
+                }
+
+                case spv::OpConstant:
+                case spv::OpVariable:
+                {
+                    // Result type comes first for these, store as [type, rest...]
+                    SpirvId& result = module.ids.at(inst[2]);
+                    result.opcode   = opcode;
+                    result.operands.assign(inst + 3, inst + wordCount);
+                    result.operands.insert(result.operands.begin(), inst[1]);
+                    if (opcode == spv::OpVariable)
+                    {
+                        module.variables.push_back(inst[2]);
+                    }
+                    break;
+                }
+
+                case spv::OpLoad:
+                case spv::OpImageTexelPointer:
+                case spv::OpAccessChain:
+                case spv::OpInBoundsAccessChain:
+                case spv::OpPtrAccessChain:
+                case spv::OpArrayLength:
+                    markUsed(inst[3]);
+                    break;
+
+                case spv::OpStore:
+                case spv::OpAtomicStore:        // No result, so the pointer is the first operand
+                    markUsed(inst[1]);
+                    break;
+
+                case spv::OpCopyMemory:
+                    markUsed(inst[1]);
+                    markUsed(inst[2]);
+                    break;
+
+                case spv::OpFunctionCall:
+                    for (uint32_t i = 4; i < wordCount; i++)
+                    {
+                        markUsed(inst[i]);
+                    }
+                    break;
+
+                default:
+                    if (opcode >= spv::OpAtomicLoad && opcode <= spv::OpAtomicXor)
+                    {
+                        markUsed(inst[3]);
+                    }
+                    break;
+            }
+
+            offset += wordCount;
+        }
+
+        if (!entryPointFound)
+        {
+            throw std::runtime_error("SPIR-V module has no entry point!");
+        }
+
+        return module;
+    }
+
+    uint32_t getConstantValue(const SpirvModule& module, uint32_t id)
+    {
+        const SpirvId& constant = module.get(id);
+        if (constant.opcode != spv::OpConstant || constant.operands.size() < 2)
+        {
+            throw std::runtime_error("SPIR-V array length is not a constant!");
+        }
+        return constant.operands[1];
+    }
+
+    // Size in bytes of a type as laid out in a block (uses the explicit Offset/ArrayStride/MatrixStride decorations)
+    uint32_t getTypeSize(const SpirvModule& module, uint32_t typeId, uint32_t matrixStride = 0)
+    {
+        const SpirvId& type = module.get(typeId);
+        switch (type.opcode)
+        {
+            case spv::OpTypeInt:
+            case spv::OpTypeFloat:
+                return type.operands[0] / 8;
+
+            case spv::OpTypeVector:
+                return getTypeSize(module, type.operands[0]) * type.operands[1];
+
+            case spv::OpTypeMatrix:
+                // Columns are MatrixStride apart when decorated, otherwise tightly packed
+                return type.operands[1] * (matrixStride > 0 ? matrixStride : getTypeSize(module, type.operands[0]));
+
+            case spv::OpTypeArray:
+            {
+                uint32_t stride = type.arrayStride > 0 ? type.arrayStride : getTypeSize(module, type.operands[0], matrixStride);
+                return stride * getConstantValue(module, type.operands[1]);
+            }
+
+            case spv::OpTypeStruct:
+            {
+                // End of the member that finishes furthest into the struct
+                uint32_t size = 0;
+                for (size_t i = 0; i < type.operands.size(); i++)
+                {
+                    uint32_t memberOffset = i < type.memberOffsets.size() ? type.memberOffsets[i] : size;
+                    uint32_t memberStride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+                    size = std::max(size, memberOffset + getTypeSize(module, type.operands[i], memberStride));
+                }
+                return size;
+            }
+        }
+
+        throw std::runtime_error("Unsupported SPIR-V type in block!");
+    }
+
+    VkFormat getVertexFormat(const SpirvModule& module, uint32_t typeId, uint32_t* size)
+    {
+        const SpirvId& type = module.get(typeId);
+        uint32_t componentCount = 1;
+        const SpirvId* component = &type;
+        if (type.opcode == spv::OpTypeVector)
+        {
+            componentCount = type.operands[1];
+            component      = &module.get(type.operands[0]);
+        }
+
+        if ((component->opcode != spv::OpTypeFloat && component->opcode != spv::OpTypeInt) || component->operands[0] != 32)
+        {
+            throw std::runtime_error("Unsupported vertex input type in SPIR-V!");
+        }
+        *size = 4 * componentCount;
+
+        // Indexed by component count - 1
+        static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static const VkFormat sintFormats[]  = { VK_FORMAT_R32_SINT,   VK_FORMAT_R32G32_SINT,   VK_FORMAT_R32G32B32_SINT,   VK_FORMAT_R32G32B32A32_SINT };
+        static const VkFormat uintFormats[]  = { VK_FORMAT_R32_UINT,   VK_FORMAT_R32G32_UINT,   VK_FORMAT_R32G32B32_UINT,   VK_FORMAT_R32G32B32A32_UINT };
+
+        if (component->opcode == spv::OpTypeFloat)
+        {
+            return floatFormats[componentCount - 1];
+        }
+        return component->operands[1] ? sintFormats[componentCount - 1] : uintFormats[componentCount - 1];
+    }
+
+    VkDescriptorType getDescriptorType(const SpirvModule& module, uint32_t storageClass, const SpirvId& type)
+    {
+        if (storageClass == spv::StorageBuffer || (storageClass == spv::Uniform && type.isBufferBlock))
+        {
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        if (storageClass == spv::Uniform)
+        {
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        }
+
+        switch (type.opcode)
+        {
+            case spv::OpTypeSampler:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case spv::OpTypeSampledImage:
+                return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case spv::OpTypeImage:
+            {
+                // Operands: sampled type, dim, depth, arrayed, MS, sampled (1 = sampled, 2 = storage), format
+                bool isBuffer  = type.operands[1] == spv::DIM_BUFFER;
+                bool isStorage = type.operands[5] == 2;
+                if (isBuffer)
+                {
+                    return isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                return isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+        }
+
+        throw std::runtime_error("Unsupported descriptor type in SPIR-V!");
+    }
+}
+
+ShaderReflection reflectShader(std::span<const char> spirvCode)
+{
+    SpirvModule module = parseModule(spirvCode);
+
+    ShaderReflection reflection;
+    reflection.stageFlags = module.stage;
+    reflection.specializationConstantIds.assign(module.specializationConstantIds.begin(), module.specializationConstantIds.end());
+
+    for (uint32_t variableId : module.variables)
+    {
+        const SpirvId& variable     = module.get(variableId);
+        const SpirvId& pointerType  = module.get(variable.operands[0]);
+        uint32_t       storageClass = variable.operands[1];
+        uint32_t       typeId       = pointerType.operands[1];
+
+        // Vertex inputs come from the vertex buffer whether the shader reads them or not
+        if (storageClass == spv::Input)
+        {
+            if (module.stage == VK_SHADER_STAGE_VERTEX_BIT && variable.hasLocation && !variable.isBuiltIn)
+            {
+                ReflectedVertexInput input = {};
+                input.location = variable.location;
+                input.format   = getVertexFormat(module, typeId, &input.size);
+                reflection.vertexInputs.push_back(input);
+            }
+            continue;
+        }
+
+        // Declared but never read or written, so leave it out of the layout
+        if (module.usedIds.count(variableId) == 0)
+        {
+            continue;
+        }
+
+        if (storageClass == spv::PushConstant)
+        {
+            reflection.pushConstantRange.stageFlags = module.stage;
+            reflection.pushConstantRange.offset     = 0;
+            reflection.pushConstantRange.size       = getTypeSize(module, typeId);
+            continue;
+        }
+
+        if (storageClass != spv::UniformConstant && storageClass != spv::Uniform && storageClass != spv::StorageBuffer)
+        {
+            continue;
+        }
+
+        // Arrays of resources become one binding with several descriptors
+        uint32_t descriptorCount = 1;
+        const SpirvId* type = &module.get(typeId);
+        if (type->opcode == spv::OpTypeArray)
+        {
+            descriptorCount = getConstantValue(module, type->operands[1]);
+            type            = &module.get(type->operands[0]);
+        }
+        else if (type->opcode == spv::OpTypeRuntimeArray)
+        {
+            type            = &module.get(type->operands[0]);
+        }
+
+        ReflectedBinding binding = {};
+        binding.set             = variable.set;
+        binding.binding         = variable.binding;
+        binding.descriptorType  = getDescriptorType(module, storageClass, *type);
+        binding.descriptorCount = descriptorCount;
+        binding.stageFlags      = module.stage;
+        reflection.bindings.push_back(binding);
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+    {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const ReflectedVertexInput& a, const ReflectedVertexInput& b)
+    {
+        return a.location < b.location;
+    });
+
+    return reflection;
+}
+
+ShaderReflection mergeShaderReflections(const std::vector<ShaderReflection>& stages)
+{
+    ShaderReflection merged;
+    std::map<std::pair<uint32_t, uint32_t>, ReflectedBinding> bindings;    // Keyed by (set, binding), keeps them sorted
+    std::set<uint32_t>                                        specializationConstantIds;
+
+    for (const ShaderReflection& stage : stages)
+    {
+        merged.stageFlags |= stage.stageFlags;
+
+        for (const ReflectedBinding& binding : stage.bindings)
+        {
+            auto key   = std::make_pair(binding.set, binding.binding);
+            auto found = bindings.find(key);
+            if (found == bindings.end())
+            {
+                bindings[key] = binding;
+                continue;
+            }
+
+            if (found->second.descriptorType != binding.descriptorType)
+            {
+                throw std::runtime_error("Shader stages disagree on a descriptor binding type!");
+            }
+            found->second.stageFlags     |= binding.stageFlags;
+            found->second.descriptorCount = std::max(found->second.descriptorCount, binding.descriptorCount);
+        }
+
+        if (!stage.vertexInputs.empty())
+        {
+            merged.vertexInputs = stage.vertexInputs;
+        }
+        specializationConstantIds.insert(stage.specializationConstantIds.begin(), stage.specializationConstantIds.end());
+
+        // One range covering every stage's push constants
+        if (stage.pushConstantRange.size > 0)
+        {
+            merged.pushConstantRange.stageFlags |= stage.pushConstantRange.stageFlags;
+            merged.pushConstantRange.size        = std::max(merged.pushConstantRange.size, stage.pushConstantRange.size);
+        }
+    }
+
+    for (auto& binding : bindings)
+    {
+        merged.bindings.push_back(binding.second);
+    }
+    merged.specializationConstantIds.assign(specializationConstantIds.begin(), specializationConstantIds.end());
+
+    return merged;
+}
+
+uint32_t ShaderReflection::getSetCount()
+{
+    return bindings.empty() ? 0 : bindings.back().set + 1;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetLayoutBindings(uint32_t set)
+{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    for (const ReflectedBinding& binding : bindings)
+    {
+        if (binding.set != set)
+        {
+            continue;
+        }
+
+        VkDescriptorSetLayoutBinding layoutBinding = {};
+        layoutBinding.binding                      = binding.binding;
+        layoutBinding.descriptorType               = binding.descriptorType;
+        layoutBinding.descriptorCount              = binding.descriptorCount;
+        layoutBinding.stageFlags                   = binding.stageFlags;
+        layoutBinding.pImmutableSamplers           = nullptr;
+        layoutBindings.push_back(layoutBinding);
+    }
+    return layoutBindings;
+}
+
+uint32_t ShaderReflection::getVertexStride()
+{
+    uint32_t stride = 0;
+    for (const ReflectedVertexInput& input : vertexInputs)
+    {
+        stride += input.size;
+    }
+    return stride;
+}
+
+std::vector<VkVertexInputAttributeDescription> ShaderReflection::getVertexAttributes(uint32_t binding)
+{
+    // Attributes packed back to back in location order, the same as the Vertex struct
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    uint32_t offset = 0;
+    for (const ReflectedVertexInput& input : vertexInputs)
+    {
+        VkVertexInputAttributeDescription attribute = {};
+        attribute.binding                           = binding;
+        attribute.location                          = input.location;
+        attribute.format                            = input.format;
+        attribute.offset                            = offset;
+        attributes.push_back(attribute);
+        offset += input.size;
+    }
+    return attributes;
+}
+
+bool ShaderReflection::hasSameLayout(const ShaderReflection& other)
+{
+    // Same descriptor bindings, push constants and vertex inputs, so existing layouts and buffers still fit
+    if (bindings.size() != other.bindings.size() || vertexInputs.size() != other.vertexInputs.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const ReflectedBinding& a = bindings[i];
+        const ReflectedBinding& b = other.bindings[i];
+        if (a.set != b.set || a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < vertexInputs.size(); i++)
+    {
+        if (vertexInputs[i].location != other.vertexInputs[i].location || vertexInputs[i].format != other.vertexInputs[i].format)
+        {
+            return false;
+        }
+    }
+    return pushConstantRange.stageFlags == other.pushConstantRange.stageFlags &&
+           pushConstantRange.size       == other.pushConstantRange.size;
+}
+
+bool ShaderReflection::hasSpecializationConstant(uint32_t constantId)
+{
+    return std::binary_search(specializationConstantIds.begin(), specializationConstantIds.end(), constantId);
+}
+
+DescriptorLayoutCache::DescriptorLayoutCache()
+{
+}
+
+void DescriptorLayoutCache::init(VkDevice device)
+{
+    _device = device;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    SetLayoutKey key = { bindings };
+    std::sort(key.bindings.begin(), key.bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+    {
+        return a.binding < b.binding;
+    });
+
+    auto found = _setLayouts.find(key);
+    if (found != _setLayouts.end())
+    {
+        return found->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutCI = {};
+    layoutCI.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCI.bindingCount                    = static_cast<uint32_t>(key.bindings.size());
+    layoutCI.pBindings                       = key.bindings.data();
+
+    VkDescriptorSetLayout setLayout;
+    VkResult result = vkCreateDescriptorSetLayout(_device, &layoutCI, nullptr, &setLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+    }
+
+    _setLayouts[key] = setLayout;
+    return setLayout;
+}
+
+VkPipelineLayout DescriptorLayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                                         const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+    PipelineLayoutKey key = { setLayouts, pushConstantRanges };
+
+    auto found = _pipelineLayouts.find(key);
+    if (found != _pipelineLayouts.end())
+    {
+        return found->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
+    pipelineLayoutCI.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCI.setLayoutCount         = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutCI.pSetLayouts            = setLayouts.data();
+    pipelineLayoutCI.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutCI.pPushConstantRanges    = pushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout;
+    VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutCI, nullptr, &pipelineLayout);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create Pipeline Layout!");
+    }
+
+    _pipelineLayouts[key] = pipelineLayout;
+    return pipelineLayout;
+}
+
+void DescriptorLayoutCache::destroy()
+{
+    for (auto& pipelineLayout : _pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(_device, pipelineLayout.second, nullptr);
+    }
+    for (auto& setLayout : _setLayouts)
+    {
+        vkDestroyDescriptorSetLayout(_device, setLayout.second, nullptr);
+    }
+    _pipelineLayouts.clear();
+    _setLayouts.clear();
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+}
+
+bool DescriptorLayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const
+{
+    if (bindings.size() != other.bindings.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const VkDescriptorSetLayoutBinding& a = bindings[i];
+        const VkDescriptorSetLayoutBinding& b = other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DescriptorLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const
+{
+    if (setLayouts != other.setLayouts || pushConstantRanges.size() != other.pushConstantRanges.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < pushConstantRanges.size(); i++)
+    {
+        const VkPushConstantRange& a = pushConstantRanges[i];
+        const VkPushConstantRange& b = other.pushConstantRanges[i];
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a, fed one value at a time
+static uint64_t hashCombine(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 1099511628211ull;
+}
+
+size_t DescriptorLayoutCache::SetLayoutKeyHash::operator()(const SetLayoutKey& key) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const VkDescriptorSetLayoutBinding& binding : key.bindings)
+    {
+        hash = hashCombine(hash, binding.binding);
+        hash = hashCombine(hash, static_cast<uint64_t>(binding.descriptorType));
+        hash = hashCombine(hash, binding.descriptorCount);
+        hash = hashCombine(hash, binding.stageFlags);
+    }
+    return static_cast<size_t>(hash);
+}
+
+size_t DescriptorLayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (VkDescriptorSetLayout setLayout : key.setLayouts)
+    {
+        hash = hashCombine(hash, (uint64_t)setLayout);
+    }
+    for (const VkPushConstantRange& range : key.pushConstantRanges)
+    {
+        hash = hashCombine(hash, range.stageFlags);
+        hash = hashCombine(hash, range.offset);
+        hash = hashCombine(hash, range.size);
+    }
+    return static_cast<size_t>(hash);
+}
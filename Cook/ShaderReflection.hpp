@@ -0,0 +1,95 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct ReflectedBinding
+{
+    uint32_t           set;
+    uint32_t           binding;
+    VkDescriptorType   descriptorType;
+    uint32_t           descriptorCount;
+    VkShaderStageFlags stageFlags;
+};
+
+struct ReflectedVertexInput
+{
+    uint32_t location;
+    VkFormat format;
+    uint32_t size;          // Bytes, used to lay attributes out tightly in location order
+};
+
+// Resources a set of shader stages actually use, read from their SPIR-V
+struct ShaderReflection
+{
+    VkShaderStageFlags                stageFlags = 0;
+    std::vector<ReflectedBinding>     bindings;          // Sorted by set then binding
+    std::vector<ReflectedVertexInput> vertexInputs;      // Sorted by location, vertex stage only
+    VkPushConstantRange               pushConstantRange = {};   // size 0 if no push constants
+    std::vector<uint32_t>             specializationConstantIds;  // Sorted constant_id of every specialization constant declared
+
+    uint32_t                                  getSetCount();
+    std::vector<VkDescriptorSetLayoutBinding> getSetLayoutBindings(uint32_t set);
+    uint32_t                                  getVertexStride();
+    std::vector<VkVertexInputAttributeDescription> getVertexAttributes(uint32_t binding);
+    bool                                      hasSameLayout(const ShaderReflection& other);
+    bool                                      hasSpecializationConstant(uint32_t constantId);
+};
+
+// Parses a SPIR-V module. Only resources that are statically used by the entry point are reported,
+// so declared but unused bindings don't end up in the layouts.
+ShaderReflection reflectShader(std::span<const char> spirvCode);
+
+// Combines the stages of one pipeline, bindings used by several stages get all their stage flags
+ShaderReflection mergeShaderReflections(const std::vector<ShaderReflection>& stages);
+
+// Creates descriptor set layouts and pipeline layouts on demand, returning the existing one when
+// an identical layout was already created. Owns everything it creates.
+class DescriptorLayoutCache
+{
+    public:
+        DescriptorLayoutCache();
+
+        void                  init(VkDevice device);
+        VkDescriptorSetLayout getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+        VkPipelineLayout      getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                                const std::vector<VkPushConstantRange>& pushConstantRanges);
+        void                  destroy();
+
+        ~DescriptorLayoutCache();
+
+    private:
+        struct SetLayoutKey
+        {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+            bool operator==(const SetLayoutKey& other) const;
+        };
+
+        struct PipelineLayoutKey
+        {
+            std::vector<VkDescriptorSetLayout> setLayouts;
+            std::vector<VkPushConstantRange>   pushConstantRanges;
+
+            bool operator==(const PipelineLayoutKey& other) const;
+        };
+
+        struct SetLayoutKeyHash
+        {
+            size_t operator()(const SetLayoutKey& key) const;
+        };
+
+        struct PipelineLayoutKeyHash
+        {
+            size_t operator()(const PipelineLayoutKey& key) const;
+        };
+
+        VkDevice _device;
+        std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, SetLayoutKeyHash>   _setLayouts;
+        std::unordered_map<PipelineLayoutKey, VkPipelineLayout, PipelineLayoutKeyHash> _pipelineLayouts;
+};
@@ -0,0 +1,575 @@
+#include "TextureStreamer.hpp"
+#include "Utilities.hpp"
+#include "CpuProfiler.hpp"
+#include "MemoryTracker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// Next mip level down, each texel the average of the 2x2 block above it (edges repeat for odd sizes)
+static std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+    uint32_t mipWidth  = std::max(width / 2, 1u);
+    uint32_t mipHeight = std::max(height / 2, 1u);
+
+    std::vector<uint8_t> mip(static_cast<size_t>(mipWidth) * mipHeight * 4);
+    for (uint32_t y = 0; y < mipHeight; y++)
+    {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32_t x = 0; x < mipWidth; x++)
+        {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] + pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c]
+                             + pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] + pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                mip[(static_cast<size_t>(y) * mipWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return mip;
+}
+
+TextureStreamer::TextureStreamer()
+{
+    _commandPool    = VK_NULL_HANDLE;
+    _descriptorPool = VK_NULL_HANDLE;
+    _budgetBytes    = 0;
+    _residentBytes  = 0;
+}
+
+void TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamilyIndex,
+                           VkDescriptorSetLayout samplerSetLayout, VkSampler sampler, VkDeviceSize budgetBytes)
+{
+    _physicalDevice   = physicalDevice;
+    _device           = device;
+    _queue            = queue;
+    _samplerSetLayout = samplerSetLayout;
+    _sampler          = sampler;
+    _budgetBytes      = budgetBytes;
+
+    // Upload command buffers are freed one at a time, as their fences signal
+    VkCommandPoolCreateInfo poolCI = {};
+    poolCI.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCI.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolCI.queueFamilyIndex        = queueFamilyIndex;
+
+    VkResult result = vkCreateCommandPool(_device, &poolCI, nullptr, &_commandPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a texture streaming Command Pool!");
+    }
+
+    // One set per texture, plus room for the sets being swapped out. Sets are freed individually when retired
+    uint32_t maxSets = TEXTURE_STREAMING_MAX_TEXTURES + TEXTURE_STREAMING_MAX_UPLOADS * (MAX_FRAME_DRAWS + 2);
+
+    VkDescriptorPoolSize samplerPoolSize = {};
+    samplerPoolSize.type                 = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerPoolSize.descriptorCount      = maxSets;
+
+    VkDescriptorPoolCreateInfo descriptorPoolCI = {};
+    descriptorPoolCI.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCI.flags                      = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    descriptorPoolCI.maxSets                    = maxSets;
+    descriptorPoolCI.poolSizeCount              = 1;
+    descriptorPoolCI.pPoolSizes                 = &samplerPoolSize;
+
+    result = vkCreateDescriptorPool(_device, &descriptorPoolCI, nullptr, &_descriptorPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a texture streaming Descriptor Pool!");
+    }
+}
+
+int TextureStreamer::addTexture(const uint8_t* rgbaPixels, uint32_t width, uint32_t height)
+{
+    CPU_PROFILE_SCOPE("TextureStreamer::addTexture");
+
+    if (_textures.size() >= TEXTURE_STREAMING_MAX_TEXTURES)
+    {
+        throw std::runtime_error("Too many streamed textures!");
+    }
+
+    StreamedTexture texture = {};
+    texture.width  = width;
+    texture.height = height;
+
+    // Whole mip chain on the CPU, it is where every upload comes from
+    texture.mips.push_back(std::vector<uint8_t>(rgbaPixels, rgbaPixels + static_cast<size_t>(width) * height * 4));
+    for (uint32_t mipWidth = width, mipHeight = height; mipWidth > 1 || mipHeight > 1;
+         mipWidth = std::max(mipWidth / 2, 1u), mipHeight = std::max(mipHeight / 2, 1u))
+    {
+        texture.mips.push_back(downsample(texture.mips.back(), mipWidth, mipHeight));
+    }
+
+    uint32_t mipCount = static_cast<uint32_t>(texture.mips.size());
+    texture.minResidentMip = mipCount - 1;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+        if (std::max(width >> mip, height >> mip) <= static_cast<uint32_t>(TEXTURE_STREAMING_MIN_RESIDENT_SIZE))
+        {
+            texture.minResidentMip = mip;
+            break;
+        }
+    }
+    texture.residentMip = mipCount;
+    texture.wantedMip   = texture.minResidentMip;
+
+    int streamId = static_cast<int>(_textures.size());
+    _textures.push_back(texture);
+
+    // Small levels go up straight away, so the texture can be drawn (blurry) from the first frame
+    startUpload(streamId, texture.minResidentMip);
+    PendingUpload upload = _pendingUploads.back();
+    _pendingUploads.pop_back();
+    vkWaitForFences(_device, 1, &upload.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    completeUpload(upload, 0);
+
+    return streamId;
+}
+
+void TextureStreamer::requestMip(int streamId, uint32_t mipLevel, uint64_t frameNumber)
+{
+    StreamedTexture& texture = _textures[streamId];
+    mipLevel = std::min(mipLevel, static_cast<uint32_t>(texture.mips.size()) - 1);
+
+    // Most detailed level asked for this frame wins
+    if (texture.lastUsedFrame != frameNumber)
+    {
+        texture.wantedMip     = mipLevel;
+        texture.lastUsedFrame = frameNumber;
+    }
+    else
+    {
+        texture.wantedMip = std::min(texture.wantedMip, mipLevel);
+    }
+}
+
+void TextureStreamer::update(uint64_t frameNumber)
+{
+    CPU_PROFILE_SCOPE("TextureStreamer::update");
+
+    // Swap in finished uploads, never waits
+    for (size_t i = 0; i < _pendingUploads.size();)
+    {
+        if (vkGetFenceStatus(_device, _pendingUploads[i].fence) == VK_SUCCESS)
+        {
+            completeUpload(_pendingUploads[i], frameNumber);
+            _pendingUploads.erase(_pendingUploads.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    destroyRetired(frameNumber, false);
+
+    // Over budget: drop the top level of the least recently used texture not drawn this frame, one at a time
+    while (_pendingUploads.size() < TEXTURE_STREAMING_MAX_UPLOADS && isOverBudget(0))
+    {
+        int leastRecentlyUsed = -1;
+        for (size_t i = 0; i < _textures.size(); i++)
+        {
+            const StreamedTexture& texture = _textures[i];
+            if (texture.uploading || texture.residentMip >= texture.minResidentMip || texture.lastUsedFrame == frameNumber)
+            {
+                continue;
+            }
+            if (leastRecentlyUsed < 0 || texture.lastUsedFrame < _textures[leastRecentlyUsed].lastUsedFrame)
+            {
+                leastRecentlyUsed = static_cast<int>(i);
+            }
+        }
+        if (leastRecentlyUsed < 0)
+        {
+            break;
+        }
+        startUpload(leastRecentlyUsed, _textures[leastRecentlyUsed].residentMip + 1);
+    }
+
+    // Textures drawn this frame that want more detail, blurriest first
+    std::vector<int> wanting;
+    for (size_t i = 0; i < _textures.size(); i++)
+    {
+        const StreamedTexture& texture = _textures[i];
+        if (!texture.uploading && texture.lastUsedFrame == frameNumber && texture.wantedMip < texture.residentMip)
+        {
+            wanting.push_back(static_cast<int>(i));
+        }
+    }
+    std::sort(wanting.begin(), wanting.end(), [this](int a, int b)
+    {
+        return _textures[a].residentMip - _textures[a].wantedMip > _textures[b].residentMip - _textures[b].wantedMip;
+    });
+
+    for (int streamId : wanting)
+    {
+        if (_pendingUploads.size() >= TEXTURE_STREAMING_MAX_UPLOADS)
+        {
+            break;
+        }
+
+        // All the way to the wanted level if it fits, otherwise one level up
+        StreamedTexture& texture = _textures[streamId];
+        for (uint32_t baseMip : { texture.wantedMip, texture.residentMip - 1 })
+        {
+            VkDeviceSize extraBytes = getMipChainBytes(texture, baseMip) - std::min(texture.imageBytes, getMipChainBytes(texture, baseMip));
+            if (!isOverBudget(extraBytes))
+            {
+                startUpload(streamId, baseMip);
+                break;
+            }
+        }
+    }
+}
+
+size_t TextureStreamer::getTextureCount()
+{
+    return _textures.size();
+}
+
+VkDescriptorSet TextureStreamer::getDescriptorSet(int streamId)
+{
+    return _textures[streamId].descriptorSet;
+}
+
+uint32_t TextureStreamer::getTextureSize(int streamId)
+{
+    return std::max(_textures[streamId].width, _textures[streamId].height);
+}
+
+uint32_t TextureStreamer::getMipCount(int streamId)
+{
+    return static_cast<uint32_t>(_textures[streamId].mips.size());
+}
+
+uint32_t TextureStreamer::getResidentMip(int streamId)
+{
+    return _textures[streamId].residentMip;
+}
+
+VkDeviceSize TextureStreamer::getResidentBytes()
+{
+    return _residentBytes;
+}
+
+void TextureStreamer::clear()
+{
+    // Caller makes sure the device is idle, so uploads have finished and nothing is using the images
+    for (PendingUpload& upload : _pendingUploads)
+    {
+        vkDestroyImage(_device, upload.image, nullptr);
+        MemoryTracker::freeMemory(_device, upload.imageMemory);
+        vkDestroyBuffer(_device, upload.stagingBuffer, nullptr);
+        MemoryTracker::freeMemory(_device, upload.stagingMemory);
+        vkFreeCommandBuffers(_device, _commandPool, 1, &upload.commandBuffer);
+        vkDestroyFence(_device, upload.fence, nullptr);
+    }
+    _pendingUploads.clear();
+
+    destroyRetired(0, true);
+
+    for (StreamedTexture& texture : _textures)
+    {
+        vkDestroyImageView(_device, texture.imageView, nullptr);
+        vkDestroyImage(_device, texture.image, nullptr);
+        MemoryTracker::freeMemory(_device, texture.imageMemory);
+    }
+    _textures.clear();
+    _residentBytes = 0;
+
+    if (_descriptorPool != VK_NULL_HANDLE)
+    {
+        vkResetDescriptorPool(_device, _descriptorPool, 0);
+    }
+}
+
+void TextureStreamer::destroy()
+{
+    clear();
+    vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+    vkDestroyCommandPool(_device, _commandPool, nullptr);
+    _descriptorPool = VK_NULL_HANDLE;
+    _commandPool    = VK_NULL_HANDLE;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+VkDeviceSize TextureStreamer::getMipChainBytes(const StreamedTexture& texture, uint32_t baseMip)
+{
+    VkDeviceSize bytes = 0;
+    for (uint32_t mip = baseMip; mip < texture.mips.size(); mip++)
+    {
+        bytes += texture.mips[mip].size();
+    }
+    return bytes;
+}
+
+bool TextureStreamer::isOverBudget(VkDeviceSize extraBytes)
+{
+    // Resident bytes once the uploads in flight have replaced their textures' images
+    VkDeviceSize projectedBytes = _residentBytes + extraBytes;
+    for (const PendingUpload& upload : _pendingUploads)
+    {
+        projectedBytes = projectedBytes + upload.imageBytes - _textures[upload.streamId].imageBytes;
+    }
+    if (projectedBytes > _budgetBytes)
+    {
+        return true;
+    }
+
+    // Streaming's own budget may still be more than the device has left, whoever else is using it
+    for (const MemoryHeapUsage& heapUsage : MemoryTracker::getHeapUsage())
+    {
+        if ((heapUsage.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            && heapUsage.usage + extraBytes > heapUsage.budget * static_cast<double>(MEMORY_BUDGET_WARNING_FRACTION))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextureStreamer::startUpload(int streamId, uint32_t baseMip)
+{
+    StreamedTexture& texture   = _textures[streamId];
+    uint32_t         mipLevels = static_cast<uint32_t>(texture.mips.size()) - baseMip;
+
+    PendingUpload upload = {};
+    upload.streamId      = streamId;
+    upload.baseMip       = baseMip;
+
+    // Image holding levels baseMip and down, so its level 0 is the texture's level baseMip
+    VkImageCreateInfo imageCI = {};
+    imageCI.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCI.imageType         = VK_IMAGE_TYPE_2D;
+    imageCI.extent.width      = std::max(texture.width >> baseMip, 1u);
+    imageCI.extent.height     = std::max(texture.height >> baseMip, 1u);
+    imageCI.extent.depth      = 1;
+    imageCI.mipLevels         = mipLevels;
+    imageCI.arrayLayers       = 1;
+    imageCI.format            = VK_FORMAT_R8G8B8A8_UNORM;
+    imageCI.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCI.usage             = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageCI.samples           = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateImage(_device, &imageCI, nullptr, &upload.image);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a streamed texture Image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(_device, upload.image, &memoryRequirements);
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.allocationSize       = memoryRequirements.size;
+    memoryAllocInfo.memoryTypeIndex      = findMemoryTypeIndex(_physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    result = MemoryTracker::allocateMemory(_device, &memoryAllocInfo, MEMORY_CATEGORY_TEXTURE, &upload.imageMemory);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate memory for a streamed texture Image!");
+    }
+    vkBindImageMemory(_device, upload.image, upload.imageMemory, 0);
+    upload.imageBytes = memoryRequirements.size;
+
+    // All the levels one after another in a staging buffer, one copy region each
+    VkDeviceSize stagingBytes = getMipChainBytes(texture, baseMip);
+    createBuffer(_physicalDevice, _device, stagingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 &upload.stagingBuffer, &upload.stagingMemory, MEMORY_CATEGORY_STAGING);
+
+    uint8_t* data;
+    vkMapMemory(_device, upload.stagingMemory, 0, stagingBytes, 0, reinterpret_cast<void**>(&data));
+
+    std::vector<VkBufferImageCopy> copyRegions;
+    VkDeviceSize                   bufferOffset = 0;
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        const std::vector<uint8_t>& mip = texture.mips[baseMip + level];
+        memcpy(data + bufferOffset, mip.data(), mip.size());
+
+        VkBufferImageCopy copyRegion               = {};
+        copyRegion.bufferOffset                    = bufferOffset;
+        copyRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.mipLevel       = level;
+        copyRegion.imageSubresource.baseArrayLayer = 0;
+        copyRegion.imageSubresource.layerCount     = 1;
+        copyRegion.imageExtent                     = { std::max(imageCI.extent.width >> level, 1u), std::max(imageCI.extent.height >> level, 1u), 1 };
+        copyRegions.push_back(copyRegion);
+
+        bufferOffset += mip.size();
+    }
+    vkUnmapMemory(_device, upload.stagingMemory);
+
+    VkCommandBufferAllocateInfo cbAllocInfo = {};
+    cbAllocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cbAllocInfo.commandPool                 = _commandPool;
+    cbAllocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbAllocInfo.commandBufferCount          = 1;
+    vkAllocateCommandBuffers(_device, &cbAllocInfo, &upload.commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(upload.commandBuffer, &beginInfo);
+
+    // Every level to transfer destination, copy, then every level to shader readable
+    VkImageMemoryBarrier imageMemoryBarrier = {};
+    imageMemoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageMemoryBarrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image                           = upload.image;
+    imageMemoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.baseMipLevel   = 0;
+    imageMemoryBarrier.subresourceRange.levelCount     = mipLevels;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    imageMemoryBarrier.subresourceRange.layerCount     = 1;
+    imageMemoryBarrier.srcAccessMask                   = 0;
+    imageMemoryBarrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+    vkCmdCopyBufferToImage(upload.commandBuffer, upload.stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+
+    imageMemoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(upload.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+    vkEndCommandBuffer(upload.commandBuffer);
+
+    VkFenceCreateInfo fenceCI = {};
+    fenceCI.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    result = vkCreateFence(_device, &fenceCI, nullptr, &upload.fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a texture streaming Fence!");
+    }
+
+    // Same queue as the frames, submitted from the same thread, so no extra synchronisation with them is needed
+    VkSubmitInfo submitInfo       = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &upload.commandBuffer;
+
+    result = vkQueueSubmit(_queue, 1, &submitInfo, upload.fence);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit a texture upload!");
+    }
+
+    texture.uploading = true;
+    _pendingUploads.push_back(upload);
+}
+
+void TextureStreamer::completeUpload(PendingUpload& upload, uint64_t frameNumber)
+{
+    StreamedTexture& texture = _textures[upload.streamId];
+
+    VkImageViewCreateInfo viewCI           = {};
+    viewCI.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewCI.image                           = upload.image;
+    viewCI.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewCI.format                          = VK_FORMAT_R8G8B8A8_UNORM;
+    viewCI.components.r                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.g                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.b                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.a                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewCI.subresourceRange.baseMipLevel   = 0;
+    viewCI.subresourceRange.levelCount     = static_cast<uint32_t>(texture.mips.size()) - upload.baseMip;
+    viewCI.subresourceRange.baseArrayLayer = 0;
+    viewCI.subresourceRange.layerCount     = 1;
+
+    VkImageView imageView;
+    VkResult result = vkCreateImageView(_device, &viewCI, nullptr, &imageView);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a streamed texture Image View!");
+    }
+
+    // New set rather than updating the old one, frames in flight may still be reading it
+    VkDescriptorSetAllocateInfo setAllocInfo = {};
+    setAllocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setAllocInfo.descriptorPool              = _descriptorPool;
+    setAllocInfo.descriptorSetCount          = 1;
+    setAllocInfo.pSetLayouts                 = &_samplerSetLayout;
+
+    VkDescriptorSet descriptorSet;
+    result = vkAllocateDescriptorSets(_device, &setAllocInfo, &descriptorSet);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate a streamed texture Descriptor Set!");
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView             = imageView;
+    imageInfo.sampler               = _sampler;
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet               = descriptorSet;
+    descriptorWrite.dstBinding           = 0;
+    descriptorWrite.dstArrayElement      = 0;
+    descriptorWrite.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount      = 1;
+    descriptorWrite.pImageInfo           = &imageInfo;
+    vkUpdateDescriptorSets(_device, 1, &descriptorWrite, 0, nullptr);
+
+    if (texture.image != VK_NULL_HANDLE)
+    {
+        _retiredTextures.push_back({ texture.image, texture.imageView, texture.imageMemory, texture.descriptorSet, frameNumber });
+    }
+
+    _residentBytes        = _residentBytes - texture.imageBytes + upload.imageBytes;
+    texture.image         = upload.image;
+    texture.imageView     = imageView;
+    texture.imageMemory   = upload.imageMemory;
+    texture.imageBytes    = upload.imageBytes;
+    texture.descriptorSet = descriptorSet;
+    texture.residentMip   = upload.baseMip;
+    texture.uploading     = false;
+
+    vkDestroyBuffer(_device, upload.stagingBuffer, nullptr);
+    MemoryTracker::freeMemory(_device, upload.stagingMemory);
+    vkFreeCommandBuffers(_device, _commandPool, 1, &upload.commandBuffer);
+    vkDestroyFence(_device, upload.fence, nullptr);
+}
+
+void TextureStreamer::destroyRetired(uint64_t frameNumber, bool all)
+{
+    // Frames before frameNumber - MAX_FRAME_DRAWS have finished, their fences have been waited on
+    for (size_t i = 0; i < _retiredTextures.size();)
+    {
+        RetiredTexture& retired = _retiredTextures[i];
+        if (!all && frameNumber < retired.retiredFrame + MAX_FRAME_DRAWS)
+        {
+            i++;
+            continue;
+        }
+
+        vkDestroyImageView(_device, retired.imageView, nullptr);
+        vkDestroyImage(_device, retired.image, nullptr);
+        MemoryTracker::freeMemory(_device, retired.imageMemory);
+        vkFreeDescriptorSets(_device, _descriptorPool, 1, &retired.descriptorSet);
+        _retiredTextures.erase(_retiredTextures.begin() + i);
+    }
+}
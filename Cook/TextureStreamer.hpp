@@ -0,0 +1,99 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// Keeps only the mip levels textures need on the GPU. Every texture's full mip chain is kept in host memory,
+// and its GPU image holds the levels from residentMip down to the smallest. Each frame the renderer asks for the
+// level it wants per visible texture (requestMip), and update then:
+//   - swaps in images whose uploads have finished, by giving the texture a new descriptor set
+//   - frees images and sets that frames in flight may still have been using, MAX_FRAME_DRAWS frames later
+//   - drops a level from the least recently used textures while over budget
+//   - starts uploads of more detailed levels for the textures that want them, as long as they fit
+// A residency change is a new image with the new levels, uploaded on the graphics queue with its own fence, so
+// rendering never waits for it and draws keep using the old image until the new one is ready.
+class TextureStreamer
+{
+    public:
+        TextureStreamer();
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, uint32_t queueFamilyIndex,
+                  VkDescriptorSetLayout samplerSetLayout, VkSampler sampler, VkDeviceSize budgetBytes);
+        int  addTexture(const uint8_t* rgbaPixels, uint32_t width, uint32_t height);
+        void requestMip(int streamId, uint32_t mipLevel, uint64_t frameNumber);
+        void update(uint64_t frameNumber);
+
+        size_t          getTextureCount();
+        VkDescriptorSet getDescriptorSet(int streamId);
+        uint32_t        getTextureSize(int streamId);      // Largest dimension of mip 0
+        uint32_t        getMipCount(int streamId);
+        uint32_t        getResidentMip(int streamId);
+        VkDeviceSize    getResidentBytes();
+        void            clear();
+        void            destroy();
+
+        ~TextureStreamer();
+
+    private:
+        struct StreamedTexture
+        {
+            uint32_t                          width;
+            uint32_t                          height;
+            std::vector<std::vector<uint8_t>> mips;             // RGBA8, full chain down to 1x1
+            uint32_t                          minResidentMip;   // Levels from here down are always resident
+            uint32_t                          residentMip;      // Most detailed level on the GPU
+            uint32_t                          wantedMip;        // Most detailed level asked for in lastUsedFrame
+            uint64_t                          lastUsedFrame;
+            bool                              uploading;
+            VkImage                           image;
+            VkImageView                       imageView;
+            VkDeviceMemory                    imageMemory;
+            VkDeviceSize                      imageBytes;
+            VkDescriptorSet                   descriptorSet;
+        };
+
+        struct PendingUpload
+        {
+            int             streamId;
+            uint32_t        baseMip;
+            VkImage         image;
+            VkDeviceMemory  imageMemory;
+            VkDeviceSize    imageBytes;
+            VkBuffer        stagingBuffer;
+            VkDeviceMemory  stagingMemory;
+            VkCommandBuffer commandBuffer;
+            VkFence         fence;
+        };
+
+        // Image and set replaced in retiredFrame, destroyed once no frame in flight can be using them
+        struct RetiredTexture
+        {
+            VkImage         image;
+            VkImageView     imageView;
+            VkDeviceMemory  imageMemory;
+            VkDescriptorSet descriptorSet;
+            uint64_t        retiredFrame;
+        };
+
+        VkPhysicalDevice             _physicalDevice;
+        VkDevice                     _device;
+        VkQueue                      _queue;
+        VkCommandPool                _commandPool;
+        VkDescriptorPool             _descriptorPool;
+        VkDescriptorSetLayout        _samplerSetLayout;
+        VkSampler                    _sampler;
+        VkDeviceSize                 _budgetBytes;
+        VkDeviceSize                 _residentBytes;      // Current images of all textures
+        std::vector<StreamedTexture> _textures;
+        std::vector<PendingUpload>   _pendingUploads;
+        std::vector<RetiredTexture>  _retiredTextures;
+
+        VkDeviceSize getMipChainBytes(const StreamedTexture& texture, uint32_t baseMip);
+        bool         isOverBudget(VkDeviceSize extraBytes);
+        void         startUpload(int streamId, uint32_t baseMip);
+        void         completeUpload(PendingUpload& upload, uint64_t frameNumber);
+        void         destroyRetired(uint64_t frameNumber, bool all);
+};
@@ -1 +1,78 @@
 #include "Utilities.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+static std::string dataDirectory;   // Ends in a '/', empty means the working directory
+
+static std::string asDirectory(const std::filesystem::path& path)
+{
+    std::string directory = path.string();
+    if (!directory.empty() && directory.back() != '/')
+    {
+        directory += '/';
+    }
+    return directory;
+}
+
+static bool hasShaderDirectory(const std::filesystem::path& directory)
+{
+    std::error_code error;
+    return std::filesystem::is_directory(directory / SHADER_DIRECTORY, error);
+}
+
+void initDataDirectory(const char* dataDirectoryArg, const char* executablePath)
+{
+    const char* chosenDirectory = dataDirectoryArg;
+    if (chosenDirectory == nullptr)
+    {
+        chosenDirectory = std::getenv(DATA_DIRECTORY_VARIABLE);
+    }
+    if (chosenDirectory != nullptr && chosenDirectory[0] != '\0')
+    {
+        dataDirectory = asDirectory(chosenDirectory);
+        if (!hasShaderDirectory(chosenDirectory))
+        {
+            printf("Data directory %s has no %s\n", dataDirectory.c_str(), SHADER_DIRECTORY);
+        }
+        return;
+    }
+
+    // A copied build keeps its data next to it, a build run from the IDE finds it in the source tree
+    std::vector<std::filesystem::path> candidates;
+    std::error_code                    error;
+    if (executablePath != nullptr)
+    {
+        std::filesystem::path executable = std::filesystem::canonical(executablePath, error);
+        if (!error)
+        {
+            candidates.push_back(executable.parent_path());
+        }
+    }
+    candidates.push_back(std::filesystem::path(__FILE__).parent_path());
+    for (const std::filesystem::path& candidate : candidates)
+    {
+        if (!candidate.empty() && hasShaderDirectory(candidate))
+        {
+            dataDirectory = asDirectory(candidate);
+            return;
+        }
+    }
+    dataDirectory.clear();
+}
+
+const std::string& getDataDirectory()
+{
+    return dataDirectory;
+}
+
+std::string getShaderDirectory()
+{
+    return dataDirectory + SHADER_DIRECTORY;
+}
+
+std::string getTextureDirectory()
+{
+    return dataDirectory + TEXTURE_DIRECTORY;
+}
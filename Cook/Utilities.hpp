@@ -2,11 +2,54 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <string>
 #include <fstream>
 #include <glm/glm.hpp>
 
+#include "MemoryTracker.hpp"
+
 const int MAX_FRAME_DRAWS = 2;
 const int MAX_OBJECTS = 2;
+const int DRAWS_PER_COMMAND_BUFFER = 64;    // Draws recorded by one job into one secondary command buffer
+const int NODES_PER_CULL_JOB = 256;
+const int SAMPLER_DESCRIPTORS_PER_POOL = 256;   // Another pool is created when one runs out
+const int GPU_PROFILER_MAX_SCOPES = 32;      // Timestamp scopes per frame, each uses two queries
+const int GPU_PROFILER_HISTORY_FRAMES = 120; // Frames averaged in the GPU timing report
+const int TEXTURE_STREAMING_MAX_TEXTURES = 1024;
+const int TEXTURE_STREAMING_MAX_UPLOADS = 4;         // Residency changes in flight at once
+const int TEXTURE_STREAMING_MIN_RESIDENT_SIZE = 64;  // Mips this size and smaller are never evicted
+const int ASYNC_FILE_QUEUE_DEPTH = 64;             // Files being read at once
+const int ASYNC_FILE_FALLBACK_THREADS = 4;        // Reading threads when io_uring isn't available
+const bool ASYNC_FILE_DIRECT_IO = true;           // Textures are read once and uploaded, no point keeping them in the page cache
+const VkDeviceSize TEXTURE_STREAMING_BUDGET_BYTES = 256ull * 1024 * 1024;
+const VkDeviceSize UPLOAD_BATCH_MAX_BYTES = 64ull * 1024 * 1024;     // Staging memory a scene import fills before submitting its copies
+const size_t UINT16_INDEX_MAX_VERTICES = 65536;     // Meshes with up to this many vertices get 16 bit indices (no primitive restart, so 0xFFFF is usable)
+const size_t PACKED_VERTEX_MIN_VERTICES = 4096;   // Loaded meshes this big are stored as PackedVertex, smaller ones aren't worth the extra pipelines
+const int MESH_LOD_MAX_LEVELS = 6;                // Levels of detail generated, counting the full mesh
+const size_t MESH_LOD_MIN_TRIANGLES = 64;         // No coarser level is made from one this small
+const float LOD_MAX_SCREEN_ERROR = 1.0f;          // Pixels a level's error may cover on screen before a finer level is drawn
+const int VIRTUAL_TEXTURE_PAGE_SIZE = 128;        // Texels per side of a page, must match PAGE_SIZE in simple_shader.frag
+const int VIRTUAL_TEXTURE_PAGE_BORDER = 1;        // Texels copied from neighbouring pages for filtering, must match PAGE_BORDER
+const int VIRTUAL_TEXTURE_CACHE_PAGES = 16;       // Physical cache is this many pages per side
+const int VIRTUAL_TEXTURE_MAX_UPLOADS = 8;        // Pages loaded and copied into the cache per frame
+const int VIRTUAL_TEXTURE_MAX_MIPS = 16;          // Must match the mipOffsets array size in simple_shader.frag
+const float MEMORY_BUDGET_WARNING_FRACTION = 0.9f;   // Heap usage that triggers the memory threshold callback
+const double FRAME_STATISTICS_HITCH_FACTOR = 2.0;  // Frame is a hitch when it takes this many times the recent average
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin";    // Relative to the working directory
+const char* const ASSET_PACK_FILE = "assets.pak";    // Relative to the working directory, loose files are used when it is missing
+const char* const DATA_DIRECTORY_VARIABLE = "COOK_DATA_DIR";    // Environment variable naming the data directory, --data-dir overrides it
+const char* const SHADER_DIRECTORY = "shaders/";      // Relative to the data directory, use getShaderDirectory()
+const char* const TEXTURE_DIRECTORY = "Textures/";    // Relative to the data directory, use getTextureDirectory()
+const char* const VERTEX_SHADER_FILE = "simple_shader.vert";
+const char* const FRAGMENT_SHADER_FILE = "simple_shader.frag";
+const char* const FRAGMENT_SHADER_NO_FEEDBACK_BINARY = "simple_shader_nofeedback.frag.spv";   // Built with VIRTUAL_TEXTURE_FEEDBACK=0
+
+// Directory shaders/ and Textures/ are found in. Picked once at start up from --data-dir (dataDirectoryArg),
+// then COOK_DATA_DIR, then next to the executable, then the source directory the program was built from
+void initDataDirectory(const char* dataDirectoryArg, const char* executablePath);
+const std::string& getDataDirectory();
+std::string getShaderDirectory();
+std::string getTextureDirectory();
 
 const std::vector<const char*> requiredDeviceExtensions =
 {
@@ -34,6 +77,32 @@ struct Vertex
     glm::vec2 tex; // Texture Coords (u, v)
 };
 
+// Range of a mesh's index buffer drawing one level of detail, level 0 is the full mesh
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float    error;              // Model space distance this level is allowed to be off the full mesh by
+};
+
+// Layout of the vertices in a mesh's vertex buffer. Picks the pipeline's vertex input formats, so it is part of PipelineStateDesc
+enum VertexFormat : uint32_t
+{
+    VERTEX_FORMAT_FULL            = 0,    // Vertex
+    VERTEX_FORMAT_PACKED          = 1,    // PackedVertex, texture coordinates as 16 bit UNORM
+    VERTEX_FORMAT_PACKED_HALF_TEX = 2,    // PackedVertex, texture coordinates as half floats, for ones outside [0, 1]
+};
+
+// Vertex in half the space, unpacked by the vertex fetch so the shaders still see floats. Position is 16 bit UNORM
+// across the mesh's bounding box, the mesh's dequantisation matrix takes it back to model space (the 4th component
+// is padding, three 16 bit components aren't a format every GPU can fetch)
+struct PackedVertex
+{
+    uint16_t pos[4];
+    uint8_t  col[4];     // UNORM, alpha unused
+    uint16_t tex[2];
+};
+
 struct SwapChainDetails
 {
     VkSurfaceCapabilitiesKHR        surfaceCapabilities; // Surface properties, e.g. image size/extent
@@ -95,7 +164,7 @@ static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
     return -1;
 }
 
-static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags bufferProperties, VkBuffer* vkBuffer, VkDeviceMemory* vkDeviceMemory)
+static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags bufferProperties, VkBuffer* vkBuffer, VkDeviceMemory* vkDeviceMemory, MemoryCategory memoryCategory)
 {
     // Information to create a buffer (doesn't include assigning memory)
     VkBufferCreateInfo bufferInfo = {};
@@ -122,7 +191,7 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
     memoryAllocInfo.memoryTypeIndex      = findMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits, bufferProperties);
     
     // ALLOCATE MEMORY TO VKDEVICEMEMORY
-    result = vkAllocateMemory(device, &memoryAllocInfo, nullptr, vkDeviceMemory);
+    result = MemoryTracker::allocateMemory(device, &memoryAllocInfo, memoryCategory, vkDeviceMemory);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to allocate Vertex Buffer Memory!");
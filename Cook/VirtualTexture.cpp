@@ -0,0 +1,690 @@
+#include "VirtualTexture.hpp"
+#include "Utilities.hpp"
+#include "CpuProfiler.hpp"
+#include "MemoryTracker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+static const uint32_t INVALID_PAGE   = 0xFFFFFFFF;
+static const uint32_t UNMAPPED_ENTRY = 0xFF000000;    // Mip field coarser than any level, replaced when the root page is loaded
+static const uint32_t BORDERED_PAGE_SIZE = VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER;
+static const VkDeviceSize PAGE_BYTES     = static_cast<VkDeviceSize>(BORDERED_PAGE_SIZE) * BORDERED_PAGE_SIZE * 4;
+
+// Page table entry: cache slot column and row in 12 bits each, then the mip level of the page in the slot
+static uint32_t packEntry(uint32_t slot, uint32_t mipLevel)
+{
+    return (slot % VIRTUAL_TEXTURE_CACHE_PAGES) | ((slot / VIRTUAL_TEXTURE_CACHE_PAGES) << 12) | (mipLevel << 24);
+}
+
+static bool isPowerOfTwo(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Bilinear resize, sampling at texel centres. Exactly halving averages each 2x2 block, so it builds mips too
+static std::vector<uint8_t> resize(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t newWidth, uint32_t newHeight)
+{
+    std::vector<uint8_t> resized(static_cast<size_t>(newWidth) * newHeight * 4);
+    float scaleX = static_cast<float>(width) / newWidth;
+    float scaleY = static_cast<float>(height) / newHeight;
+    for (uint32_t y = 0; y < newHeight; y++)
+    {
+        float    sourceY = std::max((y + 0.5f) * scaleY - 0.5f, 0.0f);
+        uint32_t y0      = std::min(static_cast<uint32_t>(sourceY), height - 1);
+        uint32_t y1      = std::min(y0 + 1, height - 1);
+        float    fy      = sourceY - y0;
+        for (uint32_t x = 0; x < newWidth; x++)
+        {
+            float    sourceX = std::max((x + 0.5f) * scaleX - 0.5f, 0.0f);
+            uint32_t x0      = std::min(static_cast<uint32_t>(sourceX), width - 1);
+            uint32_t x1      = std::min(x0 + 1, width - 1);
+            float    fx      = sourceX - x0;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                float top    = pixels[(static_cast<size_t>(y0) * width + x0) * 4 + c] * (1.0f - fx) + pixels[(static_cast<size_t>(y0) * width + x1) * 4 + c] * fx;
+                float bottom = pixels[(static_cast<size_t>(y1) * width + x0) * 4 + c] * (1.0f - fx) + pixels[(static_cast<size_t>(y1) * width + x1) * 4 + c] * fx;
+                resized[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<uint8_t>(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    return resized;
+}
+
+VirtualTexturePageSource createVirtualTexturePixelSource(const uint8_t* rgbaPixels, uint32_t width, uint32_t height,
+                                                         uint32_t* pagesWide, uint32_t* pagesHigh)
+{
+    *pagesWide = 1;
+    while (*pagesWide * VIRTUAL_TEXTURE_PAGE_SIZE < width)
+    {
+        *pagesWide *= 2;
+    }
+    *pagesHigh = 1;
+    while (*pagesHigh * VIRTUAL_TEXTURE_PAGE_SIZE < height)
+    {
+        *pagesHigh *= 2;
+    }
+
+    // Every level is a whole number of pages, levels where one side is down to a single page keep that side's size
+    struct MipLevel
+    {
+        uint32_t             width;
+        uint32_t             height;
+        std::vector<uint8_t> pixels;
+    };
+    auto mips = std::make_shared<std::vector<MipLevel>>();
+
+    uint32_t mipWidth  = *pagesWide * VIRTUAL_TEXTURE_PAGE_SIZE;
+    uint32_t mipHeight = *pagesHigh * VIRTUAL_TEXTURE_PAGE_SIZE;
+    mips->push_back({ mipWidth, mipHeight, resize(rgbaPixels, width, height, mipWidth, mipHeight) });
+    while (mipWidth > VIRTUAL_TEXTURE_PAGE_SIZE || mipHeight > VIRTUAL_TEXTURE_PAGE_SIZE)
+    {
+        uint32_t newWidth  = std::max(mipWidth / 2, static_cast<uint32_t>(VIRTUAL_TEXTURE_PAGE_SIZE));
+        uint32_t newHeight = std::max(mipHeight / 2, static_cast<uint32_t>(VIRTUAL_TEXTURE_PAGE_SIZE));
+        mips->push_back({ newWidth, newHeight, resize(mips->back().pixels.data(), mipWidth, mipHeight, newWidth, newHeight) });
+        mipWidth  = newWidth;
+        mipHeight = newHeight;
+    }
+
+    return [mips](uint32_t mipLevel, uint32_t pageX, uint32_t pageY, uint8_t* pagePixels)
+    {
+        const MipLevel& mip    = (*mips)[std::min(mipLevel, static_cast<uint32_t>(mips->size()) - 1)];
+        int             startX = static_cast<int>(pageX * VIRTUAL_TEXTURE_PAGE_SIZE) - VIRTUAL_TEXTURE_PAGE_BORDER;
+        int             startY = static_cast<int>(pageY * VIRTUAL_TEXTURE_PAGE_SIZE) - VIRTUAL_TEXTURE_PAGE_BORDER;
+        for (uint32_t y = 0; y < BORDERED_PAGE_SIZE; y++)
+        {
+            int sourceY = std::min(std::max(startY + static_cast<int>(y), 0), static_cast<int>(mip.height) - 1);
+            for (uint32_t x = 0; x < BORDERED_PAGE_SIZE; x++)
+            {
+                int sourceX = std::min(std::max(startX + static_cast<int>(x), 0), static_cast<int>(mip.width) - 1);
+                memcpy(pagePixels + (static_cast<size_t>(y) * BORDERED_PAGE_SIZE + x) * 4,
+                       mip.pixels.data() + (static_cast<size_t>(sourceY) * mip.width + sourceX) * 4, 4);
+            }
+        }
+    };
+}
+
+VirtualTexture::VirtualTexture()
+{
+    _descriptorPool   = VK_NULL_HANDLE;
+    _cacheImage       = VK_NULL_HANDLE;
+    _cacheImageMemory = VK_NULL_HANDLE;
+    _cacheImageView   = VK_NULL_HANDLE;
+    _cacheSampler     = VK_NULL_HANDLE;
+    _cacheInitialised = false;
+    _pageCount        = 0;
+    _rootPage         = 0;
+    _pagesLoaded      = 0;
+}
+
+void VirtualTexture::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDescriptorSetLayout setLayout)
+{
+    _physicalDevice = physicalDevice;
+    _device         = device;
+    _setLayout      = setLayout;
+
+    createCache();
+
+    // One set per frame slot, rewritten whenever the texture (and so its buffers) changes
+    std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+    poolSizes[0].type                             = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount                  = 2 * MAX_FRAME_DRAWS;
+    poolSizes[1].type                             = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount                  = MAX_FRAME_DRAWS;
+
+    VkDescriptorPoolCreateInfo descriptorPoolCI = {};
+    descriptorPoolCI.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolCI.maxSets                    = MAX_FRAME_DRAWS;
+    descriptorPoolCI.poolSizeCount              = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolCI.pPoolSizes                 = poolSizes.data();
+
+    VkResult result = vkCreateDescriptorPool(_device, &descriptorPoolCI, nullptr, &_descriptorPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a virtual texture Descriptor Pool!");
+    }
+
+    // Mid grey single page until a real texture is set
+    clear();
+}
+
+void VirtualTexture::setTexture(uint32_t pagesWide, uint32_t pagesHigh, VirtualTexturePageSource pageSource)
+{
+    CPU_PROFILE_SCOPE("VirtualTexture::setTexture");
+
+    if (!isPowerOfTwo(pagesWide) || !isPowerOfTwo(pagesHigh))
+    {
+        throw std::runtime_error("Virtual texture pages per side must be powers of two!");
+    }
+
+    // Caller makes sure the device is idle, the frames' buffers are replaced
+    destroyFrameResources();
+
+    _pageSource       = pageSource;
+    _header           = {};
+    _header.pagesWide = pagesWide;
+    _header.pagesHigh = pagesHigh;
+    _header.mipCount  = 1;
+    while ((pagesWide >> (_header.mipCount - 1)) > 1 || (pagesHigh >> (_header.mipCount - 1)) > 1)
+    {
+        _header.mipCount++;
+    }
+    if (_header.mipCount > VIRTUAL_TEXTURE_MAX_MIPS)
+    {
+        throw std::runtime_error("Virtual texture has too many mip levels!");
+    }
+
+    _pageCount = 0;
+    for (uint32_t mipLevel = 0; mipLevel < _header.mipCount; mipLevel++)
+    {
+        _header.mipOffsets[mipLevel] = _pageCount;
+        _pageCount += getPagesWide(mipLevel) * getPagesHigh(mipLevel);
+    }
+    _rootPage = _pageCount - 1;
+
+    _pageTable.assign(_pageCount, UNMAPPED_ENTRY);
+    _cacheSlots.assign(VIRTUAL_TEXTURE_CACHE_PAGES * VIRTUAL_TEXTURE_CACHE_PAGES, { INVALID_PAGE, 0 });
+    _residentPages.clear();
+    _pagesLoaded = 0;
+
+    createFrameResources();
+}
+
+void VirtualTexture::update(uint32_t frameSlot, uint64_t frameNumber)
+{
+    CPU_PROFILE_SCOPE("VirtualTexture::update");
+
+    FrameResources& frame = _frames[frameSlot];
+
+    // Pages sampled by the last frame drawn with this slot, its fence has been waited on. Used pages and the
+    // ancestors they fall back to are kept from eviction; missing ones, and their missing ancestors, get loaded
+    std::vector<uint32_t> missingPages;
+    if (_residentPages.find(_rootPage) == _residentPages.end())
+    {
+        missingPages.push_back(_rootPage);
+    }
+
+    uint32_t feedbackWords = (_pageCount + 31) / 32;
+    for (uint32_t word = 0; word < feedbackWords; word++)
+    {
+        uint32_t bits = frame.feedback[word];
+        if (bits == 0)
+        {
+            continue;
+        }
+        frame.feedback[word] = 0;
+
+        for (; bits != 0; bits &= bits - 1)
+        {
+            for (uint32_t pageIndex = word * 32 + __builtin_ctz(bits); ; pageIndex = getParentPage(pageIndex))
+            {
+                auto resident = _residentPages.find(pageIndex);
+                if (resident == _residentPages.end())
+                {
+                    missingPages.push_back(pageIndex);
+                }
+                else if (_cacheSlots[resident->second].lastUsedFrame == frameNumber)
+                {
+                    break;      // Already walked up from here this frame
+                }
+                else
+                {
+                    _cacheSlots[resident->second].lastUsedFrame = frameNumber;
+                }
+
+                if (pageIndex == _rootPage)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Coarser levels come later in the page table, so highest index first loads the fallbacks before the detail
+    std::sort(missingPages.begin(), missingPages.end(), std::greater<uint32_t>());
+    missingPages.erase(std::unique(missingPages.begin(), missingPages.end()), missingPages.end());
+
+    for (uint32_t pageIndex : missingPages)
+    {
+        if (frame.uploads.size() >= VIRTUAL_TEXTURE_MAX_UPLOADS)
+        {
+            break;
+        }
+
+        int slot = allocateSlot(frameNumber);
+        if (slot < 0)
+        {
+            break;      // Everything in the cache was used this frame
+        }
+        loadPage(pageIndex, static_cast<uint32_t>(slot), frame);
+        _cacheSlots[slot].lastUsedFrame = frameNumber;
+    }
+
+    // Bring this frame's copy of the page table up to date
+    if (frame.dirtyBegin < frame.dirtyEnd)
+    {
+        memcpy(frame.pageTable + frame.dirtyBegin, _pageTable.data() + frame.dirtyBegin, (frame.dirtyEnd - frame.dirtyBegin) * sizeof(uint32_t));
+        frame.dirtyBegin = _pageCount;
+        frame.dirtyEnd   = 0;
+    }
+}
+
+void VirtualTexture::recordUploads(VkCommandBuffer commandBuffer, uint32_t frameSlot)
+{
+    FrameResources& frame = _frames[frameSlot];
+    if (frame.uploads.empty())
+    {
+        return;
+    }
+
+    // Barrier source covers the fragment shader reads of every frame submitted before this one
+    VkImageMemoryBarrier imageMemoryBarrier = {};
+    imageMemoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageMemoryBarrier.oldLayout                       = _cacheInitialised ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    imageMemoryBarrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    imageMemoryBarrier.image                           = _cacheImage;
+    imageMemoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageMemoryBarrier.subresourceRange.baseMipLevel   = 0;
+    imageMemoryBarrier.subresourceRange.levelCount     = 1;
+    imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+    imageMemoryBarrier.subresourceRange.layerCount     = 1;
+    imageMemoryBarrier.srcAccessMask                   = VK_ACCESS_SHADER_READ_BIT;
+    imageMemoryBarrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+    vkCmdCopyBufferToImage(commandBuffer, frame.stagingBuffer, _cacheImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(frame.uploads.size()), frame.uploads.data());
+
+    imageMemoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageMemoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+    frame.uploads.clear();
+    _cacheInitialised = true;
+}
+
+void VirtualTexture::recordFeedbackBarrier(VkCommandBuffer commandBuffer)
+{
+    // Feedback bits written by the fragment shader are read on the host once the frame's fence signals
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask   = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+VkDescriptorSet VirtualTexture::getDescriptorSet(uint32_t frameSlot)
+{
+    return _frames[frameSlot].descriptorSet;
+}
+
+VkImageView VirtualTexture::getCacheImageView()
+{
+    return _cacheImageView;
+}
+
+uint32_t VirtualTexture::getPageCount()
+{
+    return _pageCount;
+}
+
+uint32_t VirtualTexture::getResidentPageCount()
+{
+    return static_cast<uint32_t>(_residentPages.size());
+}
+
+void VirtualTexture::printReport()
+{
+    const double mebibyte     = 1024.0 * 1024.0;
+    double       virtualBytes = 0.0;
+    for (uint32_t mipLevel = 0; mipLevel < _header.mipCount; mipLevel++)
+    {
+        virtualBytes += static_cast<double>(getPagesWide(mipLevel)) * getPagesHigh(mipLevel) * VIRTUAL_TEXTURE_PAGE_SIZE * VIRTUAL_TEXTURE_PAGE_SIZE * 4;
+    }
+
+    printf("Virtual texture: %u x %u pages, %u mip levels (%.1f MiB), %u of %u cache slots used (%.1f MiB), %llu pages loaded\n",
+           _header.pagesWide, _header.pagesHigh, _header.mipCount, virtualBytes / mebibyte,
+           getResidentPageCount(), static_cast<uint32_t>(_cacheSlots.size()), _cacheSlots.size() * PAGE_BYTES / mebibyte,
+           static_cast<unsigned long long>(_pagesLoaded));
+}
+
+void VirtualTexture::clear()
+{
+    setTexture(1, 1, [](uint32_t mipLevel, uint32_t pageX, uint32_t pageY, uint8_t* rgbaPixels)
+    {
+        memset(rgbaPixels, 128, PAGE_BYTES);
+    });
+}
+
+void VirtualTexture::destroy()
+{
+    destroyFrameResources();
+    vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+    vkDestroySampler(_device, _cacheSampler, nullptr);
+    vkDestroyImageView(_device, _cacheImageView, nullptr);
+    vkDestroyImage(_device, _cacheImage, nullptr);
+    MemoryTracker::freeMemory(_device, _cacheImageMemory);
+    _descriptorPool = VK_NULL_HANDLE;
+    _cacheImage     = VK_NULL_HANDLE;
+}
+
+VirtualTexture::~VirtualTexture()
+{
+}
+
+void VirtualTexture::createCache()
+{
+    // Physical page cache, slots in rows, each page with its border
+    VkImageCreateInfo imageCI = {};
+    imageCI.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCI.imageType         = VK_IMAGE_TYPE_2D;
+    imageCI.extent.width      = VIRTUAL_TEXTURE_CACHE_PAGES * BORDERED_PAGE_SIZE;
+    imageCI.extent.height     = VIRTUAL_TEXTURE_CACHE_PAGES * BORDERED_PAGE_SIZE;
+    imageCI.extent.depth      = 1;
+    imageCI.mipLevels         = 1;
+    imageCI.arrayLayers       = 1;
+    imageCI.format            = VK_FORMAT_R8G8B8A8_UNORM;
+    imageCI.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageCI.usage             = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageCI.samples           = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateImage(_device, &imageCI, nullptr, &_cacheImage);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the virtual texture cache Image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(_device, _cacheImage, &memoryRequirements);
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.allocationSize       = memoryRequirements.size;
+    memoryAllocInfo.memoryTypeIndex      = findMemoryTypeIndex(_physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    result = MemoryTracker::allocateMemory(_device, &memoryAllocInfo, MEMORY_CATEGORY_TEXTURE, &_cacheImageMemory);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate memory for the virtual texture cache Image!");
+    }
+    vkBindImageMemory(_device, _cacheImage, _cacheImageMemory, 0);
+
+    VkImageViewCreateInfo viewCI           = {};
+    viewCI.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewCI.image                           = _cacheImage;
+    viewCI.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewCI.format                          = VK_FORMAT_R8G8B8A8_UNORM;
+    viewCI.components.r                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.g                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.b                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.components.a                    = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewCI.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewCI.subresourceRange.baseMipLevel   = 0;
+    viewCI.subresourceRange.levelCount     = 1;
+    viewCI.subresourceRange.baseArrayLayer = 0;
+    viewCI.subresourceRange.layerCount     = 1;
+
+    result = vkCreateImageView(_device, &viewCI, nullptr, &_cacheImageView);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the virtual texture cache Image View!");
+    }
+
+    // Shader works out the mip level itself and samples the one level in the cache, borders make bilinear safe
+    VkSamplerCreateInfo samplerCreateInfo     = {};
+    samplerCreateInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter               = VK_FILTER_LINEAR;
+    samplerCreateInfo.minFilter               = VK_FILTER_LINEAR;
+    samplerCreateInfo.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerCreateInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.minLod                  = 0.0f;
+    samplerCreateInfo.maxLod                  = 0.0f;
+
+    result = vkCreateSampler(_device, &samplerCreateInfo, nullptr, &_cacheSampler);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the virtual texture cache Sampler!");
+    }
+}
+
+void VirtualTexture::createFrameResources()
+{
+    VkDeviceSize pageTableBytes = sizeof(PageTableHeader) + static_cast<VkDeviceSize>(_pageCount) * sizeof(uint32_t);
+    VkDeviceSize feedbackBytes  = static_cast<VkDeviceSize>((_pageCount + 31) / 32) * sizeof(uint32_t);
+
+    vkResetDescriptorPool(_device, _descriptorPool, 0);
+
+    _frames.resize(MAX_FRAME_DRAWS);
+    for (FrameResources& frame : _frames)
+    {
+        // Host visible and kept mapped: the CPU writes the page table and reads back feedback every frame
+        const VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        createBuffer(_physicalDevice, _device, pageTableBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory,
+                     &frame.pageTableBuffer, &frame.pageTableMemory, MEMORY_CATEGORY_OTHER);
+        createBuffer(_physicalDevice, _device, feedbackBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory,
+                     &frame.feedbackBuffer, &frame.feedbackMemory, MEMORY_CATEGORY_OTHER);
+        createBuffer(_physicalDevice, _device, PAGE_BYTES * VIRTUAL_TEXTURE_MAX_UPLOADS, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, hostMemory,
+                     &frame.stagingBuffer, &frame.stagingMemory, MEMORY_CATEGORY_STAGING);
+
+        void* pageTable;
+        vkMapMemory(_device, frame.pageTableMemory, 0, pageTableBytes, 0, &pageTable);
+        memcpy(pageTable, &_header, sizeof(PageTableHeader));
+        frame.pageTable = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pageTable) + sizeof(PageTableHeader));
+
+        void* feedback;
+        vkMapMemory(_device, frame.feedbackMemory, 0, feedbackBytes, 0, &feedback);
+        memset(feedback, 0, feedbackBytes);
+        frame.feedback = static_cast<uint32_t*>(feedback);
+
+        void* staging;
+        vkMapMemory(_device, frame.stagingMemory, 0, PAGE_BYTES * VIRTUAL_TEXTURE_MAX_UPLOADS, 0, &staging);
+        frame.staging = static_cast<uint8_t*>(staging);
+
+        // Whole table goes in on first use
+        frame.uploads.clear();
+        frame.dirtyBegin = 0;
+        frame.dirtyEnd   = _pageCount;
+
+        VkDescriptorSetAllocateInfo setAllocInfo = {};
+        setAllocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setAllocInfo.descriptorPool              = _descriptorPool;
+        setAllocInfo.descriptorSetCount          = 1;
+        setAllocInfo.pSetLayouts                 = &_setLayout;
+
+        VkResult result = vkAllocateDescriptorSets(_device, &setAllocInfo, &frame.descriptorSet);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate a virtual texture Descriptor Set!");
+        }
+
+        VkDescriptorBufferInfo pageTableInfo = { frame.pageTableBuffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorImageInfo  cacheInfo     = { _cacheSampler, _cacheImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        VkDescriptorBufferInfo feedbackInfo  = { frame.feedbackBuffer, 0, VK_WHOLE_SIZE };
+
+        // Bindings match set 2 of simple_shader.frag: page table, page cache, feedback
+        std::array<VkWriteDescriptorSet, 3> setWrites = {};
+        for (uint32_t binding = 0; binding < setWrites.size(); binding++)
+        {
+            setWrites[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            setWrites[binding].dstSet          = frame.descriptorSet;
+            setWrites[binding].dstBinding      = binding;
+            setWrites[binding].dstArrayElement = 0;
+            setWrites[binding].descriptorCount = 1;
+        }
+        setWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        setWrites[0].pBufferInfo    = &pageTableInfo;
+        setWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        setWrites[1].pImageInfo     = &cacheInfo;
+        setWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        setWrites[2].pBufferInfo    = &feedbackInfo;
+        vkUpdateDescriptorSets(_device, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+    }
+}
+
+void VirtualTexture::destroyFrameResources()
+{
+    for (FrameResources& frame : _frames)
+    {
+        vkDestroyBuffer(_device, frame.pageTableBuffer, nullptr);
+        MemoryTracker::freeMemory(_device, frame.pageTableMemory);
+        vkDestroyBuffer(_device, frame.feedbackBuffer, nullptr);
+        MemoryTracker::freeMemory(_device, frame.feedbackMemory);
+        vkDestroyBuffer(_device, frame.stagingBuffer, nullptr);
+        MemoryTracker::freeMemory(_device, frame.stagingMemory);
+    }
+    _frames.clear();
+}
+
+uint32_t VirtualTexture::getPagesWide(uint32_t mipLevel)
+{
+    return std::max(_header.pagesWide >> mipLevel, 1u);
+}
+
+uint32_t VirtualTexture::getPagesHigh(uint32_t mipLevel)
+{
+    return std::max(_header.pagesHigh >> mipLevel, 1u);
+}
+
+uint32_t VirtualTexture::getMipLevel(uint32_t pageIndex)
+{
+    uint32_t mipLevel = 0;
+    while (mipLevel + 1 < _header.mipCount && pageIndex >= _header.mipOffsets[mipLevel + 1])
+    {
+        mipLevel++;
+    }
+    return mipLevel;
+}
+
+uint32_t VirtualTexture::getParentPage(uint32_t pageIndex)
+{
+    uint32_t mipLevel = getMipLevel(pageIndex);
+    uint32_t local    = pageIndex - _header.mipOffsets[mipLevel];
+    uint32_t pageX    = local % getPagesWide(mipLevel);
+    uint32_t pageY    = local / getPagesWide(mipLevel);
+
+    // A side already down to one page stays one page
+    uint32_t parentX = pageX * getPagesWide(mipLevel + 1) / getPagesWide(mipLevel);
+    uint32_t parentY = pageY * getPagesHigh(mipLevel + 1) / getPagesHigh(mipLevel);
+    return _header.mipOffsets[mipLevel + 1] + parentY * getPagesWide(mipLevel + 1) + parentX;
+}
+
+int VirtualTexture::allocateSlot(uint64_t frameNumber)
+{
+    // Free slot, else the least recently used page that wasn't used in the frame just read back
+    int leastRecentlyUsed = -1;
+    for (uint32_t slot = 0; slot < _cacheSlots.size(); slot++)
+    {
+        const CacheSlot& cacheSlot = _cacheSlots[slot];
+        if (cacheSlot.pageIndex == INVALID_PAGE)
+        {
+            return static_cast<int>(slot);
+        }
+        if (cacheSlot.pageIndex == _rootPage || cacheSlot.lastUsedFrame == frameNumber)
+        {
+            continue;
+        }
+        if (leastRecentlyUsed < 0 || cacheSlot.lastUsedFrame < _cacheSlots[leastRecentlyUsed].lastUsedFrame)
+        {
+            leastRecentlyUsed = static_cast<int>(slot);
+        }
+    }
+
+    if (leastRecentlyUsed >= 0)
+    {
+        // Everything that pointed at the evicted page falls back to what its parent points at
+        uint32_t pageIndex = _cacheSlots[leastRecentlyUsed].pageIndex;
+        setEntries(pageIndex, _pageTable[getParentPage(pageIndex)], false, packEntry(leastRecentlyUsed, getMipLevel(pageIndex)));
+        _residentPages.erase(pageIndex);
+        _cacheSlots[leastRecentlyUsed].pageIndex = INVALID_PAGE;
+    }
+    return leastRecentlyUsed;
+}
+
+void VirtualTexture::loadPage(uint32_t pageIndex, uint32_t slot, FrameResources& frame)
+{
+    uint32_t mipLevel = getMipLevel(pageIndex);
+    uint32_t local    = pageIndex - _header.mipOffsets[mipLevel];
+
+    VkDeviceSize bufferOffset = frame.uploads.size() * PAGE_BYTES;
+    _pageSource(mipLevel, local % getPagesWide(mipLevel), local / getPagesWide(mipLevel), frame.staging + bufferOffset);
+
+    VkBufferImageCopy copyRegion               = {};
+    copyRegion.bufferOffset                    = bufferOffset;
+    copyRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    copyRegion.imageSubresource.mipLevel       = 0;
+    copyRegion.imageSubresource.baseArrayLayer = 0;
+    copyRegion.imageSubresource.layerCount     = 1;
+    copyRegion.imageOffset                     = { static_cast<int32_t>((slot % VIRTUAL_TEXTURE_CACHE_PAGES) * BORDERED_PAGE_SIZE),
+                                                   static_cast<int32_t>((slot / VIRTUAL_TEXTURE_CACHE_PAGES) * BORDERED_PAGE_SIZE), 0 };
+    copyRegion.imageExtent                     = { BORDERED_PAGE_SIZE, BORDERED_PAGE_SIZE, 1 };
+    frame.uploads.push_back(copyRegion);
+
+    // Page and everything below it that was falling back to something coarser now use this page
+    _cacheSlots[slot].pageIndex = pageIndex;
+    _residentPages[pageIndex]   = slot;
+    setEntries(pageIndex, packEntry(slot, mipLevel), true, 0);
+    _pagesLoaded++;
+}
+
+void VirtualTexture::setEntries(uint32_t pageIndex, uint32_t newEntry, bool replaceCoarser, uint32_t oldEntry)
+{
+    // Page's area at each finer level, down to mip 0
+    uint32_t mipLevel = getMipLevel(pageIndex);
+    uint32_t local    = pageIndex - _header.mipOffsets[mipLevel];
+    uint32_t beginX   = local % getPagesWide(mipLevel);
+    uint32_t beginY   = local / getPagesWide(mipLevel);
+    uint32_t endX     = beginX + 1;
+    uint32_t endY     = beginY + 1;
+
+    for (int level = static_cast<int>(mipLevel); level >= 0; level--)
+    {
+        if (level < static_cast<int>(mipLevel))
+        {
+            uint32_t scaleX = getPagesWide(level) / getPagesWide(level + 1);
+            uint32_t scaleY = getPagesHigh(level) / getPagesHigh(level + 1);
+            beginX *= scaleX;
+            endX   *= scaleX;
+            beginY *= scaleY;
+            endY   *= scaleY;
+        }
+
+        for (uint32_t y = beginY; y < endY; y++)
+        {
+            uint32_t rowStart = _header.mipOffsets[level] + y * getPagesWide(level);
+            for (uint32_t x = beginX; x < endX; x++)
+            {
+                uint32_t& entry = _pageTable[rowStart + x];
+                if (replaceCoarser ? (entry >> 24) > mipLevel : entry == oldEntry)
+                {
+                    entry = newEntry;
+                }
+            }
+        }
+
+        // Every frame's copy gets this level's rows when it is next used
+        uint32_t dirtyBegin = _header.mipOffsets[level] + beginY * getPagesWide(level);
+        uint32_t dirtyEnd   = _header.mipOffsets[level] + (endY - 1) * getPagesWide(level) + endX;
+        for (FrameResources& frame : _frames)
+        {
+            frame.dirtyBegin = std::min(frame.dirtyBegin, dirtyBegin);
+            frame.dirtyEnd   = std::max(frame.dirtyEnd, dirtyEnd);
+        }
+    }
+}
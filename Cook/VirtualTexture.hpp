@@ -0,0 +1,119 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Fills one page of a virtual texture with (PAGE_SIZE + 2 * PAGE_BORDER)^2 RGBA8 texels: the page's texels at mipLevel,
+// surrounded by a PAGE_BORDER wide apron taken from the pages next to it (clamped at the edges of the texture).
+// Mip level m is (pagesWide >> m) by (pagesHigh >> m) pages, never less than one. Called on the render thread.
+using VirtualTexturePageSource = std::function<void(uint32_t mipLevel, uint32_t pageX, uint32_t pageY, uint8_t* rgbaPixels)>;
+
+// Page source for an image held in memory. The image is resized up to a power of two number of pages per side,
+// which is returned in pagesWide and pagesHigh, and its mip chain is built up front.
+VirtualTexturePageSource createVirtualTexturePixelSource(const uint8_t* rgbaPixels, uint32_t width, uint32_t height,
+                                                         uint32_t* pagesWide, uint32_t* pagesHigh);
+
+// One virtual texture, of any size, drawn from a fixed size physical page cache.
+//   - The texture is split into pages, every mip level included. Pages are only loaded (from the page source) when
+//     the fragment shader asks for them, and copied into a free slot of the physical cache image.
+//   - The fragment shader picks the mip level it wants from its derivatives, sets that page's bit in the frame's
+//     feedback buffer, and samples through the page table: one entry per page, giving the cache slot and mip level
+//     of the page itself if it is resident, otherwise of its nearest resident ancestor.
+//   - update reads the feedback of the frame that last used the slot, marks the pages (and their ancestors) used,
+//     loads up to VIRTUAL_TEXTURE_MAX_UPLOADS missing pages, coarsest first, evicting the least recently used
+//     pages when the cache is full, and writes the changed page table entries into the frame's page table.
+// The smallest mip level is a single page that is always resident, so everything has something to fall back to.
+// Copies into the cache are recorded in the frame's command buffer before the render pass, so they are ordered
+// after every earlier frame's reads of the slots they overwrite and nothing has to wait.
+class VirtualTexture
+{
+    public:
+        VirtualTexture();
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDescriptorSetLayout setLayout);
+        void setTexture(uint32_t pagesWide, uint32_t pagesHigh, VirtualTexturePageSource pageSource);
+        void update(uint32_t frameSlot, uint64_t frameNumber);
+        void recordUploads(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+        void recordFeedbackBarrier(VkCommandBuffer commandBuffer);
+
+        VkDescriptorSet getDescriptorSet(uint32_t frameSlot);
+        VkImageView     getCacheImageView();
+        uint32_t        getPageCount();
+        uint32_t        getResidentPageCount();
+        void            printReport();
+        void            clear();
+        void            destroy();
+
+        ~VirtualTexture();
+
+    private:
+        // Page table buffer starts with this, entries follow. Layout matches PageTable in simple_shader.frag
+        struct PageTableHeader
+        {
+            uint32_t pagesWide;
+            uint32_t pagesHigh;
+            uint32_t mipCount;
+            uint32_t padding;
+            uint32_t mipOffsets[16];      // Index of each mip level's first page
+        };
+
+        struct CacheSlot
+        {
+            uint32_t pageIndex;           // INVALID_PAGE when free
+            uint64_t lastUsedFrame;
+        };
+
+        // Buffers written by the CPU or GPU while another frame is in flight, one set per frame slot
+        struct FrameResources
+        {
+            VkBuffer                       pageTableBuffer;
+            VkDeviceMemory                 pageTableMemory;
+            uint32_t*                      pageTable;         // Mapped, entries after the header
+            VkBuffer                       feedbackBuffer;
+            VkDeviceMemory                 feedbackMemory;
+            uint32_t*                      feedback;          // Mapped, one bit per page
+            VkBuffer                       stagingBuffer;
+            VkDeviceMemory                 stagingMemory;
+            uint8_t*                       staging;           // Mapped, room for VIRTUAL_TEXTURE_MAX_UPLOADS pages
+            std::vector<VkBufferImageCopy> uploads;           // Copies for recordUploads, from staging into the cache
+            uint32_t                       dirtyBegin;        // Page table entries changed since this frame's copy was written
+            uint32_t                       dirtyEnd;
+            VkDescriptorSet                descriptorSet;
+        };
+
+        VkPhysicalDevice                       _physicalDevice;
+        VkDevice                               _device;
+        VkDescriptorSetLayout                  _setLayout;
+        VkDescriptorPool                       _descriptorPool;
+        VkImage                                _cacheImage;
+        VkDeviceMemory                         _cacheImageMemory;
+        VkImageView                            _cacheImageView;
+        VkSampler                              _cacheSampler;
+        bool                                   _cacheInitialised;   // Cache has been moved out of the undefined layout
+        std::vector<FrameResources>            _frames;
+
+        VirtualTexturePageSource               _pageSource;
+        PageTableHeader                        _header;
+        uint32_t                               _pageCount;
+        uint32_t                               _rootPage;           // Single page of the smallest mip level
+        std::vector<uint32_t>                  _pageTable;          // Resolved entries, what the frames' copies are updated from
+        std::vector<CacheSlot>                 _cacheSlots;
+        std::unordered_map<uint32_t, uint32_t> _residentPages;      // Page index to cache slot
+        uint64_t                               _pagesLoaded;
+
+        void     createCache();
+        void     createFrameResources();
+        void     destroyFrameResources();
+        uint32_t getPagesWide(uint32_t mipLevel);
+        uint32_t getPagesHigh(uint32_t mipLevel);
+        uint32_t getMipLevel(uint32_t pageIndex);
+        uint32_t getParentPage(uint32_t pageIndex);
+        int      allocateSlot(uint64_t frameNumber);
+        void     loadPage(uint32_t pageIndex, uint32_t slot, FrameResources& frame);
+        void     setEntries(uint32_t pageIndex, uint32_t newEntry, bool replaceCoarser, uint32_t oldEntry);
+};
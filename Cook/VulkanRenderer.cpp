@@ -1,6 +1,9 @@
 #include "VulkanRenderer.hpp"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT     messageSeverity,
@@ -54,17 +57,50 @@ VulkanRenderer::~VulkanRenderer()
 //
 int VulkanRenderer::init(GLFWwindow * newWindow)
 {
-    _window = newWindow;
+    _window   = newWindow;
+    _headless = false;
+    return initRenderer();
+}
+
+int VulkanRenderer::initHeadless(uint32_t width, uint32_t height)
+{
+    // No window, surface or swapchain. Frames are rendered into offscreen images of this size instead
+    _window          = nullptr;
+    _headless        = true;
+    _swapChainExtent = { width, height };
+    return initRenderer();
+}
+
+int VulkanRenderer::initRenderer()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::init");
 
     try
     {
         createInstance();
         setupDebugMessenger();
-        createSurface();
+        if (!_headless)
+        {
+            createSurface();
+        }
         getPhysicalDevice();
         createLogicalDevice();
-        createSwapChain();
+        MemoryTracker::init(_instance, _mainDevice.physicalDevice, _memoryBudgetEnabled);
+        _pipelineCache.create(_mainDevice.physicalDevice, _mainDevice.logicalDevice, PIPELINE_CACHE_FILE);
+        if (_headless)
+        {
+            createOffscreenTargets();
+        }
+        else
+        {
+            createSwapChain();
+        }
         createRenderPass();
+        if (!_assetPack.open(ASSET_PACK_FILE))
+        {
+            printf("No asset pack at %s, loading loose files\n", ASSET_PACK_FILE);
+        }
+        loadShaders();
         createDescriptorSetLayout();
         createPushConstantRange();
         createGraphicsPipeline();
@@ -72,7 +108,31 @@ int VulkanRenderer::init(GLFWwindow * newWindow)
         createFramebuffers();
         createCommandPool();
         createCommandBuffers();
+        _gpuProfiler.init(_instance, _mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue,
+                          getQueueFamilies(_mainDevice.physicalDevice).graphicsFamily, _graphicsCommandPool,
+                          _calibratedTimestampsEnabled);
+        _pipelineStatistics.init(_mainDevice.logicalDevice, _pipelineStatisticsEnabled);
+
+        // Main thread takes part in the jobs too, so one worker per remaining core
+        _jobSystem.init(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        _assetLoader.init(ASYNC_FILE_QUEUE_DEPTH, ASYNC_FILE_FALLBACK_THREADS, ASYNC_FILE_DIRECT_IO);
+        createThreadCommandPools();
         createTextureSampler();
+        _textureStreamer.init(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue,
+                              getQueueFamilies(_mainDevice.physicalDevice).graphicsFamily, _vkSamplerDescriptorSetLayout,
+                              _textureSampler, TEXTURE_STREAMING_BUDGET_BYTES);
+        if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
+        {
+            _virtualTexture.init(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _vkVirtualTextureDescriptorSetLayout);
+        }
+        else if (!_fragmentStoresAndAtomicsEnabled)
+        {
+            printf("Virtual texturing unavailable, the GPU can't write its feedback (no fragmentStoresAndAtomics)\n");
+        }
+        else
+        {
+            printf("Virtual texturing unavailable, shaders were built without it (run compile.sh)\n");
+        }
         //allocateDynamicBufferTransferSpace();
         createUniformBuffers();
         createDescriptorPool();
@@ -83,6 +143,7 @@ int VulkanRenderer::init(GLFWwindow * newWindow)
         _uboViewProjection.view = glm::lookAt(glm::vec3(2.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
         _uboViewProjection.projection[1][1] *= -1;
+        _uboViewProjection.shaderFeatures = glm::uvec4(VK_FALSE, VK_FALSE, 1, 0);
         
         std::vector<Vertex> meshVertices = {
             { { -0.4, 0.4, 0.0 }, { 1.0f, 0.0f, 0.0f },{ 1.0f, 1.0f } }, // 0
@@ -103,21 +164,31 @@ int VulkanRenderer::init(GLFWwindow * newWindow)
             0, 1, 2,
             2, 3, 0
         };
+        std::vector<int> textureIds = createStreamedTextures({ "panda.jpg", "giraffe.jpg" });
         Mesh firstMesh = Mesh(_mainDevice.physicalDevice,
                               _mainDevice.logicalDevice,
                               _graphicsQueue,
                               _graphicsCommandPool,
                               &meshVertices, &meshIndices,
-                              createTexture("panda.jpg"));
+                              textureIds[0]);
         Mesh secondMesh = Mesh(_mainDevice.physicalDevice,
                                _mainDevice.logicalDevice,
                                _graphicsQueue,
                                _graphicsCommandPool,
                                &meshVertices2, &meshIndices,
-                               createTexture("giraffe.jpg"));
+                               textureIds[1]);
         
         _meshList.push_back(firstMesh);
         _meshList.push_back(secondMesh);
+
+        // Root of the scene hierarchy, meshes are placed in the scene with addSceneNode
+        _sceneRootNode = _sceneGraph.addNode(-1, glm::mat4(1.0f));
+
+        // Recompile and swap in shaders whenever their GLSL source is saved (not headless, runs should be reproducible)
+        if (!_headless)
+        {
+            _shaderHotReload.start(getShaderDirectory(), [this](const std::vector<std::string>& changedFiles) { reloadShaders(changedFiles); });
+        }
     }
     catch (const std::runtime_error &e)
     {
@@ -130,30 +201,47 @@ int VulkanRenderer::init(GLFWwindow * newWindow)
 
 void VulkanRenderer::cleanup()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::cleanup");
+
     vkDeviceWaitIdle(_mainDevice.logicalDevice);
+
+    _shaderHotReload.stop();
+    _assetLoader.shutdown();
+    _jobSystem.printUtilisation();
+    _jobSystem.shutdown();
+    _gpuProfiler.printReport();
+    _gpuProfiler.destroy();
+    _pipelineStatistics.printReport(_swapChainExtent);
+    _pipelineStatistics.destroy();
+    _textureStreamer.destroy();
+    if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        _virtualTexture.destroy();
+    }
     
-    vkDestroyDescriptorPool(_mainDevice.logicalDevice, _samplerDescriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(_mainDevice.logicalDevice, _vkSamplerDescriptorSetLayout, nullptr);
+    for (VkDescriptorPool samplerDescriptorPool : _samplerDescriptorPools)
+    {
+        vkDestroyDescriptorPool(_mainDevice.logicalDevice, samplerDescriptorPool, nullptr);
+    }
     
     for(size_t ii=0; ii<_vkTextureImages.size(); ++ii)
     {
         vkDestroyImageView(_mainDevice.logicalDevice, _vkTextureImageViews[ii], nullptr);
         vkDestroyImage(_mainDevice.logicalDevice, _vkTextureImages[ii], nullptr);
-        vkFreeMemory(_mainDevice.logicalDevice, _vkTextureImageDeviceMemory[ii], nullptr);
+        MemoryTracker::freeMemory(_mainDevice.logicalDevice, _vkTextureImageDeviceMemory[ii]);
     }
     
     vkDestroyImageView(_mainDevice.logicalDevice, _depthBufferVkImageView, nullptr);
     vkDestroyImage(_mainDevice.logicalDevice, _depthBufferVkImage, nullptr);
-    vkFreeMemory(_mainDevice.logicalDevice, _depthBufferImageVkDeviceMemory, nullptr);
+    MemoryTracker::freeMemory(_mainDevice.logicalDevice, _depthBufferImageVkDeviceMemory);
     
     //free(_modelTransferSpace);
     vkDestroyDescriptorPool(_mainDevice.logicalDevice, _descriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(_mainDevice.logicalDevice, _vkDescriptorSetLayout, nullptr);
     
     for(size_t i=0; i<_swapChainImages.size(); ++i)
     {
         vkDestroyBuffer(_mainDevice.logicalDevice, _vpUniformBuffer[i], nullptr);
-        vkFreeMemory(_mainDevice.logicalDevice, _vpUniformBufferMemory[i], nullptr);
+        MemoryTracker::freeMemory(_mainDevice.logicalDevice, _vpUniformBufferMemory[i]);
     }
     
     for (size_t i = 0; i < _meshList.size(); i++)
@@ -169,20 +257,42 @@ void VulkanRenderer::cleanup()
     }
     
     
+    for (auto& frameCommandPools : _threadCommandPools)
+    {
+        for (ThreadCommandPool& threadCommandPool : frameCommandPools)
+        {
+            vkDestroyCommandPool(_mainDevice.logicalDevice, threadCommandPool.commandPool, nullptr);
+        }
+    }
     vkDestroyCommandPool(_mainDevice.logicalDevice, _graphicsCommandPool, nullptr);
     for(VkFramebuffer framebuffer : _swapChainFramebuffers)
     {
         vkDestroyFramebuffer(_mainDevice.logicalDevice, framebuffer, nullptr);
     }
-    vkDestroyPipeline(_mainDevice.logicalDevice, _graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(_mainDevice.logicalDevice, _pipelineLayout, nullptr);
+    _pipelineLibrary.destroy();
+    _pipelineCache.save();
+    _pipelineCache.destroy();
+    _assetPack.close();
+    _layoutCache.destroy();     // Owns the descriptor set layouts and pipeline layout
     vkDestroyRenderPass(_mainDevice.logicalDevice, _renderPass, nullptr);
     for (auto swapchainImage : _swapChainImages)
     {
         vkDestroyImageView(_mainDevice.logicalDevice, swapchainImage.vkImageView, nullptr);
     }
-    vkDestroySwapchainKHR(_mainDevice.logicalDevice, _swapchain, nullptr);
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    if (_headless)
+    {
+        // Offscreen images are owned by us rather than a swapchain
+        for (size_t i = 0; i < _swapChainImages.size(); i++)
+        {
+            vkDestroyImage(_mainDevice.logicalDevice, _swapChainImages[i].vkImage, nullptr);
+            MemoryTracker::freeMemory(_mainDevice.logicalDevice, _offscreenImageMemory[i]);
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR(_mainDevice.logicalDevice, _swapchain, nullptr);
+        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    }
     vkDestroyDevice(_mainDevice.logicalDevice, nullptr);
     
     if (_enableValidationLayers)
@@ -195,6 +305,8 @@ void VulkanRenderer::cleanup()
 
 void VulkanRenderer::createInstance()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createInstance");
+
     if (_enableValidationLayers && !checkValidationLayerSupport())
     {
         throw std::runtime_error("validation layers requested, but not available!");
@@ -223,8 +335,8 @@ void VulkanRenderer::createInstance()
     uint32_t glfwExtensionCount = 0;                // GLFW may require multiple extensions
     const char** glfwExtensions;                    // Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
 
-    // Get GLFW extensions
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    // Get GLFW extensions (none needed without a window to present to)
+    glfwExtensions = _headless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     // Add GLFW extensions to list of extensions
     for (size_t i = 0; i < glfwExtensionCount; i++)
@@ -270,6 +382,8 @@ void VulkanRenderer::createInstance()
 
 void VulkanRenderer::createSurface()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createSurface");
+
     // Create Surface (creates a surface create info struct, runs the create surface function, returns result)
     VkResult result = glfwCreateWindowSurface(_instance, _window, nullptr, &_surface);
 
@@ -281,6 +395,8 @@ void VulkanRenderer::createSurface()
 
 void VulkanRenderer::createLogicalDevice()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createLogicalDevice");
+
     //Get the queue family indices for the chosen Physical Device
     QueueFamilyIndices indices = getQueueFamilies(_mainDevice.physicalDevice);
     
@@ -298,19 +414,61 @@ void VulkanRenderer::createLogicalDevice()
         queueCreateInfo.pQueuePriorities = &priority;                       // Vulkan needs to know how to handle multiple queues, so decide priority (1 = highest priority)
         queueCreateInfos.push_back(queueCreateInfo);
     }
-    
+
+    // Optional extensions, only enabled when the device has them
+    std::vector<const char*> enabledExtensions = getRequiredDeviceExtensions();
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(_mainDevice.physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> deviceExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(_mainDevice.physicalDevice, nullptr, &extensionCount, deviceExtensions.data());
+
+    for (const auto &extension : deviceExtensions)
+    {
+        // GPU profiler uses it to line GPU timestamps up with CPU time
+        if (strcmp(extension.extensionName, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0)
+        {
+            enabledExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+            _calibratedTimestampsEnabled = true;
+        }
+
+        // Memory tracker reads the OS budget for each heap with it
+        if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+        {
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            _memoryBudgetEnabled = true;
+        }
+    }
 
     // Information to create logical device (sometimes called "device")
     VkDeviceCreateInfo deviceCreateInfo = {};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.queueCreateInfoCount =  static_cast<uint32_t>(queueCreateInfos.size());
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
-    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
-    deviceCreateInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
+    deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // Physical Device Features the Logical Device will be using
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_mainDevice.physicalDevice, &supportedFeatures);
+
+    // Virtual texture feedback is written by the fragment shader, without this the shaders without it are loaded
+    if (supportedFeatures.fragmentStoresAndAtomics)
+    {
+        deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+        _fragmentStoresAndAtomicsEnabled        = true;
+    }
+
+    // Pipeline statistics queries around the render pass also have to cover the secondary command buffers executed in it
+    if (supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries)
+    {
+        deviceFeatures.pipelineStatisticsQuery = VK_TRUE;
+        deviceFeatures.inheritedQueries        = VK_TRUE;
+        _pipelineStatisticsEnabled             = true;
+    }
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
     // Create the logical device for the given physical device
@@ -329,6 +487,8 @@ void VulkanRenderer::createLogicalDevice()
 
 void VulkanRenderer::getPhysicalDevice()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::getPhysicalDevice");
+
     // Enumerate Physical devices the vkInstance can access
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr);
@@ -357,6 +517,8 @@ void VulkanRenderer::getPhysicalDevice()
 
 void VulkanRenderer::createSwapChain()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createSwapChain");
+
     // Get Swap Chain details so we can pick best settings
     SwapChainDetails swapChainDetails = getSwapChainDetailsPerPhysicalDevice(_mainDevice.physicalDevice);
 
@@ -443,216 +605,230 @@ void VulkanRenderer::createSwapChain()
     }
 }
 
-void VulkanRenderer::createGraphicsPipeline()
+void VulkanRenderer::loadShaders()
 {
-    // Read in SPIR-V code of shaders
-    auto vertexShaderCode   = readFile("/Users/flo/LocalDocuments/Projects/VulkanLearning/Cook/Cook/shaders/simple_shader.vert.spv");
-    auto fragmentShaderCode = readFile("/Users/flo/LocalDocuments/Projects/VulkanLearning/Cook/Cook/shaders/simple_shader.frag.spv");
-
-    // Create Shader Modules
-    VkShaderModule vertexShaderModule   = createShaderModule(vertexShaderCode);
-    VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
-
-    // -- SHADER STAGE CREATION INFORMATION --
-    // Vertex Stage creation information
-    VkPipelineShaderStageCreateInfo vertexShaderCI   = {};
-    vertexShaderCI.sType                             = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexShaderCI.stage                             = VK_SHADER_STAGE_VERTEX_BIT;
-    vertexShaderCI.module                            = vertexShaderModule;
-    vertexShaderCI.pName                             = "main";
-
-    // Fragment Stage creation information
-    VkPipelineShaderStageCreateInfo fragmentShaderCI = {};
-    fragmentShaderCI.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragmentShaderCI.stage                           = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragmentShaderCI.module                          = fragmentShaderModule;
-    fragmentShaderCI.pName                           = "main";
-
-    // Put shader stage creation info in to array
-    // Graphics Pipeline creation info requires array of shader stage creates
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCI, fragmentShaderCI };
-
-    // CREATE PIPELINE
-    
-    // How the data for a single vertex (including info such as position, color, texture coords, normals, ...etc) is as a whole.
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding                         = 0;
-    bindingDescription.stride                          = sizeof(Vertex);
-    // Choose between VK_VERTEX_INPUT_RATE_INDEX and VK_VERTEX_INPUT_RATE_INSTANCE
-    bindingDescription.inputRate                       = VK_VERTEX_INPUT_RATE_VERTEX;
-    
-    // VkVertexInputBindingDescription has many VkVertexInputAttributeDescriptions.
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions;
-    attributeDescriptions[0].binding                   = 0;       // Which binding the data is at. (should be the same as above.)
-    attributeDescriptions[0].location                  = 0;       // Location in shader where data will be read from.
-    attributeDescriptions[0].format                    = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset                    = offsetof(Vertex, pos);
-    
-    attributeDescriptions[1].binding                   = 0;
-    attributeDescriptions[1].location                  = 1;
-    attributeDescriptions[1].format                    = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset                    = offsetof(Vertex, col);
-    
-    attributeDescriptions[2].binding                   = 0;
-    attributeDescriptions[2].location                  = 2;
-    attributeDescriptions[2].format                    = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset                    = offsetof(Vertex, tex);
-    
-    // -- VERTEX INPUT (TODO: Put in vertex descriptions when resources created) --
-    VkPipelineVertexInputStateCreateInfo vertexInputCI = {};
-    vertexInputCI.sType                                = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputCI.vertexBindingDescriptionCount        = 1;
-    vertexInputCI.pVertexBindingDescriptions           = &bindingDescription; // List of Vertex Binding Descriptions (data spacing/stride information)
-    vertexInputCI.vertexAttributeDescriptionCount      = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputCI.pVertexAttributeDescriptions         = attributeDescriptions.data(); // List of Vertex Attribute Descriptions (data format and where to bind to/from)
-
-    // -- INPUT ASSEMBLY --
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCI = {};
-    inputAssemblyCI.sType                               = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyCI.topology                            = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssemblyCI.primitiveRestartEnable              = VK_FALSE;
-
-    // -- VIEWPORT & SCISSOR --
-    // Create a viewport info struct
-    VkViewport viewport = {};
-    viewport.x        = 0.0f;                            // x start coordinate
-    viewport.y        = 0.0f;                            // y start coordinate
-    viewport.width    = (float)_swapChainExtent.width;   // width of viewport
-    viewport.height   = (float)_swapChainExtent.height;  // height of viewport
-    viewport.minDepth = 0.0f;                            // min framebuffer depth
-    viewport.maxDepth = 1.0f;                            // max framebuffer depth
-
-    // Create a scissor info struct
-    VkRect2D scissor = {};
-    scissor.offset   = { 0,0 };                          // Offset to use region from
-    scissor.extent   = _swapChainExtent;                 // Extent to describe region to use, starting at offset
-
-    VkPipelineViewportStateCreateInfo viewportStateCI = {};
-    viewportStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportStateCI.viewportCount                     = 1;
-    viewportStateCI.pViewports                        = &viewport;
-    viewportStateCI.scissorCount                      = 1;
-    viewportStateCI.pScissors                         = &scissor;
-
-
-    // -- DYNAMIC STATES --
-    // Dynamic states to enable
-    //std::vector<VkDynamicState> dynamicStateEnables;
-    //dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);    // Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
-    //dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);    // Dynamic Scissor    : Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
-
-    //// Dynamic State creation info
-    //VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-    //dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    //dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-    //dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
-
-    // -- RASTERIZER --
-    VkPipelineRasterizationStateCreateInfo rasterizerCI = {};
-    rasterizerCI.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizerCI.depthClampEnable        = VK_FALSE;
-    rasterizerCI.rasterizerDiscardEnable = VK_FALSE;
-    rasterizerCI.polygonMode             = VK_POLYGON_MODE_FILL;
-    rasterizerCI.lineWidth               = 1.0f;
-    rasterizerCI.cullMode                = VK_CULL_MODE_BACK_BIT;
-    rasterizerCI.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizerCI.depthBiasEnable         = VK_FALSE;
-
-    // -- MULTISAMPLING --
-    VkPipelineMultisampleStateCreateInfo multisamplingCI = {};
-    multisamplingCI.sType                                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisamplingCI.sampleShadingEnable                  = VK_FALSE;
-    multisamplingCI.rasterizationSamples                 = VK_SAMPLE_COUNT_1_BIT;
-
-    // -- BLENDING --
-    // Blending decides how to blend a new colour being written to a fragment, with the old value
-
-    // Blend Attachment State (how blending is handled)
-    VkPipelineColorBlendAttachmentState colourState = {};
-    colourState.colorWriteMask                      = VK_COLOR_COMPONENT_R_BIT |
-                                                      VK_COLOR_COMPONENT_G_BIT |    // Colours to apply blending to
-                                                      VK_COLOR_COMPONENT_B_BIT |
-                                                      VK_COLOR_COMPONENT_A_BIT;
-    colourState.blendEnable                         = VK_TRUE;
-    colourState.srcColorBlendFactor                 = VK_BLEND_FACTOR_SRC_ALPHA;
-    colourState.dstColorBlendFactor                 = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colourState.colorBlendOp                        = VK_BLEND_OP_ADD;
-
-    // Summarised: (VK_BLEND_FACTOR_SRC_ALPHA * new colour) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old colour)
-    //               (new colour alpha * new colour) + ((1 - new colour alpha) * old colour)
-
-    colourState.srcAlphaBlendFactor                 = VK_BLEND_FACTOR_ONE;
-    colourState.dstAlphaBlendFactor                 = VK_BLEND_FACTOR_ZERO;
-    colourState.alphaBlendOp                        = VK_BLEND_OP_ADD;
-    // Summarised: (1 * new alpha) + (0 * old alpha) = new alpha
-
-    VkPipelineColorBlendStateCreateInfo colourBlendingCI = {};
-    colourBlendingCI.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colourBlendingCI.logicOpEnable   = VK_FALSE;
-    colourBlendingCI.attachmentCount = 1;
-    colourBlendingCI.pAttachments    = &colourState;
+    CPU_PROFILE_SCOPE("VulkanRenderer::loadShaders");
 
+    // Read in SPIR-V code of shaders, from the asset pack if it has them
+    _vertexShaderCode   = readAsset(std::string("shaders/") + VERTEX_SHADER_FILE + ".spv",
+                                    getShaderDirectory() + VERTEX_SHADER_FILE + ".spv", &_vertexShaderFile);
+    _fragmentShaderCode = readAsset(std::string("shaders/") + getFragmentShaderBinary(),
+                                    getShaderDirectory() + getFragmentShaderBinary(), &_fragmentShaderFile);
 
-    // -- PIPELINE LAYOUT
-    
-    std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { _vkDescriptorSetLayout, _vkSamplerDescriptorSetLayout };
-    
-    VkPipelineLayoutCreateInfo pipelineLayoutCI = {};
-    pipelineLayoutCI.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCI.setLayoutCount         = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutCI.pSetLayouts            = descriptorSetLayouts.data();
-    pipelineLayoutCI.pushConstantRangeCount = 1;
-    pipelineLayoutCI.pPushConstantRanges    = &_pushConstantRange;
-
-    VkResult result = vkCreatePipelineLayout(_mainDevice.logicalDevice, &pipelineLayoutCI, nullptr, &_pipelineLayout);
-    if (result != VK_SUCCESS)
+    // Layouts, push constants and vertex input are all worked out from what the shaders actually use
+    _shaderReflection = mergeShaderReflections({ reflectShader(_vertexShaderCode), reflectShader(_fragmentShaderCode) });
+    _layoutCache.init(_mainDevice.logicalDevice);
+
+    // Create Shader Modules (handed to the pipeline library in createGraphicsPipeline, every variant is built from them)
+    _vertexShaderModule   = createShaderModule(_vertexShaderCode);
+    _fragmentShaderModule = createShaderModule(_fragmentShaderCode);
+}
+
+// Fragment shader with the virtual texture needs fragmentStoresAndAtomics for its feedback
+std::string VulkanRenderer::getFragmentShaderBinary() const
+{
+    return _fragmentStoresAndAtomicsEnabled ? std::string(FRAGMENT_SHADER_FILE) + ".spv" : FRAGMENT_SHADER_NO_FEEDBACK_BINARY;
+}
+
+// Pack first, unless the loose file is newer (rebuilt by compile.sh or written by a hot reload since the pack was built).
+// Loose files are read into fileData, packed ones aren't copied at all
+std::span<const char> VulkanRenderer::readAsset(const std::string& packName, const std::string& filePath, std::vector<char>* fileData)
+{
+    std::span<const char> packed = _assetPack.find(packName);
+    if (!packed.empty())
+    {
+        std::error_code                 fileError;
+        std::error_code                 packError;
+        std::filesystem::file_time_type fileTime = std::filesystem::last_write_time(filePath, fileError);
+        std::filesystem::file_time_type packTime = std::filesystem::last_write_time(ASSET_PACK_FILE, packError);
+        if (fileError || packError || fileTime <= packTime)
+        {
+            return packed;
+        }
+        printf("%s is newer than the asset pack, loading it instead\n", filePath.c_str());
+    }
+    *fileData = readFile(filePath);
+    return *fileData;
+}
+
+// Runs on the hot reload thread. Pipelines are rebuilt here too, and swapped in by draw() at the start of a frame
+void VulkanRenderer::reloadShaders(const std::vector<std::string>& changedFiles)
+{
+    auto reloadStart = std::chrono::steady_clock::now();
+
+    std::vector<char> vertexShaderCode(_vertexShaderCode.begin(), _vertexShaderCode.end());
+    std::vector<char> fragmentShaderCode(_fragmentShaderCode.begin(), _fragmentShaderCode.end());
+    for (const std::string& changedFile : changedFiles)
+    {
+        std::string fileName = changedFile.substr(changedFile.find_last_of('/') + 1);
+        std::vector<char>* shaderCode = fileName == VERTEX_SHADER_FILE   ? &vertexShaderCode :
+                                        fileName == FRAGMENT_SHADER_FILE ? &fragmentShaderCode : nullptr;
+        if (!shaderCode)
+        {
+            continue;
+        }
+
+        // Same variant loadShaders picked, so the layout still matches
+        std::vector<std::string> definitions;
+        if (shaderCode == &fragmentShaderCode && !_fragmentStoresAndAtomicsEnabled)
+        {
+            definitions.push_back("VIRTUAL_TEXTURE_FEEDBACK=0");
+        }
+
+        std::string errors;
+        if (!compileGlslToSpirv(changedFile, definitions, shaderCode, &errors))
+        {
+            printf("Shader reload failed, %s didn't compile:\n%s\n", fileName.c_str(), errors.c_str());
+            return;
+        }
+    }
+
+    // Layouts, descriptor sets and vertex buffers stay as they are, so the new shaders must still fit them
+    VkShaderModule vertexShaderModule   = VK_NULL_HANDLE;
+    VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+    try
+    {
+        ShaderReflection reflection = mergeShaderReflections({ reflectShader(vertexShaderCode), reflectShader(fragmentShaderCode) });
+        if (!reflection.hasSameLayout(_shaderReflection))
+        {
+            printf("Shader reload skipped, descriptor/push constant/vertex layout changed (restart needed)\n");
+            return;
+        }
+
+        vertexShaderModule   = createShaderModule(vertexShaderCode);
+        fragmentShaderModule = createShaderModule(fragmentShaderCode);
+    }
+    catch (const std::runtime_error &e)
+    {
+        printf("Shader reload failed: %s\n", e.what());
+        if (vertexShaderModule != VK_NULL_HANDLE)
+        {
+            vkDestroyShaderModule(_mainDevice.logicalDevice, vertexShaderModule, nullptr);
+        }
+        return;
+    }
+
+    // Library takes the modules either way, and destroys them if the pipelines fail to build
+    if (!_pipelineLibrary.reloadShaders(vertexShaderModule, fragmentShaderModule))
     {
-        throw std::runtime_error("Failed to create Pipeline Layout!");
+        printf("Shader reload failed, Graphics Pipeline couldn't be created\n");
+        return;
     }
 
+    _vertexShaderFile   = std::move(vertexShaderCode);
+    _fragmentShaderFile = std::move(fragmentShaderCode);
+    _vertexShaderCode   = _vertexShaderFile;
+    _fragmentShaderCode = _fragmentShaderFile;
 
-    // -- DEPTH STENCIL TESTING --
-    VkPipelineDepthStencilStateCreateInfo depthStencilCI = {};
-    depthStencilCI.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencilCI.depthTestEnable       = VK_TRUE;                // Enable checking depth to determine fragment write
-    depthStencilCI.depthWriteEnable      = VK_TRUE;           // Enable writing to depth buffer (to replace old values)
-    depthStencilCI.depthCompareOp        = VK_COMPARE_OP_LESS;// Comparison operation that allows an overwrite (is in front)
-    depthStencilCI.depthBoundsTestEnable = VK_FALSE;        // Depth Bounds Test: Does the depth value exist between two bounds
-    depthStencilCI.stencilTestEnable     = VK_FALSE;            // Enable Stencil Test
+    // Keep the .spv files in step with the sources, so the next start uses the new shaders too
+    std::ofstream(getShaderDirectory() + VERTEX_SHADER_FILE + ".spv", std::ios::binary).write(_vertexShaderCode.data(), _vertexShaderCode.size());
+    std::ofstream(getShaderDirectory() + getFragmentShaderBinary(), std::ios::binary).write(_fragmentShaderCode.data(), _fragmentShaderCode.size());
+
+    double reloadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reloadStart).count();
+    printf("Shaders reloaded in %.1f ms\n", reloadMs);
+}
+
+void VulkanRenderer::createGraphicsPipeline()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createGraphicsPipeline");
+
+    // -- PIPELINE LAYOUT
+    // One set layout per set the shaders use, shared with any other pipeline using the same layout
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+    for (uint32_t set = 0; set < _shaderReflection.getSetCount(); set++)
+    {
+        descriptorSetLayouts.push_back(_layoutCache.getDescriptorSetLayout(_shaderReflection.getSetLayoutBindings(set)));
+    }
+    _pipelineLayout = _layoutCache.getPipelineLayout(descriptorSetLayouts, { _pushConstantRange });
+
+    // -- VERTEX INPUT --
+    // Attributes come from the vertex shader inputs, they must line up with the Vertex struct in the vertex buffers
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes = _shaderReflection.getVertexAttributes(0);
+    if (_shaderReflection.getVertexStride() != sizeof(Vertex))
+    {
+        throw std::runtime_error("Vertex shader inputs don't match the Vertex struct!");
+    }
 
     // -- GRAPHICS PIPELINE CREATION --
-    VkGraphicsPipelineCreateInfo pipelineCI = {};
-    pipelineCI.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCI.layout              = _pipelineLayout;      // Pipeline Layout pipeline should use
-    pipelineCI.pStages             = shaderStages;          // List of shader stages
-    pipelineCI.stageCount          = 2;                     // Number of shader stages
-    pipelineCI.pVertexInputState   = &vertexInputCI;        // All the fixed function pipeline states
-    pipelineCI.pViewportState      = &viewportStateCI;
-    pipelineCI.pDynamicState       = nullptr;
-    pipelineCI.pRasterizationState = &rasterizerCI;
-    pipelineCI.pMultisampleState   = &multisamplingCI;
-    pipelineCI.pColorBlendState    = &colourBlendingCI;
-    pipelineCI.pDepthStencilState  = &depthStencilCI;
-    pipelineCI.renderPass          = _renderPass;          // Render pass description the pipeline is compatible with
-    pipelineCI.subpass             = 0;                    // Subpass of render pass to use with pipeline
-    pipelineCI.pInputAssemblyState = &inputAssemblyCI;
-    // Pipeline Derivatives : Can create multiple pipelines that derive from one another for optimisation
-    pipelineCI.basePipelineHandle  = VK_NULL_HANDLE;       // Existing pipeline to derive from...
-    pipelineCI.basePipelineIndex   = -1;                     // or index of pipeline being created to derive from (in case creating multiple at once)
-
-    result = vkCreateGraphicsPipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCI, nullptr, &_graphicsPipeline);
-    if (result != VK_SUCCESS)
+    // Default state is compiled now as the fallback, other variants compile in the background when first requested.
+    // Time it to compare a cold pipeline cache (compile from SPIR-V) against a warm one loaded from disk
+    auto pipelineStart = std::chrono::steady_clock::now();
+    _pipelineLibrary.init(_mainDevice.logicalDevice,
+                          _pipelineCache.getPipelineCache(),
+                          _renderPass,
+                          _pipelineLayout,
+                          _swapChainExtent,
+                          _vertexShaderModule,
+                          _fragmentShaderModule,
+                          vertexAttributes,
+                          sizeof(Vertex),
+                          PipelineStateDesc(),
+                          std::max(std::thread::hardware_concurrency() / 4, 1u));
+    double pipelineMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+    printf("Graphics Pipeline created in %.3f ms (%s pipeline cache)\n", pipelineMs, _pipelineCache.isWarm() ? "warm" : "cold");
+
+    // Queue every blend/cull/depth permutation, so they are compiled before anything asks for them
+    const VkBool32        blendModes[] = { VK_TRUE, VK_FALSE };
+    const VkCullModeFlags cullModes[]  = { VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_NONE };
+    const VkBool32        depthModes[][2] = { { VK_TRUE, VK_TRUE }, { VK_TRUE, VK_FALSE }, { VK_FALSE, VK_FALSE } };   // { test, write }
+    for (VkBool32 blendMode : blendModes)
+    {
+        for (VkCullModeFlags cullMode : cullModes)
+        {
+            for (const auto& depthMode : depthModes)
+            {
+                PipelineStateDesc desc;
+                desc.blendEnable      = blendMode;
+                desc.cullMode         = cullMode;
+                desc.depthTestEnable  = depthMode[0];
+                desc.depthWriteEnable = depthMode[1];
+                _pipelineLibrary.request(desc);
+            }
+        }
+    }
+
+    // Fallback can't read packed vertices, so their default variants are queued up front too
+    for (VertexFormat vertexFormat : { VERTEX_FORMAT_PACKED, VERTEX_FORMAT_PACKED_HALF_TEX })
     {
-        throw std::runtime_error("Failed to create a Graphics Pipeline!");
+        PipelineStateDesc desc;
+        desc.vertexFormat = vertexFormat;
+        _pipelineLibrary.request(desc);
+    }
+}
+
+void VulkanRenderer::createOffscreenTargets()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createOffscreenTargets");
+
+    // Stand in for the swapchain when headless: one colour image per frame in flight, in a format a
+    // swapchain would typically use, so the render pass and pipelines are the same as when presenting
+    _swapChainImageFormat = chooseSupportedFormat({ VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM },
+                                                  VK_IMAGE_TILING_OPTIMAL,
+                                                  VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+
+    for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+    {
+        VkDeviceMemory imageMemory;
+        SwapchainImage offscreenImage = {};
+        offscreenImage.vkImage        = createVkImage(_swapChainExtent.width,
+                                                      _swapChainExtent.height,
+                                                      _swapChainImageFormat,
+                                                      VK_IMAGE_TILING_OPTIMAL,
+                                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                      &imageMemory,
+                                                      MEMORY_CATEGORY_ATTACHMENT);
+        offscreenImage.vkImageView    = createVkImageView(offscreenImage.vkImage, _swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+        _swapChainImages.push_back(offscreenImage);
+        _offscreenImageMemory.push_back(imageMemory);
     }
-    
-    // Destroy Shader Modules, no longer needed after Pipeline created
-    vkDestroyShaderModule(_mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-    vkDestroyShaderModule(_mainDevice.logicalDevice, vertexShaderModule, nullptr);
 }
 
 void VulkanRenderer::createRenderPass()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createRenderPass");
+
     // ATTACHMENTS
     // Colour attachment of render pass
     VkAttachmentDescription vkColourAttachmentDescription = {};
@@ -666,7 +842,8 @@ void VulkanRenderer::createRenderPass()
     // Framebuffer data will be stored as an image, but images can be given different data layouts
     // to give optimal use for certain operations
     vkColourAttachmentDescription.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;     // Image data layout before render pass starts
-    vkColourAttachmentDescription.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Image data layout after render pass (to change to)
+    vkColourAttachmentDescription.finalLayout    = _headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL    // Offscreen images are only ever copied from
+                                                             : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Image data layout after render pass (to change to)
     
     // Depth Attachment
     VkAttachmentDescription depthAttachment = {};
@@ -747,6 +924,8 @@ void VulkanRenderer::createRenderPass()
 
 void VulkanRenderer::createDepthBufferImage()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createDepthBufferImage");
+
     // Get supported format for depth buffer
     VkFormat depthFormat = chooseSupportedFormat(
         { VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
@@ -755,7 +934,7 @@ void VulkanRenderer::createDepthBufferImage()
 
     // Create Depth Buffer Image
     _depthBufferVkImage = createVkImage(_swapChainExtent.width, _swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_depthBufferImageVkDeviceMemory);
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &_depthBufferImageVkDeviceMemory, MEMORY_CATEGORY_ATTACHMENT);
 
     // Create Depth Buffer Image View
     _depthBufferVkImageView = createVkImageView(_depthBufferVkImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
@@ -784,7 +963,7 @@ VkFormat VulkanRenderer::chooseSupportedFormat(const std::vector<VkFormat>& form
     throw std::runtime_error("Failed to find a matching format!");
 }
 
-VkImage VulkanRenderer::createVkImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageVkDeviceMemory)
+VkImage VulkanRenderer::createVkImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageVkDeviceMemory, MemoryCategory memoryCategory)
 {
     // CREATE IMAGE
     // Image Creation Info
@@ -823,7 +1002,7 @@ VkImage VulkanRenderer::createVkImage(uint32_t width, uint32_t height, VkFormat
     memoryAllocInfo.allocationSize       = memoryRequirements.size;
     memoryAllocInfo.memoryTypeIndex      = findMemoryTypeIndex(_mainDevice.physicalDevice, memoryRequirements.memoryTypeBits, propFlags);
 
-    result = vkAllocateMemory(_mainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageVkDeviceMemory);
+    result = MemoryTracker::allocateMemory(_mainDevice.logicalDevice, &memoryAllocInfo, memoryCategory, imageVkDeviceMemory);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to allocate memory for image!");
@@ -837,6 +1016,8 @@ VkImage VulkanRenderer::createVkImage(uint32_t width, uint32_t height, VkFormat
 
 void VulkanRenderer::createTextureSampler()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createTextureSampler");
+
     // Sampler Creation Info
     VkSamplerCreateInfo samplerCreateInfo = {};
     samplerCreateInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -850,7 +1031,7 @@ void VulkanRenderer::createTextureSampler()
     samplerCreateInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;       // Mipmap interpolation mode
     samplerCreateInfo.mipLodBias              = 0.0f;            // Level of Details bias for mip level
     samplerCreateInfo.minLod                  = 0.0f;            // Minimum Level of Detail to pick mip level
-    samplerCreateInfo.maxLod                  = 0.0f;            // Maximum Level of Detail to pick mip level
+    samplerCreateInfo.maxLod                  = VK_LOD_CLAMP_NONE;   // Maximum Level of Detail to pick mip level, streamed textures have mips
     samplerCreateInfo.anisotropyEnable        = VK_TRUE;         // Enable Anisotropy
     samplerCreateInfo.maxAnisotropy           = 16;              // Anisotropy sample level
 
@@ -868,13 +1049,19 @@ int VulkanRenderer::createTextureDescriptor(VkImageView textureImage)
     // Descriptor Set Allocation Info
     VkDescriptorSetAllocateInfo setAllocInfo = {};
     setAllocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    setAllocInfo.descriptorPool              = _samplerDescriptorPool;
+    setAllocInfo.descriptorPool              = _samplerDescriptorPools.back();
     setAllocInfo.descriptorSetCount          = 1;
     setAllocInfo.pSetLayouts                 = &_vkSamplerDescriptorSetLayout;
 
-    // Allocate Descriptor Sets
+    // Allocate Descriptor Sets, from a new pool if the current one is full
     VkResult result = vkAllocateDescriptorSets(_mainDevice.logicalDevice, &setAllocInfo, &descriptorSet);
     if (result != VK_SUCCESS)
+    {
+        createSamplerDescriptorPool();
+        setAllocInfo.descriptorPool = _samplerDescriptorPools.back();
+        result = vkAllocateDescriptorSets(_mainDevice.logicalDevice, &setAllocInfo, &descriptorSet);
+    }
+    if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to allocate Texture Descriptor Sets!");
     }
@@ -900,6 +1087,7 @@ int VulkanRenderer::createTextureDescriptor(VkImageView textureImage)
 
     // Add descriptor set to list
     _vkSamplerDescriptorSets.push_back(descriptorSet);
+    _textureStreamIds.push_back(-1);
 
     // Return descriptor set location
     return _vkSamplerDescriptorSets.size() - 1;
@@ -907,6 +1095,8 @@ int VulkanRenderer::createTextureDescriptor(VkImageView textureImage)
 
 void VulkanRenderer::createFramebuffers()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createFramebuffers");
+
     // Resize framebuffer count to equal swap chain image count
     _swapChainFramebuffers.resize(_swapChainImages.size());
 
@@ -941,6 +1131,8 @@ void VulkanRenderer::allocateDynamicBufferTransferSpace()
 
 void VulkanRenderer::createDescriptorPool()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createDescriptorPool");
+
     // CREATE UNIFORM DESCRIPTOR POOL
     // Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
     // ViewProjection Pool
@@ -967,82 +1159,64 @@ void VulkanRenderer::createDescriptorPool()
     }
     
     // CREATE SAMPLER DESCRIPTOR POOL
-    // Texture sampler pool
+    createSamplerDescriptorPool();
+}
+
+void VulkanRenderer::createSamplerDescriptorPool()
+{
+    // Texture sampler pool, one set per texture. More pools are added as textures are created
     VkDescriptorPoolSize samplerPoolSize     = {};
     samplerPoolSize.type                     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSize.descriptorCount          = MAX_OBJECTS;
+    samplerPoolSize.descriptorCount          = SAMPLER_DESCRIPTORS_PER_POOL;
 
     VkDescriptorPoolCreateInfo samplerPoolCI = {};
     samplerPoolCI.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    samplerPoolCI.maxSets                    = MAX_OBJECTS;
+    samplerPoolCI.maxSets                    = SAMPLER_DESCRIPTORS_PER_POOL;
     samplerPoolCI.poolSizeCount              = 1;
     samplerPoolCI.pPoolSizes                 = &samplerPoolSize;
 
-    result = vkCreateDescriptorPool(_mainDevice.logicalDevice, &samplerPoolCI, nullptr, &_samplerDescriptorPool);
+    VkDescriptorPool samplerDescriptorPool;
+    VkResult result = vkCreateDescriptorPool(_mainDevice.logicalDevice, &samplerPoolCI, nullptr, &samplerDescriptorPool);
     if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a Descriptor Pool!");
     }
+    _samplerDescriptorPools.push_back(samplerDescriptorPool);
 }
 
 void VulkanRenderer::createPushConstantRange()
 {
-    _pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    _pushConstantRange.offset     = 0;
-    _pushConstantRange.size       = sizeof(Model);
+    CPU_PROFILE_SCOPE("VulkanRenderer::createPushConstantRange");
+
+    // Push constant block in the shaders holds the Model, check they haven't drifted apart
+    _pushConstantRange = _shaderReflection.pushConstantRange;
+    if (_pushConstantRange.size != sizeof(Model))
+    {
+        throw std::runtime_error("Shader push constant block doesn't match the Model struct!");
+    }
 }
 
 void VulkanRenderer::createDescriptorSetLayout()
 {
-    // UNIFORM VALUES DESCRIPTOR SET LAYOUT
-    // MVP Binding Info
-    VkDescriptorSetLayoutBinding vpLayoutBinding    = {};
-    vpLayoutBinding.binding                         = 0; // Binding point in shader (designated by binding number in shader)
-    vpLayoutBinding.descriptorType                  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor (uniform, dynamic uniform, image sampler, etc)
-    vpLayoutBinding.descriptorCount                 = 1;                                 // Number of descriptors for binding
-    vpLayoutBinding.stageFlags                      = VK_SHADER_STAGE_VERTEX_BIT;        // Shader stage to bind to
-    vpLayoutBinding.pImmutableSamplers              = nullptr;                           // For Texture: Can make sampler data unchangeable (immutable) by specifying in layout
-    
-    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {vpLayoutBinding};
+    CPU_PROFILE_SCOPE("VulkanRenderer::createDescriptorSetLayout");
 
-    // Create Descriptor Set Layout with given bindings
-    VkDescriptorSetLayoutCreateInfo layoutCI        = {};
-    layoutCI.sType                                  = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutCI.bindingCount                           = static_cast<uint32_t>(layoutBindings.size()); // Num of binding infos
-    layoutCI.pBindings                              = layoutBindings.data();                     // Array of binding infos
+    // UNIFORM VALUES DESCRIPTOR SET LAYOUT (set 0: view projection)
+    _vkDescriptorSetLayout        = _layoutCache.getDescriptorSetLayout(_shaderReflection.getSetLayoutBindings(0));
 
-    // Create Descriptor Set Layout
-    VkResult result = vkCreateDescriptorSetLayout(_mainDevice.logicalDevice, &layoutCI, nullptr, &_vkDescriptorSetLayout);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create a Descriptor Set Layout!");
-    }
-    
-    // CREATE TEXTURE SAMPLER DESCRIPTOR SET LAYOUT
-    // Texture binding info
-    VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-    samplerLayoutBinding.binding                      = 0;
-    samplerLayoutBinding.descriptorType               = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.descriptorCount              = 1;
-    samplerLayoutBinding.stageFlags                   = VK_SHADER_STAGE_FRAGMENT_BIT;
-    samplerLayoutBinding.pImmutableSamplers           = nullptr;
-
-    // Create a Descriptor Set Layout with given bindings for texture
-    VkDescriptorSetLayoutCreateInfo textureLayoutCreateInfo = {};
-    textureLayoutCreateInfo.sType                           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    textureLayoutCreateInfo.bindingCount                    = 1;
-    textureLayoutCreateInfo.pBindings                       = &samplerLayoutBinding;
-
-    // Create Descriptor Set Layout
-    result = vkCreateDescriptorSetLayout(_mainDevice.logicalDevice, &textureLayoutCreateInfo, nullptr, &_vkSamplerDescriptorSetLayout);
-    if (result != VK_SUCCESS)
+    // TEXTURE SAMPLER DESCRIPTOR SET LAYOUT (set 1: texture)
+    _vkSamplerDescriptorSetLayout = _layoutCache.getDescriptorSetLayout(_shaderReflection.getSetLayoutBindings(1));
+
+    // VIRTUAL TEXTURE DESCRIPTOR SET LAYOUT (set 2: page table, page cache, feedback), missing from shaders built before it
+    if (_shaderReflection.getSetCount() > 2)
     {
-        throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+        _vkVirtualTextureDescriptorSetLayout = _layoutCache.getDescriptorSetLayout(_shaderReflection.getSetLayoutBindings(2));
     }
 }
 
 void VulkanRenderer::createDescriptorSets()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createDescriptorSets");
+
     // Resize Descriptor Set list so one for every buffer
     _vkDescriptorSets.resize(_swapChainImages.size());
 
@@ -1093,6 +1267,8 @@ void VulkanRenderer::createDescriptorSets()
 
 void VulkanRenderer::createUniformBuffers()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createUniformBuffers");
+
     VkDeviceSize vpBufferSize = sizeof(UboViewProjection);
 
     // One uniform buffer for each image (and by extension, command buffer)
@@ -1103,12 +1279,15 @@ void VulkanRenderer::createUniformBuffers()
     for (size_t i = 0; i < _swapChainImages.size(); i++)
     {
         createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, vpBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_vpUniformBuffer[i], &_vpUniformBufferMemory[i]);
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &_vpUniformBuffer[i], &_vpUniformBufferMemory[i],
+                     MEMORY_CATEGORY_UNIFORM);
     }
 }
 
 void VulkanRenderer::createCommandPool()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createCommandPool");
+
     // Get indices of queue families from device
     QueueFamilyIndices queueFamilyIndices = getQueueFamilies(_mainDevice.physicalDevice);
 
@@ -1127,6 +1306,8 @@ void VulkanRenderer::createCommandPool()
 
 void VulkanRenderer::createCommandBuffers()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createCommandBuffers");
+
     // Resize command buffer count to have one for each framebuffer
     _commandBuffers.resize(_swapChainFramebuffers.size());
 
@@ -1143,10 +1324,42 @@ void VulkanRenderer::createCommandBuffers()
         throw std::runtime_error("Failed to allocate Command Buffers!");
     }
 }
+
+void VulkanRenderer::createThreadCommandPools()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createThreadCommandPools");
+
+    QueueFamilyIndices queueFamilyIndices = getQueueFamilies(_mainDevice.physicalDevice);
+
+    // Pools are reset as a whole at the start of each frame, so no per buffer reset flag
+    VkCommandPoolCreateInfo poolCI = {};
+    poolCI.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCI.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolCI.queueFamilyIndex        = queueFamilyIndices.graphicsFamily;
+
+    // One pool per job thread for every frame in flight, reset once that frame's fence says its buffers are done
+    _threadCommandPools.resize(MAX_FRAME_DRAWS);
+    for (auto& frameCommandPools : _threadCommandPools)
+    {
+        frameCommandPools.resize(_jobSystem.getThreadCount());
+        for (ThreadCommandPool& threadCommandPool : frameCommandPools)
+        {
+            threadCommandPool.commandBuffersUsed = 0;
+
+            VkResult result = vkCreateCommandPool(_mainDevice.logicalDevice, &poolCI, nullptr, &threadCommandPool.commandPool);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create a thread Command Pool!");
+            }
+        }
+    }
+}
 //
 // Must be per imageIndex. Can not update all of them at the same time because one of them may be being read in the command buffer.
 void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex)
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::updateUniformBuffers");
+
     void * data;
     vkMapMemory(_mainDevice.logicalDevice, _vpUniformBufferMemory[imageIndex], 0, sizeof(UboViewProjection), 0, &data);
     memcpy(data, &_uboViewProjection, sizeof(UboViewProjection));
@@ -1155,6 +1368,8 @@ void VulkanRenderer::updateUniformBuffers(uint32_t imageIndex)
 
 void VulkanRenderer::recordCommands(uint32_t currentImage)
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::recordCommands");
+
     // Information about how to begin each command buffer
     VkCommandBufferBeginInfo vkCommandBufferBI = {};
     vkCommandBufferBI.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1182,31 +1397,34 @@ void VulkanRenderer::recordCommands(uint32_t currentImage)
         throw std::runtime_error("Failed to start recording a Command Buffer!");
     }
 
-    vkCmdBeginRenderPass(_commandBuffers[currentImage], &vkRenderPassBI, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
-    for (size_t j = 0; j < _meshList.size(); j++)
+    // Timestamps can't be written inside a render pass whose contents are secondary command buffers, so scopes go around it
+    _gpuProfiler.beginFrame(_commandBuffers[currentImage], _currentFrame, _frameNumber);
+    _gpuProfiler.beginScope(_commandBuffers[currentImage], "Frame");
+
+    // Pages the virtual texture loaded this frame go into the cache before anything samples it
+    if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
     {
-        VkBuffer vertexBuffers[] = { _meshList[j].getVertexBuffer() };                // Buffers to bind
-        VkDeviceSize offsets[] = { 0 };                                               // Offsets into buffers being bound
-        vkCmdBindVertexBuffers(_commandBuffers[currentImage], 0, 1, vertexBuffers, offsets);    // Command to bind vertex buffer before drawing with them
+        _virtualTexture.recordUploads(_commandBuffers[currentImage], _currentFrame);
+    }
 
-        // Bind mesh index buffer, with 0 offset and using the uint32 type
-        vkCmdBindIndexBuffer(_commandBuffers[currentImage], _meshList[j].getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-        
-        Model temp =_meshList[j].getModel();
-        
-        vkCmdPushConstants(_commandBuffers[currentImage], _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model), &temp);
-        
-        std::array<VkDescriptorSet, 2> descriptorSetGroup = { _vkDescriptorSets[currentImage],
-            _vkSamplerDescriptorSets[_meshList[j].getTexId()] };
-        
-        // Bind Descriptor Sets
-        vkCmdBindDescriptorSets(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0,static_cast<uint32_t>(descriptorSetGroup.size()) , descriptorSetGroup.data(), 0, nullptr);
+    _gpuProfiler.beginScope(_commandBuffers[currentImage], "Main render pass");
+    _pipelineStatistics.begin(_commandBuffers[currentImage], _currentFrame, _frameNumber);
 
-        // Execute pipeline
-        vkCmdDrawIndexed(_commandBuffers[currentImage], _meshList[j].getIndexCount(), 1, 0, 0, 0);
+    // Draws were recorded into secondary command buffers by the frame jobs, primary buffer just runs them
+    vkCmdBeginRenderPass(_commandBuffers[currentImage], &vkRenderPassBI, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    if (!_drawChunkCommandBuffers.empty())
+    {
+        vkCmdExecuteCommands(_commandBuffers[currentImage], static_cast<uint32_t>(_drawChunkCommandBuffers.size()), _drawChunkCommandBuffers.data());
     }
     vkCmdEndRenderPass(_commandBuffers[currentImage]);
+    if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        _virtualTexture.recordFeedbackBarrier(_commandBuffers[currentImage]);
+    }
+
+    _pipelineStatistics.end(_commandBuffers[currentImage]);
+    _gpuProfiler.endScope(_commandBuffers[currentImage]);
+    _gpuProfiler.endScope(_commandBuffers[currentImage]);
 
     // Stop recording to command buffer
     result = vkEndCommandBuffer(_commandBuffers[currentImage]);
@@ -1218,6 +1436,8 @@ void VulkanRenderer::recordCommands(uint32_t currentImage)
 //
 void VulkanRenderer::createSynchronization()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createSynchronization");
+
     _imageAvailableVkSemaphores.resize(MAX_FRAME_DRAWS);
     _renderFinishedVkSemaphores.resize(MAX_FRAME_DRAWS);
     _drawVkFences              .resize(MAX_FRAME_DRAWS);
@@ -1245,106 +1465,874 @@ void VulkanRenderer::createSynchronization()
 
 void VulkanRenderer::updateModel(int modelId, glm::mat4 newModel)
 {
-    if (modelId >= _meshList.size()) return;
+    if (modelId >= _renderNodes.size()) return;
 
-    _meshList[modelId].setModel(newModel);
+    _sceneGraph.setLocalTransform(_renderNodes[modelId], newModel);
 }
 
-void VulkanRenderer::draw()
+int VulkanRenderer::addSceneNode(int parentNode, glm::mat4 localTransform, int meshId)
 {
-    // -- GET NEXT IMAGE --
-    // Wait for given fence to signal (open) from last draw before continuing
-    vkWaitForFences(_mainDevice.logicalDevice, 1, &_drawVkFences[_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-    // Manually reset (close) fences
-    vkResetFences(_mainDevice.logicalDevice, 1, &_drawVkFences[_currentFrame]);
-
-    // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(_mainDevice.logicalDevice, _swapchain, std::numeric_limits<uint64_t>::max(), _imageAvailableVkSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
-    
-    recordCommands(imageIndex);
-    updateUniformBuffers(imageIndex); // update _uniformBufferMemory[imageIndex] with new rotation angle
-    
-    // -- SUBMIT COMMAND BUFFER TO RENDER --
-    // Queue submission information
-    VkSubmitInfo submitInfo           = {};
-    submitInfo.sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount     = 1;                                             // Number of semaphores to wait on
-    submitInfo.pWaitSemaphores        = &_imageAvailableVkSemaphores[_currentFrame];   // List of semaphores to wait on
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}; // Can't do this stage until .pWaitSemaphores are open.
-    submitInfo.pWaitDstStageMask      = waitStages;                                    // Stages to check semaphores at
-    submitInfo.commandBufferCount     = 1;                                             // Number of command buffers to submit
-    submitInfo.pCommandBuffers        = &_commandBuffers[imageIndex];                  // Command buffer to submit
-    submitInfo.signalSemaphoreCount   = 1;                                             // Number of semaphores to signal
-    submitInfo.pSignalSemaphores      = &_renderFinishedVkSemaphores[_currentFrame];   // Semaphores to signal command buffer finished
-
-    // Submit command buffer to queue, signal fence when finished.
-    VkResult result = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _drawVkFences[_currentFrame]);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to submit Command Buffer to Queue!");
-    }
+    int nodeId = _sceneGraph.addNode(parentNode, localTransform, meshId);
 
-    // -- PRESENT RENDERED IMAGE TO SCREEN --
-    VkPresentInfoKHR presentInfo   = {};
-    presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;                                        // Number of semaphores to wait on
-    presentInfo.pWaitSemaphores    = &_renderFinishedVkSemaphores[_currentFrame];          // Semaphores to wait on
-    presentInfo.swapchainCount     = 1;                                        // Number of swapchains to present to
-    presentInfo.pSwapchains        = &_swapchain;                              // Swapchains to present images to
-    presentInfo.pImageIndices      = &imageIndex;                              // Index of images in swapchains to present
-
-    // Present image
-    result = vkQueuePresentKHR(_presentationQueue, &presentInfo);
-    if (result != VK_SUCCESS)
+    // Nodes with a mesh get drawn, and can be moved with updateModel
+    if (meshId >= 0)
     {
-        throw std::runtime_error("Failed to present Image!");
+        _renderNodes.push_back(nodeId);
     }
 
-    // Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
-    _currentFrame = (_currentFrame + 1) % MAX_FRAME_DRAWS;
+    return nodeId;
 }
 
-stbi_uc* VulkanRenderer::loadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize)
+int VulkanRenderer::addMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, int textureId)
 {
-    // Number of channels image uses
-    int channels;
+    return addMesh(Mesh(_mainDevice.physicalDevice,
+                        _mainDevice.logicalDevice,
+                        _graphicsQueue,
+                        _graphicsCommandPool,
+                        vertices, indices,
+                        textureId));
+}
 
-    // Load pixel data for image
-    std::string fileLoc = "/Users/flo/LocalDocuments/Projects/VulkanLearning/Cook/Cook/Textures/" + fileName;
-    stbi_uc* image      = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
+int VulkanRenderer::addMeshFromFile(const std::string& filePath, int textureId)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::addMeshFromFile");
 
-    if (!image)
+    // Vertices and indices are copied from the mapping into the staging buffers, then the file is unmapped
+    MeshFile meshFile;
+    if (!meshFile.open(filePath))
     {
-        throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+        throw std::runtime_error("Failed to load a Mesh file! (" + filePath + ")");
     }
 
-    // Calculate image size using given and known data
-    *imageSize = *width * *height * 4;
+    BufferUploadBatch uploadBatch;
+    uploadBatch.init(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool);
 
-    return image;
+    // Every level of detail is uploaded, the draw picks one by distance
+    int meshId = addMesh(Mesh(_mainDevice.physicalDevice,
+                              _mainDevice.logicalDevice,
+                              &uploadBatch,
+                              meshFile.getVertices(), meshFile.getIndices(),
+                              meshFile.getBoundingCentre(), meshFile.getBoundingRadius(),
+                              textureId, meshFile.getLods(), meshFile.getVertices().size() >= PACKED_VERTEX_MIN_VERTICES));
+    uploadBatch.submit();
+    return meshId;
 }
 
-bool VulkanRenderer::checkInstanceExtensionSupport(std::vector<const char*>* checkExtensions)
+int VulkanRenderer::loadGltfScene(const std::string& filePath, int parentNode)
 {
-    // Need to get number of extensions to create array of correct size to hold extensions
-    uint32_t extensionCount = 0;
-    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    CPU_PROFILE_SCOPE("VulkanRenderer::loadGltfScene");
 
-    // Create a list of VkExtensionProperties using count
-    std::vector<VkExtensionProperties> extensions(extensionCount);
-    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+    // Buffers stay mapped until the scene goes, vertices and indices are copied once, into staging memory
+    GltfScene scene;
+    if (!importGltf(filePath, &_jobSystem, &scene))
+    {
+        throw std::runtime_error("Failed to load a glTF file! (" + filePath + ")");
+    }
+    printf("Imported %s, vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", filePath.c_str(), scene.cacheBefore.getAcmr(),
+           scene.cacheAfter.getAcmr(), scene.cacheBefore.getAtvr(), scene.cacheAfter.getAtvr());
 
-    // Check if given extensions are in list of available extensions
-    for (const auto &checkExtension : *checkExtensions)
+    // Every image the materials use is read and decoded in one batch, embedded ones straight from the buffers
+    std::vector<int> imageTextureIds(scene.images.size(), -1);
+    std::vector<TextureSource> sources;
+    std::vector<size_t>        sourceImages;
+    for (const GltfMaterial& material : scene.materials)
     {
-        bool hasExtension = false;
-        for (const auto &extension : extensions)
+        if (material.baseColourImage >= 0 && imageTextureIds[material.baseColourImage] == -1)
         {
-        // TODO strncmp
-            if (strcmp(checkExtension, extension.extensionName))
-            {
-                hasExtension = true;
+            const GltfImage& image = scene.images[material.baseColourImage];
+            sources.push_back({ image.data, "", image.filePath });
+            sourceImages.push_back(material.baseColourImage);
+            imageTextureIds[material.baseColourImage] = -2;     // Queued
+        }
+    }
+    loadTextureFiles(sources, [this, &imageTextureIds, &sourceImages](size_t index, stbi_uc* imageData, int width, int height)
+    {
+        int streamId = _textureStreamer.addTexture(imageData, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        _vkSamplerDescriptorSets.push_back(_textureStreamer.getDescriptorSet(streamId));
+        _textureStreamIds.push_back(streamId);
+        imageTextureIds[sourceImages[index]] = static_cast<int>(_vkSamplerDescriptorSets.size()) - 1;
+    });
+
+    // Untextured materials sample white, their colour is in the vertices
+    if (_whiteTextureId < 0)
+    {
+        _whiteTextureId = createTextureFromPixels(1, 1, { 255, 255, 255, 255 });
+    }
+
+    // One staging buffer and one submit for many meshes, flushed whenever it grows past the limit
+    BufferUploadBatch uploadBatch;
+    uploadBatch.init(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool);
+
+    // Materials are only honoured by shaders declaring the constants, a stale binary would silently ignore them
+    bool materialFeatures = _shaderReflection.hasSpecializationConstant(SHADER_FEATURE_VERTEX_COLOUR)
+                            && _shaderReflection.hasSpecializationConstant(SHADER_FEATURE_ALPHA_TEST);
+    if (!materialFeatures)
+    {
+        printf("Fragment shader has no vertex colour/alpha test constants, glTF materials are ignored (run compile.sh)\n");
+    }
+
+    std::vector<int> meshIds(scene.primitives.size(), -1);
+    for (size_t i = 0; i < scene.primitives.size(); i++)
+    {
+        const GltfPrimitive& primitive = scene.primitives[i];
+        if (primitive.indices.empty())
+        {
+            continue;
+        }
+
+        const GltfMaterial* material  = primitive.material >= 0 ? &scene.materials[primitive.material] : nullptr;
+        int                 textureId = material && material->baseColourImage >= 0 ? imageTextureIds[material->baseColourImage] : _whiteTextureId;
+        meshIds[i] = addMesh(Mesh(_mainDevice.physicalDevice,
+                                  _mainDevice.logicalDevice,
+                                  &uploadBatch,
+                                  primitive.vertices, primitive.indices,
+                                  primitive.boundingCentre, primitive.boundingRadius,
+                                  textureId, primitive.lods, primitive.vertices.size() >= PACKED_VERTEX_MIN_VERTICES));
+
+        if (materialFeatures)
+        {
+            PipelineStateDesc pipelineState = _meshList[meshIds[i]].getPipelineState();
+            pipelineState.shaderFeatures[SHADER_FEATURE_VERTEX_COLOUR] = primitive.hasVertexColours ? VK_TRUE : VK_FALSE;
+            pipelineState.shaderFeatures[SHADER_FEATURE_ALPHA_TEST]    = material && material->alphaMask ? VK_TRUE : VK_FALSE;
+            setMeshPipelineState(meshIds[i], pipelineState);
+        }
+
+        if (uploadBatch.getPendingBytes() > UPLOAD_BATCH_MAX_BYTES)
+        {
+            uploadBatch.submit();
+        }
+    }
+    uploadBatch.submit();
+
+    // Whole scene hangs off one node, so it can be moved as one
+    int sceneNode = addSceneNode(parentNode, glm::mat4(1.0f));
+    std::vector<bool> visited(scene.nodes.size(), false);
+    for (int rootNode : scene.rootNodes)
+    {
+        addGltfNode(scene, rootNode, sceneNode, meshIds, &visited);
+    }
+    return sceneNode;
+}
+
+void VulkanRenderer::addGltfNode(const GltfScene& scene, int gltfNode, int parentNode, const std::vector<int>& meshIds,
+                                 std::vector<bool>* visited)
+{
+    // A node is only added once, a file with a cycle in it would recurse forever otherwise
+    if ((*visited)[gltfNode])
+    {
+        return;
+    }
+    (*visited)[gltfNode] = true;
+
+    const GltfNode& node   = scene.nodes[gltfNode];
+    int             nodeId = addSceneNode(parentNode, node.localTransform);
+
+    // Each primitive is drawn by its own child node, a scene node has only one mesh
+    if (node.mesh >= 0)
+    {
+        for (int primitive : scene.meshes[node.mesh])
+        {
+            if (meshIds[primitive] >= 0)
+            {
+                addSceneNode(nodeId, glm::mat4(1.0f), meshIds[primitive]);
+            }
+        }
+    }
+    for (int child : node.children)
+    {
+        addGltfNode(scene, child, nodeId, meshIds, visited);
+    }
+}
+
+int VulkanRenderer::addMesh(Mesh mesh)
+{
+    _meshList.push_back(mesh);
+
+    // Virtual texture is sampled by a pipeline variant, the texture id's own set just holds the page cache
+    int textureId = mesh.getTexId();
+    if (textureId >= 0 && textureId == _virtualTextureId)
+    {
+        PipelineStateDesc pipelineState = _meshList.back().getPipelineState();
+        pipelineState.shaderFeatures[SHADER_FEATURE_VIRTUAL_TEXTURE] = VK_TRUE;
+        _meshList.back().setPipelineState(pipelineState);
+    }
+    return static_cast<int>(_meshList.size()) - 1;
+}
+
+void VulkanRenderer::clearScene()
+{
+    // Nothing still in flight may be using the meshes or textures
+    vkDeviceWaitIdle(_mainDevice.logicalDevice);
+
+    for (Mesh& mesh : _meshList)
+    {
+        mesh.destroyBuffers();
+    }
+    _meshList.clear();
+    _meshPipelines.clear();
+
+    for (size_t i = 0; i < _vkTextureImages.size(); i++)
+    {
+        vkDestroyImageView(_mainDevice.logicalDevice, _vkTextureImageViews[i], nullptr);
+        vkDestroyImage(_mainDevice.logicalDevice, _vkTextureImages[i], nullptr);
+        MemoryTracker::freeMemory(_mainDevice.logicalDevice, _vkTextureImageDeviceMemory[i]);
+    }
+    _vkTextureImages.clear();
+    _vkTextureImageViews.clear();
+    _vkTextureImageDeviceMemory.clear();
+
+    // Texture descriptor sets all go back at once, keep just the first pool
+    for (size_t i = 1; i < _samplerDescriptorPools.size(); i++)
+    {
+        vkDestroyDescriptorPool(_mainDevice.logicalDevice, _samplerDescriptorPools[i], nullptr);
+    }
+    _samplerDescriptorPools.resize(1);
+    vkResetDescriptorPool(_mainDevice.logicalDevice, _samplerDescriptorPools[0], 0);
+    _vkSamplerDescriptorSets.clear();
+    _textureStreamer.clear();
+    _textureStreamIds.clear();
+    if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        _virtualTexture.clear();
+    }
+    _virtualTextureId = -1;
+    _whiteTextureId   = -1;
+
+    _sceneGraph.clear();
+    _renderNodes.clear();
+    _renderNodeVisible.clear();
+    _nodeLods.clear();
+    _drawList.clear();
+    _sceneRootNode = _sceneGraph.addNode(-1, glm::mat4(1.0f));
+}
+
+uint32_t VulkanRenderer::getDrawCount()
+{
+    return static_cast<uint32_t>(_drawList.size());
+}
+
+std::string VulkanRenderer::getDeviceName()
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(_mainDevice.physicalDevice, &deviceProperties);
+    return deviceProperties.deviceName;
+}
+
+VkExtent2D VulkanRenderer::getExtent()
+{
+    return _swapChainExtent;
+}
+
+FrameStatistics& VulkanRenderer::getFrameStatistics()
+{
+    return _frameStatistics;
+}
+
+JobSystem& VulkanRenderer::getJobSystem()
+{
+    return _jobSystem;
+}
+
+VirtualTexture* VulkanRenderer::getVirtualTexture()
+{
+    return _vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE ? &_virtualTexture : nullptr;
+}
+
+RendererDeviceContext VulkanRenderer::getDeviceContext()
+{
+    RendererDeviceContext context;
+    context.physicalDevice           = _mainDevice.physicalDevice;
+    context.logicalDevice            = _mainDevice.logicalDevice;
+    context.graphicsQueue            = _graphicsQueue;
+    context.graphicsQueueFamilyIndex = static_cast<uint32_t>(getQueueFamilies(_mainDevice.physicalDevice).graphicsFamily);
+    context.graphicsCommandPool      = _graphicsCommandPool;
+    context.renderPass               = _renderPass;
+    context.framebuffer              = _swapChainFramebuffers[0];
+    return context;
+}
+
+void VulkanRenderer::setMeshPipelineState(int meshId, const PipelineStateDesc& pipelineState)
+{
+    // Meshes drawn with the virtual texture keep sampling it whatever else changes
+    PipelineStateDesc meshPipelineState = pipelineState;
+    if (_meshList[meshId].getTexId() == _virtualTextureId)
+    {
+        meshPipelineState.shaderFeatures[SHADER_FEATURE_VIRTUAL_TEXTURE] = VK_TRUE;
+    }
+    _meshList[meshId].setPipelineState(meshPipelineState);
+}
+
+bool VulkanRenderer::isPipelineReady(const PipelineStateDesc& pipelineState)
+{
+    return _pipelineLibrary.isReady(pipelineState);
+}
+
+void VulkanRenderer::setDynamicShaderFeatures(glm::uvec4 shaderFeatures)
+{
+    _uboViewProjection.shaderFeatures = shaderFeatures;
+}
+
+void VulkanRenderer::updateSceneNode(int nodeId, glm::mat4 localTransform)
+{
+    _sceneGraph.setLocalTransform(nodeId, localTransform);
+}
+
+int VulkanRenderer::getSceneRoot()
+{
+    return _sceneRootNode;
+}
+
+bool VulkanRenderer::openGpuProfileCsv(const std::string& filePath)
+{
+    return _gpuProfiler.openCsvReport(filePath);
+}
+
+const std::vector<GpuScopeTiming>& VulkanRenderer::getGpuTimings()
+{
+    return _gpuProfiler.getLatestTimings();
+}
+
+const PipelineStatisticsCounters& VulkanRenderer::getPipelineStatistics()
+{
+    return _pipelineStatistics.getLatest();
+}
+
+void VulkanRenderer::draw()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::draw");
+    _frameStatistics.beginFrame();
+
+    // -- GET NEXT IMAGE --
+    // Wait for given fence to signal (open) from last draw before continuing
+    auto fenceWaitStart = std::chrono::steady_clock::now();
+    vkWaitForFences(_mainDevice.logicalDevice, 1, &_drawVkFences[_currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    _frameStatistics.record(FRAME_TIME_FENCE_WAIT, std::chrono::steady_clock::now() - fenceWaitStart);
+    // Manually reset (close) fences
+    vkResetFences(_mainDevice.logicalDevice, 1, &_drawVkFences[_currentFrame]);
+
+    // Frame boundary: refresh the memory budget, swap in reloaded shaders, and free old ones no frame in flight can still be using
+    MemoryTracker::update();
+    _pipelineLibrary.applyReload(_frameNumber);
+    if (_frameNumber >= MAX_FRAME_DRAWS)
+    {
+        _pipelineLibrary.destroyRetired(_frameNumber - MAX_FRAME_DRAWS);
+    }
+    updateTextureStreaming();
+    if (_vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        _virtualTexture.update(_currentFrame, _frameNumber);
+    }
+
+    // Get index of next image to be drawn to, and signal semaphore when ready to be drawn to
+    // Headless has one offscreen image per frame slot, which is free again now that the slot's fence has been waited on
+    uint32_t imageIndex = _currentFrame;
+    if (!_headless)
+    {
+        auto acquireStart = std::chrono::steady_clock::now();
+        vkAcquireNextImageKHR(_mainDevice.logicalDevice, _swapchain, std::numeric_limits<uint64_t>::max(), _imageAvailableVkSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+        _frameStatistics.record(FRAME_TIME_ACQUIRE, std::chrono::steady_clock::now() - acquireStart);
+    }
+    
+    // Transform update, culling, draw list build and draw recording, spread over the job threads
+    runFrameJobs(imageIndex);
+    recordCommands(imageIndex);
+    
+    // -- SUBMIT COMMAND BUFFER TO RENDER --
+    // Queue submission information
+    VkSubmitInfo submitInfo           = {};
+    submitInfo.sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount     = 1;                                             // Number of semaphores to wait on
+    submitInfo.pWaitSemaphores        = &_imageAvailableVkSemaphores[_currentFrame];   // List of semaphores to wait on
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}; // Can't do this stage until .pWaitSemaphores are open.
+    submitInfo.pWaitDstStageMask      = waitStages;                                    // Stages to check semaphores at
+    submitInfo.commandBufferCount     = 1;                                             // Number of command buffers to submit
+    submitInfo.pCommandBuffers        = &_commandBuffers[imageIndex];                  // Command buffer to submit
+    submitInfo.signalSemaphoreCount   = 1;                                             // Number of semaphores to signal
+    submitInfo.pSignalSemaphores      = &_renderFinishedVkSemaphores[_currentFrame];   // Semaphores to signal command buffer finished
+
+    // Nothing acquired or presented headless, so no semaphores either
+    if (_headless)
+    {
+        submitInfo.waitSemaphoreCount   = 0;
+        submitInfo.signalSemaphoreCount = 0;
+    }
+
+    // Submit command buffer to queue, signal fence when finished.
+    VkResult result = vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _drawVkFences[_currentFrame]);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit Command Buffer to Queue!");
+    }
+
+    // -- PRESENT RENDERED IMAGE TO SCREEN --
+    // Headless frames stay in their offscreen image
+    if (!_headless)
+    {
+        VkPresentInfoKHR presentInfo   = {};
+        presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;                                        // Number of semaphores to wait on
+        presentInfo.pWaitSemaphores    = &_renderFinishedVkSemaphores[_currentFrame];          // Semaphores to wait on
+        presentInfo.swapchainCount     = 1;                                        // Number of swapchains to present to
+        presentInfo.pSwapchains        = &_swapchain;                              // Swapchains to present images to
+        presentInfo.pImageIndices      = &imageIndex;                              // Index of images in swapchains to present
+
+        // Present image
+        auto presentStart = std::chrono::steady_clock::now();
+        result = vkQueuePresentKHR(_presentationQueue, &presentInfo);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to present Image!");
+        }
+        _frameStatistics.record(FRAME_TIME_PRESENT, std::chrono::steady_clock::now() - presentStart);
+    }
+
+    // Rolling GPU timings and overdraw in the window title, twice a second
+    double now = _window ? glfwGetTime() : 0.0;
+    if (_window && _gpuProfiler.isEnabled() && now - _gpuReportTime >= 0.5)
+    {
+        std::string title = _gpuProfiler.getSummary();
+        if (_pipelineStatistics.isEnabled())
+        {
+            char overdraw[64];
+            snprintf(overdraw, sizeof(overdraw), " | %.2f fragments/pixel",
+                     _pipelineStatistics.getAverage().fragmentShaderInvocations / (double(_swapChainExtent.width) * _swapChainExtent.height));
+            title += overdraw;
+        }
+        glfwSetWindowTitle(_window, title.c_str());
+        _gpuReportTime = now;
+    }
+
+    // Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
+    _currentFrame = (_currentFrame + 1) % MAX_FRAME_DRAWS;
+    _frameNumber++;
+}
+
+void VulkanRenderer::runFrameJobs(uint32_t currentImage)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::runFrameJobs");
+
+    // Secondary buffers recorded the last time this frame was in flight are done, draw waited for its fence
+    for (ThreadCommandPool& threadCommandPool : _threadCommandPools[_currentFrame])
+    {
+        vkResetCommandPool(_mainDevice.logicalDevice, threadCommandPool.commandPool, 0);
+        threadCommandPool.commandBuffersUsed = 0;
+    }
+
+    JobCounter frameDone;
+
+    // Uniform buffer doesn't depend on the scene, so it can go straight away
+    _jobSystem.run([this, currentImage]() { updateUniformBuffers(currentImage); }, &frameDone, "Update uniform buffers");
+
+    // Scene stages run in order in one job, each waiting for its parallel part. One that throws stops the stages
+    // after it, so nothing is culled or recorded from stale transforms, and its exception reaches wait(&frameDone)
+    _jobSystem.run([this, currentImage]()
+    {
+        // Propagate only the transforms that changed since last frame down the hierarchy
+        _sceneGraph.updateWorldTransforms();
+
+        // Cull each render node's bounding sphere against the view frustum, in parallel batches
+        calculateFrustumPlanes();
+        _renderNodeVisible.resize(_renderNodes.size());
+        _nodeLods.resize(_sceneGraph.getNodeCount());
+        JobCounter cullingDone;
+        _jobSystem.parallelFor(static_cast<uint32_t>(_renderNodes.size()), NODES_PER_CULL_JOB,
+                               [this](uint32_t begin, uint32_t end) { cullRenderNodes(begin, end); }, &cullingDone, "Cull render nodes");
+        _jobSystem.wait(&cullingDone);
+
+        buildDrawList();
+
+        // Record the draw list in chunks, each chunk into its own secondary command buffer
+        uint32_t drawCount  = static_cast<uint32_t>(_drawList.size());
+        uint32_t chunkCount = (drawCount + DRAWS_PER_COMMAND_BUFFER - 1) / DRAWS_PER_COMMAND_BUFFER;
+        _drawChunkCommandBuffers.resize(chunkCount);
+        JobCounter recordingDone;
+        _jobSystem.parallelFor(chunkCount, 1, [this, currentImage, drawCount](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t firstDraw = chunk * DRAWS_PER_COMMAND_BUFFER;
+                recordDrawChunk(currentImage, chunk, firstDraw, std::min(firstDraw + DRAWS_PER_COMMAND_BUFFER, drawCount));
+            }
+        }, &recordingDone, "Record draw chunk");
+        _jobSystem.wait(&recordingDone);
+    }, &frameDone, "Build frame");
+
+    // Main thread helps run the jobs until the whole frame is ready
+    _jobSystem.wait(&frameDone);
+}
+
+void VulkanRenderer::calculateFrustumPlanes()
+{
+    // Gribb/Hartmann: planes are sums/differences of the rows of the view-projection matrix
+    glm::mat4 viewProjection = _uboViewProjection.projection * _uboViewProjection.view;
+    glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    _frustumPlanes[0] = row3 + row0;    // Left
+    _frustumPlanes[1] = row3 - row0;    // Right
+    _frustumPlanes[2] = row3 + row1;    // Bottom
+    _frustumPlanes[3] = row3 - row1;    // Top
+    _frustumPlanes[4] = row3 + row2;    // Near
+    _frustumPlanes[5] = row3 - row2;    // Far
+
+    // Normalise so plane distances are in world units, to compare against sphere radius
+    for (glm::vec4& plane : _frustumPlanes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+void VulkanRenderer::cullRenderNodes(uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; i++)
+    {
+        int node = _renderNodes[i];
+        Mesh& mesh = _meshList[_sceneGraph.getMeshId(node)];
+        const glm::mat4& world = _sceneGraph.getWorldTransform(node);
+
+        // Move bounding sphere into world space, radius grows with the largest scale axis
+        glm::vec3 centre = glm::vec3(world * glm::vec4(mesh.getBoundingCentre(), 1.0f));
+        float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+        float radius = mesh.getBoundingRadius() * scale;
+
+        // Visible unless completely behind one of the planes
+        uint8_t visible = 1;
+        for (const glm::vec4& plane : _frustumPlanes)
+        {
+            if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius)
+            {
+                visible = 0;
+                break;
+            }
+        }
+        _renderNodeVisible[i] = visible;
+
+        // Coarsest level whose error still covers no more than LOD_MAX_SCREEN_ERROR pixels, measured at the nearest
+        // point of the bounding sphere
+        float distance      = std::max(glm::length(glm::vec3(_uboViewProjection.view * glm::vec4(centre, 1.0f))) - radius, 0.001f);
+        float pixelsPerUnit = std::abs(_uboViewProjection.projection[1][1]) * 0.5f * _swapChainExtent.height / distance;
+        const std::vector<MeshLod>& lods = mesh.getLods();
+        uint8_t lod = 0;
+        while (lod + 1u < lods.size() && lods[lod + 1].error * scale * pixelsPerUnit <= LOD_MAX_SCREEN_ERROR)
+        {
+            lod++;
+        }
+        _nodeLods[node] = lod;
+    }
+}
+
+void VulkanRenderer::buildDrawList()
+{
+    // Look up each mesh's pipeline once per frame, variants still compiling come back as the fallback.
+    // Fallback reads full vertices, packed meshes are left out until their own variant is ready
+    _meshPipelines.resize(_meshList.size());
+    VkPipeline fallbackPipeline = _pipelineLibrary.getFallbackPipeline();
+    for (size_t i = 0; i < _meshList.size(); i++)
+    {
+        _meshPipelines[i] = _pipelineLibrary.getPipeline(_meshList[i].getPipelineState());
+        if (_meshPipelines[i] == fallbackPipeline && _meshList[i].getVertexFormat() != VERTEX_FORMAT_FULL)
+        {
+            _meshPipelines[i] = VK_NULL_HANDLE;
+        }
+    }
+
+    _drawList.clear();
+    for (size_t i = 0; i < _renderNodes.size(); i++)
+    {
+        if (_renderNodeVisible[i] && _meshPipelines[_sceneGraph.getMeshId(_renderNodes[i])] != VK_NULL_HANDLE)
+        {
+            _drawList.push_back(_renderNodes[i]);
+        }
+    }
+
+    // Group draws sharing a pipeline, then texture and mesh, so less state gets rebound
+    std::sort(_drawList.begin(), _drawList.end(), [this](int a, int b)
+    {
+        int meshA = _sceneGraph.getMeshId(a);
+        int meshB = _sceneGraph.getMeshId(b);
+        if (_meshPipelines[meshA] != _meshPipelines[meshB])
+        {
+            return _meshPipelines[meshA] < _meshPipelines[meshB];
+        }
+        int texA  = _meshList[meshA].getTexId();
+        int texB  = _meshList[meshB].getTexId();
+        if (texA != texB)
+        {
+            return texA < texB;
+        }
+        return meshA < meshB;
+    });
+}
+
+void VulkanRenderer::updateTextureStreaming()
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::updateTextureStreaming");
+
+    if (_textureStreamer.getTextureCount() == 0)
+    {
+        return;
+    }
+
+    // Last frame's draw list is a frame behind the camera, close enough to pick mips with.
+    // Mip wanted is the one with about one texel per pixel across the mesh's bounding sphere on screen
+    float pixelsPerUnit = std::abs(_uboViewProjection.projection[1][1]) * 0.5f * _swapChainExtent.height;
+    for (int node : _drawList)
+    {
+        Mesh& mesh     = _meshList[_sceneGraph.getMeshId(node)];
+        int   streamId = _textureStreamIds[mesh.getTexId()];
+        if (streamId < 0)
+        {
+            continue;
+        }
+
+        const glm::mat4& world = _sceneGraph.getWorldTransform(node);
+        glm::vec3 centre   = glm::vec3(_uboViewProjection.view * world * glm::vec4(mesh.getBoundingCentre(), 1.0f));
+        float     scale    = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+        float     diameter = 2.0f * mesh.getBoundingRadius() * scale;
+        float     distance = std::max(glm::length(centre), 0.001f);
+
+        float    projectedPixels = std::max(diameter * pixelsPerUnit / distance, 1.0f);
+        float    texelsPerPixel  = _textureStreamer.getTextureSize(streamId) / projectedPixels;
+        uint32_t mipLevel        = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel))) : 0;
+        _textureStreamer.requestMip(streamId, mipLevel, _frameNumber);
+    }
+
+    _textureStreamer.update(_frameNumber);
+
+    // Pick up swapped in images before this frame's draws are recorded
+    for (size_t i = 0; i < _textureStreamIds.size(); i++)
+    {
+        if (_textureStreamIds[i] >= 0)
+        {
+            _vkSamplerDescriptorSets[i] = _textureStreamer.getDescriptorSet(_textureStreamIds[i]);
+        }
+    }
+}
+
+void VulkanRenderer::recordDrawChunk(uint32_t currentImage, uint32_t chunk, uint32_t begin, uint32_t end)
+{
+    // Take the next free secondary buffer from this thread's pool, allocating one if it has run out
+    ThreadCommandPool& threadCommandPool = _threadCommandPools[_currentFrame][_jobSystem.getThreadIndex()];
+    if (threadCommandPool.commandBuffersUsed == threadCommandPool.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo cbAllocInfo = {};
+        cbAllocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cbAllocInfo.commandPool                 = threadCommandPool.commandPool;
+        cbAllocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        cbAllocInfo.commandBufferCount          = 1;
+
+        VkCommandBuffer newCommandBuffer;
+        VkResult result = vkAllocateCommandBuffers(_mainDevice.logicalDevice, &cbAllocInfo, &newCommandBuffer);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate a secondary Command Buffer!");
+        }
+        threadCommandPool.commandBuffers.push_back(newCommandBuffer);
+    }
+    VkCommandBuffer commandBuffer = threadCommandPool.commandBuffers[threadCommandPool.commandBuffersUsed++];
+    _drawChunkCommandBuffers[chunk] = commandBuffer;
+
+    // Secondary buffer runs entirely inside the primary buffer's render pass
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType                          = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass                     = _renderPass;
+    inheritanceInfo.subpass                        = 0;
+    inheritanceInfo.framebuffer                    = _swapChainFramebuffers[currentImage];
+    inheritanceInfo.pipelineStatistics             = _pipelineStatistics.getInheritedStatistics();
+
+    VkCommandBufferBeginInfo vkCommandBufferBI = {};
+    vkCommandBufferBI.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkCommandBufferBI.flags                    = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkCommandBufferBI.pInheritanceInfo         = &inheritanceInfo;
+
+    VkResult result = vkBeginCommandBuffer(commandBuffer, &vkCommandBufferBI);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to start recording a secondary Command Buffer!");
+    }
+
+    recordDrawCommands(commandBuffer, currentImage, begin, end);
+
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to stop recording a secondary Command Buffer!");
+    }
+}
+
+void VulkanRenderer::recordDrawCommands(VkCommandBuffer commandBuffer, uint32_t currentImage, uint32_t begin, uint32_t end)
+{
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (uint32_t j = begin; j < end; j++)
+    {
+        int meshId = _sceneGraph.getMeshId(_drawList[j]);
+        Mesh& mesh = _meshList[meshId];
+
+        // Draw list is sorted by pipeline, so this only rebinds at the boundaries
+        if (_meshPipelines[meshId] != boundPipeline)
+        {
+            boundPipeline = _meshPipelines[meshId];
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+        }
+
+        VkBuffer vertexBuffers[] = { mesh.getVertexBuffer() };                        // Buffers to bind
+        VkDeviceSize offsets[] = { 0 };                                               // Offsets into buffers being bound
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);         // Command to bind vertex buffer before drawing with them
+
+        // Bind mesh index buffer, with 0 offset and the index type the mesh chose
+        vkCmdBindIndexBuffer(commandBuffer, mesh.getIndexBuffer(), 0, mesh.getIndexType());
+
+        // World transform of the node, already propagated down the scene hierarchy. Packed positions are unpacked
+        // by the same matrix, so the shader is the same for both
+        Model temp = { _sceneGraph.getWorldTransform(_drawList[j]) };
+        if (mesh.getVertexFormat() != VERTEX_FORMAT_FULL)
+        {
+            temp.model = temp.model * mesh.getDequantisation();
+        }
+
+        vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Model), &temp);
+
+        // Virtual texture set is per frame slot, and only there when the shaders use it
+        bool virtualTexture = _vkVirtualTextureDescriptorSetLayout != VK_NULL_HANDLE;
+        std::array<VkDescriptorSet, 3> descriptorSetGroup = { _vkDescriptorSets[currentImage],
+            _vkSamplerDescriptorSets[mesh.getTexId()],
+            virtualTexture ? _virtualTexture.getDescriptorSet(_currentFrame) : VK_NULL_HANDLE };
+
+        // Bind Descriptor Sets
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, virtualTexture ? 3 : 2, descriptorSetGroup.data(), 0, nullptr);
+
+        // Execute pipeline, drawing just the indices of the level of detail culling picked
+        const MeshLod& lod = mesh.getLods()[_nodeLods[_drawList[j]]];
+        vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, 0);
+    }
+}
+
+stbi_uc* VulkanRenderer::loadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::loadTextureFile");
+
+    // Number of channels image uses
+    int channels;
+
+    // Load pixel data for image, decoded straight from the asset pack's mapping when it has the file
+    stbi_uc*              image  = nullptr;
+    std::span<const char> packed = _assetPack.find("Textures/" + fileName);
+    if (!packed.empty())
+    {
+        image = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(packed.data()), static_cast<int>(packed.size()),
+                                      width, height, &channels, STBI_rgb_alpha);
+    }
+    else
+    {
+        std::string fileLoc = getTextureDirectory() + fileName;
+        image               = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
+    }
+
+    if (!image)
+    {
+        throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+    }
+
+    // Calculate image size using given and known data
+    *imageSize = *width * *height * 4;
+
+    return image;
+}
+
+// Loads a batch of textures in three overlapping stages: every file not in memory or the asset pack is read at once
+// by the async loader, each is decoded on the job system as soon as its read finishes (the others straight away), and
+// upload is called for each on this thread, in sources order, once they have all been decoded
+void VulkanRenderer::loadTextureFiles(const std::vector<TextureSource>& sources,
+                                      std::function<void(size_t index, stbi_uc* pixels, int width, int height)> upload)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::loadTextureFiles");
+
+    struct DecodedTexture
+    {
+        stbi_uc* pixels = nullptr;
+        int      width  = 0;
+        int      height = 0;
+    };
+    std::vector<DecodedTexture> decoded(sources.size());
+    JobCounter                  decodesDone;
+
+    // Each job writes only its own entry, data is kept alive by the job until it has been decoded
+    auto decode = [this, &decoded, &decodesDone](size_t index, std::span<const char> data, std::shared_ptr<AsyncFileData> file)
+    {
+        _jobSystem.run([&decoded, index, data, file]()
+        {
+            int channels;
+            decoded[index].pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()), static_cast<int>(data.size()),
+                                                          &decoded[index].width, &decoded[index].height, &channels, STBI_rgb_alpha);
+        }, &decodesDone, "Decode texture");
+    };
+
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        if (!sources[i].data.empty())
+        {
+            decode(i, sources[i].data, nullptr);
+            continue;
+        }
+        std::span<const char> packed = sources[i].packName.empty() ? std::span<const char>() : _assetPack.find(sources[i].packName);
+        if (!packed.empty())
+        {
+            decode(i, packed, nullptr);
+            continue;
+        }
+        _assetLoader.read(sources[i].filePath, [decode, i](std::shared_ptr<AsyncFileData> file)
+        {
+            if (file->succeeded)
+            {
+                decode(i, file->data(), file);
+            }
+        });
+    }
+
+    // Read callbacks run in here, queueing the decodes while the remaining reads are still going
+    _assetLoader.waitAll();
+    _jobSystem.wait(&decodesDone);
+
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        if (!decoded[i].pixels)
+        {
+            for (DecodedTexture& texture : decoded)
+            {
+                stbi_image_free(texture.pixels);
+            }
+            throw std::runtime_error("Failed to load a Texture file! (" + (sources[i].filePath.empty() ? std::string("embedded image") : sources[i].filePath) + ")");
+        }
+    }
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        upload(i, decoded[i].pixels, decoded[i].width, decoded[i].height);
+        stbi_image_free(decoded[i].pixels);
+    }
+}
+
+bool VulkanRenderer::checkInstanceExtensionSupport(std::vector<const char*>* checkExtensions)
+{
+    // Need to get number of extensions to create array of correct size to hold extensions
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    // Create a list of VkExtensionProperties using count
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+    // Check if given extensions are in list of available extensions
+    for (const auto &checkExtension : *checkExtensions)
+    {
+        bool hasExtension = false;
+        for (const auto &extension : extensions)
+        {
+        // TODO strncmp
+            if (strcmp(checkExtension, extension.extensionName))
+            {
+                hasExtension = true;
                 break;
             }
         }
@@ -1360,6 +2348,8 @@ bool VulkanRenderer::checkInstanceExtensionSupport(std::vector<const char*>* che
 
 int VulkanRenderer::createTexture(std::string filename)
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createTexture");
+
     // Create Texture Image and get its location in array
     int textureImageLoc = createTextureImage(filename);
 
@@ -1374,14 +2364,114 @@ int VulkanRenderer::createTexture(std::string filename)
     return descriptorLoc;
 }
 
+int VulkanRenderer::createVirtualTexture(uint32_t pagesWide, uint32_t pagesHigh, VirtualTexturePageSource pageSource)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createVirtualTexture");
+
+    if (_vkVirtualTextureDescriptorSetLayout == VK_NULL_HANDLE)
+    {
+        throw std::runtime_error("Virtual texturing needs shaders built with it!");
+    }
+    if (_virtualTextureId >= 0)
+    {
+        throw std::runtime_error("Only one virtual texture at a time, clear the scene first!");
+    }
+
+    // Page table and feedback buffers are replaced, nothing in flight may be using them
+    vkDeviceWaitIdle(_mainDevice.logicalDevice);
+    _virtualTexture.setTexture(pagesWide, pagesHigh, pageSource);
+
+    // Meshes with this texture id get the virtual texture pipeline variant in addMesh
+    _virtualTextureId = createTextureDescriptor(_virtualTexture.getCacheImageView());
+    return _virtualTextureId;
+}
+
+int VulkanRenderer::createVirtualTextureFromFile(std::string fileName)
+{
+    int            width;
+    int            height;
+    VkDeviceSize   imageSize;
+    stbi_uc*       imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+
+    uint32_t pagesWide;
+    uint32_t pagesHigh;
+    VirtualTexturePageSource pageSource = createVirtualTexturePixelSource(imageData, width, height, &pagesWide, &pagesHigh);
+    stbi_image_free(imageData);
+
+    return createVirtualTexture(pagesWide, pagesHigh, pageSource);
+}
+
+int VulkanRenderer::createStreamedTexture(std::string fileName)
+{
+    return createStreamedTextures({ fileName })[0];
+}
+
+std::vector<int> VulkanRenderer::createStreamedTextures(const std::vector<std::string>& fileNames)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createStreamedTextures");
+
+    std::vector<TextureSource> sources(fileNames.size());
+    for (size_t i = 0; i < fileNames.size(); i++)
+    {
+        sources[i].packName = "Textures/" + fileNames[i];
+        sources[i].filePath = getTextureDirectory() + fileNames[i];
+    }
+
+    std::vector<int> textureIds(fileNames.size());
+    loadTextureFiles(sources, [this, &textureIds](size_t index, stbi_uc* imageData, int width, int height)
+    {
+        // Streamer keeps its own copy of every mip, only the smallest go to the GPU now
+        int streamId = _textureStreamer.addTexture(imageData, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
+        // Set is swapped for the streamer's current one every frame, in updateTextureStreaming
+        _vkSamplerDescriptorSets.push_back(_textureStreamer.getDescriptorSet(streamId));
+        _textureStreamIds.push_back(streamId);
+        textureIds[index] = static_cast<int>(_vkSamplerDescriptorSets.size()) - 1;
+    });
+    return textureIds;
+}
+
+int VulkanRenderer::createTextureFromPixels(uint32_t width, uint32_t height, const std::vector<uint8_t>& rgbaPixels)
+{
+    CPU_PROFILE_SCOPE("VulkanRenderer::createTextureFromPixels");
+
+    if (rgbaPixels.size() < static_cast<size_t>(width) * height * 4)
+    {
+        throw std::runtime_error("Not enough pixel data for texture!");
+    }
+
+    // Same as createTexture, without the file
+    int textureImageLoc = createTextureImageFromPixels(rgbaPixels.data(), static_cast<int>(width), static_cast<int>(height));
+
+    VkImageView vkImageView = createVkImageView(_vkTextureImages[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    _vkTextureImageViews.push_back(vkImageView);
+
+    return createTextureDescriptor(vkImageView);
+}
+
 // populates vec<VkImage> _textureImages and vec<VkDeviceMemory> _textureImageMemory
 int VulkanRenderer::createTextureImage(std::string fileName)
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::createTextureImage");
+
     // Load image file
     int            width;
     int            height;
     VkDeviceSize   imageSize;
     stbi_uc*       imageData = loadTextureFile(fileName, &width, &height, &imageSize);
+
+    int textureImageLoc = createTextureImageFromPixels(imageData, width, height);
+
+    // Free original image data
+    stbi_image_free(imageData);
+
+    return textureImageLoc;
+}
+
+int VulkanRenderer::createTextureImageFromPixels(const void* pixels, int width, int height)
+{
+    // RGBA, 8 bits per channel
+    VkDeviceSize   imageSize = static_cast<VkDeviceSize>(width) * height * 4;
     VkBuffer       imageStagingBuffer;
     VkDeviceMemory imageStagingBufferMemory;
     
@@ -1389,24 +2479,21 @@ int VulkanRenderer::createTextureImage(std::string fileName)
     // VK_BUFFER_USAGE_TRANSFER_SRC_BIT = buffer can be used as a source of a transfer command.
     createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &imageStagingBuffer, &imageStagingBufferMemory);
+        &imageStagingBuffer, &imageStagingBufferMemory, MEMORY_CATEGORY_STAGING);
 
     // Copy image data to staging buffer
     void *data;
     vkMapMemory(_mainDevice.logicalDevice, imageStagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, imageData, static_cast<size_t>(imageSize));
+    memcpy(data, pixels, static_cast<size_t>(imageSize));
     vkUnmapMemory(_mainDevice.logicalDevice, imageStagingBufferMemory);
 
-    // Free original image data
-    stbi_image_free(imageData);
-
     // Create image to hold final texture
     VkImage texImage;
     VkDeviceMemory vkTexDeviceMemory;
     // VK_IMAGE_USAGE_TRANSFER_DST_BIT = image can be used as the destination of a transfer command.
     // VK_IMAGE_USAGE_SAMPLED_BIT = image can be used to create a VkImageView suitable for occupying a VkDescriptorSet slot either of type VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE or VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, and be sampled by a shader.
     texImage = createVkImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vkTexDeviceMemory);
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vkTexDeviceMemory, MEMORY_CATEGORY_TEXTURE);
 
 
     // COPY DATA TO IMAGE
@@ -1427,12 +2514,22 @@ int VulkanRenderer::createTextureImage(std::string fileName)
 
     // Destroy staging buffers
     vkDestroyBuffer(_mainDevice.logicalDevice, imageStagingBuffer, nullptr);
-    vkFreeMemory(_mainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
+    MemoryTracker::freeMemory(_mainDevice.logicalDevice, imageStagingBufferMemory);
 
     // Return index of new texture image
     return _vkTextureImages.size() - 1;
 }
 
+std::vector<const char*> VulkanRenderer::getRequiredDeviceExtensions()
+{
+    // Swapchain extension is only needed to present to a window
+    if (_headless)
+    {
+        return {};
+    }
+    return requiredDeviceExtensions;
+}
+
 bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {
     // Get device extension count
@@ -1448,7 +2545,7 @@ bool VulkanRenderer::checkDeviceExtensionSupport(VkPhysicalDevice device)
     std::vector<VkExtensionProperties> actualDeviceExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, actualDeviceExtensions.data());
 
-    for (const auto &requiredDeviceExtension : requiredDeviceExtensions)
+    for (const auto &requiredDeviceExtension : getRequiredDeviceExtensions())
     {
         bool hasExtension = false;
         for (const auto &extension : actualDeviceExtensions)
@@ -1485,8 +2582,9 @@ bool VulkanRenderer::checkPhysicalDeviceSuitable(VkPhysicalDevice physicalDevice
 
     bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice);
 
-    bool swapChainValid = false;
-    if (extensionsSupported)
+    // Nothing to present to when headless, so any device that can render will do
+    bool swapChainValid = _headless;
+    if (extensionsSupported && !_headless)
     {
         SwapChainDetails swapChainDetails = getSwapChainDetailsPerPhysicalDevice(physicalDevice);
         swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
@@ -1517,8 +2615,12 @@ QueueFamilyIndices VulkanRenderer::getQueueFamilies(VkPhysicalDevice device)
             indices.graphicsFamily = i;        // If queue family is valid, then get index
         }
         
-        VkBool32 presentationSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentationSupport);
+        // Headless has no surface, rendered images never leave the graphics queue
+        VkBool32 presentationSupport = _headless && indices.graphicsFamily == i;
+        if (!_headless)
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentationSupport);
+        }
         if(queueFamily.queueCount > 0 && presentationSupport)
         {
             indices.presentationFamily = i;
@@ -1586,6 +2688,8 @@ void VulkanRenderer::populateDebugMessengerCreateInfo(
 
 void VulkanRenderer::setupDebugMessenger()
 {
+    CPU_PROFILE_SCOPE("VulkanRenderer::setupDebugMessenger");
+
     if (!_enableValidationLayers) return;
     VkDebugUtilsMessengerCreateInfoEXT createInfo;
     populateDebugMessengerCreateInfo(createInfo);
@@ -1719,7 +2823,7 @@ VkImageView VulkanRenderer::createVkImageView(VkImage image, VkFormat format, Vk
     return imageView;
 }
 
-VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
+VkShaderModule VulkanRenderer::createShaderModule(std::span<const char> code)
 {
     // Shader Module creation information
     VkShaderModuleCreateInfo shaderModuleCI = {};
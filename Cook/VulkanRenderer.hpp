@@ -13,6 +13,34 @@
 #include "stb_image.hpp"
 #include "Utilities.hpp"
 #include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "SceneGraph.hpp"
+#include "JobSystem.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineLibrary.hpp"
+#include "ShaderReflection.hpp"
+#include "ShaderHotReload.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "PipelineStatistics.hpp"
+#include "FrameStatistics.hpp"
+#include "TextureStreamer.hpp"
+#include "VirtualTexture.hpp"
+#include "AssetPack.hpp"
+#include "AsyncFileLoader.hpp"
+#include "GltfImporter.hpp"
+
+// Handles for code outside the renderer that creates, uploads or records with the renderer's device
+struct RendererDeviceContext
+{
+    VkPhysicalDevice physicalDevice;
+    VkDevice         logicalDevice;
+    VkQueue          graphicsQueue;
+    uint32_t         graphicsQueueFamilyIndex;
+    VkCommandPool    graphicsCommandPool;     // Only for use on the thread that calls draw
+    VkRenderPass     renderPass;
+    VkFramebuffer    framebuffer;             // First frame's, for inheritance info of secondary buffers
+};
 
 class VulkanRenderer
 {
@@ -20,7 +48,36 @@ class VulkanRenderer
         VulkanRenderer();
 
         int init(GLFWwindow * newWindow);
+        int initHeadless(uint32_t width, uint32_t height);
         void updateModel(int modelId, glm::mat4 newModel);
+        int  addSceneNode(int parentNode, glm::mat4 localTransform, int meshId = -1);
+        void updateSceneNode(int nodeId, glm::mat4 localTransform);
+        int  addMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, int textureId);
+        int  addMeshFromFile(const std::string& filePath, int textureId);
+        int  loadGltfScene(const std::string& filePath, int parentNode);
+        int  createTextureFromPixels(uint32_t width, uint32_t height, const std::vector<uint8_t>& rgbaPixels);
+        int  createStreamedTexture(std::string fileName);
+        std::vector<int> createStreamedTextures(const std::vector<std::string>& fileNames);
+        int  createVirtualTexture(uint32_t pagesWide, uint32_t pagesHigh, VirtualTexturePageSource pageSource);
+        int  createVirtualTextureFromFile(std::string fileName);
+        void clearScene();
+        void setMeshPipelineState(int meshId, const PipelineStateDesc& pipelineState);
+        bool isPipelineReady(const PipelineStateDesc& pipelineState);
+        void setDynamicShaderFeatures(glm::uvec4 shaderFeatures);
+        int  getSceneRoot();
+        bool openGpuProfileCsv(const std::string& filePath);
+        uint32_t    getDrawCount();
+        std::string getDeviceName();
+        VkExtent2D  getExtent();
+        RendererDeviceContext getDeviceContext();
+        const std::vector<GpuScopeTiming>& getGpuTimings();
+        const PipelineStatisticsCounters&  getPipelineStatistics();
+        FrameStatistics&                   getFrameStatistics();
+        VirtualTexture*                    getVirtualTexture();    // nullptr when the shaders were built without it
+        JobSystem&                         getJobSystem();
+
+        // Binds and draws draw list entries [begin, end) of the last frame, into a secondary buffer already recording in the render pass
+        void recordDrawCommands(VkCommandBuffer commandBuffer, uint32_t currentImage, uint32_t begin, uint32_t end);
         void draw();
         void cleanup();
 
@@ -28,6 +85,22 @@ class VulkanRenderer
 
     private:
     
+        // Secondary command buffers are allocated per thread, command pools can't be used from two threads at once
+        struct ThreadCommandPool
+        {
+            VkCommandPool                commandPool;
+            std::vector<VkCommandBuffer> commandBuffers;
+            uint32_t                     commandBuffersUsed;   // Handed out since the pool was last reset
+        };
+
+        // Where a texture's encoded image is: in memory already, in the asset pack, or a file to read
+        struct TextureSource
+        {
+            std::span<const char> data;
+            std::string           packName;
+            std::string           filePath;
+        };
+
         struct
         {
             VkPhysicalDevice physicalDevice;
@@ -35,7 +108,10 @@ class VulkanRenderer
         }_mainDevice;
         
         int                             _currentFrame = 0;
+        uint64_t                        _frameNumber = 0;     // Frames drawn since start, never wraps
         GLFWwindow*                     _window;
+        bool                            _headless = false;    // Rendering into offscreen images, no window or swapchain
+        std::vector<VkDeviceMemory>     _offscreenImageMemory;
         VkInstance                      _instance;
         VkDebugUtilsMessengerEXT        _debugMessenger;
         VkQueue                         _graphicsQueue;
@@ -47,7 +123,26 @@ class VulkanRenderer
         VkImageView                     _depthBufferVkImageView;
         VkImage                         _depthBufferVkImage;
         VkDeviceMemory                  _depthBufferImageVkDeviceMemory;
-        VkPipeline                      _graphicsPipeline;
+        PipelineCache                   _pipelineCache;
+        ShaderReflection                _shaderReflection;
+        DescriptorLayoutCache           _layoutCache;
+        VkShaderModule                  _vertexShaderModule;
+        VkShaderModule                  _fragmentShaderModule;
+        std::span<const char>           _vertexShaderCode;     // SPIR-V in use, kept so a reload can rebuild the unchanged stage
+        std::span<const char>           _fragmentShaderCode;
+        std::vector<char>               _vertexShaderFile;     // Loose or reloaded SPIR-V the code spans point into, otherwise they point into the asset pack
+        std::vector<char>               _fragmentShaderFile;
+        ShaderHotReload                 _shaderHotReload;
+        bool                            _calibratedTimestampsEnabled = false;
+        bool                            _memoryBudgetEnabled = false;
+        GpuProfiler                     _gpuProfiler;
+        bool                            _pipelineStatisticsEnabled = false;
+        bool                            _fragmentStoresAndAtomicsEnabled = false;  // Picks the fragment shader with or without virtual texture feedback
+        PipelineStatistics              _pipelineStatistics;
+        double                          _gpuReportTime = 0.0;      // glfwGetTime of last window title update
+        FrameStatistics                 _frameStatistics;
+        PipelineLibrary                 _pipelineLibrary;
+        std::vector<VkPipeline>         _meshPipelines;       // Pipeline each mesh draws with this frame
         VkPipelineLayout                _pipelineLayout;
         VkRenderPass                    _renderPass;
         VkExtent2D                      _swapChainExtent;
@@ -60,11 +155,21 @@ class VulkanRenderer
         std::vector<VkFence>            _drawVkFences;
         const std::vector<const char *> _validationLayers = {"VK_LAYER_KHRONOS_validation"};
         std::vector<Mesh>               _meshList;
+        SceneGraph                      _sceneGraph;
+        int                             _sceneRootNode;
+        std::vector<int>                _renderNodes;    // Scene nodes that draw a mesh, indexed by model id
+        std::vector<uint8_t>            _renderNodeVisible;   // Culling result, one per render node
+        std::vector<uint8_t>            _nodeLods;            // Level of detail culling picked, by scene node id as the draw list holds them
+        std::vector<int>                _drawList;            // Visible render nodes, sorted by texture then mesh
+        std::array<glm::vec4, 6>        _frustumPlanes;
+        JobSystem                       _jobSystem;
+        std::vector<std::vector<ThreadCommandPool>> _threadCommandPools;     // [frame in flight][job thread]
+        std::vector<VkCommandBuffer>    _drawChunkCommandBuffers;            // Secondary buffers, in draw list order
         VkDescriptorSetLayout           _vkDescriptorSetLayout;
         VkDescriptorSetLayout           _vkSamplerDescriptorSetLayout;
         VkPushConstantRange             _pushConstantRange;
         VkDescriptorPool                _descriptorPool;
-        VkDescriptorPool                _samplerDescriptorPool;
+        std::vector<VkDescriptorPool>   _samplerDescriptorPools;    // Texture sets come from the last one
         std::vector<VkDescriptorSet>    _vkDescriptorSets;
         std::vector<VkDescriptorSet>    _vkSamplerDescriptorSets;
         std::vector<VkBuffer>           _vpUniformBuffer;
@@ -73,19 +178,32 @@ class VulkanRenderer
         std::vector<VkImage>            _vkTextureImages;
         std::vector<VkDeviceMemory>     _vkTextureImageDeviceMemory;
         std::vector<VkImageView>        _vkTextureImageViews;
+        TextureStreamer                 _textureStreamer;
+        std::vector<int>                _textureStreamIds;    // Per texture id, its TextureStreamer id or -1 when fully resident
+        VkDescriptorSetLayout           _vkVirtualTextureDescriptorSetLayout = VK_NULL_HANDLE;   // Set 2, if the shaders use it
+        VirtualTexture                  _virtualTexture;
+        int                             _virtualTextureId = -1;       // Texture id meshes use to draw with the virtual texture
+        AssetPack                       _assetPack;                   // Shaders and textures, when ASSET_PACK_FILE exists
+        AsyncFileLoader                 _assetLoader;                 // Loose files not in the pack
+        int                             _whiteTextureId = -1;         // 1x1 white, for imported meshes with no texture
         
         
         struct UboViewProjection
         {
-            glm::mat4 projection;
-            glm::mat4 view;
+            glm::mat4  projection;
+            glm::mat4  view;
+            glm::uvec4 shaderFeatures;   // Used by pipelines with SHADER_FEATURE_DYNAMIC_FEATURES instead of specialization constants
         } _uboViewProjection;
         
 
+        int  initRenderer();
         void createInstance();
         void createLogicalDevice();
         void createSurface();
         void createSwapChain();
+        void createOffscreenTargets();
+        void loadShaders();
+        void reloadShaders(const std::vector<std::string>& changedFiles);
         void createGraphicsPipeline();
         void createRenderPass();
         void createDescriptorSetLayout();
@@ -94,9 +212,11 @@ class VulkanRenderer
         void createFramebuffers();
         void createCommandPool();
         void createCommandBuffers();
+        void createThreadCommandPools();
         void createSynchronization();
         void createUniformBuffers();
         void createDescriptorPool();
+        void createSamplerDescriptorPool();
         void createDescriptorSets();
         void updateUniformBuffers(uint32_t imageIndex);
         void getPhysicalDevice();
@@ -104,10 +224,17 @@ class VulkanRenderer
         void setupDebugMessenger();
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
         void recordCommands(uint32_t currentImage);
+        void runFrameJobs(uint32_t currentImage);
+        void calculateFrustumPlanes();
+        void cullRenderNodes(uint32_t begin, uint32_t end);
+        void buildDrawList();
+        void recordDrawChunk(uint32_t currentImage, uint32_t chunk, uint32_t begin, uint32_t end);
         void createTextureSampler();
+        void updateTextureStreaming();
     
         bool                      checkInstanceExtensionSupport(std::vector<const char*> * checkExtensions);
         bool                      checkDeviceExtensionSupport(VkPhysicalDevice device);
+        std::vector<const char*>  getRequiredDeviceExtensions();
         bool                      checkPhysicalDeviceSuitable(VkPhysicalDevice device);
         std::vector<const char *> getRequiredExtensions();
         QueueFamilyIndices        getQueueFamilies(VkPhysicalDevice device);
@@ -120,17 +247,26 @@ class VulkanRenderer
                                                         VkFormatFeatureFlags featureFlags);
         bool                      checkValidationLayerSupport();
         VkImageView               createVkImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-        VkShaderModule            createShaderModule(const std::vector<char>& code);
+        VkShaderModule            createShaderModule(std::span<const char> code);
         VkImage                   createVkImage(uint32_t width,
                                               uint32_t height,
                                               VkFormat format,
                                               VkImageTiling tiling,
                                               VkImageUsageFlags useFlags,
                                               VkMemoryPropertyFlags propFlags,
-                                              VkDeviceMemory *imageVkDeviceMemory);
+                                              VkDeviceMemory *imageVkDeviceMemory,
+                                              MemoryCategory memoryCategory);
+        std::string               getFragmentShaderBinary() const;
+        std::span<const char>     readAsset(const std::string& packName, const std::string& filePath, std::vector<char>* fileData);
         stbi_uc*                  loadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize);
+        void                      loadTextureFiles(const std::vector<TextureSource>& sources,
+                                                   std::function<void(size_t index, stbi_uc* pixels, int width, int height)> upload);
         int                       createTextureImage(std::string fileName);
+        int                       createTextureImageFromPixels(const void* pixels, int width, int height);
         int                       createTexture(std::string fileName);
         int                       createTextureDescriptor(VkImageView textureImage);
+        int                       addMesh(Mesh mesh);
+        void                      addGltfNode(const GltfScene& scene, int gltfNode, int parentNode, const std::vector<int>& meshIds,
+                                              std::vector<bool>* visited);
 
 };
@@ -1,2 +1,55 @@
-/Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
-/Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
+#!/bin/sh
+# Builds the .spv files the renderer loads from the GLSL sources in shaders/. The .spv files are committed, so
+# commit them with any shader change, together with shaders/spv.checksums. Xcode runs this before compiling
+# ("Compile Shaders" build phase). glslc comes from the Vulkan SDK when VULKAN_SDK is set, otherwise from PATH.
+#   ./compile.sh          rebuild every .spv that wasn't built by this script from its current source and options
+#   ./compile.sh --check  only list those, exits with 1 if there are any
+# spv.checksums holds a checksum of the source and options each .spv was last built from. Timestamps aren't used,
+# git doesn't keep them, and a .spv with no entry (not built here) is always rebuilt.
+set -e
+cd "$(dirname "$0")/shaders"
+
+GLSLC="${VULKAN_SDK:+$VULKAN_SDK/bin/}glslc"
+MANIFEST=spv.checksums
+STALE=0
+RECORDED=""
+if [ -f "$MANIFEST" ]; then
+    RECORDED=$(cat "$MANIFEST")
+fi
+BUILT=""
+
+# compile <source> <output> [glslc options...]
+compile()
+{
+    source="$1"
+    output="$2"
+    shift 2
+    checksum=$({ echo "$*"; cat "$source"; } | cksum | cut -d ' ' -f 1,2)
+    BUILT="$BUILT$checksum $output
+"
+    if [ -f "$output" ] && printf '%s\n' "$RECORDED" | grep -qxF "$checksum $output"; then
+        return
+    fi
+    if [ "$CHECK" = 1 ]; then
+        echo "shaders/$output wasn't built from the current shaders/$source, run compile.sh"
+        STALE=1
+        return
+    fi
+    echo "Compiling shaders/$source -> shaders/$output"
+    "$GLSLC" "$@" "$source" -o "$output"
+}
+
+CHECK=0
+if [ "$1" = "--check" ]; then
+    CHECK=1
+fi
+
+compile simple_shader.vert simple_shader.vert.spv
+compile simple_shader.frag simple_shader.frag.spv
+compile simple_shader.frag simple_shader_nofeedback.frag.spv -DVIRTUAL_TEXTURE_FEEDBACK=0
+
+if [ "$CHECK" = 0 ] && [ "$(printf '%s' "$BUILT")" != "$RECORDED" ]; then
+    printf '%s' "$BUILT" > "$MANIFEST"
+fi
+
+exit $STALE
@@ -7,12 +7,29 @@
 #include <stdexcept>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
 
 #include "VulkanRenderer.hpp"
+#include "BenchmarkSuite.hpp"
+#include "Microbenchmarks.hpp"
+#include "MeshConverter.hpp"
 
-GLFWwindow* window;
+GLFWwindow* window = nullptr;     // Stays null when running headless
 VulkanRenderer vulkanRenderer;
 
+// P prints the frame time percentiles so far, without waiting for shutdown
+void keyCallback(GLFWwindow* keyWindow, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        vulkanRenderer.getFrameStatistics().printReport();
+    }
+}
+
 void initWindow(std::string wName = "Test Window", const int width = 800, const int height = 600)
 {
     // Initialise GLFW
@@ -23,57 +40,510 @@ void initWindow(std::string wName = "Test Window", const int width = 800, const
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
     window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
+    glfwSetKeyCallback(window, keyCallback);
+}
+
+// Destroy GLFW window and stop GLFW (never started when headless)
+void destroyWindow()
+{
+    if (window)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+}
+
+// Headless runs have no window to close or events to handle
+bool windowOpen()
+{
+    return !window || !glfwWindowShouldClose(window);
+}
+
+void pollEvents()
+{
+    if (window)
+    {
+        glfwPollEvents();
+    }
+}
+
+// Frame time summary for runs without a window, where there is nothing to look at
+void printFrameTimes(const std::vector<double>& frameMilliseconds)
+{
+    if (frameMilliseconds.empty())
+    {
+        return;
+    }
+
+    double total   = 0.0;
+    double fastest = frameMilliseconds[0];
+    double slowest = frameMilliseconds[0];
+    for (double milliseconds : frameMilliseconds)
+    {
+        total  += milliseconds;
+        fastest = std::min(fastest, milliseconds);
+        slowest = std::max(slowest, milliseconds);
+    }
+
+    double average = total / frameMilliseconds.size();
+    printf("Headless, %zu frames: %8.3f ms/frame (min %.3f, max %.3f)  %8.1f fps\n",
+           frameMilliseconds.size(), average, fastest, slowest, 1000.0 / average);
+}
+
+// Draws layers of screen filling quads so the fragment shader dominates, first with the shader features baked in
+// through specialization constants, then with the same features read from a uniform and branched on at runtime
+void runSpecializationBenchmark()
+{
+    const int layerCount     = 64;
+    const int warmUpFrames   = 60;
+    const int measuredFrames = 600;
+
+    for (int i = 0; i < layerCount; i++)
+    {
+        glm::mat4 layer = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f + i * 0.001f));
+        vulkanRenderer.addSceneNode(vulkanRenderer.getSceneRoot(), glm::scale(layer, glm::vec3(10.0f, 10.0f, 1.0f)), 0);
+    }
+
+    // Same features both ways: vertex colour, alpha test and one texture
+    PipelineStateDesc specialised;
+    specialised.depthTestEnable  = VK_FALSE;
+    specialised.depthWriteEnable = VK_FALSE;
+    specialised.shaderFeatures   = { VK_TRUE, VK_TRUE, 1, VK_FALSE, VK_FALSE };
+
+    PipelineStateDesc uniformBranching = specialised;
+    uniformBranching.shaderFeatures[SHADER_FEATURE_DYNAMIC_FEATURES] = VK_TRUE;
+    vulkanRenderer.setDynamicShaderFeatures(glm::uvec4(1, 1, 1, 0));
+
+    struct
+    {
+        const char*       name;
+        PipelineStateDesc pipelineState;
+    } variants[] = { { "specialised", specialised }, { "uniform", uniformBranching } };
+
+    printf("Specialization benchmark, %d full screen layers, %d frames per variant\n", layerCount, measuredFrames);
+    for (auto& variant : variants)
+    {
+        vulkanRenderer.setMeshPipelineState(0, variant.pipelineState);
+
+        // Variant compiles in the background, the fallback pipeline would be measured until it's ready
+        while (!vulkanRenderer.isPipelineReady(variant.pipelineState) && windowOpen())
+        {
+            pollEvents();
+            vulkanRenderer.draw();
+        }
+        for (int i = 0; i < warmUpFrames && windowOpen(); i++)
+        {
+            pollEvents();
+            vulkanRenderer.draw();
+        }
+
+        // Window can be closed part way, so only the frames actually drawn count
+        auto start       = std::chrono::steady_clock::now();
+        int  drawnFrames = 0;
+        for (; drawnFrames < measuredFrames && windowOpen(); drawnFrames++)
+        {
+            pollEvents();
+            vulkanRenderer.draw();
+        }
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (drawnFrames == 0)
+        {
+            printf("  %-12s not measured, window closed\n", variant.name);
+            continue;
+        }
+        printf("  %-12s %8.3f ms/frame  %8.1f fps\n", variant.name, elapsedMs / drawnFrames, drawnFrames * 1000.0 / elapsedMs);
+    }
+}
+
+// Every generated benchmark scene (or those whose name contains filter), measuredFrames frames each, results written as JSON
+void runBenchmarkSuite(const char* reportFile, const char* filter, int measuredFrames)
+{
+    const uint32_t warmUpFrames = 10;
+
+    BenchmarkSuite               suite(&vulkanRenderer);
+    std::vector<BenchmarkResult> results;
+
+    printf("Benchmark suite on %s, %d frames per scene\n", vulkanRenderer.getDeviceName().c_str(), measuredFrames);
+    for (const BenchmarkSceneDesc& scene : BenchmarkSuite::getDefaultScenes())
+    {
+        if (filter && scene.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        results.push_back(suite.runScene(scene, warmUpFrames, static_cast<uint32_t>(measuredFrames)));
+    }
+
+    if (suite.writeReport(reportFile, results, static_cast<uint32_t>(measuredFrames)))
+    {
+        printf("Benchmark report written to %s\n", reportFile);
+    }
+    else
+    {
+        printf("Failed to write benchmark report %s\n", reportFile);
+    }
+}
+
+// Low level helpers timed one at a time (or those whose name contains filter). Runs headless, so it also works
+// on a software driver such as lavapipe, selected by pointing VK_ICD_FILENAMES at its ICD json.
+// A glTF file given with --gltf is timed being imported too
+void runMicrobenchmarks(const char* reportFile, const char* filter, const char* gltfFile)
+{
+    Microbenchmarks microbenchmarks(&vulkanRenderer);
+    microbenchmarks.addDefaultBenchmarks();
+    if (gltfFile)
+    {
+        microbenchmarks.addGltfImportBenchmark(gltfFile);
+    }
+
+    printf("Microbenchmarks on %s\n", vulkanRenderer.getDeviceName().c_str());
+    std::vector<MicrobenchmarkResult> results = microbenchmarks.run(filter);
+
+    if (microbenchmarks.writeReport(reportFile, results))
+    {
+        printf("Microbenchmark report written to %s\n", reportFile);
+    }
+    else
+    {
+        printf("Failed to write microbenchmark report %s\n", reportFile);
+    }
+}
+
+// Page of an endless checkerboard, fine and coarse squares, tinted bluer at each smaller mip level so the
+// levels being streamed in can be told apart on screen
+void fillCheckerboardPage(uint32_t mipLevel, uint32_t pageX, uint32_t pageY, uint8_t* rgbaPixels)
+{
+    const int borderedPageSize = VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER;
+    for (int y = 0; y < borderedPageSize; y++)
+    {
+        for (int x = 0; x < borderedPageSize; x++)
+        {
+            // Texel position at mip 0
+            int64_t u = (static_cast<int64_t>(pageX) * VIRTUAL_TEXTURE_PAGE_SIZE + x - VIRTUAL_TEXTURE_PAGE_BORDER) * (1ll << mipLevel);
+            int64_t v = (static_cast<int64_t>(pageY) * VIRTUAL_TEXTURE_PAGE_SIZE + y - VIRTUAL_TEXTURE_PAGE_BORDER) * (1ll << mipLevel);
+
+            int shade = (((u >> 6) ^ (v >> 6)) & 1) ? 200 : 120;
+            if (((u >> 11) ^ (v >> 11)) & 1)
+            {
+                shade -= 60;
+            }
+
+            uint8_t* texel = rgbaPixels + (y * borderedPageSize + x) * 4;
+            texel[0] = static_cast<uint8_t>(shade);
+            texel[1] = static_cast<uint8_t>(shade);
+            texel[2] = static_cast<uint8_t>(std::min(shade + 16 * static_cast<int>(mipLevel), 255));
+            texel[3] = 255;
+        }
+    }
+}
+
+// Packs every compiled shader and texture into one asset pack, under the names the renderer looks them up by.
+// Shaders compress well, the textures are already compressed images so they are stored as they are
+bool buildAssetPack(const char* assetPackFile)
+{
+    AssetCompression shaderCompression = AssetPack::isCompressionSupported(ASSET_COMPRESSION_LZ4) ? ASSET_COMPRESSION_LZ4
+                                                                                                  : ASSET_COMPRESSION_NONE;
+    std::vector<AssetPackSource> sources;
+    std::error_code              error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(getShaderDirectory(), error))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".spv")
+        {
+            sources.push_back({ "shaders/" + entry.path().filename().string(), entry.path().string(), shaderCompression });
+        }
+    }
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(getTextureDirectory(), error))
+    {
+        if (entry.is_regular_file())
+        {
+            sources.push_back({ "Textures/" + entry.path().filename().string(), entry.path().string(), ASSET_COMPRESSION_NONE });
+        }
+    }
+
+    if (error || !AssetPack::write(assetPackFile, sources))
+    {
+        printf("Failed to build asset pack %s\n", assetPackFile);
+        return false;
+    }
+    printf("Asset pack %s written with %zu assets\n", assetPackFile, sources.size());
+    return true;
+}
+
+// Write the CPU profiler's scopes out, if a trace file was asked for
+void exportCpuTrace(const char* cpuTraceFile)
+{
+    if (!cpuTraceFile)
+    {
+        return;
+    }
+
+    if (CpuProfiler::exportChromeTrace(cpuTraceFile))
+    {
+        printf("CPU trace written to %s\n", cpuTraceFile);
+    }
+    else
+    {
+        printf("Failed to write CPU trace %s\n", cpuTraceFile);
+    }
 }
 //
-int main()
+int main(int argc, char* argv[])
 {
-    // Create Window
-    initWindow("Test Window", 1366, 768);
+    bool        benchmarkSpecialization = false;
+    bool        headless                = false;
+    bool        virtualTextureFloor     = false;
+    int         frameCount              = -1;          // Default depends on what is being run
+    const char* benchmarkReport         = nullptr;
+    const char* benchmarkFilter         = nullptr;
+    const char* microbenchmarkReport    = nullptr;
+    uint32_t    width                   = 1366;
+    uint32_t    height                  = 768;
+    const char* gpuProfileCsv           = nullptr;
+    const char* cpuTraceFile            = nullptr;
+    const char* assetPackFile           = nullptr;
+    const char* convertMeshSource       = nullptr;
+    const char* convertMeshFile         = nullptr;
+    const char* meshFile                = nullptr;
+    const char* gltfFile                = nullptr;
+    const char* dataDirectory           = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--benchmark-specialization") == 0)
+        {
+            benchmarkSpecialization = true;
+        }
+        else if (strcmp(argv[i], "--gpu-profile-csv") == 0 && i + 1 < argc)
+        {
+            gpuProfileCsv = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cpu-trace") == 0 && i + 1 < argc)
+        {
+            cpuTraceFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--virtual-texture") == 0)
+        {
+            virtualTextureFloor = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frameCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--benchmark-suite") == 0 && i + 1 < argc)
+        {
+            benchmarkReport = argv[++i];
+            headless        = true;
+        }
+        else if (strcmp(argv[i], "--microbenchmarks") == 0 && i + 1 < argc)
+        {
+            microbenchmarkReport = argv[++i];
+            headless             = true;
+        }
+        else if (strcmp(argv[i], "--benchmark-filter") == 0 && i + 1 < argc)
+        {
+            benchmarkFilter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--build-asset-pack") == 0 && i + 1 < argc)
+        {
+            assetPackFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--convert-mesh") == 0 && i + 2 < argc)
+        {
+            convertMeshSource = argv[++i];
+            convertMeshFile   = argv[++i];
+        }
+        else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+        {
+            meshFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--gltf") == 0 && i + 1 < argc)
+        {
+            gltfFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+        {
+            width = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+        {
+            height = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--data-dir") == 0 && i + 1 < argc)
+        {
+            dataDirectory = argv[++i];
+        }
+    }
+    initDataDirectory(dataDirectory, argv[0]);
+
+    // Offline steps, no renderer needed
+    if (assetPackFile)
+    {
+        return buildAssetPack(assetPackFile) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (convertMeshSource)
+    {
+        return convertToMeshFile(convertMeshSource, convertMeshFile) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // Create Vulkan Renderer instance
-    if (vulkanRenderer.init(window) == EXIT_FAILURE)
+    // Record from the start, so start up shows in the trace too
+    CpuProfiler::setEnabled(cpuTraceFile != nullptr);
+
+    // Create Vulkan Renderer instance, headless renders offscreen and needs no window system at all
+    int initResult = 0;
+    if (headless)
+    {
+        initResult = vulkanRenderer.initHeadless(width, height);
+    }
+    else
+    {
+        // Create Window
+        initWindow("Test Window", width, height);
+        initResult = vulkanRenderer.init(window);
+    }
+    if (initResult == EXIT_FAILURE)
     {
         return EXIT_FAILURE;
     }
 
+    // Warn once a heap gets close to its budget, before the driver starts paging or allocations fail
+    MemoryTracker::setThresholdCallback(MEMORY_BUDGET_WARNING_FRACTION, [](const MemoryHeapUsage& heapUsage)
+    {
+        printf("Memory heap %u is at %.1f MiB of its %.1f MiB budget\n", heapUsage.heapIndex,
+               heapUsage.usage / (1024.0 * 1024.0), heapUsage.budget / (1024.0 * 1024.0));
+    });
+
+    // Every GPU scope of every frame, as it is read back
+    if (gpuProfileCsv && !vulkanRenderer.openGpuProfileCsv(gpuProfileCsv))
+    {
+        printf("Failed to open GPU profile file %s\n", gpuProfileCsv);
+    }
+
+    if (benchmarkReport)
+    {
+        runBenchmarkSuite(benchmarkReport, benchmarkFilter, frameCount > 0 ? frameCount : 100);
+        vulkanRenderer.cleanup();
+        exportCpuTrace(cpuTraceFile);
+        return 0;
+    }
+
+    if (microbenchmarkReport)
+    {
+        runMicrobenchmarks(microbenchmarkReport, benchmarkFilter, gltfFile);
+        vulkanRenderer.cleanup();
+        exportCpuTrace(cpuTraceFile);
+        return 0;
+    }
+
+    if (benchmarkSpecialization)
+    {
+        runSpecializationBenchmark();
+        vulkanRenderer.cleanup();
+        exportCpuTrace(cpuTraceFile);
+        destroyWindow();
+        return 0;
+    }
+
+    // Pivots hold each quad's fixed position, so only the spinning child nodes change per frame
+    int redPivot  = vulkanRenderer.addSceneNode(vulkanRenderer.getSceneRoot(),
+                                                glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, -1.5f)));
+    int bluePivot = vulkanRenderer.addSceneNode(vulkanRenderer.getSceneRoot(),
+                                                glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, -3.0f)));
+    int redQuad   = vulkanRenderer.addSceneNode(redPivot, glm::mat4(1.0f), 0);
+    int blueQuad  = vulkanRenderer.addSceneNode(bluePivot, glm::mat4(1.0f), 1);
+
+    // Blue quad uses an opaque, double sided pipeline variant (drawn with the default pipeline until it has compiled)
+    PipelineStateDesc opaqueState;
+    opaqueState.blendEnable = VK_FALSE;
+    opaqueState.cullMode    = VK_CULL_MODE_NONE;
+    vulkanRenderer.setMeshPipelineState(1, opaqueState);
+
+    // Floor with a 32768 x 32768 procedural virtual texture (4 GiB at mip 0), drawn through the fixed size page cache
+    if (virtualTextureFloor && vulkanRenderer.getVirtualTexture())
+    {
+        int floorTexture = vulkanRenderer.createVirtualTexture(256, 256, fillCheckerboardPage);
+
+        std::vector<Vertex> floorVertices = {
+            { { -0.5, 0.5, 0.0 },  { 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f } },
+            { { -0.5, -0.5, 0.0 }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f } },
+            { { 0.5, -0.5, 0.0 },  { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f } },
+            { { 0.5, 0.5, 0.0 },   { 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } },
+        };
+        std::vector<uint32_t> floorIndices = { 0, 1, 2, 2, 3, 0 };
+        int floorMesh = vulkanRenderer.addMesh(&floorVertices, &floorIndices, floorTexture);
+
+        glm::mat4 floorTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.6f, -3.0f));
+        floorTransform = glm::rotate(floorTransform, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        vulkanRenderer.addSceneNode(vulkanRenderer.getSceneRoot(), glm::scale(floorTransform, glm::vec3(20.0f, 20.0f, 1.0f)), floorMesh);
+    }
+
+    // Mesh file in front of the quads, with the panda texture (created first, so id 0)
+    if (meshFile)
+    {
+        int fileMesh = vulkanRenderer.addMeshFromFile(meshFile, 0);
+        vulkanRenderer.addSceneNode(vulkanRenderer.getSceneRoot(), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.5f)), fileMesh);
+    }
+
+    // glTF scene behind the quads, as the file places it
+    if (gltfFile)
+    {
+        int gltfScene = vulkanRenderer.loadGltfScene(gltfFile, vulkanRenderer.getSceneRoot());
+        vulkanRenderer.updateSceneNode(gltfScene, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)));
+    }
+
     float angle     = 0.0f;
     float deltaTime = 0.0f;
     float lastTime  = 0.0f;
+
+    // Headless draws a fixed number of frames with a fixed time step, so every run draws exactly the same thing
+    const float         headlessTimeStep = 1.0f / 60.0f;
+    std::vector<double> frameMilliseconds;
     
     // Loop until closed
-    while (!glfwWindowShouldClose(window))
+    int headlessFrames = frameCount > 0 ? frameCount : 600;
+    while (headless ? static_cast<int>(frameMilliseconds.size()) < headlessFrames : windowOpen())
     {
-        glfwPollEvents();
+        pollEvents();
         
-        float now = glfwGetTime();
-        deltaTime = now - lastTime;
-        lastTime = now;
+        if (headless)
+        {
+            deltaTime = headlessTimeStep;
+        }
+        else
+        {
+            float now = glfwGetTime();
+            deltaTime = now - lastTime;
+            lastTime = now;
+        }
         
         angle += 10.0f * deltaTime;
         if(angle > 360.0f)
         {
             angle -= 360.0f;
         }
-        glm::mat4 firstModel(1.0f);
-        glm::mat4 secondModel(1.0f);
-//
-        firstModel = glm::translate(firstModel, glm::vec3(-1.0f, 0.0f, -1.5f)); // red
-        firstModel = glm::rotate(firstModel, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
 
-        secondModel = glm::translate(secondModel, glm::vec3(1.0f, 0.0f, -3.0f)); // blue
-        secondModel = glm::rotate(secondModel, glm::radians(-angle * 25), glm::vec3(0.0f, 0.0f, 1.0f));
-
-        vulkanRenderer.updateModel(0, firstModel);
-        vulkanRenderer.updateModel(1, secondModel);
+        vulkanRenderer.updateSceneNode(redQuad, glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f)));       // red
+        vulkanRenderer.updateSceneNode(blueQuad, glm::rotate(glm::mat4(1.0f), glm::radians(-angle * 25), glm::vec3(0.0f, 0.0f, 1.0f))); // blue
 
+        auto frameStart = std::chrono::steady_clock::now();
         vulkanRenderer.draw();
+        if (headless)
+        {
+            frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        }
     }
 
+    printFrameTimes(frameMilliseconds);
+    vulkanRenderer.getFrameStatistics().printReport();
+    if (virtualTextureFloor && vulkanRenderer.getVirtualTexture())
+    {
+        vulkanRenderer.getVirtualTexture()->printReport();
+    }
+    MemoryTracker::printReport();
     vulkanRenderer.cleanup();
-
-    // Destroy GLFW window and stop GLFW
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    exportCpuTrace(cpuTraceFile);
+    destroyWindow();
 
     return 0;
 }
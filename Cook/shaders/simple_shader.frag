@@ -1,13 +1,120 @@
 #version 450
 
+// 0 leaves out the virtual texture (set 2), for GPUs without fragmentStoresAndAtomics to write the feedback with.
+// compile.sh builds both, as simple_shader.frag.spv and simple_shader_nofeedback.frag.spv
+#ifndef VIRTUAL_TEXTURE_FEEDBACK
+#define VIRTUAL_TEXTURE_FEEDBACK 1
+#endif
+
 layout(location = 0) in vec3 fragCol;
 layout(location = 1) in vec2 fragTex;
 
+layout(set = 0, binding = 0) uniform UboViewProjection
+{
+    mat4  projection;
+    mat4  view;
+    uvec4 shaderFeatures;   // Only read when DYNAMIC_FEATURES is set (x = vertex colour, y = alpha test, z = texture count, w = virtual texture)
+} uboViewProjection;
+
 layout(set=1, binding = 0) uniform sampler2D textureSampler;
 
+#if VIRTUAL_TEXTURE_FEEDBACK
+// Virtual texture (VirtualTexture.hpp). Page table entries are cache slot x | slot y << 12 | mip level << 24,
+// of the page itself if it is resident, otherwise of its nearest resident ancestor
+layout(set = 2, binding = 0) readonly buffer PageTable
+{
+    uvec2 pages;            // Pages across and down at mip 0, halved per level down to 1
+    uint  mipCount;
+    uint  padding;
+    uint  mipOffsets[16];   // Index of each level's first entry (VIRTUAL_TEXTURE_MAX_MIPS)
+    uint  entries[];
+} pageTable;
+
+layout(set = 2, binding = 1) uniform sampler2D pageCache;
+
+// One bit per page, set for every page the frame wanted, read back on the CPU
+layout(set = 2, binding = 2) buffer Feedback
+{
+    uint requested[];
+} feedback;
+#endif
+
+const float PAGE_SIZE   = 128.0;    // VIRTUAL_TEXTURE_PAGE_SIZE
+const float PAGE_BORDER = 1.0;      // VIRTUAL_TEXTURE_PAGE_BORDER
+
+// Specialization constants, set per pipeline (ids match ShaderFeature in PipelineLibrary.hpp)
+layout(constant_id = 0) const bool VERTEX_COLOUR    = false;   // Multiply by vertex colour
+layout(constant_id = 1) const bool ALPHA_TEST       = false;   // Discard mostly transparent fragments
+layout(constant_id = 2) const int  TEXTURE_COUNT    = 1;       // 0 = vertex colour only, 1 = sample the texture
+layout(constant_id = 3) const bool DYNAMIC_FEATURES = false;   // Branch on uniform values instead (for comparison)
+layout(constant_id = 4) const bool VIRTUAL_TEXTURE  = false;   // Sample the virtual texture instead of set 1
+
 layout(location = 0) out vec4 outColour;     // Final output colour (must also have location
 
+#if VIRTUAL_TEXTURE_FEEDBACK
+uvec2 getPages(uint mipLevel)
+{
+    return max(pageTable.pages >> mipLevel, uvec2(1));
+}
+
+vec4 sampleVirtualTexture(vec2 uv)
+{
+    uv = fract(uv);
+
+    // Level with about one texel per pixel, rounded down so it is never blurrier than a normal mip chain
+    vec2  texel = uv * vec2(pageTable.pages) * PAGE_SIZE;
+    vec2  dx    = dFdx(texel);
+    vec2  dy    = dFdy(texel);
+    float lod   = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    uint  mip   = uint(clamp(floor(lod), 0.0, float(pageTable.mipCount - 1)));
+
+    // Ask for the page, checking first so each page only costs one atomic per warp or so
+    uvec2 pages = getPages(mip);
+    uvec2 page  = min(uvec2(uv * vec2(pages)), pages - 1);
+    uint  index = pageTable.mipOffsets[mip] + page.y * pages.x + page.x;
+    uint  bit   = 1u << (index & 31u);
+    if ((feedback.requested[index >> 5] & bit) == 0u)
+    {
+        atomicOr(feedback.requested[index >> 5], bit);
+    }
+
+    // Sample whatever is resident, at the level of the page actually found
+    uint  entry         = pageTable.entries[index];
+    uvec2 slot          = uvec2(entry & 0xFFFu, (entry >> 12) & 0xFFFu);
+    vec2  residentPages = vec2(getPages(entry >> 24));
+    vec2  inPage        = uv * residentPages - floor(uv * residentPages);
+    vec2  cacheTexel    = vec2(slot) * (PAGE_SIZE + 2.0 * PAGE_BORDER) + PAGE_BORDER + inPage * PAGE_SIZE;
+    return textureLod(pageCache, cacheTexel / vec2(textureSize(pageCache, 0)), 0.0);
+}
+#endif
+
 void main() {
-    outColour = texture(textureSampler, fragTex);
-    
+    bool vertexColour = VERTEX_COLOUR;
+    bool alphaTest    = ALPHA_TEST;
+    int  textureCount = TEXTURE_COUNT;
+    bool virtualTex   = VIRTUAL_TEXTURE;
+    if (DYNAMIC_FEATURES)
+    {
+        vertexColour = uboViewProjection.shaderFeatures.x != 0;
+        alphaTest    = uboViewProjection.shaderFeatures.y != 0;
+        textureCount = int(uboViewProjection.shaderFeatures.z);
+        virtualTex   = uboViewProjection.shaderFeatures.w != 0;
+    }
+
+#if VIRTUAL_TEXTURE_FEEDBACK
+    vec4 colour = virtualTex ? sampleVirtualTexture(fragTex) :
+                  textureCount > 0 ? texture(textureSampler, fragTex) : vec4(fragCol, 1.0);
+#else
+    vec4 colour = textureCount > 0 ? texture(textureSampler, fragTex) : vec4(fragCol, 1.0);
+#endif
+    if (vertexColour)
+    {
+        colour.rgb *= fragCol;
+    }
+    if (alphaTest && colour.a < 0.5)
+    {
+        discard;
+    }
+
+    outColour = colour;
 }
@@ -7,8 +7,9 @@ layout(location = 2) in vec2 tex;
 // These two bindings are part of the same descriptor set.
 layout(set = 0, binding=0) uniform UboViewProjection
 {
-    mat4 projection;
-    mat4 view;
+    mat4  projection;
+    mat4  view;
+    uvec4 shaderFeatures;   // Read by the fragment shader
 } uboViewProjection;
 
 layout(set = 0, binding=1) uniform UboModel